@@ -0,0 +1,234 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <new>
+#include <stdlib.h>
+
+#include "AllocCount.hh"
+
+#if __cplusplus >= 201103L
+#define WF_THROWS_BAD_ALLOC
+#define WF_NO_THROW             noexcept
+#else
+#define WF_THROWS_BAD_ALLOC     throw(std::bad_alloc)
+#define WF_NO_THROW             throw()
+#endif
+
+static bool               enabled = false;
+static __thread uint64_t  thread_allocations;   // Zero for a new thread
+static __thread uint64_t  thread_bytes;
+
+///////////////////////////////////////////////////////////////////////
+// note(size_t bytes)
+//
+// Parameters:  bytes       - Asked for by the current thread
+///////////////////////////////////////////////////////////////////////
+static inline void
+note(size_t bytes)
+{
+    if (enabled) {
+        thread_allocations++;
+        thread_bytes += bytes;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// enable()
+//
+// Starts counting. Call it before any threads are started.
+///////////////////////////////////////////////////////////////////////
+void
+AllocCount::enable()
+{
+    enabled = true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// isEnabled()
+//
+// Returns: True once enable() has been called
+///////////////////////////////////////////////////////////////////////
+bool
+AllocCount::isEnabled()
+{
+    return enabled;
+}
+
+///////////////////////////////////////////////////////////////////////
+// get()
+//
+// Returns: What the calling thread has allocated since enable()
+///////////////////////////////////////////////////////////////////////
+AllocCount::Counts
+AllocCount::get()
+{
+    Counts counts;
+
+    counts.allocations = thread_allocations;
+    counts.bytes       = thread_bytes;
+    return counts;
+}
+
+///////////////////////////////////////////////////////////////////////
+// since(const Counts &start)
+//
+// Parameters:  start       - An earlier get() on the same thread
+//
+// Returns: What the calling thread has allocated since then
+///////////////////////////////////////////////////////////////////////
+AllocCount::Counts
+AllocCount::since(const Counts &start)
+{
+    Counts counts = get();
+
+    counts.allocations -= start.allocations;
+    counts.bytes       -= start.bytes;
+    return counts;
+}
+
+///////////////////////////////////////////////////////////////////////
+// The malloc family. Qt allocates its containers' storage with
+// qMalloc(), which is malloc(), so counting only operator new would
+// miss most of what it does. glibc's own functions are still there
+// under other names for hooks like these to call.
+///////////////////////////////////////////////////////////////////////
+#ifdef __GLIBC__
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *memory, size_t size);
+
+void *
+malloc(size_t size)
+{
+    note(size);
+    return __libc_malloc(size);
+}
+
+void *
+calloc(size_t count, size_t size)
+{
+    note(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *
+realloc(void *memory, size_t size)
+{
+    note(size);
+    return __libc_realloc(memory, size);
+}
+
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// operator new(size_t size)
+//
+// The standard behaviour: keep calling the new handler until there is
+// memory, or throw if there is none. With glibc the allocation is
+// counted by malloc() instead, so it is not counted twice.
+///////////////////////////////////////////////////////////////////////
+void *
+operator new(size_t size) WF_THROWS_BAD_ALLOC
+{
+#ifndef __GLIBC__
+    note(size);
+#endif
+
+    for (;;) {
+        void *memory = malloc(size > 0 ? size : 1);
+
+        if (memory)
+            return memory;
+
+        std::new_handler handler = std::set_new_handler(0);
+
+        std::set_new_handler(handler);
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void *
+operator new[](size_t size) WF_THROWS_BAD_ALLOC
+{
+    return operator new(size);
+}
+
+void *
+operator new(size_t size, const std::nothrow_t &) WF_NO_THROW
+{
+    try {
+        return operator new(size);
+    } catch (...) {
+        return 0;
+    }
+}
+
+void *
+operator new[](size_t size, const std::nothrow_t &) WF_NO_THROW
+{
+    try {
+        return operator new(size);
+    } catch (...) {
+        return 0;
+    }
+}
+
+void
+operator delete(void *memory) WF_NO_THROW
+{
+    free(memory);
+}
+
+void
+operator delete[](void *memory) WF_NO_THROW
+{
+    free(memory);
+}
+
+void
+operator delete(void *memory, const std::nothrow_t &) WF_NO_THROW
+{
+    free(memory);
+}
+
+void
+operator delete[](void *memory, const std::nothrow_t &) WF_NO_THROW
+{
+    free(memory);
+}
+
+#if __cplusplus >= 201402L
+void
+operator delete(void *memory, size_t) WF_NO_THROW
+{
+    free(memory);
+}
+
+void
+operator delete[](void *memory, size_t) WF_NO_THROW
+{
+    free(memory);
+}
+#endif
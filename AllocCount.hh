@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_ALLOCCOUNT_HH
+#define WF_ALLOCCOUNT_HH
+
+///////////////////////////////////////////////////////////////////////
+// AllocCount.hh
+//
+// This file contains the declarations for the AllocCount class, which
+// counts how often each thread asks for heap memory.
+///////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////
+// AllocCount
+//
+// AllocCount.cc replaces the global operator new, and with glibc also
+// malloc, calloc, and realloc, so that it sees Qt's containers and
+// images as well as our own objects. Each thread has its own counts,
+// so taking them costs no locking. Nothing is counted until enable()
+// is called; until then the hooks only pass the memory along.
+///////////////////////////////////////////////////////////////////////
+class AllocCount
+{
+public:
+    struct Counts
+    {
+        uint64_t    allocations;
+        uint64_t    bytes;
+    };
+
+    static void     enable();
+    static bool     isEnabled();
+    static Counts   get();                      // This thread's so far
+    static Counts   since(const Counts &start); // This thread's since start
+};
+
+#endif
@@ -0,0 +1,186 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QCoreApplication>
+#include <iostream>
+
+#include "AnimationClock.hh"
+#include "Search.hh"
+
+///////////////////////////////////////////////////////////////////////
+// instance()
+//
+// Returns: The one clock, made the first time it is asked for and
+// deleted along with the application
+///////////////////////////////////////////////////////////////////////
+AnimationClock *
+AnimationClock::instance()
+{
+    static AnimationClock *clock = new AnimationClock(qApp);
+
+    return clock;
+}
+
+///////////////////////////////////////////////////////////////////////
+// now()
+//
+// Returns: The time animations are measured in, in microseconds
+///////////////////////////////////////////////////////////////////////
+int64_t
+AnimationClock::now()
+{
+    return Search::monotonicMicros();
+}
+
+///////////////////////////////////////////////////////////////////////
+// AnimationClock(QObject *parent)
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+AnimationClock::AnimationClock(QObject *parent) :
+    QObject(parent),
+    enabled(true),
+    last_tick(0),
+    frames(0),
+    total_micros(0),
+    worst_micros(0)
+{
+    for (int i = 0; i < BUCKETS; ++i)
+        histogram[i] = 0;
+
+    timer.setInterval(FRAME_MICROS / 1000);
+    connect(&timer, SIGNAL(timeout()), this, SLOT(tick()));
+}
+
+///////////////////////////////////////////////////////////////////////
+// start(Animated *animated)
+//
+// Parameters:  Animated    *animated   Something to animate, which is
+//                                      only added once however often
+//                                      it is started
+///////////////////////////////////////////////////////////////////////
+void
+AnimationClock::start(Animated *animated)
+{
+    if (!enabled || running.contains(animated))
+        return;
+
+    running.append(animated);
+    if (!timer.isActive()) {
+        last_tick = 0;
+        timer.start();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// stop(Animated *animated)
+//
+// Parameters:  Animated    *animated   Something that should not be
+//                                      animated any more, such as a
+//                                      widget being deleted
+///////////////////////////////////////////////////////////////////////
+void
+AnimationClock::stop(Animated *animated)
+{
+    int index = running.indexOf(animated);
+
+    if (index >= 0)
+        running[index] = 0;             // Removed by the next tick
+}
+
+///////////////////////////////////////////////////////////////////////
+// setEnabled(bool enabled)
+//
+// Parameters:  bool        enabled     False to show everything at once,
+//                                      as when nobody is watching
+///////////////////////////////////////////////////////////////////////
+void
+AnimationClock::setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+}
+
+///////////////////////////////////////////////////////////////////////
+// isEnabled()
+//
+// Returns: False if animations should jump straight to their end
+///////////////////////////////////////////////////////////////////////
+bool
+AnimationClock::isEnabled() const
+{
+    return enabled;
+}
+
+///////////////////////////////////////////////////////////////////////
+// tick()
+//
+// Moves every animation along one frame, dropping the ones that have
+// finished, and notes how long it has been since the last frame.
+///////////////////////////////////////////////////////////////////////
+void
+AnimationClock::tick()
+{
+    int64_t time = now();
+
+    if (last_tick != 0) {
+        int64_t micros = time - last_tick;
+        int     bucket = int((micros + FRAME_MICROS / 2) / FRAME_MICROS);
+
+        histogram[qBound(0, bucket - 1, BUCKETS - 1)]++;
+        frames++;
+        total_micros += micros;
+        worst_micros  = qMax(worst_micros, micros);
+    }
+    last_tick = time;
+
+    // Animations may be stopped by the ones before them, which leaves
+    // a hole rather than moving the rest
+    int kept = 0;
+
+    for (int i = 0; i < running.size(); ++i) {
+        if (running[i] && running[i]->animate(time))
+            running[kept++] = running[i];
+    }
+    running.resize(kept);
+
+    if (running.isEmpty())
+        timer.stop();
+}
+
+///////////////////////////////////////////////////////////////////////
+// printReport()
+//
+// Writes the frame time histogram to stderr
+///////////////////////////////////////////////////////////////////////
+void
+AnimationClock::printReport() const
+{
+    std::cerr << "frames: " << frames;
+    if (frames > 0)
+        std::cerr << ", mean " << total_micros / int64_t(frames) / 1000.0
+                  << " ms, worst " << worst_micros / 1000.0 << " ms";
+    std::cerr << "\n";
+
+    for (int i = 0; i < BUCKETS; ++i) {
+        std::cerr << "    " << i + 1 << (i == BUCKETS - 1 ? "+" : " ")
+                  << " frame" << (i == 0 ? " " : "s") << " "
+                  << histogram[i] << "\n";
+    }
+}
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_ANIMATIONCLOCK_HH
+#define WF_ANIMATIONCLOCK_HH
+
+///////////////////////////////////////////////////////////////////////
+// AnimationClock.hh
+//
+// This file contains the declarations for the Animated interface and
+// the AnimationClock class, which drives every animation in the game
+// from one timer.
+///////////////////////////////////////////////////////////////////////
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////
+// Animated
+//
+// Something the clock can move along. animate() is called once a
+// frame with the time in microseconds; it should work out where the
+// animation has got to, ask for a repaint of just what moved, and
+// return false once it has finished.
+///////////////////////////////////////////////////////////////////////
+class Animated
+{
+public:
+    virtual ~Animated() {}
+    virtual bool animate(int64_t now) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////
+// AnimationClock
+//
+// One timer for every animation, rather than one per widget, so all
+// of them step together and there is nothing to wake up for when none
+// are running. The timer only runs while something is animating.
+//
+// The time between frames is kept in a histogram counted in frames at
+// 60 per second: a frame that took twice as long as it should have is
+// counted under 2, and so on.
+///////////////////////////////////////////////////////////////////////
+class AnimationClock : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum {
+        FRAME_MICROS = 16667,                   // 60 frames per second
+        BUCKETS      = 8                        // Last is that or more
+    };
+
+    static AnimationClock *instance();
+    static int64_t  now();
+
+    void        start(Animated *animated);
+    void        stop(Animated *animated);
+    void        setEnabled(bool enabled);
+    bool        isEnabled() const;
+    void        printReport() const;            // To stderr
+
+private slots:
+    void        tick();
+
+private:
+    AnimationClock(QObject *parent);
+
+    QTimer              timer;
+    QVector<Animated *> running;
+    bool                enabled;
+    int64_t             last_tick;              // 0 when just started
+
+    quint64             histogram[BUCKETS];     // Frames by length
+    quint64             frames;
+    int64_t             total_micros;
+    int64_t             worst_micros;
+};
+
+#endif
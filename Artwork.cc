@@ -0,0 +1,149 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include "Artwork.hh"
+
+// The pictures, in a function so the pixmaps are not made before the
+// QApplication, which Qt does not allow
+struct Cache
+{
+    Cache() : size(Artwork::BASE_SIZE), rasterized(0) {}
+
+    QPixmap     originals[Artwork::PICTURES];   // As loaded
+    QPixmap     scaled[Artwork::PIECES];        // At size
+    int         size;
+    int         rasterized;
+};
+
+static Cache &
+cache()
+{
+    static Cache pictures;
+
+    return pictures;
+}
+
+///////////////////////////////////////////////////////////////////////
+// get(Picture picture, int size)
+//
+// Parameters:  Picture     picture     Which picture
+//              int         size        Width and height wanted, for
+//                                      EMPTY, X, and O
+//
+// Returns: The picture at that size. A QPixmap copy only takes a
+// reference, so callers may keep what they are given.
+///////////////////////////////////////////////////////////////////////
+const QPixmap &
+Artwork::get(Picture picture, int size)
+{
+    QPixmap *originals = cache().originals;
+    QPixmap *scaled    = cache().scaled;
+
+    if (originals[picture].isNull())
+        originals[picture].load(QString(":/images/") + fileName(picture));
+
+    if (picture >= PIECES || size == BASE_SIZE || size < 1)
+        return originals[picture];
+
+    // A new size means the spaces were resized, and the old pictures
+    // will not be wanted again
+    if (size != cache().size) {
+        for (int i = 0; i < PIECES; ++i)
+            scaled[i] = QPixmap();
+        cache().size = size;
+    }
+
+    if (scaled[picture].isNull()) {
+        scaled[picture] = originals[picture].scaled(size, size,
+                                                    Qt::KeepAspectRatio,
+                                                    Qt::SmoothTransformation);
+        cache().rasterized++;
+    }
+    return scaled[picture];
+}
+
+///////////////////////////////////////////////////////////////////////
+// fileName(Picture picture)
+//
+// Returns: The name of the picture's file, the same in xsnos.qrc and in
+// every theme pack
+///////////////////////////////////////////////////////////////////////
+const char *
+Artwork::fileName(Picture picture)
+{
+    static const char *file_names[PICTURES] = {
+        "empty.png", "x.png", "o.png",
+        "x_turn.png", "o_turn.png",
+        "x_wins.png", "o_wins.png", "draw.png",
+        "title.png", "new_game.png", "undo.png", "quit.png"
+    };
+
+    return file_names[picture];
+}
+
+///////////////////////////////////////////////////////////////////////
+// install(const QImage *images, const QImage *pieces, int size)
+//
+// Parameters:  images      - Every picture, PICTURES of them, at the
+//                            size they were drawn
+//              pieces      - EMPTY, X, and O already scaled to size
+//              size        - The size pieces were scaled to
+//
+// Replaces every picture at once. A picture that is missing falls back
+// to the built in one the next time it is asked for, and pieces that
+// were not scaled are scaled then.
+///////////////////////////////////////////////////////////////////////
+void
+Artwork::install(const QImage *images, const QImage *pieces, int size)
+{
+    Cache &pictures = cache();
+
+    for (int i = 0; i < PICTURES; ++i)
+        pictures.originals[i] = QPixmap::fromImage(images[i]);
+
+    for (int i = 0; i < PIECES; ++i) {
+        pictures.scaled[i] = size == BASE_SIZE ? QPixmap()
+                                               : QPixmap::fromImage(pieces[i]);
+    }
+    pictures.size = size;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getSize()
+//
+// Returns: The size the scaled pictures are kept at
+///////////////////////////////////////////////////////////////////////
+int
+Artwork::getSize()
+{
+    return cache().size;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getRasterized()
+//
+// Returns: How many times a picture has been scaled, to check that
+// painting never does it
+///////////////////////////////////////////////////////////////////////
+int
+Artwork::getRasterized()
+{
+    return cache().rasterized;
+}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_ARTWORK_HH
+#define WF_ARTWORK_HH
+
+///////////////////////////////////////////////////////////////////////
+// Artwork.hh
+//
+// This file contains the declarations for the Artwork class, which
+// keeps the pictures the game is drawn with, the board and pieces at
+// the size they are shown.
+///////////////////////////////////////////////////////////////////////
+
+#include <QImage>
+#include <QPixmap>
+
+///////////////////////////////////////////////////////////////////////
+// Artwork
+//
+// The pictures are drawn for BASE_SIZE spaces. Any other size is
+// scaled from them once, smoothly, the first time it is asked for,
+// and kept until a different size is asked for, so painting a space
+// or a piece is always a plain copy of pixels. Only one size is kept
+// at a time: every space and piece is the same size, and changing it
+// throws the old pictures away rather than letting them pile up.
+//
+// The pictures come from the images built in through xsnos.qrc until
+// a Theme installs others. install() swaps every picture at once, from
+// images already decoded and scaled on another thread, so the only
+// work left for the GUI thread is turning them into pixmaps. The old
+// theme's pictures are let go of as soon as nothing shows them.
+//
+// Pixmaps only work on the GUI thread, so this does too.
+///////////////////////////////////////////////////////////////////////
+class Artwork
+{
+public:
+    enum Picture {
+        EMPTY, X, O,                            // Same order as GameSpace
+        X_TURN, O_TURN,                         // Whose turn it is
+        X_WINS, O_WINS, DRAW,                   // How the game ended
+        TITLE, NEW_GAME, UNDO, QUIT,
+        PICTURES
+    };
+
+    enum {
+        PIECES    = O + 1,                      // Scaled to the spaces
+        BASE_SIZE = 60                          // What the PNGs are drawn at
+    };
+
+    static const QPixmap &get(Picture picture, int size = BASE_SIZE);
+    static const char *fileName(Picture picture);
+    static void     install(const QImage *images, const QImage *pieces,
+                            int size);
+    static int      getSize();                  // What is kept now
+    static int      getRasterized();            // Pictures scaled so far
+};
+
+#endif
@@ -0,0 +1,521 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#include "Board.hh"
+
+///////////////////////////////////////////////////////////////////////
+// zobristKey(int index, Board::Cell player)
+//
+// Parameters:  int         index       Cell the piece is on
+//              Board::Cell player      X or O
+//
+// Returns: A fixed pseudo random key for a piece on a cell. This is
+// the splitmix64 mixer, so the keys are the same in every process and
+// every file written with them.
+///////////////////////////////////////////////////////////////////////
+static uint64_t
+zobristKey(int index, Board::Cell player)
+{
+    uint64_t z = (uint64_t(index) * 2 + uint64_t(player))
+                 * 0x9E3779B97F4A7C15ULL + 0x9E3779B97F4A7C15ULL;
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+///////////////////////////////////////////////////////////////////////
+// Board(int rows, int cols, int win_length)
+//
+// Parameters:  int     rows        - Rows on the board
+//              int     cols        - Columns on the board
+//              int     win_length  - How many in a row wins
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+Board::Board(int rows, int cols, int win_length) :
+    rows(rows),
+    cols(cols),
+    win_length(win_length),
+    symmetry_count(rows == cols ? 8 : 4),
+    cells(rows * cols, EMPTY),
+    line_count(0),
+    open_lines(0)
+{
+    buildLines();
+    buildSymmetries();
+    clear();
+}
+
+///////////////////////////////////////////////////////////////////////
+// Getters
+///////////////////////////////////////////////////////////////////////
+int
+Board::getRows() const
+{
+    return rows;
+}
+
+int
+Board::getCols() const
+{
+    return cols;
+}
+
+int
+Board::getWinLength() const
+{
+    return win_length;
+}
+
+int
+Board::getCellCount() const
+{
+    return rows * cols;
+}
+
+Board::Cell
+Board::getCell(int row, int col) const
+{
+    return Cell(cells[row * cols + col]);
+}
+
+int
+Board::getSymmetryCount() const
+{
+    return symmetry_count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// clear()
+//
+// Empties the board.
+///////////////////////////////////////////////////////////////////////
+void
+Board::clear()
+{
+    for (int i = 0; i < getCellCount(); ++i)
+        cells[i] = EMPTY;
+
+    for (int i = 0; i < line_count; ++i) {
+        line_x[i] = 0;
+        line_o[i] = 0;
+    }
+
+    pieces[EMPTY] = getCellCount();
+    pieces[X]     = 0;
+    pieces[O]     = 0;
+
+    open_lines    = line_count;
+    full_lines[X] = 0;
+    full_lines[O] = 0;
+
+    for (int s = 0; s < MAX_SYMMETRIES; ++s) {
+        ranks[s]  = 0;
+        hashes[s] = 0;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// place(int index, Cell player)
+//
+// Parameters:  int     index       - The cell to play on, which must
+//                                    be EMPTY
+//              Cell    player      - X or O
+//
+// Puts a piece on the board and updates every line through it.
+///////////////////////////////////////////////////////////////////////
+void
+Board::place(int index, Cell player)
+{
+    const std::vector<int> &through = lines_through[index];
+
+    cells[index] = player;
+    pieces[EMPTY]--;
+    pieces[player]++;
+
+    for (unsigned i = 0; i < through.size(); ++i) {
+        int line = through[i];
+
+        if (player == X) {
+            if (line_x[line] == 0 && line_o[line] > 0)
+                open_lines--;
+            if (++line_x[line] == win_length)
+                full_lines[X]++;
+        } else {
+            if (line_o[line] == 0 && line_x[line] > 0)
+                open_lines--;
+            if (++line_o[line] == win_length)
+                full_lines[O]++;
+        }
+    }
+
+    for (int s = 0; s < symmetry_count; ++s) {
+        int mapped = symmetry_map[s * getCellCount() + index];
+
+        if (isRankable())
+            ranks[s] += uint64_t(player) * powers[mapped];
+        hashes[s] ^= zobristKey(mapped, player);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// remove(int index)
+//
+// Parameters:  int     index       - A cell holding an X or an O
+//
+// Takes a piece back off the board. This is the exact reverse of
+// place(), so a search can play and unplay moves freely.
+///////////////////////////////////////////////////////////////////////
+void
+Board::remove(int index)
+{
+    const std::vector<int> &through = lines_through[index];
+    Cell player = Cell(cells[index]);
+
+    for (unsigned i = 0; i < through.size(); ++i) {
+        int line = through[i];
+
+        if (player == X) {
+            if (line_x[line]-- == win_length)
+                full_lines[X]--;
+            if (line_x[line] == 0 && line_o[line] > 0)
+                open_lines++;
+        } else {
+            if (line_o[line]-- == win_length)
+                full_lines[O]--;
+            if (line_o[line] == 0 && line_x[line] > 0)
+                open_lines++;
+        }
+    }
+
+    for (int s = 0; s < symmetry_count; ++s) {
+        int mapped = symmetry_map[s * getCellCount() + index];
+
+        if (isRankable())
+            ranks[s] -= uint64_t(player) * powers[mapped];
+        hashes[s] ^= zobristKey(mapped, player);
+    }
+
+    cells[index] = EMPTY;
+    pieces[player]--;
+    pieces[EMPTY]++;
+}
+
+///////////////////////////////////////////////////////////////////////
+// completesLine(int index, Cell player)
+//
+// Parameters:  int     index       - An EMPTY cell
+//              Cell    player      - X or O
+//
+// Returns: True if playing player on index would win the game
+///////////////////////////////////////////////////////////////////////
+bool
+Board::completesLine(int index, Cell player) const
+{
+    const std::vector<int> &through = lines_through[index];
+
+    for (unsigned i = 0; i < through.size(); ++i) {
+        int line = through[i];
+
+        if (player == X && line_x[line] == win_length - 1 && line_o[line] == 0)
+            return true;
+        if (player == O && line_o[line] == win_length - 1 && line_x[line] == 0)
+            return true;
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getLineCount()
+//
+// Returns: How many runs of win_length cells there are on the board
+///////////////////////////////////////////////////////////////////////
+int
+Board::getLineCount() const
+{
+    return line_count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getLinePieces(int line, Cell player)
+//
+// Parameters:  int     line        - Which line
+//              Cell    player      - X or O
+//
+// Returns: How many of player's pieces are on the line
+///////////////////////////////////////////////////////////////////////
+int
+Board::getLinePieces(int line, Cell player) const
+{
+    return player == X ? line_x[line] : line_o[line];
+}
+
+///////////////////////////////////////////////////////////////////////
+// getLineCells(int line)
+//
+// Returns: The win_length cells making up a line, in order along it
+///////////////////////////////////////////////////////////////////////
+const int *
+Board::getLineCells(int line) const
+{
+    return &line_cells[line * win_length];
+}
+
+///////////////////////////////////////////////////////////////////////
+// getLinesThrough(int index)
+//
+// Returns: The lines that run through a cell
+///////////////////////////////////////////////////////////////////////
+const std::vector<int> &
+Board::getLinesThrough(int index) const
+{
+    return lines_through[index];
+}
+
+///////////////////////////////////////////////////////////////////////
+// mapCell(int symmetry, int index)
+//
+// Parameters:  int     symmetry    - Which rotation or reflection
+//              int     index       - A cell
+//
+// Returns: Where the cell ends up after the board is transformed
+///////////////////////////////////////////////////////////////////////
+int
+Board::mapCell(int symmetry, int index) const
+{
+    return symmetry_map[symmetry * getCellCount() + index];
+}
+
+///////////////////////////////////////////////////////////////////////
+// isRankable()
+//
+// Returns: True if the board is small enough for rank() to be exact
+///////////////////////////////////////////////////////////////////////
+bool
+Board::isRankable() const
+{
+    return getCellCount() <= MAX_RANK_CELLS;
+}
+
+///////////////////////////////////////////////////////////////////////
+// rank()
+//
+// Returns: The position as a base 3 number, cell 0 being the lowest
+// digit. Only meaningful when isRankable().
+///////////////////////////////////////////////////////////////////////
+uint64_t
+Board::rank() const
+{
+    return ranks[0];
+}
+
+///////////////////////////////////////////////////////////////////////
+// canonicalRank()
+//
+// Returns: The smallest rank of all the rotations and reflections of
+// the position, so equivalent positions share one number.
+///////////////////////////////////////////////////////////////////////
+uint64_t
+Board::canonicalRank() const
+{
+    uint64_t best = ranks[0];
+
+    for (int s = 1; s < symmetry_count; ++s) {
+        if (ranks[s] < best)
+            best = ranks[s];
+    }
+    return best;
+}
+
+///////////////////////////////////////////////////////////////////////
+// hash()
+//
+// Returns: The Zobrist hash of the position
+///////////////////////////////////////////////////////////////////////
+uint64_t
+Board::hash() const
+{
+    return hashes[0];
+}
+
+///////////////////////////////////////////////////////////////////////
+// canonicalHash()
+//
+// Returns: The smallest hash of all the rotations and reflections of
+// the position. Works for boards too big to rank.
+///////////////////////////////////////////////////////////////////////
+uint64_t
+Board::canonicalHash() const
+{
+    uint64_t best = hashes[0];
+
+    for (int s = 1; s < symmetry_count; ++s) {
+        if (hashes[s] < best)
+            best = hashes[s];
+    }
+    return best;
+}
+
+///////////////////////////////////////////////////////////////////////
+// toString()
+//
+// Returns: The board row by row, one of 'X', 'O', or '.' per cell
+///////////////////////////////////////////////////////////////////////
+std::string
+Board::toString() const
+{
+    std::string out(getCellCount(), '.');
+
+    for (int i = 0; i < getCellCount(); ++i) {
+        if (cells[i] == X)
+            out[i] = 'X';
+        else if (cells[i] == O)
+            out[i] = 'O';
+    }
+    return out;
+}
+
+///////////////////////////////////////////////////////////////////////
+// fromString(const std::string &text)
+//
+// Parameters:  text        - One character per cell, row by row.
+//                            X and O are pieces, '.', '-', and '_'
+//                            are empty cells.
+//
+// Returns: False if the text does not describe a board of this size.
+// The board is left unchanged in that case.
+///////////////////////////////////////////////////////////////////////
+bool
+Board::fromString(const std::string &text)
+{
+    if (int(text.size()) != getCellCount())
+        return false;
+
+    for (unsigned i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c != 'X' && c != 'x' && c != 'O' && c != 'o'
+                && c != '.' && c != '-' && c != '_')
+            return false;
+    }
+
+    clear();
+    for (unsigned i = 0; i < text.size(); ++i) {
+        if (text[i] == 'X' || text[i] == 'x')
+            place(i, X);
+        else if (text[i] == 'O' || text[i] == 'o')
+            place(i, O);
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// rankCount(int cells)
+//
+// Parameters:  int     cells       - Cells on a board
+//
+// Returns: 3^cells, the number of ranks a board of that size has
+///////////////////////////////////////////////////////////////////////
+uint64_t
+Board::rankCount(int cells)
+{
+    uint64_t count = 1;
+
+    for (int i = 0; i < cells; ++i)
+        count *= 3;
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// buildLines()
+//
+// Finds every run of win_length cells across, down, and along both
+// diagonals. On a 3x3 board these are the 8 lines checkXWin() looks at.
+///////////////////////////////////////////////////////////////////////
+void
+Board::buildLines()
+{
+    static const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+    lines_through.assign(getCellCount(), std::vector<int>());
+    line_cells.clear();
+
+    for (int d = 0; d < 4; ++d) {
+        int dr = directions[d][0];
+        int dc = directions[d][1];
+
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                int end_r = r + dr * (win_length - 1);
+                int end_c = c + dc * (win_length - 1);
+
+                if (end_r < 0 || end_r >= rows || end_c < 0 || end_c >= cols)
+                    continue;
+
+                for (int i = 0; i < win_length; ++i) {
+                    int index = (r + dr * i) * cols + (c + dc * i);
+                    line_cells.push_back(index);
+                    lines_through[index].push_back(line_count);
+                }
+                line_count++;
+            }
+        }
+    }
+
+    line_x.assign(line_count, 0);
+    line_o.assign(line_count, 0);
+}
+
+///////////////////////////////////////////////////////////////////////
+// buildSymmetries()
+//
+// Works out where every cell goes under each rotation and reflection.
+// Square boards have 8 of these, other boards only have 4.
+///////////////////////////////////////////////////////////////////////
+void
+Board::buildSymmetries()
+{
+    int n = getCellCount();
+
+    symmetry_map.assign(symmetry_count * n, 0);
+
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            int from   = r * cols + c;
+            int fr     = rows - 1 - r;          // Flipped row
+            int fc     = cols - 1 - c;          // Flipped column
+
+            symmetry_map[0 * n + from] = r  * cols + c;
+            symmetry_map[1 * n + from] = r  * cols + fc;
+            symmetry_map[2 * n + from] = fr * cols + c;
+            symmetry_map[3 * n + from] = fr * cols + fc;
+
+            if (symmetry_count == 8) {
+                symmetry_map[4 * n + from] = c  * cols + r;
+                symmetry_map[5 * n + from] = c  * cols + fr;
+                symmetry_map[6 * n + from] = fc * cols + r;
+                symmetry_map[7 * n + from] = fc * cols + fr;
+            }
+        }
+    }
+
+    powers.assign(n, 1);
+    for (int i = 1; i < n && i < MAX_RANK_CELLS; ++i)
+        powers[i] = powers[i - 1] * 3;
+}
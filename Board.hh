@@ -0,0 +1,209 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#ifndef WF_BOARD_HH
+#define WF_BOARD_HH
+
+///////////////////////////////////////////////////////////////////////
+// Board.hh
+//
+// This file contains the declarations for the Board class. A Board is
+// a tictactoe board without any widgets attached to it, so it can be
+// used by solvers and tools. It knows the same rules as MainWindow's
+// checkXWin(), checkOWin(), and checkDraw(), but for any number of
+// rows and columns and any length of line.
+///////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////
+// Board
+//
+// A rows x cols board where a player wins with win_length in a row.
+// The draw rule is the early one used by checkDraw(): the game is a
+// draw as soon as every possible line holds both an X and an O.
+//
+// Everything the rules need is kept up to date as pieces are placed
+// and removed, so asking for a winner or a draw never rescans the
+// board.
+///////////////////////////////////////////////////////////////////////
+class Board
+{
+public:
+    enum Cell {EMPTY, X, O};                    // Same order as GameSpace
+
+    enum {
+        MAX_CELLS      = 256,                   // Biggest board we allow
+        MAX_RANK_CELLS = 40,                    // 3^40 still fits 64 bits
+        MAX_SYMMETRIES = 8                      // Rotations and reflections
+    };
+
+    Board(int rows = 3, int cols = 3, int win_length = 3);
+
+    int         getRows() const;
+    int         getCols() const;
+    int         getWinLength() const;
+    int         getCellCount() const;
+    Cell        getCell(int index) const;
+    Cell        getCell(int row, int col) const;
+    int         getPieceCount(Cell player) const;
+    int         getMoveCount() const;
+
+    void        clear();
+    void        place(int index, Cell player);  // Put a piece down
+    void        remove(int index);              // Take a piece back
+
+    bool        hasLine(Cell player) const;     // checkXWin()/checkOWin()
+    bool        isBlocked() const;              // checkDraw()
+    bool        isOver() const;                 // Won or drawn
+    bool        completesLine(int index, Cell player) const;
+    Cell        toMove() const;                 // X moves first
+
+    int         getLineCount() const;           // Possible winning lines
+    int         getLinePieces(int line, Cell player) const;
+    const int  *getLineCells(int line) const;
+    const std::vector<int> &getLinesThrough(int index) const;
+
+    int         getSymmetryCount() const;
+    int         mapCell(int symmetry, int index) const;
+    bool        isRankable() const;             // Small enough to rank
+    uint64_t    rank() const;                   // Base 3 position number
+    uint64_t    canonicalRank() const;          // Smallest symmetric rank
+    uint64_t    hash() const;                   // Zobrist hash
+    uint64_t    canonicalHash() const;          // Smallest symmetric hash
+
+    std::string toString() const;               // One char per cell
+    bool        fromString(const std::string &cells);
+
+    static Cell opponent(Cell player);
+    static uint64_t rankCount(int cells);       // 3^cells
+
+private:
+    void        buildLines();
+    void        buildSymmetries();
+
+    int                         rows;           // Rows on the board
+    int                         cols;           // Columns on the board
+    int                         win_length;     // Pieces needed in a row
+    int                         symmetry_count; // 8 if square, else 4
+    std::vector<unsigned char>  cells;          // Current contents
+    int                         pieces[3];      // Pieces of each kind
+
+    // Every possible winning line, win_length cells each, and the lines
+    // running through each cell.
+    std::vector<int>                line_cells;
+    std::vector< std::vector<int> > lines_through;
+    std::vector<unsigned char>      line_x;     // Xs on each line
+    std::vector<unsigned char>      line_o;     // Os on each line
+    int                             line_count;
+    int                             open_lines; // Lines missing an X or O
+    int                             full_lines[3]; // Lines owned outright
+
+    // symmetry_map[s * cell_count + i] is where cell i goes under s
+    std::vector<int>            symmetry_map;
+    std::vector<uint64_t>       powers;         // 3^i for each cell
+    uint64_t                    ranks[MAX_SYMMETRIES];
+    uint64_t                    hashes[MAX_SYMMETRIES];
+};
+
+// What follows is asked at every node of every search, and is what the
+// rule policies in Rules.hh are made of, so it is defined here where
+// the compiler can inline it into each policy.
+
+inline Board::Cell
+Board::getCell(int index) const
+{
+    return Cell(cells[index]);
+}
+
+inline int
+Board::getPieceCount(Cell player) const
+{
+    return pieces[player];
+}
+
+inline int
+Board::getMoveCount() const
+{
+    return pieces[X] + pieces[O];
+}
+
+///////////////////////////////////////////////////////////////////////
+// hasLine(Cell player)
+//
+// Parameters:  Cell    player      - X or O
+//
+// Returns: True if player has win_length in a row anywhere. This is
+// checkXWin() and checkOWin() for any size of board.
+///////////////////////////////////////////////////////////////////////
+inline bool
+Board::hasLine(Cell player) const
+{
+    return full_lines[player] > 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// isBlocked()
+//
+// Returns: True if every line has both an X and an O on it, so nobody
+// can win anymore. This is checkDraw() for any size of board.
+///////////////////////////////////////////////////////////////////////
+inline bool
+Board::isBlocked() const
+{
+    return open_lines == 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// isOver()
+//
+// Returns: True if either player has won or the game is a draw
+///////////////////////////////////////////////////////////////////////
+inline bool
+Board::isOver() const
+{
+    return full_lines[X] > 0 || full_lines[O] > 0 || open_lines == 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// toMove()
+//
+// Returns: Whose turn it is if the players take turns and X goes
+// first, which is what the turn label in the MainWindow shows.
+///////////////////////////////////////////////////////////////////////
+inline Board::Cell
+Board::toMove() const
+{
+    return pieces[X] > pieces[O] ? O : X;
+}
+
+///////////////////////////////////////////////////////////////////////
+// opponent(Cell player)
+//
+// Returns: The other player
+///////////////////////////////////////////////////////////////////////
+inline Board::Cell
+Board::opponent(Cell player)
+{
+    return player == X ? O : X;
+}
+
+#endif
@@ -0,0 +1,1388 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QTime>
+#include <QVector>
+#include <iostream>
+
+#include "Commands.hh"
+#include "Board.hh"
+#include "GameIndex.hh"
+#include "GameLog.hh"
+#include "GameSpace.hh"
+#include "InputLog.hh"
+#include "LiveStats.hh"
+#include "MainWindow.hh"
+#include "Network.hh"
+#include "ReplayViewer.hh"
+#include "Rules.hh"
+#include "Search.hh"
+#include "SelfPlay.hh"
+#include "Solver.hh"
+#include "Tablebase.hh"
+#include "ThreatSearch.hh"
+#include "Thumbnail.hh"
+#include "Tournament.hh"
+#include "TrainingData.hh"
+
+///////////////////////////////////////////////////////////////////////
+// buildTablebase(const QStringList &args)
+//
+// Usage: --build-tablebase {rows} {cols} {win length} {file} [rules]
+//
+// Solves a board and saves it as a tablebase. The rules are one of the
+// names in Rules.cc, standard if not given.
+///////////////////////////////////////////////////////////////////////
+static int
+buildTablebase(const QStringList &args)
+{
+    if (args.size() != 4 && args.size() != 5) {
+        std::cerr << "usage: --build-tablebase rows cols win_length file"
+                     " [rules]\n";
+        return 1;
+    }
+
+    int         rows       = args[0].toInt();
+    int         cols       = args[1].toInt();
+    int         win_length = args[2].toInt();
+    Rules::Set  rules      = Rules::STANDARD;
+    QString     error;
+    QTime       timer;
+
+    if (rows < 1 || cols < 1 || win_length < 1
+            || win_length > qMax(rows, cols)) {
+        std::cerr << "bad board size\n";
+        return 1;
+    }
+
+    if (args.size() == 5
+            && !Rules::fromName(args[4].toLower().toStdString(), &rules)) {
+        std::cerr << qPrintable(args[4]) << ": no such rules\n";
+        return 1;
+    }
+    if (rules == Rules::GRAVITY) {
+        std::cerr << "the gravity rules can not be solved, as rotations"
+                     " of a position are different games\n";
+        return 1;
+    }
+
+    Solver solver(rows, cols, win_length, rules);
+
+    timer.start();
+    if (!solver.solve()) {
+        std::cerr << "boards bigger than " << int(Solver::MAX_CELLS)
+                  << " cells can not be solved\n";
+        return 1;
+    }
+
+    std::cout << "solved " << solver.getSolvedCount() << " positions in "
+              << timer.elapsed() << " ms\n";
+
+    if (!Tablebase::write(solver, args[3], &error)) {
+        std::cerr << qPrintable(error) << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// exportPositions(const QStringList &args)
+//
+// Usage: --export-positions {rows} {cols} {win length} {file} [rules]
+//                           [threads]
+//
+// Solves a board and writes every position, with its value and the
+// value of each move, to a column file for training. See
+// TrainingData.hh for the layout.
+///////////////////////////////////////////////////////////////////////
+static int
+exportPositions(const QStringList &args)
+{
+    if (args.size() < 4 || args.size() > 6) {
+        std::cerr << "usage: --export-positions rows cols win_length file"
+                     " [rules] [threads]\n";
+        return 1;
+    }
+
+    int         rows       = args[0].toInt();
+    int         cols       = args[1].toInt();
+    int         win_length = args[2].toInt();
+    int         threads    = args.size() > 5 ? args[5].toInt() : 0;
+    Rules::Set  rules      = Rules::STANDARD;
+    QString     error;
+    QTime       timer;
+
+    if (rows < 1 || cols < 1 || win_length < 1
+            || win_length > qMax(rows, cols)) {
+        std::cerr << "bad board size\n";
+        return 1;
+    }
+
+    if (args.size() > 4
+            && !Rules::fromName(args[4].toLower().toStdString(), &rules)) {
+        std::cerr << qPrintable(args[4]) << ": no such rules\n";
+        return 1;
+    }
+    if (rules == Rules::GRAVITY) {
+        std::cerr << "the gravity rules can not be solved, as rotations"
+                     " of a position are different games\n";
+        return 1;
+    }
+
+    Solver solver(rows, cols, win_length, rules);
+
+    timer.start();
+    if (!solver.solve()) {
+        std::cerr << "boards bigger than " << int(Solver::MAX_CELLS)
+                  << " cells can not be solved\n";
+        return 1;
+    }
+
+    std::cout << "solved " << solver.getSolvedCount() << " positions in "
+              << timer.elapsed() << " ms\n";
+
+    timer.restart();
+    if (!TrainingData::write(solver, args[3], threads, &error)) {
+        std::cerr << qPrintable(error) << "\n";
+        return 1;
+    }
+
+    std::cout << "exported in " << timer.elapsed() << " ms\n";
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// probeTablebase(const QStringList &args)
+//
+// Usage: --probe {file} {cells}...
+//
+// Prints what each position is worth. Cells are given row by row
+// using X, O, and '.' for empty, for example "X...O....".
+///////////////////////////////////////////////////////////////////////
+static int
+probeTablebase(const QStringList &args)
+{
+    Tablebase tablebase;
+
+    if (args.size() < 2) {
+        std::cerr << "usage: --probe file cells...\n";
+        return 1;
+    }
+
+    if (!tablebase.open(args[0])) {
+        std::cerr << qPrintable(tablebase.errorString()) << "\n";
+        return 1;
+    }
+
+    Board board(tablebase.getRows(), tablebase.getCols(),
+                tablebase.getWinLength());
+
+    for (int i = 1; i < args.size(); ++i) {
+        if (!board.fromString(args[i].toStdString())) {
+            std::cerr << qPrintable(args[i]) << ": not a "
+                      << board.getRows() << "x" << board.getCols()
+                      << " board\n";
+            return 1;
+        }
+        std::cout << qPrintable(args[i]) << ": "
+                  << qPrintable(tablebase.describe(board)) << "\n";
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// searchPosition(const QStringList &args)
+//
+// Usage: --search {rows} {cols} {win length} {msecs} {cells} [weights]
+//
+// Runs the computer player's search on a position for the given
+// number of milliseconds and prints the move it picked, how deep it
+// got, and how fast it went. Handy for checking what a kiosk can do.
+// With a weights file the search scores positions with that network.
+///////////////////////////////////////////////////////////////////////
+static int
+searchPosition(const QStringList &args)
+{
+    if (args.size() != 5 && args.size() != 6) {
+        std::cerr << "usage: --search rows cols win_length msecs cells"
+                     " [weights]\n";
+        return 1;
+    }
+
+    int rows       = args[0].toInt();
+    int cols       = args[1].toInt();
+    int win_length = args[2].toInt();
+    int msecs      = args[3].toInt();
+
+    if (rows < 1 || cols < 1 || rows * cols > Board::MAX_CELLS
+            || win_length < 1 || win_length > qMax(rows, cols)) {
+        std::cerr << "bad board size\n";
+        return 1;
+    }
+
+    Board       board(rows, cols, win_length);
+    Search      search;
+    Network     network;
+    std::string error;
+
+    if (!board.fromString(args[4].toStdString())) {
+        std::cerr << qPrintable(args[4]) << ": not a " << rows << "x"
+                  << cols << " board\n";
+        return 1;
+    }
+
+    if (args.size() == 6) {
+        if (!network.load(args[5].toLocal8Bit().constData(), &error)) {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        if (network.getCells() != rows * cols) {
+            std::cerr << qPrintable(args[5]) << " is for boards of "
+                      << network.getCells() << " cells\n";
+            return 1;
+        }
+        search.setNetwork(&network);
+    }
+
+    int move = search.findMove(board, board.getPieceCount(Board::EMPTY),
+                               msecs);
+
+    if (move < 0) {
+        std::cout << "game over\n";
+        return 0;
+    }
+
+    std::cout << "move (" << move / cols << "," << move % cols << ")"
+              << " score " << search.getScore()
+              << " depth " << search.getDepth()
+              << " nodes " << search.getNodes()
+              << " time " << search.getElapsed() << " ms"
+              << " speed " << search.getNodesPerSecond() << " nodes/s\n";
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// findThreats(const QStringList &args)
+//
+// Usage: --threats {rows} {cols} {win length} {cells}
+//
+// Runs a threat-space search on a position and prints the forced win
+// it finds for the player to move, or else the moves that might stop
+// the opponent's, along with how long it took.
+///////////////////////////////////////////////////////////////////////
+static int
+findThreats(const QStringList &args)
+{
+    if (args.size() != 4) {
+        std::cerr << "usage: --threats rows cols win_length cells\n";
+        return 1;
+    }
+
+    int rows       = args[0].toInt();
+    int cols       = args[1].toInt();
+    int win_length = args[2].toInt();
+
+    if (rows < 1 || cols < 1 || rows * cols > Board::MAX_CELLS
+            || win_length < 1 || win_length > qMax(rows, cols)) {
+        std::cerr << "bad board size\n";
+        return 1;
+    }
+
+    Board        board(rows, cols, win_length);
+    ThreatSearch threats;
+    int          moves[Board::MAX_CELLS];
+
+    if (!board.fromString(args[3].toStdString())) {
+        std::cerr << qPrintable(args[3]) << ": not a " << rows << "x"
+                  << cols << " board\n";
+        return 1;
+    }
+
+    int win = threats.findWin(board);
+
+    if (win >= 0) {
+        std::cout << "win at (" << win / cols << "," << win % cols << ")"
+                  << (threats.isFourWin() ? " with fours" : " with threes")
+                  << " nodes " << threats.getNodes()
+                  << " time " << threats.getElapsed() << " ms\n";
+        return 0;
+    }
+
+    int count = threats.findDefences(board, moves);
+
+    if (count == 0) {
+        std::cout << "no forced win found";
+    } else {
+        std::cout << "defend at";
+        for (int i = 0; i < count; ++i)
+            std::cout << " (" << moves[i] / cols << "," << moves[i] % cols
+                      << ")";
+    }
+    std::cout << " nodes " << threats.getNodes()
+              << " time " << threats.getElapsed() << " ms\n";
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// makeNetwork(const QStringList &args)
+//
+// Usage: --make-network {cells} {seed} {file}
+//
+// Writes a weights file full of random weights. It plays no better
+// than chance, but has the right shape for trying out the evaluation
+// until trained weights are available.
+///////////////////////////////////////////////////////////////////////
+static int
+makeNetwork(const QStringList &args)
+{
+    if (args.size() != 3) {
+        std::cerr << "usage: --make-network cells seed file\n";
+        return 1;
+    }
+
+    int     cells = args[0].toInt();
+    Network network;
+
+    if (cells < 1 || cells > Board::MAX_CELLS) {
+        std::cerr << "bad number of cells\n";
+        return 1;
+    }
+
+    network.randomize(cells, args[1].toUInt());
+    if (!network.save(args[2].toLocal8Bit().constData())) {
+        std::cerr << "could not write " << qPrintable(args[2]) << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// checkNetwork(const QStringList &args)
+//
+// Usage: --check-network {file} {rows} {cols} {win length} {games}
+//
+// Plays random games, keeping the network's first layer up to date
+// move by move the way the search does, and checks every score
+// against evaluateReference(), which works everything out from scratch
+// without SIMD. Then prints how fast each way is.
+///////////////////////////////////////////////////////////////////////
+static int
+checkNetwork(const QStringList &args)
+{
+    if (args.size() != 5) {
+        std::cerr << "usage: --check-network file rows cols win_length"
+                     " games\n";
+        return 1;
+    }
+
+    int                  rows       = args[1].toInt();
+    int                  cols       = args[2].toInt();
+    int                  win_length = args[3].toInt();
+    int                  games      = args[4].toInt();
+    Network              network;
+    Network::Accumulator accumulator;
+    std::string          error;
+
+    if (!network.load(args[0].toLocal8Bit().constData(), &error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    if (rows < 1 || cols < 1 || rows * cols != network.getCells()
+            || win_length < 1 || win_length > qMax(rows, cols)) {
+        std::cerr << "bad board size for a network of "
+                  << network.getCells() << " cells\n";
+        return 1;
+    }
+
+    Board         board(rows, cols, win_length);
+    QVector<int>  played;
+    int           positions  = 0;
+    int           mismatches = 0;
+    qint64        fast_ns    = 0;
+    qint64        slow_ns    = 0;
+    volatile int  sink       = 0;
+    QTime         timer;
+
+    qsrand(1);
+
+    for (int game = 0; game < games; ++game) {
+        board.clear();
+        played.clear();
+        network.refresh(accumulator, board);
+
+        // Play into the game, then take half of it back again
+        while (!board.isOver()) {
+            int         cell   = qrand() % board.getCellCount();
+            Board::Cell player = board.toMove();
+
+            if (board.getCell(cell) != Board::EMPTY)
+                continue;
+
+            board.place(cell, player);
+            network.addPiece(accumulator, cell, player);
+            played.append(cell);
+
+            for (int side = Board::X; side <= Board::O; ++side) {
+                Board::Cell who = Board::Cell(side);
+                int fast = network.evaluate(accumulator, who);
+                int slow = network.evaluateReference(board, who);
+
+                if (fast != slow && mismatches++ < 10)
+                    std::cerr << "mismatch at " << board.toString()
+                              << ": " << fast << " != " << slow << "\n";
+            }
+            positions++;
+        }
+
+        int keep = played.size() / 2;
+
+        while (played.size() > keep) {
+            int         cell   = played.last();
+            Board::Cell player = board.getCell(cell);
+
+            played.pop_back();
+            board.remove(cell);
+            network.removePiece(accumulator, cell, player);
+
+            if (network.evaluate(accumulator, Board::X)
+                    != network.evaluateReference(board, Board::X)
+                    && mismatches++ < 10)
+                std::cerr << "mismatch after undo at " << board.toString()
+                          << "\n";
+            positions++;
+        }
+    }
+
+    // Time a move, its undo, and a score against scoring from scratch
+    timer.start();
+    for (int i = 0; i < 100000; ++i) {
+        network.addPiece(accumulator, 0, Board::X);
+        network.removePiece(accumulator, 0, Board::X);
+        sink += network.evaluate(accumulator, board.toMove());
+    }
+    fast_ns = qint64(timer.elapsed()) * 10;
+
+    timer.start();
+    for (int i = 0; i < 10000; ++i)
+        sink += network.evaluateReference(board, board.toMove());
+    slow_ns = qint64(timer.elapsed()) * 100;
+
+    std::cout << "kernel " << Network::kernelName()
+              << " positions " << positions
+              << " mismatches " << mismatches
+              << " incremental " << fast_ns << " ns"
+              << " reference " << slow_ns << " ns\n";
+    return mismatches == 0 ? 0 : 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// referenceXWin(GameSpace *space[3][3])
+//
+// The original checkXWin() from before the Board class, reading the
+// spaces themselves. Kept as the definition of what a win is.
+///////////////////////////////////////////////////////////////////////
+static bool
+referenceXWin(GameSpace *space[3][3])
+{
+    // Check to see if X wins
+    for (int i = 0; i < 3; i++) {
+        if (   (space[i][0]->getState() == GameSpace::X 
+            &&  space[i][1]->getState() == GameSpace::X  // Rows
+            &&  space[i][2]->getState() == GameSpace::X)
+            || (space[0][i]->getState() == GameSpace::X 
+            &&  space[1][i]->getState() == GameSpace::X  // Cols
+            &&  space[2][i]->getState() == GameSpace::X)
+            || (space[0][0]->getState() == GameSpace::X
+            &&  space[1][1]->getState() == GameSpace::X  // Diagonal 1
+            &&  space[2][2]->getState() == GameSpace::X)
+            || (space[0][2]->getState() == GameSpace::X
+            &&  space[1][1]->getState() == GameSpace::X  // Diagonal 2
+            &&  space[2][0]->getState() == GameSpace::X)) 
+            return true;
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////
+// referenceOWin(GameSpace *space[3][3])
+//
+// The original checkOWin().
+///////////////////////////////////////////////////////////////////////
+static bool
+referenceOWin(GameSpace *space[3][3])
+{
+    // Check to see if O wins
+    for (int i = 0; i < 3; i++) {
+        if (   (space[i][0]->getState() == GameSpace::O 
+            &&  space[i][1]->getState() == GameSpace::O  // Rows
+            &&  space[i][2]->getState() == GameSpace::O)
+            || (space[0][i]->getState() == GameSpace::O
+            &&  space[1][i]->getState() == GameSpace::O  // Cols
+            &&  space[2][i]->getState() == GameSpace::O)
+            || (space[0][0]->getState() == GameSpace::O
+            &&  space[1][1]->getState() == GameSpace::O  // Diagonal 1
+            &&  space[2][2]->getState() == GameSpace::O)
+            || (space[0][2]->getState() == GameSpace::O
+            &&  space[1][1]->getState() == GameSpace::O  // Diagonal 2
+            &&  space[2][0]->getState() == GameSpace::O)) 
+        return true;
+        
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////
+// referenceDraw(GameSpace *space[3][3])
+//
+// The original checkDraw(): a draw as soon as every row, column, and
+// diagonal contains both an X and an O, full board or not.
+///////////////////////////////////////////////////////////////////////
+static bool
+referenceDraw(GameSpace *space[3][3])
+{
+    bool draw    = true;
+    bool found_x = false;
+    bool found_o = false;
+
+    // Check the rows to see if they contain an X and an O
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            if (space[i][j]->getState() == GameSpace::X)
+                found_x = true;
+            else if (space[i][j]->getState() == GameSpace::O)
+                found_o = true;
+        }
+        if (!found_x || !found_o) {
+            draw = false;
+        } else {
+            found_x = false;
+            found_o = false;
+        }
+    }
+
+    // Check the columns to see if they contain an X and an O
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            if (space[j][i]->getState() == GameSpace::X)
+                found_x = true;
+            else if (space[j][i]->getState() == GameSpace::O)
+                found_o = true;
+        }
+        if (!found_x || !found_o) {
+            draw = false;
+        } else {
+            found_x = false;
+            found_o = false;
+        }
+    }
+
+    // Check the first diaganol
+    for (int i = 0; i < 3; i++) {
+        if (space[i][i]->getState() == GameSpace::X)
+            found_x = true;
+        else if (space[i][i]->getState() == GameSpace::O)
+            found_o = true;
+    }
+    if (!found_x || !found_o) {
+        draw = false;
+    } else {
+        found_x = false;
+        found_o = false;
+    }
+
+    // Check the second diaganol
+    int j = 2;
+    for (int i = 0; i < 3; i++) {
+        if (space[i][j]->getState() == GameSpace::X)
+            found_x = true;
+        else if (space[i][j]->getState() == GameSpace::O)
+            found_o = true;
+
+        j--;
+    }
+    if (!found_x || !found_o) 
+        draw = false;
+
+    return draw;
+}
+
+///////////////////////////////////////////////////////////////////////
+// nextFilling(int *digits)
+//
+// Parameters:  digits      - One of EMPTY, X, or O for each of the 9
+//                            cells, counted up like a base 3 number
+//
+// Returns: False once every filling has been counted and digits is
+// back to an empty board
+///////////////////////////////////////////////////////////////////////
+static bool
+nextFilling(int *digits)
+{
+    for (int i = 0; i < 9; ++i) {
+        if (++digits[i] < 3)
+            return true;
+        digits[i] = 0;
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////
+// checkDetection(const QStringList &args)
+//
+// Usage: --check-detection [repeats]
+//
+// Goes through all 3^9 ways of filling a 3x3 board, legal or not, and
+// checks Board::hasLine() and Board::isBlocked() against the original
+// checkXWin(), checkOWin(), and checkDraw(), which read the state of
+// real GameSpaces. Then times both: per board, checking one position
+// repeats times over, and in bulk, setting up and checking every
+// position in turn. The spaces are never shown, so this runs without
+// a screen under a virtual X server.
+///////////////////////////////////////////////////////////////////////
+static int
+checkDetection(const QStringList &args)
+{
+    int repeats = args.isEmpty() ? 100 : args[0].toInt();
+
+    if (args.size() > 1 || repeats < 1) {
+        std::cerr << "usage: --check-detection [repeats]\n";
+        return 1;
+    }
+
+    GameSpace     *space[3][3];
+    Board          board(3, 3, 3);
+    int            digits[9]  = {0};
+    int            boards     = 0;
+    int            x_wins     = 0;
+    int            o_wins     = 0;
+    int            draws      = 0;
+    int            early      = 0;          // Draws with spaces left
+    int            mismatches = 0;
+    int64_t        reference_us = 0;
+    int64_t        board_us     = 0;
+    int64_t        start;
+    volatile int   sink       = 0;
+
+    // The board checks are inline loads that do not change between
+    // repeats, so the compiler would do them once for the whole timing
+    // loop. Reading the board through a volatile pointer makes it do
+    // them every time.
+    const Board *volatile subject = &board;
+
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j)
+            space[i][j] = new GameSpace(i, j);
+    }
+
+    // Compare every filling, timing each way on it as we go
+    do {
+        for (int i = 0; i < 9; ++i) {
+            if (board.getCell(i) != Board::EMPTY)
+                board.remove(i);
+            if (digits[i] != Board::EMPTY)
+                board.place(i, Board::Cell(digits[i]));
+            space[i / 3][i % 3]->setState(GameSpace::SpaceState(digits[i]));
+        }
+
+        bool x_win = referenceXWin(space);
+        bool o_win = referenceOWin(space);
+        bool draw  = referenceDraw(space);
+
+        if ((x_win != board.hasLine(Board::X)
+                || o_win != board.hasLine(Board::O)
+                || draw != board.isBlocked()) && mismatches++ < 10)
+            std::cerr << "mismatch at " << board.toString() << "\n";
+
+        boards++;
+        x_wins += x_win;
+        o_wins += o_win;
+        draws  += draw;
+        early  += draw && board.getPieceCount(Board::EMPTY) > 0;
+
+        start = Search::monotonicMicros();
+        for (int r = 0; r < repeats; ++r)
+            sink += referenceXWin(space) + referenceOWin(space)
+                  + referenceDraw(space);
+        reference_us += Search::monotonicMicros() - start;
+
+        start = Search::monotonicMicros();
+        for (int r = 0; r < repeats; ++r) {
+            const Board &timed = *subject;
+            sink += timed.hasLine(Board::X) + timed.hasLine(Board::O)
+                  + timed.isBlocked();
+        }
+        board_us += Search::monotonicMicros() - start;
+    } while (nextFilling(digits));
+
+    std::cout << "boards " << boards << " x wins " << x_wins
+              << " o wins " << o_wins << " draws " << draws
+              << " (" << early << " before the board was full)"
+              << " mismatches " << mismatches << "\n";
+    std::cout << "per board: reference "
+              << reference_us * 1000 / (int64_t(boards) * repeats)
+              << " ns, board " << board_us * 1000 / (int64_t(boards) * repeats)
+              << " ns\n";
+
+    // Set up and check every filling in turn, changing only the cells
+    // that differ from the last one, as a game would
+    start = Search::monotonicMicros();
+    do {
+        for (int i = 0; i < 9; ++i)
+            space[i / 3][i % 3]->setState(GameSpace::SpaceState(digits[i]));
+        sink += referenceXWin(space) + referenceOWin(space)
+              + referenceDraw(space);
+    } while (nextFilling(digits));
+    reference_us = Search::monotonicMicros() - start;
+
+    start = Search::monotonicMicros();
+    do {
+        for (int i = 0; i < 9; ++i) {
+            if (board.getCell(i) == Board::Cell(digits[i]))
+                continue;
+            if (board.getCell(i) != Board::EMPTY)
+                board.remove(i);
+            if (digits[i] != Board::EMPTY)
+                board.place(i, Board::Cell(digits[i]));
+        }
+        sink += board.hasLine(Board::X) + board.hasLine(Board::O)
+              + board.isBlocked();
+    } while (nextFilling(digits));
+    board_us = Search::monotonicMicros() - start;
+
+    std::cout << "all boards: reference " << reference_us
+              << " us, board " << board_us << " us\n";
+
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j)
+            delete space[i][j];
+    }
+    return mismatches == 0 ? 0 : 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// renderGames(const QStringList &args)
+//
+// Usage: --render-games {rows} {cols} {log} {directory} [threads]
+//
+// Draws the final board of every game in a log to a PNG in directory.
+// Games that end in the same position, or a rotation or reflection of
+// it, share one picture, drawn the way the first such game left it.
+// directory/games.txt lists the picture for each line of the log, or
+// '-' for a line that is not a game on this size of board.
+///////////////////////////////////////////////////////////////////////
+static int
+renderGames(const QStringList &args)
+{
+    if (args.size() < 4 || args.size() > 5) {
+        std::cerr << "usage: --render-games rows cols log directory"
+                     " [threads]\n";
+        return 1;
+    }
+
+    int   rows    = args[0].toInt();
+    int   cols    = args[1].toInt();
+    int   threads = args.size() > 4 ? args[4].toInt() : 0;
+    QFile log(args[2]);
+    QDir  directory(args[3]);
+
+    if (rows < 1 || cols < 1 || rows * cols > Board::MAX_CELLS) {
+        std::cerr << "bad board size\n";
+        return 1;
+    }
+    if (!log.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        std::cerr << qPrintable(args[2]) << ": "
+                  << qPrintable(log.errorString()) << "\n";
+        return 1;
+    }
+    if (!directory.mkpath(".")) {
+        std::cerr << "can not make " << qPrintable(args[3]) << "\n";
+        return 1;
+    }
+
+    QFile index(directory.filePath("games.txt"));
+
+    if (!index.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        std::cerr << qPrintable(index.fileName()) << ": "
+                  << qPrintable(index.errorString()) << "\n";
+        return 1;
+    }
+    if (!Thumbnail::loadArtwork()) {
+        std::cerr << "can not load the piece images\n";
+        return 1;
+    }
+
+    QThreadPool            *pool = QThreadPool::globalInstance();
+    QTextStream             in(&log);
+    QTextStream             out(&index);
+    QHash<quint64, QString> rendered;           // Canonical hash to file
+    QVector<Move>           moves;
+    Board                   board(rows, cols, qMin(qMax(rows, cols), 5));
+    int                     line_number = 0;
+    int                     games       = 0;
+    int                     bad         = 0;
+    QTime                   timer;
+
+    if (threads > 0)
+        pool->setMaxThreadCount(threads);
+    timer.start();
+
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+
+        line_number++;
+        if (line.trimmed().isEmpty())
+            continue;
+
+        if (!GameLog::parseGame(line, &moves)
+                || !GameLog::replay(moves, &board)) {
+            out << line_number << " -\n";
+            bad++;
+            continue;
+        }
+
+        quint64 key  = board.canonicalHash();
+        QString name = rendered.value(key);
+
+        if (name.isEmpty()) {
+            name = QString("board-%1.png").arg(key, 16, 16, QChar('0'));
+            rendered.insert(key, name);
+            pool->start(new Thumbnail(board.toString(), rows, cols,
+                                      directory.filePath(name)));
+        }
+        out << line_number << " " << name << "\n";
+        games++;
+    }
+
+    pool->waitForDone();
+
+    int msecs = timer.elapsed();
+
+    std::cout << "games " << games << " skipped " << bad
+              << " pictures " << rendered.size()
+              << " failed " << Thumbnail::getFailures()
+              << " in " << msecs << " ms on "
+              << pool->maxThreadCount() << " threads\n";
+    return Thumbnail::getFailures() == 0 ? 0 : 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// indexGames(const QStringList &args)
+//
+// Usage: --index-games {rows} {cols} {log} {index} [unique log]
+//
+// Adds every game in a log to a GameIndex, made if it does not exist,
+// and prints how many were new and how many were repeats, counting
+// rotations and reflections of a game as repeats. With a unique log,
+// the games that were new are added to it, so only those need to be
+// kept.
+///////////////////////////////////////////////////////////////////////
+static int
+indexGames(const QStringList &args)
+{
+    if (args.size() != 4 && args.size() != 5) {
+        std::cerr << "usage: --index-games rows cols log index"
+                     " [unique_log]\n";
+        return 1;
+    }
+
+    int         rows = args[0].toInt();
+    int         cols = args[1].toInt();
+    QFile       log(args[2]);
+    QFile       unique(args.size() > 4 ? args[4] : QString());
+    GameIndex   index;
+
+    if (rows < 1 || cols < 1 || rows * cols > Board::MAX_CELLS) {
+        std::cerr << "bad board size\n";
+        return 1;
+    }
+    if (!log.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        std::cerr << qPrintable(args[2]) << ": "
+                  << qPrintable(log.errorString()) << "\n";
+        return 1;
+    }
+    if (args.size() > 4 && !unique.open(QIODevice::WriteOnly
+                                        | QIODevice::Append
+                                        | QIODevice::Text)) {
+        std::cerr << qPrintable(args[4]) << ": "
+                  << qPrintable(unique.errorString()) << "\n";
+        return 1;
+    }
+    if (!index.open(args[3], rows, cols)) {
+        std::cerr << qPrintable(index.errorString()) << "\n";
+        return 1;
+    }
+
+    QTextStream     in(&log);
+    QTextStream     out(&unique);
+    QVector<Move>   moves;
+    Board           board(rows, cols, qMin(qMax(rows, cols), 5));
+    int             games   = 0;
+    int             repeats = 0;
+    int             bad     = 0;
+    QTime           timer;
+
+    timer.start();
+
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+
+        if (line.trimmed().isEmpty())
+            continue;
+
+        if (!GameLog::parseGame(line, &moves)
+                || !GameLog::replay(moves, &board)) {
+            bad++;
+            continue;
+        }
+
+        if (index.add(GameIndex::fingerprint(moves, board),
+                      moves.size()) > 0)
+            repeats++;
+        else if (unique.isOpen())
+            out << line.trimmed() << "\n";
+        games++;
+    }
+
+    int msecs = timer.elapsed();
+
+    std::cout << "games " << games << " new " << games - repeats
+              << " repeats " << repeats << " skipped " << bad
+              << " in " << msecs << " ms\n"
+              << "index holds " << index.getUnique() << " games of "
+              << index.getGames() << " played, "
+              << (index.getLookups() > 0
+                  ? double(index.getProbes()) / index.getLookups() : 0.0)
+              << " probes a lookup\n";
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// countGame(const QStringList &args)
+//
+// Usage: --count-game {index} {game}
+//
+// Prints how many times a game, written as a line of the log, has been
+// played in the games added to an index, rotations and reflections
+// included.
+///////////////////////////////////////////////////////////////////////
+static int
+countGame(const QStringList &args)
+{
+    if (args.size() != 2) {
+        std::cerr << "usage: --count-game index game\n";
+        return 1;
+    }
+
+    GameIndex       index;
+    QVector<Move>   moves;
+
+    if (!index.open(args[0])) {
+        std::cerr << qPrintable(index.errorString()) << "\n";
+        return 1;
+    }
+
+    int   rows = index.getRows();
+    int   cols = index.getCols();
+    Board board(rows, cols, qMin(qMax(rows, cols), 5));
+
+    if (!GameLog::parseGame(args[1], &moves)
+            || !GameLog::replay(moves, &board)) {
+        std::cerr << qPrintable(args[1]) << ": not a game on a " << rows
+                  << "x" << cols << " board\n";
+        return 1;
+    }
+
+    std::cout << index.count(GameIndex::fingerprint(moves, board))
+              << " of " << index.getGames() << " games\n";
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// replayInput(const QStringList &args)
+//
+// Usage: --replay-input {file} [fast]
+//
+// Opens a game window like the one the recording was made in and plays
+// the recorded drags into it, at the pace they were made or, with
+// "fast", as quickly as they go. Then prints how long each kind of
+// event took to handle, including the signals and repaints it caused,
+// and how long each paint took. Sessions against the computer replay
+// only the child's moves, as the computer is left out.
+///////////////////////////////////////////////////////////////////////
+static int
+replayInput(const QStringList &args)
+{
+    if (args.isEmpty() || args.size() > 2
+            || (args.size() == 2 && args[1] != "fast")) {
+        std::cerr << "usage: --replay-input file [fast]\n";
+        return 1;
+    }
+
+    InputReplayer replayer;
+
+    if (!replayer.load(args[0])) {
+        std::cerr << qPrintable(replayer.errorString()) << "\n";
+        return 1;
+    }
+
+    MainWindow window(replayer.getRows(), replayer.getCols(),
+                      replayer.getWinLength());
+
+    window.setRules(replayer.getRules());
+    window.newGame();
+    window.show();
+
+    replayer.replay(&window, args.size() == 2);
+    replayer.printReport();
+    return replayer.getDivergences() == 0 ? 0 : 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// viewGames(const QStringList &args)
+//
+// Usage: --view-games {rows} {cols} {log} [game]
+//
+// Opens a window for stepping through the games in a log, starting
+// with the given one, counted from 1, or the first.
+///////////////////////////////////////////////////////////////////////
+static int
+viewGames(const QStringList &args)
+{
+    if (args.size() != 3 && args.size() != 4) {
+        std::cerr << "usage: --view-games rows cols log [game]\n";
+        return 1;
+    }
+
+    int rows = args[0].toInt();
+    int cols = args[1].toInt();
+
+    if (rows < 1 || cols < 1 || rows > 16 || cols > 16) {
+        std::cerr << "bad board size\n";
+        return 1;
+    }
+
+    ReplayViewer viewer(rows, cols);
+
+    if (!viewer.load(args[2])) {
+        std::cerr << qPrintable(viewer.errorString()) << "\n";
+        return 1;
+    }
+    if (args.size() == 4)
+        viewer.showGame(args[3].toInt());
+
+    viewer.show();
+    return qApp->exec();
+}
+
+///////////////////////////////////////////////////////////////////////
+// selfPlay(const QStringList &args)
+//
+// Usage: --self-play {rows} {cols} {win length} {games} {msecs} {corpus}
+//                    [workers]
+//
+// Has the computer play itself, thinking msecs a move, in as many
+// processes as there are cores unless told otherwise. The games are
+// added to corpus in the log format and the results printed at the
+// end. See SelfPlay.hh.
+///////////////////////////////////////////////////////////////////////
+static int
+selfPlay(const QStringList &args)
+{
+    if (args.size() != 6 && args.size() != 7) {
+        std::cerr << "usage: --self-play rows cols win_length games msecs"
+                     " corpus [workers]\n";
+        return 1;
+    }
+
+    int rows       = args[0].toInt();
+    int cols       = args[1].toInt();
+    int win_length = args[2].toInt();
+    int games      = args[3].toInt();
+    int msecs      = args[4].toInt();
+    int workers    = args.size() > 6 ? args[6].toInt()
+                                     : QThread::idealThreadCount();
+
+    if (rows < 1 || cols < 1 || rows * cols > Board::MAX_CELLS
+            || win_length < 1 || win_length > qMax(rows, cols)) {
+        std::cerr << "bad board size\n";
+        return 1;
+    }
+    if (games < 1 || msecs < 1) {
+        std::cerr << "games and msecs must be positive\n";
+        return 1;
+    }
+    workers = qMax(1, qMin(workers, games));
+
+    SelfPlay farm(rows, cols, win_length, msecs);
+    bool     ok = farm.run(games, workers, args[5]);
+
+    if (!ok)
+        std::cerr << qPrintable(farm.errorString()) << "\n";
+
+    int played = farm.getGames();
+    int msecs_taken = qMax(farm.getElapsed(), 1);
+
+    std::cout << "games " << played
+              << " x " << farm.getWins(Board::X)
+              << " o " << farm.getWins(Board::O)
+              << " draws " << farm.getWins(Board::EMPTY)
+              << " average length "
+              << (played > 0 ? double(farm.getMoves()) / played : 0.0)
+              << " restarts " << farm.getRestarts()
+              << " in " << farm.getElapsed() << " ms on "
+              << workers << " workers, "
+              << played * 1000.0 / msecs_taken << " games/s\n";
+    return ok ? 0 : 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// selfPlayWorker(const QStringList &args)
+//
+// Usage: --self-play-worker {key} {worker}
+//
+// What --self-play starts in each of its processes; not for running by
+// hand.
+///////////////////////////////////////////////////////////////////////
+static int
+selfPlayWorker(const QStringList &args)
+{
+    if (args.size() != 2) {
+        std::cerr << "usage: --self-play-worker key worker\n";
+        return 1;
+    }
+    return SelfPlay::work(args[0], args[1].toInt());
+}
+
+///////////////////////////////////////////////////////////////////////
+// tournament(const QStringList &args)
+//
+// Usage: --tournament {rows} {cols} {win length} {players} {results}
+//                     [log] [threads]
+//
+// Plays the players, a comma separated list such as
+// random,greedy,depth2,depth4, against each other until every pairing
+// is decided, and prints how each one went. Openings come from log if
+// given, or "-" for every pair of first moves. See Tournament.hh for
+// the players and the results file.
+///////////////////////////////////////////////////////////////////////
+static int
+tournament(const QStringList &args)
+{
+    if (args.size() < 5 || args.size() > 7) {
+        std::cerr << "usage: --tournament rows cols win_length players"
+                     " results [log] [threads]\n";
+        return 1;
+    }
+
+    int rows       = args[0].toInt();
+    int cols       = args[1].toInt();
+    int win_length = args[2].toInt();
+    int threads    = args.size() > 6 ? args[6].toInt() : 0;
+
+    if (rows < 1 || cols < 1 || rows * cols > Board::MAX_CELLS
+            || win_length < 1 || win_length > qMax(rows, cols)) {
+        std::cerr << "bad board size\n";
+        return 1;
+    }
+
+    Tournament  match(rows, cols, win_length);
+    QStringList names = args[3].split(',', QString::SkipEmptyParts);
+
+    for (int i = 0; i < names.size(); ++i) {
+        if (!match.addPlayer(names[i])) {
+            std::cerr << qPrintable(match.errorString()) << "\n";
+            return 1;
+        }
+    }
+    if (args.size() > 5 && args[5] != "-" && !match.loadOpenings(args[5])) {
+        std::cerr << qPrintable(match.errorString()) << "\n";
+        return 1;
+    }
+
+    bool ok = match.run(args[4], threads);
+
+    if (!ok)
+        std::cerr << qPrintable(match.errorString()) << "\n";
+    match.printReport();
+    return ok ? 0 : 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// liveStats(const QStringList &args)
+//
+// Usage: --live-stats {rows} {cols} {win length} {socket} {log}...
+//
+// Follows the logs the games in a room are printing, and serves what
+// the last hour of games looks like on a local socket until killed.
+// See LiveStats.hh.
+///////////////////////////////////////////////////////////////////////
+static int
+liveStats(const QStringList &args)
+{
+    if (args.size() < 5) {
+        std::cerr << "usage: --live-stats rows cols win_length socket"
+                     " log...\n";
+        return 1;
+    }
+
+    int rows       = args[0].toInt();
+    int cols       = args[1].toInt();
+    int win_length = args[2].toInt();
+
+    if (rows < 1 || cols < 1 || rows * cols > Board::MAX_CELLS
+            || win_length < 1 || win_length > qMax(rows, cols)) {
+        std::cerr << "bad board size\n";
+        return 1;
+    }
+
+    LiveStats stats(rows, cols, win_length);
+
+    for (int i = 4; i < args.size(); ++i) {
+        if (!stats.addLog(args[i])) {
+            std::cerr << qPrintable(stats.errorString()) << "\n";
+            return 1;
+        }
+    }
+    if (!stats.listen(args[3])) {
+        std::cerr << qPrintable(stats.errorString()) << "\n";
+        return 1;
+    }
+    return qApp->exec();
+}
+
+///////////////////////////////////////////////////////////////////////
+// queryStats(const QStringList &args)
+//
+// Usage: --query-stats {socket}
+//
+// Prints what a --live-stats on socket has to say
+///////////////////////////////////////////////////////////////////////
+static int
+queryStats(const QStringList &args)
+{
+    if (args.size() != 1) {
+        std::cerr << "usage: --query-stats socket\n";
+        return 1;
+    }
+
+    QByteArray snapshot;
+    QString    error;
+
+    if (!LiveStats::query(args[0], &snapshot, &error)) {
+        std::cerr << qPrintable(error) << "\n";
+        return 1;
+    }
+    std::cout << snapshot.constData();
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// The tools, by name
+///////////////////////////////////////////////////////////////////////
+struct Command
+{
+    const char  *name;
+    int         (*run)(const QStringList &args);
+    bool        widgets;                        // Needs a QApplication
+};
+
+static const Command commands[] = {
+    {"--build-tablebase",   buildTablebase,     false},
+    {"--probe",             probeTablebase,     false},
+    {"--export-positions",  exportPositions,    false},
+    {"--search",            searchPosition,     false},
+    {"--threats",           findThreats,        false},
+    {"--make-network",      makeNetwork,        false},
+    {"--check-network",     checkNetwork,       false},
+    {"--check-detection",   checkDetection,     true},
+    {"--render-games",      renderGames,        false},
+    {"--index-games",       indexGames,         false},
+    {"--count-game",        countGame,          false},
+    {"--replay-input",      replayInput,        true},
+    {"--view-games",        viewGames,          true},
+    {"--self-play",         selfPlay,           false},
+    {"--self-play-worker",  selfPlayWorker,     false},
+    {"--tournament",        tournament,         false},
+    {"--live-stats",        liveStats,          false},
+    {"--query-stats",       queryStats,         false},
+};
+
+static const int command_count = sizeof(commands) / sizeof(commands[0]);
+
+///////////////////////////////////////////////////////////////////////
+// isCommand(const QStringList &args)
+//
+// Parameters:  args        - The command line, without the program name
+//
+// Returns: True if the first argument names a tool
+///////////////////////////////////////////////////////////////////////
+bool
+isCommand(const QStringList &args)
+{
+    if (args.isEmpty())
+        return false;
+
+    for (int i = 0; i < command_count; ++i) {
+        if (args[0] == commands[i].name)
+            return true;
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////
+// needsWidgets(const QStringList &args)
+//
+// Parameters:  args        - The command line, without the program name
+//
+// Returns: True if the tool makes widgets, so needs a QApplication
+// rather than a QCoreApplication
+///////////////////////////////////////////////////////////////////////
+bool
+needsWidgets(const QStringList &args)
+{
+    for (int i = 0; i < command_count; ++i) {
+        if (!args.isEmpty() && args[0] == commands[i].name)
+            return commands[i].widgets;
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////
+// runCommand(const QStringList &args)
+//
+// Parameters:  args        - The command line, without the program name
+//
+// Returns: The exit code of the tool
+///////////////////////////////////////////////////////////////////////
+int
+runCommand(const QStringList &args)
+{
+    for (int i = 0; i < command_count; ++i) {
+        if (args[0] == commands[i].name)
+            return commands[i].run(args.mid(1));
+    }
+    return 1;
+}
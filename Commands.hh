@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#ifndef WF_COMMANDS_HH
+#define WF_COMMANDS_HH
+
+///////////////////////////////////////////////////////////////////////
+// Commands.hh
+//
+// This file contains the declarations for the command line tools that
+// are built into the tictactoe executable. A tool is picked by the
+// first argument, for example:
+//
+//      ./tictactoe --build-tablebase 4 4 4 4x4.tb
+//
+// Anything that is not a tool starts the game as usual.
+///////////////////////////////////////////////////////////////////////
+
+#include <QStringList>
+
+bool isCommand(const QStringList &args);        // Is args[0] a tool?
+bool needsWidgets(const QStringList &args);     // Does it make widgets?
+int  runCommand(const QStringList &args);       // Run it, returns exit code
+
+#endif
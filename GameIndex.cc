@@ -0,0 +1,397 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QtEndian>
+#include <string.h>
+
+#include "GameIndex.hh"
+
+static const char INDEX_MAGIC[8] = {'X', 'S', 'N', 'O', 'S', 'G', 'I', '1'};
+
+///////////////////////////////////////////////////////////////////////
+// GameIndex()
+//
+// Constructor. Nothing is open until open() is called.
+///////////////////////////////////////////////////////////////////////
+GameIndex::GameIndex() :
+    map(0),
+    rows(0),
+    cols(0),
+    capacity(0),
+    used(0),
+    games(0),
+    lookups(0),
+    probes(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// ~GameIndex()
+///////////////////////////////////////////////////////////////////////
+GameIndex::~GameIndex()
+{
+    close();
+}
+
+///////////////////////////////////////////////////////////////////////
+// open(const QString &file_name, int rows, int cols)
+//
+// Parameters:  file_name   - The index, made if it does not exist
+//              rows, cols  - The board its games are on, or 0 to take
+//                            whatever an existing index was made for
+//
+// Returns: False if the file could not be opened, is not an index, or
+// is for a different board.
+///////////////////////////////////////////////////////////////////////
+bool
+GameIndex::open(const QString &file_name, int rows, int cols)
+{
+    close();
+    file.setFileName(file_name);
+
+    if (!file.open(QIODevice::ReadWrite)) {
+        error = file_name + ": " + file.errorString();
+        return false;
+    }
+
+    bool fresh = file.size() == 0;
+
+    if (fresh && (rows < 1 || cols < 1)) {
+        error = file_name + ": not a game index";
+        close();
+        return false;
+    }
+    if (fresh && !file.resize(HEADER_SIZE
+                              + qint64(MIN_CAPACITY) * ENTRY_SIZE)) {
+        error = file_name + ": " + file.errorString();
+        close();
+        return false;
+    }
+    if (!mapFile())
+        return false;
+
+    if (fresh) {
+        this->rows = rows;
+        this->cols = cols;
+        capacity   = MIN_CAPACITY;
+        writeHeader();
+        return true;
+    }
+
+    this->rows = qFromLittleEndian<quint32>(map + 8);
+    this->cols = qFromLittleEndian<quint32>(map + 12);
+    capacity   = qFromLittleEndian<quint32>(map + 16);
+    used       = qFromLittleEndian<quint32>(map + 20);
+    games      = qFromLittleEndian<quint64>(map + 24);
+
+    if (memcmp(map, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+            || capacity < MIN_CAPACITY || (capacity & (capacity - 1)) != 0
+            || file.size() < HEADER_SIZE + qint64(capacity) * ENTRY_SIZE
+            || used > capacity / 2) {
+        error = file_name + ": not a game index";
+        close();
+        return false;
+    }
+    if ((rows > 0 && rows != this->rows)
+            || (cols > 0 && cols != this->cols)) {
+        error = QString("%1: made for %2x%3 boards").arg(file_name)
+                .arg(this->rows).arg(this->cols);
+        close();
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// mapFile()
+//
+// Returns: False if the file could not be mapped, after closing it
+///////////////////////////////////////////////////////////////////////
+bool
+GameIndex::mapFile()
+{
+    map = file.map(0, file.size());
+    if (!map) {
+        error = file.fileName() + ": " + file.errorString();
+        close();
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// close()
+//
+// Unmaps and closes the file. The operating system writes the map
+// back in its own time.
+///////////////////////////////////////////////////////////////////////
+void
+GameIndex::close()
+{
+    if (map)
+        file.unmap(map);
+    file.close();
+
+    map      = 0;
+    rows     = 0;
+    cols     = 0;
+    capacity = 0;
+    used     = 0;
+    games    = 0;
+    lookups  = 0;
+    probes   = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Getters
+///////////////////////////////////////////////////////////////////////
+bool
+GameIndex::isOpen() const
+{
+    return map != 0;
+}
+
+QString
+GameIndex::errorString() const
+{
+    return error;
+}
+
+int
+GameIndex::getRows() const
+{
+    return rows;
+}
+
+int
+GameIndex::getCols() const
+{
+    return cols;
+}
+
+quint32
+GameIndex::getUnique() const
+{
+    return used;
+}
+
+quint64
+GameIndex::getGames() const
+{
+    return games;
+}
+
+quint64
+GameIndex::getLookups() const
+{
+    return lookups;
+}
+
+quint64
+GameIndex::getProbes() const
+{
+    return probes;
+}
+
+///////////////////////////////////////////////////////////////////////
+// add(quint64 fingerprint, int length)
+//
+// Parameters:  fingerprint - From fingerprint()
+//              length      - Moves in the game
+//
+// Returns: How many times the game had been played before, so 0 for a
+// new game. Also 0 if the index could not grow to take it.
+///////////////////////////////////////////////////////////////////////
+quint32
+GameIndex::add(quint64 fingerprint, int length)
+{
+    if (!map || ((used + 1) * 2 > capacity && !grow()))
+        return 0;
+
+    uchar   *entry = find(fingerprint, &probes);
+    quint32  times = qFromLittleEndian<quint32>(entry + 8);
+
+    lookups++;
+    if (times == 0) {
+        qToLittleEndian<quint64>(fingerprint, entry);
+        qToLittleEndian<quint32>(length, entry + 12);
+        used++;
+    }
+    qToLittleEndian<quint32>(times + 1, entry + 8);
+    games++;
+    writeHeader();
+    return times;
+}
+
+///////////////////////////////////////////////////////////////////////
+// count(quint64 fingerprint)
+//
+// Returns: How many times the game has been played
+///////////////////////////////////////////////////////////////////////
+quint32
+GameIndex::count(quint64 fingerprint)
+{
+    if (!map)
+        return 0;
+
+    lookups++;
+    return qFromLittleEndian<quint32>(find(fingerprint, &probes) + 8);
+}
+
+///////////////////////////////////////////////////////////////////////
+// find(quint64 fingerprint, quint64 *probes)
+//
+// Parameters:  fingerprint - The game looked for
+//              *probes     - Counted up for each bucket read
+//
+// Returns: The game's entry, or the empty one it would go in
+///////////////////////////////////////////////////////////////////////
+uchar *
+GameIndex::find(quint64 fingerprint, quint64 *probes) const
+{
+    quint32 mask = capacity / BUCKET_ENTRIES - 1;
+
+    for (quint32 bucket = quint32(fingerprint) & mask; ;
+         bucket = (bucket + 1) & mask) {
+        uchar *entry = map + HEADER_SIZE
+                       + qint64(bucket) * BUCKET_ENTRIES * ENTRY_SIZE;
+
+        ++*probes;
+        for (int i = 0; i < BUCKET_ENTRIES; ++i, entry += ENTRY_SIZE) {
+            quint64 key = qFromLittleEndian<quint64>(entry);
+
+            if (key == fingerprint || key == 0)
+                return entry;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// grow()
+//
+// Returns: False if the file could not be made bigger
+//
+// Doubles the table and puts every entry back where it now belongs.
+///////////////////////////////////////////////////////////////////////
+bool
+GameIndex::grow()
+{
+    QByteArray  old(reinterpret_cast<const char *>(map + HEADER_SIZE),
+                    int(capacity * ENTRY_SIZE));
+    quint32     old_capacity = capacity;
+    quint64     ignored      = 0;
+
+    file.unmap(map);
+    map = 0;
+    if (!file.resize(HEADER_SIZE + qint64(old_capacity) * 2 * ENTRY_SIZE)) {
+        error = file.fileName() + ": " + file.errorString();
+        mapFile();
+        return false;
+    }
+    if (!mapFile())
+        return false;
+
+    capacity = old_capacity * 2;
+    memset(map + HEADER_SIZE, 0, size_t(capacity) * ENTRY_SIZE);
+
+    const uchar *entries = reinterpret_cast<const uchar *>(old.constData());
+
+    for (quint32 i = 0; i < old_capacity; ++i) {
+        const uchar *entry = entries + i * ENTRY_SIZE;
+        quint64      key   = qFromLittleEndian<quint64>(entry);
+
+        if (key != 0)
+            memcpy(find(key, &ignored), entry, ENTRY_SIZE);
+    }
+    writeHeader();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// writeHeader()
+///////////////////////////////////////////////////////////////////////
+void
+GameIndex::writeHeader()
+{
+    memcpy(map, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    qToLittleEndian<quint32>(rows, map + 8);
+    qToLittleEndian<quint32>(cols, map + 12);
+    qToLittleEndian<quint32>(capacity, map + 16);
+    qToLittleEndian<quint32>(used, map + 20);
+    qToLittleEndian<quint64>(games, map + 24);
+}
+
+///////////////////////////////////////////////////////////////////////
+// moveCode(const Board &board, const Move &move, int symmetry)
+//
+// Returns: The piece and cell of move once the board is turned by
+// symmetry, as one number
+///////////////////////////////////////////////////////////////////////
+static inline int
+moveCode(const Board &board, const Move &move, int symmetry)
+{
+    int cell = move.row * board.getCols() + move.col;
+
+    return move.state * board.getCellCount() + board.mapCell(symmetry, cell);
+}
+
+///////////////////////////////////////////////////////////////////////
+// fingerprint(const QVector<Move> &moves, const Board &board)
+//
+// Parameters:  moves       - A game that fits on board
+//              board       - Only its size and symmetries are used
+//
+// Returns: A number that is the same for a game and for all its
+// rotations and reflections, and never 0. The game is turned whichever
+// way makes its list of move codes smallest, and that list is hashed
+// with 64 bit FNV-1a and then mixed so the low bits, which pick the
+// bucket, depend on every move.
+///////////////////////////////////////////////////////////////////////
+quint64
+GameIndex::fingerprint(const QVector<Move> &moves, const Board &board)
+{
+    int best = 0;
+
+    for (int s = 1; s < board.getSymmetryCount(); ++s) {
+        for (int i = 0; i < moves.size(); ++i) {
+            int a = moveCode(board, moves[i], s);
+            int b = moveCode(board, moves[i], best);
+
+            if (a != b) {
+                if (a < b)
+                    best = s;
+                break;
+            }
+        }
+    }
+
+    quint64 hash = 14695981039346656037ULL;
+
+    for (int i = 0; i < moves.size(); ++i) {
+        hash ^= quint64(moveCode(board, moves[i], best));
+        hash *= 1099511628211ULL;
+    }
+    hash ^= quint64(moves.size());
+
+    hash = (hash ^ (hash >> 33)) * 0xff51afd7ed558ccdULL;
+    hash = (hash ^ (hash >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash != 0 ? hash : 1;
+}
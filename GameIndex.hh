@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_GAMEINDEX_HH
+#define WF_GAMEINDEX_HH
+
+///////////////////////////////////////////////////////////////////////
+// GameIndex.hh
+//
+// This file contains the declarations for the GameIndex class, an on
+// disk record of which games have been played and how often, with
+// games that are rotations or reflections of each other counted as
+// the same game.
+//
+// The file is laid out as:
+//
+//      "XSNOSGI1"                  magic
+//      quint32 rows, cols          board the games were played on
+//      quint32 capacity            entries, always a power of two
+//      quint32 used                entries filled in
+//      quint64 games               games added, repeats included
+//      padding to 64 bytes
+//      entries[capacity]           quint64 fingerprint, 0 if empty,
+//                                  quint32 times played,
+//                                  quint32 moves in the game
+//
+// All numbers are little endian.
+///////////////////////////////////////////////////////////////////////
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include "Board.hh"
+#include "GameLog.hh"
+
+///////////////////////////////////////////////////////////////////////
+// GameIndex
+//
+// A memory mapped hash table of game fingerprints. The entries come in
+// buckets of four, one cache line each. A game goes in the bucket its
+// fingerprint picks or, if that is full, the first one after it with
+// room. The table is doubled before it gets more than half full, so
+// nearly every lookup is answered by reading one bucket.
+// getProbes() says how many buckets were read.
+///////////////////////////////////////////////////////////////////////
+class GameIndex
+{
+public:
+    enum {
+        HEADER_SIZE    = 64,
+        ENTRY_SIZE     = 16,
+        BUCKET_ENTRIES = 4,                     // 64 bytes
+        MIN_CAPACITY   = 1024
+    };
+
+    GameIndex();
+    ~GameIndex();
+
+    bool            open(const QString &file_name, int rows = 0,
+                         int cols = 0);
+    void            close();
+    bool            isOpen() const;
+    QString         errorString() const;
+
+    int             getRows() const;
+    int             getCols() const;
+    quint32         getUnique() const;          // Different games
+    quint64         getGames() const;           // Games added
+    quint64         getLookups() const;         // Since open()
+    quint64         getProbes() const;          // Buckets read by those
+
+    quint32         add(quint64 fingerprint, int length);
+    quint32         count(quint64 fingerprint);
+
+    static quint64  fingerprint(const QVector<Move> &moves,
+                                const Board &board);
+
+private:
+    GameIndex(const GameIndex &);               // Not copyable
+    GameIndex &operator=(const GameIndex &);
+
+    bool            mapFile();
+    uchar          *find(quint64 fingerprint, quint64 *probes) const;
+    bool            grow();
+    void            writeHeader();
+
+    QFile           file;
+    uchar          *map;
+    int             rows;
+    int             cols;
+    quint32         capacity;
+    quint32         used;
+    quint64         games;
+    quint64         lookups;
+    quint64         probes;
+    QString         error;
+};
+
+#endif
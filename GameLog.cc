@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QRegExp>
+#include <QStringList>
+
+#include "GameLog.hh"
+
+///////////////////////////////////////////////////////////////////////
+// formatGame(const QVector<Move> &moves)
+//
+// Returns: The moves as one line of the log, without the newline
+///////////////////////////////////////////////////////////////////////
+QString
+GameLog::formatGame(const QVector<Move> &moves)
+{
+    QString line;
+
+    for (int i = 0; i < moves.size(); ++i) {
+        if (i > 0)
+            line += ':';
+        line += QString("%1->(%2,%3)")
+                .arg(moves[i].state == GameSpace::X ? 'X' : 'O')
+                .arg(moves[i].row).arg(moves[i].col);
+    }
+    return line;
+}
+
+///////////////////////////////////////////////////////////////////////
+// parseGame(const QString &line, QVector<Move> *moves)
+//
+// Parameters:  line        - One line of the log
+//              moves       - Set to the moves in it
+//
+// Returns: False if the line is not in the log format
+///////////////////////////////////////////////////////////////////////
+bool
+GameLog::parseGame(const QString &line, QVector<Move> *moves)
+{
+    QRegExp     pattern("([XO])->\\((\\d+),(\\d+)\\)");
+    QStringList parts = line.trimmed().split(':', QString::SkipEmptyParts);
+
+    moves->clear();
+
+    for (int i = 0; i < parts.size(); ++i) {
+        if (!pattern.exactMatch(parts[i]))
+            return false;
+
+        Move move;
+        move.state = pattern.cap(1) == "X" ? GameSpace::X : GameSpace::O;
+        move.row   = pattern.cap(2).toInt();
+        move.col   = pattern.cap(3).toInt();
+        moves->append(move);
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// replay(const QVector<Move> &moves, Board *board)
+//
+// Parameters:  moves       - A game from the log
+//              board       - Cleared, then has the moves played on it
+//
+// Returns: False if a move is off the board or on a taken space, which
+// means the log was for a different size of board
+///////////////////////////////////////////////////////////////////////
+bool
+GameLog::replay(const QVector<Move> &moves, Board *board)
+{
+    board->clear();
+
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move &move = moves[i];
+
+        if (move.row < 0 || move.row >= board->getRows()
+                || move.col < 0 || move.col >= board->getCols())
+            return false;
+
+        int cell = move.row * board->getCols() + move.col;
+
+        if (board->getCell(cell) != Board::EMPTY)
+            return false;
+        board->place(cell, Board::Cell(move.state));
+    }
+    return true;
+}
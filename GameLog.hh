@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_GAMELOG_HH
+#define WF_GAMELOG_HH
+
+///////////////////////////////////////////////////////////////////////
+// GameLog.hh
+//
+// This file contains the Move struct and the GameLog class, which
+// reads and writes games in the log format printed on stdout:
+//
+//      {Player}->({row},{col}):{Player}->({row},{col})...
+//
+// with one game per line.
+///////////////////////////////////////////////////////////////////////
+
+#include <QString>
+#include <QVector>
+
+#include "Board.hh"
+#include "GameSpace.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Move
+//
+// This struct represents a move that was played in this game. It is
+// utilized for undo and logging procedures.
+///////////////////////////////////////////////////////////////////////
+struct Move 
+{
+    GameSpace::SpaceState   state; 
+    int                     row;
+    int                     col;
+};
+
+///////////////////////////////////////////////////////////////////////
+// GameLog
+//
+// Turns a game into a line of the log and back again. Anything that
+// reads old logs, rather than playing, should go through here so the
+// format is only spelled out once.
+///////////////////////////////////////////////////////////////////////
+class GameLog
+{
+public:
+    static QString  formatGame(const QVector<Move> &moves);
+    static bool     parseGame(const QString &line, QVector<Move> *moves);
+    static bool     replay(const QVector<Move> &moves, Board *board);
+};
+
+#endif
@@ -18,6 +18,7 @@
 ///////////////////////////////////////////////////////////////////////
 
 #include "GameSpace.hh"
+#include "Artwork.hh"
 
 ///////////////////////////////////////////////////////////////////////
 // GameSpace(int row, int col, QWidget *parent)
@@ -32,11 +33,28 @@ GameSpace::GameSpace(int row, int col, QWidget *parent) :
     QWidget(parent), 
     space_state(GameSpace::EMPTY), 
     row(row), 
-    col(col)
+    col(col),
+    space_size(Artwork::BASE_SIZE),
+    above(0),
+    below(0),
+    settle_start(0),
+    settle_done(1),
+    highlight_start(0),
+    highlighted(false),
+    glow(0)
 {
     setAcceptDrops(true);           // Allow items to be dropped in space
-    setMinimumSize(60, 60);         // We want the spaces to be uniform
-    setMaximumSize(60, 60);         // Nice squares
+    setFixedSize(space_size, space_size); // Uniform squares, see setSize()
+}
+
+///////////////////////////////////////////////////////////////////////
+// ~GameSpace()
+//
+// Destructor. Makes sure the clock does not animate us any more.
+///////////////////////////////////////////////////////////////////////
+GameSpace::~GameSpace()
+{
+    AnimationClock::instance()->stop(this);
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -72,6 +90,53 @@ GameSpace::getCol()
     return col;
 }
 
+///////////////////////////////////////////////////////////////////////
+// pieceFormat()
+//
+// Returns: The MIME type pieces are dragged as. It is made once so the
+// drag and drop handlers do not build a new string for every event.
+///////////////////////////////////////////////////////////////////////
+const QString &
+GameSpace::pieceFormat()
+{
+    static const QString format("image/x-piece");
+
+    return format;
+}
+
+///////////////////////////////////////////////////////////////////////
+// setSize(int size)
+//
+// Parameters:  int         size    - Width and height in pixels
+//
+// Makes the space, and the picture in it, a new size. The picture is
+// scaled once for every space by Artwork, so painting stays a copy.
+///////////////////////////////////////////////////////////////////////
+void
+GameSpace::setSize(int size)
+{
+    space_size = size;
+    setFixedSize(size, size);
+
+    piece_pixmap = artwork(space_state);
+    piece_rect   = rect();
+
+    update();
+}
+
+///////////////////////////////////////////////////////////////////////
+// artwork(SpaceState state)
+//
+// Parameters:  SpaceState  state   - EMPTY, X, or O
+//
+// Returns: The picture for a state at this space's size
+///////////////////////////////////////////////////////////////////////
+const QPixmap &
+GameSpace::artwork(SpaceState state) const
+{
+    return Artwork::get(Artwork::Picture(state), space_size);
+}
+
 ///////////////////////////////////////////////////////////////////////
 // clear()
 //
@@ -80,13 +145,183 @@ GameSpace::getCol()
 void
 GameSpace::clear()
 {
-    QString empty_file_name = ":/images/empty.png";
-    QPixmap empty_pixmap;
-    empty_pixmap.load(empty_file_name);
+    piece_pixmap = artwork(GameSpace::EMPTY);
+    space_state  = GameSpace::EMPTY;
+
+    AnimationClock::instance()->stop(this);
+    settle_start    = 0;
+    settle_done     = 1;
+    highlight_start = 0;
+    highlighted     = false;
+
+    update();
+}
+
+///////////////////////////////////////////////////////////////////////
+// playPiece(bool is_x)
+//
+// Parameters:  bool        is_x    - Play an X?
+//
+// Puts a piece in the space just as if it had been dropped here. This
+// is how the computer player moves, and where a dropped piece ends up.
+///////////////////////////////////////////////////////////////////////
+void
+GameSpace::playPiece(bool is_x)
+{
+    if (space_state != GameSpace::EMPTY)
+        return;
+
+    space_state  = is_x ? GameSpace::X : GameSpace::O;
+    piece_pixmap = artwork(space_state);
+    piece_rect   = rect();
+
+    settle();
+    update();
+
+    emit piecePlayed(space_state, getRow(), getCol());
+}
+
+///////////////////////////////////////////////////////////////////////
+// highlight()
+//
+// Lights the space up as part of a winning line, glowing a few times
+// and then staying lit until it is cleared
+///////////////////////////////////////////////////////////////////////
+void
+GameSpace::highlight()
+{
+    AnimationClock *clock = AnimationClock::instance();
+
+    highlighted = true;
+    glow        = 160;
+
+    if (clock->isEnabled()) {
+        highlight_start = AnimationClock::now();
+        glow            = 0;
+        clock->start(this);
+    }
+    update();
+}
+
+///////////////////////////////////////////////////////////////////////
+// animate(int64_t now)
+//
+// Parameters:  int64_t     now     - The clock's time, in microseconds
+//
+// Works out how far the piece has dropped and how brightly the space
+// glows, and asks for this space to be repainted.
+//
+// Returns: False once there is nothing left to animate
+///////////////////////////////////////////////////////////////////////
+bool
+GameSpace::animate(int64_t now)
+{
+    if (settle_start != 0) {
+        settle_done = qMin(qreal(1), qreal(now - settle_start)
+                                     / SETTLE_MICROS);
+        if (settle_done >= 1)
+            settle_start = 0;
+    }
 
-    piece_pixmap = empty_pixmap;    
+    if (highlight_start != 0) {
+        int64_t since = now - highlight_start;
+        qreal   phase = qreal(since % PULSE_MICROS) / PULSE_MICROS;
+        qreal   level = phase < 0.5 ? 2 * phase : 2 * (1 - phase);
 
-    space_state = GameSpace::EMPTY;
+        // Up and back down again once a pulse, then steady
+        glow = int(80 + 80 * level);
+        if (since >= PULSES * PULSE_MICROS) {
+            highlight_start = 0;
+            glow            = 160;
+        }
+    }
+
+    update();
+    return settle_start != 0 || highlight_start != 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// settle()
+//
+// Starts the piece just put down dropping into place, unless nobody
+// is watching
+///////////////////////////////////////////////////////////////////////
+void
+GameSpace::settle()
+{
+    AnimationClock *clock = AnimationClock::instance();
+
+    if (!clock->isEnabled())
+        return;
+
+    settle_start = AnimationClock::now();
+    settle_done  = 0;
+    clock->start(this);
+}
+
+///////////////////////////////////////////////////////////////////////
+// setColumn(GameSpace *above, GameSpace *below)
+//
+// Parameters:  above       - The space above this one, or 0
+//              below       - The space below this one, or 0
+//
+// Stacks the spaces of a column for the gravity rules. With both 0,
+// as they start out, a piece stays where it is dropped.
+///////////////////////////////////////////////////////////////////////
+void
+GameSpace::setColumn(GameSpace *above, GameSpace *below)
+{
+    this->above = above;
+    this->below = below;
+}
+
+///////////////////////////////////////////////////////////////////////
+// landing()
+//
+// Returns: The space a piece dropped here is played on, or 0 if there
+// is none. Without a column that is this space if it is empty. In a
+// column it is the lowest empty space, which is found by falling from
+// an empty space or climbing from a full one, as the pieces in a
+// column are always stacked from the bottom.
+///////////////////////////////////////////////////////////////////////
+GameSpace *
+GameSpace::landing()
+{
+    GameSpace *space = this;
+
+    if (space_state != GameSpace::EMPTY) {
+        while (space && space->space_state != GameSpace::EMPTY)
+            space = space->above;
+        return space;
+    }
+
+    while (space->below && space->below->space_state == GameSpace::EMPTY)
+        space = space->below;
+    return space;
+}
+
+///////////////////////////////////////////////////////////////////////
+// setState(SpaceState state)
+//
+// Parameters:  SpaceState  state   - What the space should hold
+//
+// Shows a state without anyone having played it, so no piecePlayed()
+// signal is sent. This is for setting up positions rather than moves.
+///////////////////////////////////////////////////////////////////////
+void
+GameSpace::setState(SpaceState state)
+{
+    if (state == space_state)
+        return;
+
+    if (state == GameSpace::EMPTY) {
+        clear();
+        return;
+    }
+
+    piece_pixmap = artwork(state);
+    piece_rect   = rect();
+    space_state  = state;
 
     update();
 }
@@ -96,15 +331,21 @@ GameSpace::clear()
 //
 // Parameters:  *event      - The drag event
 //
-// Only accept tictactoe pieces
+// Only accept tictactoe pieces. Lets the MainWindow know where the
+// piece is hovering, so the computer can think about that move first.
 ///////////////////////////////////////////////////////////////////////
 void
 GameSpace::dragEnterEvent(QDragEnterEvent *event)
 {
-    if (event->mimeData()->hasFormat("image/x-piece"))
+    if (event->mimeData()->hasFormat(pieceFormat())) {
+        GameSpace *target = landing();
+
         event->accept();
-    else
+        if (target)
+            emit pieceHovered(target->getRow(), target->getCol());
+    } else {
         event->ignore();
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -129,7 +370,7 @@ GameSpace::dragLeaveEvent(QDragLeaveEvent *event)
 void
 GameSpace::dragMoveEvent(QDragMoveEvent *event)
 {
-    if (event->mimeData()->hasFormat("image/x-piece")) {
+    if (event->mimeData()->hasFormat(pieceFormat())) {
         event->setDropAction(Qt::MoveAction);
         event->accept();
     } else {
@@ -142,46 +383,34 @@ GameSpace::dragMoveEvent(QDragMoveEvent *event)
 //
 // Parameters: *event       - The drag event
 //
-// If the item is a tictactoe piece and the space is currently in the
-// EMPTY state, then allow the piece to be placed here. When the piece
-// is placed change the spaces state, emit the appropriate signals to
-// the MainWindow, and repaint the square to represent the new image.
+// If the item is a tictactoe piece and there is an EMPTY space for it,
+// which is this one unless the gravity rules are in play, then allow
+// the piece to be placed there. Playing it changes that space's state,
+// emits the appropriate signals to the MainWindow, and repaints it.
 ///////////////////////////////////////////////////////////////////////
 void
 GameSpace::dropEvent(QDropEvent *event)
 {
-    if (event->mimeData()->hasFormat("image/x-piece")
-            && space_state == GameSpace::EMPTY) {
+    GameSpace *target = event->mimeData()->hasFormat(pieceFormat())
+                        ? landing() : 0;
 
-        // piece_data  - The mimetype of the tictactoe pieces
-        // data_stream - An IO stream that is used to write to the space
-        // square      - A geometric space that we repaint after a state change
-        QByteArray  piece_data = event->mimeData()->data("image/x-piece");
-        QDataStream data_stream(&piece_data, QIODevice::ReadOnly);
-        QRect       square = QRect(event->pos().x()/60 * 60,
-                                   event->pos().y()/60 * 60,
-                                   60 , 60);
-        QPixmap     pixmap;             // The pixmap to that is being dropped
-        bool        is_x;               // Is the object an X?
+    if (target) {
 
-        data_stream >> pixmap >> is_x;  // Write the data to the variables
+        // piece_data  - The mimetype of the tictactoe pieces
+        QByteArray  piece_data = event->mimeData()->data(pieceFormat());
 
-        piece_pixmap = pixmap;          // Update the squares image
-        piece_rect   = square;          // Draw the square
+        // The data is the piece's pixmap and then whether it is an X,
+        // which QDataStream writes as one byte. Only that byte is read;
+        // decoding the pixmap would mean unpacking a PNG on every drop
+        // when the same picture is already loaded.
+        bool        is_x = !piece_data.isEmpty()
+                           && piece_data.at(piece_data.size() - 1) != 0;
 
         event->setDropAction(Qt::MoveAction);
         event->accept();
 
-        update(square);
-
-        // Emit the appropriate signals and set the state
-        if (is_x) {
-            space_state = GameSpace::X;
-            emit piecePlayed(true, getRow(), getCol());
-        } else {
-            space_state = GameSpace::O;
-            emit piecePlayed(false, getRow(), getCol());
-        }
+        // Set the state and tell everyone
+        target->playPiece(is_x);
 
     } else {
         event->ignore();
@@ -201,7 +430,21 @@ GameSpace::paintEvent(QPaintEvent * event)
     QPainter painter;                               // The painting machine
     painter.begin(this);                            // Start painting
     painter.fillRect(event->rect(), Qt::white);     // Paint the square white
+
+    if (highlighted)
+        painter.fillRect(rect(), QColor(255, 215, 0, glow));
+
+    // A piece still settling falls from a quarter of the way up, slowing
+    // as it lands, and fades in as it goes
+    QPoint  at   = piece_rect.topLeft();
+    qreal   left = 1 - settle_done;
+
+    if (settle_start != 0) {
+        at.ry() -= int(left * left * height() / 4);
+        painter.setOpacity(0.4 + 0.6 * settle_done);
+    }
     
-    painter.drawPixmap(piece_rect, piece_pixmap);   // Paint the piece image
+    // The pixmap is already the size of the space, so this is a copy
+    painter.drawPixmap(at, piece_pixmap);
     painter.end();
 }
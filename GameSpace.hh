@@ -33,6 +33,8 @@
 #include <QPoint>       // Specifies the area drag/drop events take place
 #include <QWidget>      // The parent class
 
+#include "AnimationClock.hh"
+
 class QDragEnterEvent;
 class QDropEvent;
 class QMouseEvent;
@@ -42,23 +44,49 @@ class QMouseEvent;
 //
 // A class whose objects represent a space on a tictactoe board. Can
 // exist in one of three states: EMPTY, X, or O.
+//
+// A piece that is played drops into place and fades in over a few
+// frames, and the spaces of a winning line glow. Both are moved along
+// by the AnimationClock and only ever repaint this space. The state
+// changes and piecePlayed() is sent straight away; only the picture
+// catches up later.
+//
+// Under the gravity rules each space knows the ones above and below
+// it, and a piece dropped anywhere in a column is played on the lowest
+// empty space of that column instead.
 ///////////////////////////////////////////////////////////////////////
-class GameSpace : public QWidget
+class GameSpace : public QWidget, public Animated
 {
     Q_OBJECT            // A macro used by Qt
 
 public:
     enum SpaceState {EMPTY, X, O};              // The state the space is in
+
+    enum {
+        SETTLE_MICROS = 150000,                 // A piece dropping in
+        PULSE_MICROS  = 400000,                 // One glow of a win
+        PULSES        = 3                       // Then it stays lit
+    };
     
     GameSpace(int row, int col, QWidget *parent = 0);   // Constructor
+    ~GameSpace();
     GameSpace::SpaceState getState();           // Getter for the current state
     int                   getRow();             // Getter for the row
     int                   getCol();             // Getter for the column
     void                  clear();              // Clear the space
+    void                  playPiece(bool is_x); // Play without dragging
+    void                  setState(SpaceState state); // Show a state, quietly
+    void                  setSize(int size);    // Width and height
+    void                  highlight();          // Part of a winning line
+    void                  setColumn(GameSpace *above, GameSpace *below);
+    bool                  animate(int64_t now); // For the AnimationClock
+
+    static const QString &pieceFormat();        // MIME type of a dragged piece
 
 // Signals are used by Qt to communicate with Slots in other objects
 signals:
-    void piecePlayed(bool, int, int);           // A piece was played
+    void piecePlayed(GameSpace::SpaceState, int, int); // A piece was played
+    void pieceHovered(int, int);                // A piece was dragged in
 
 protected:
     void dragEnterEvent(QDragEnterEvent *event); // Begin dragging
@@ -68,10 +96,24 @@ protected:
     void paintEvent(QPaintEvent *event);        // How square is drawn
 
 private:
+    const QPixmap &artwork(SpaceState state) const; // At our size
+    void           settle();                    // Start a piece dropping in
+    GameSpace     *landing();                   // Where a drop here goes
+
     QPixmap        piece_pixmap;                // Image used in space
     QRect          piece_rect;                  // Rect that is updated
     SpaceState     space_state;                 // State of the space
     int            row;                         // Row in grid
     int            col;                         // Column in grid
+    int            space_size;                  // Width and height
+    GameSpace     *above;                       // Neighbours in the column,
+    GameSpace     *below;                       // under the gravity rules
+
+    // Animations, each with its start time or 0 when not running
+    int64_t        settle_start;
+    qreal          settle_done;                 // 0 to 1
+    int64_t        highlight_start;
+    bool           highlighted;
+    int            glow;                        // Alpha of the highlight
 };
 #endif
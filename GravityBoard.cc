@@ -0,0 +1,395 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include "GravityBoard.hh"
+
+///////////////////////////////////////////////////////////////////////
+// toward(uint64_t bits, int offset)
+//
+// Parameters:  bits        - A set of cells
+//              offset      - How many bits along to look
+//
+// Returns: bits moved so that whatever was at cell + offset is at
+// cell, with nothing coming in from off the end
+///////////////////////////////////////////////////////////////////////
+static inline uint64_t
+toward(uint64_t bits, int offset)
+{
+    if (offset >= GravityBoard::BITS || offset <= -GravityBoard::BITS)
+        return 0;
+    return offset >= 0 ? bits >> offset : bits << -offset;
+}
+
+///////////////////////////////////////////////////////////////////////
+// GravityBoard(int rows, int cols, int win_length)
+//
+// Parameters:  rows, cols  - Size of the board, which must fit()
+//              win_length  - How many in a row wins
+///////////////////////////////////////////////////////////////////////
+GravityBoard::GravityBoard(int rows, int cols, int win_length) :
+    rows(rows),
+    cols(cols),
+    win_length(win_length),
+    height(rows + 1),
+    bottom(0),
+    cells(0)
+{
+    for (int col = 0; col < cols; ++col) {
+        bottom |= uint64_t(1) << (col * height);
+        cells  |= columnMask(col);
+    }
+
+    directions[0] = 1;                          // Up a column
+    directions[1] = height;                     // Along a row
+    directions[2] = height + 1;                 // Up and to the right
+    directions[3] = height - 1;                 // Down and to the right
+
+    clear();
+}
+
+///////////////////////////////////////////////////////////////////////
+// fits(int rows, int cols)
+//
+// Returns: True if a board that size fits in the masks
+///////////////////////////////////////////////////////////////////////
+bool
+GravityBoard::fits(int rows, int cols)
+{
+    return rows > 0 && cols > 0 && cols * (rows + 1) <= BITS;
+}
+
+///////////////////////////////////////////////////////////////////////
+// isSettled(const Board &board)
+//
+// Parameters:  board       - Any size of board
+//
+// Returns: True if every piece is on the bottom row or on top of
+// another piece, as it must be under the gravity rules
+///////////////////////////////////////////////////////////////////////
+bool
+GravityBoard::isSettled(const Board &board)
+{
+    int rows = board.getRows();
+    int cols = board.getCols();
+
+    for (int row = 0; row < rows - 1; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            if (board.getCell(row, col) != Board::EMPTY
+                    && board.getCell(row + 1, col) == Board::EMPTY)
+                return false;
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// fromBoard(const Board &board)
+//
+// Parameters:  board       - The same size as this one
+//
+// Returns: False if the board is a different size or has pieces in
+// mid air, leaving this one cleared
+///////////////////////////////////////////////////////////////////////
+bool
+GravityBoard::fromBoard(const Board &board)
+{
+    clear();
+
+    if (board.getRows() != rows || board.getCols() != cols
+            || !isSettled(board))
+        return false;
+
+    for (int col = 0; col < cols; ++col) {
+        for (int row = rows - 1; row >= 0; --row) {
+            Board::Cell piece = board.getCell(row, col);
+
+            if (piece == Board::EMPTY)
+                break;
+
+            uint64_t bit = uint64_t(1) << (col * height + rows - 1 - row);
+
+            pieces[piece] |= bit;
+            mask          |= bit;
+            moves++;
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// clear()
+//
+// Takes every piece off
+///////////////////////////////////////////////////////////////////////
+void
+GravityBoard::clear()
+{
+    pieces[Board::EMPTY] = 0;
+    pieces[Board::X]     = 0;
+    pieces[Board::O]     = 0;
+    mask                 = 0;
+    moves                = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Getters
+///////////////////////////////////////////////////////////////////////
+int
+GravityBoard::getRows() const
+{
+    return rows;
+}
+
+int
+GravityBoard::getCols() const
+{
+    return cols;
+}
+
+int
+GravityBoard::getWinLength() const
+{
+    return win_length;
+}
+
+int
+GravityBoard::getMoveCount() const
+{
+    return moves;
+}
+
+uint64_t
+GravityBoard::getPieces(Board::Cell player) const
+{
+    return pieces[player];
+}
+
+uint64_t
+GravityBoard::getMask() const
+{
+    return mask;
+}
+
+///////////////////////////////////////////////////////////////////////
+// toMove()
+//
+// Returns: Whose turn it is, going by how many pieces are down
+///////////////////////////////////////////////////////////////////////
+Board::Cell
+GravityBoard::toMove() const
+{
+    return moves % 2 == 0 ? Board::X : Board::O;
+}
+
+///////////////////////////////////////////////////////////////////////
+// landingRow(int col)
+//
+// Returns: The row, counted from the top, a piece dropped in col would
+// land in, or -1 if the column is full
+///////////////////////////////////////////////////////////////////////
+int
+GravityBoard::landingRow(int col) const
+{
+    if (!canPlay(col))
+        return -1;
+    return rows - 1 - count(mask & columnMask(col));
+}
+
+///////////////////////////////////////////////////////////////////////
+// key()
+//
+// Returns: A number that differs for every position on this size of
+// board. The mask says which cells are taken, and adding the player to
+// move's pieces, which are all inside it, says whose they are.
+///////////////////////////////////////////////////////////////////////
+uint64_t
+GravityBoard::key() const
+{
+    return mask + pieces[toMove()];
+}
+
+///////////////////////////////////////////////////////////////////////
+// canPlay(int col)
+//
+// Returns: True if col has room
+///////////////////////////////////////////////////////////////////////
+bool
+GravityBoard::canPlay(int col) const
+{
+    return (mask & (uint64_t(1) << (col * height + rows - 1))) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// play(int col)
+//
+// Parameters:  col         - A column with room
+//
+// Drops a piece for the player to move
+///////////////////////////////////////////////////////////////////////
+void
+GravityBoard::play(int col)
+{
+    uint64_t bit = (mask + (uint64_t(1) << (col * height)))
+                   & columnMask(col);
+
+    pieces[toMove()] |= bit;
+    mask             |= bit;
+    moves++;
+}
+
+///////////////////////////////////////////////////////////////////////
+// undo(int col)
+//
+// Parameters:  col         - The column last played in
+//
+// Takes the top piece of col back off
+///////////////////////////////////////////////////////////////////////
+void
+GravityBoard::undo(int col)
+{
+    uint64_t column = mask & columnMask(col);
+    uint64_t bit    = (column + (uint64_t(1) << (col * height))) >> 1;
+
+    moves--;
+    pieces[toMove()] &= ~bit;
+    mask             &= ~bit;
+}
+
+///////////////////////////////////////////////////////////////////////
+// hasLine(Board::Cell player)
+//
+// Returns: True if player has win_length in a row anywhere
+///////////////////////////////////////////////////////////////////////
+bool
+GravityBoard::hasLine(Board::Cell player) const
+{
+    return line(pieces[player]);
+}
+
+///////////////////////////////////////////////////////////////////////
+// isFull()
+//
+// Returns: True if there is nowhere left to play
+///////////////////////////////////////////////////////////////////////
+bool
+GravityBoard::isFull() const
+{
+    return mask == cells;
+}
+
+///////////////////////////////////////////////////////////////////////
+// playable()
+//
+// Returns: The cell each column with room would take its next piece in
+///////////////////////////////////////////////////////////////////////
+uint64_t
+GravityBoard::playable() const
+{
+    return (mask + bottom) & cells;
+}
+
+///////////////////////////////////////////////////////////////////////
+// winningCells(Board::Cell player)
+//
+// Returns: Every empty cell, playable yet or not, where a piece of
+// player's would complete a line. For each direction and each place
+// in a line the empty cell could be, the rest of the line is shifted
+// onto it and ANDed together.
+///////////////////////////////////////////////////////////////////////
+uint64_t
+GravityBoard::winningCells(Board::Cell player) const
+{
+    uint64_t own    = pieces[player];
+    uint64_t result = 0;
+
+    for (int d = 0; d < 4; ++d) {
+        int step = directions[d];
+
+        for (int gap = 0; gap < win_length; ++gap) {
+            uint64_t found = cells;
+
+            for (int i = 0; i < win_length && found; ++i) {
+                if (i != gap)
+                    found &= toward(own, (i - gap) * step);
+            }
+            result |= found;
+        }
+    }
+    return result & cells & ~mask;
+}
+
+///////////////////////////////////////////////////////////////////////
+// columnMask(int col)
+//
+// Returns: Every cell of col
+///////////////////////////////////////////////////////////////////////
+uint64_t
+GravityBoard::columnMask(int col) const
+{
+    return ((uint64_t(1) << rows) - 1) << (col * height);
+}
+
+///////////////////////////////////////////////////////////////////////
+// columnOf(uint64_t bit)
+//
+// Parameters:  bit         - A single cell
+//
+// Returns: The column it is in
+///////////////////////////////////////////////////////////////////////
+int
+GravityBoard::columnOf(uint64_t bit) const
+{
+    return count(bit - 1) / height;
+}
+
+///////////////////////////////////////////////////////////////////////
+// count(uint64_t bits)
+//
+// Returns: How many bits are set
+///////////////////////////////////////////////////////////////////////
+int
+GravityBoard::count(uint64_t bits)
+{
+    int n = 0;
+
+    for (; bits; bits &= bits - 1)
+        n++;
+    return n;
+}
+
+///////////////////////////////////////////////////////////////////////
+// line(uint64_t bits)
+//
+// Returns: True if win_length cells in a row are set in bits. Each
+// AND keeps the cells that have the next cell along set as well.
+///////////////////////////////////////////////////////////////////////
+bool
+GravityBoard::line(uint64_t bits) const
+{
+    for (int d = 0; d < 4; ++d) {
+        uint64_t found = bits;
+
+        for (int i = 1; i < win_length && found; ++i)
+            found &= toward(bits, i * directions[d]);
+        if (found)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_GRAVITYBOARD_HH
+#define WF_GRAVITYBOARD_HH
+
+///////////////////////////////////////////////////////////////////////
+// GravityBoard.hh
+//
+// This file contains the declarations for the GravityBoard class, a
+// bitboard for the gravity rules, where pieces drop to the bottom of
+// their column as in Connect Four.
+///////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+
+#include "Board.hh"
+
+///////////////////////////////////////////////////////////////////////
+// GravityBoard
+//
+// Each side's pieces are one 64 bit mask, a column at a time from the
+// left, rows + 1 bits a column with the bottom row lowest. The extra
+// bit at the top of each column is always clear, so a line that runs
+// off one column and into the next always passes through an empty
+// bit. Finding a line is then win_length - 1 shifts and ANDs in each
+// of the four directions.
+//
+// The column heights need no counters of their own: adding a column's
+// bottom bit to the mask of every piece carries up to the first empty
+// cell, so the cell a piece lands on is (mask + bottom) & column, and
+// the cells that can be played next are the same sum over every
+// column at once. A column is full when its top cell is in the mask.
+//
+// Only boards with cols * (rows + 1) <= 64 fit; 6x7 uses 49 bits.
+// Rows are numbered from the top, as in Board, outside this class.
+///////////////////////////////////////////////////////////////////////
+class GravityBoard
+{
+public:
+    enum {BITS = 64};
+
+    GravityBoard(int rows = 6, int cols = 7, int win_length = 4);
+
+    static bool fits(int rows, int cols);
+    static bool isSettled(const Board &board);  // No piece in mid air
+
+    bool        fromBoard(const Board &board);
+    void        clear();
+
+    int         getRows() const;
+    int         getCols() const;
+    int         getWinLength() const;
+    int         getMoveCount() const;
+    Board::Cell toMove() const;                 // X moves first
+    int         landingRow(int col) const;      // -1 if the column is full
+    uint64_t    key() const;                    // Unique for the position
+
+    bool        canPlay(int col) const;
+    void        play(int col);                  // For the player to move
+    void        undo(int col);                  // The top piece of col
+    bool        hasLine(Board::Cell player) const;
+    bool        isFull() const;
+
+    uint64_t    getPieces(Board::Cell player) const;
+    uint64_t    getMask() const;                // Every piece
+    uint64_t    playable() const;               // Where pieces would land
+    uint64_t    winningCells(Board::Cell player) const; // Empty, complete
+                                                // a line for player
+    uint64_t    columnMask(int col) const;
+    int         columnOf(uint64_t bit) const;
+
+    static int  count(uint64_t bits);
+
+private:
+    bool        line(uint64_t bits) const;
+
+    int         rows;
+    int         cols;
+    int         win_length;
+    int         height;                         // rows + 1
+    int         moves;
+    uint64_t    pieces[3];                      // By Board::Cell, EMPTY unused
+    uint64_t    mask;                           // pieces[X] | pieces[O]
+    uint64_t    bottom;                         // Bottom cell of each column
+    uint64_t    cells;                          // Every cell, no spare bits
+    int         directions[4];                  // Bit steps along a line
+};
+
+#endif
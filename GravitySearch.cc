@@ -0,0 +1,537 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+
+#include "GravitySearch.hh"
+#include "Search.hh"
+
+///////////////////////////////////////////////////////////////////////
+// centreOrder(int cols, int *order)
+//
+// Parameters:  cols        - Columns on the board
+//              order       - Filled with every column, middle first
+//                            and working out to the edges
+///////////////////////////////////////////////////////////////////////
+static void
+centreOrder(int cols, int *order)
+{
+    for (int i = 0; i < cols; ++i)
+        order[i] = cols / 2 + (i % 2 == 0 ? i / 2 : -(i + 1) / 2);
+}
+
+///////////////////////////////////////////////////////////////////////
+// GravitySearch(int table_bits)
+//
+// Parameters:  int     table_bits  - The transposition table holds
+//                                    2^table_bits entries
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+GravitySearch::GravitySearch(int table_bits) :
+    table(size_t(1) << table_bits),
+    table_bits(table_bits),
+    stopped(false),
+    interrupted(0),
+    nodes(0),
+    score(0),
+    depth_reached(0),
+    solved(false),
+    root_best(-1),
+    start_time(0),
+    deadline(0),
+    elapsed(0)
+{
+    centreOrder(position.getCols(), centre_order);
+    clearTable();
+}
+
+///////////////////////////////////////////////////////////////////////
+// Getters
+///////////////////////////////////////////////////////////////////////
+int
+GravitySearch::getScore() const
+{
+    return score;
+}
+
+uint64_t
+GravitySearch::getNodes() const
+{
+    return nodes;
+}
+
+int
+GravitySearch::getDepth() const
+{
+    return depth_reached;
+}
+
+int
+GravitySearch::getElapsed() const
+{
+    return int(elapsed / 1000);
+}
+
+bool
+GravitySearch::isSolved() const
+{
+    return solved;
+}
+
+bool
+GravitySearch::isStopped() const
+{
+    return interrupted != 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// stop()
+//
+// Asks a running findMove() to return, or the next one not to start,
+// until clearStop(). Safe to call from any thread.
+///////////////////////////////////////////////////////////////////////
+void
+GravitySearch::stop()
+{
+    interrupted.fetchAndStoreOrdered(1);
+}
+
+///////////////////////////////////////////////////////////////////////
+// clearStop()
+//
+// Forgets an earlier stop(), so the next findMove() can run
+///////////////////////////////////////////////////////////////////////
+void
+GravitySearch::clearStop()
+{
+    interrupted.fetchAndStoreOrdered(0);
+}
+
+///////////////////////////////////////////////////////////////////////
+// clearTable()
+//
+// Forgets everything in the transposition table
+///////////////////////////////////////////////////////////////////////
+void
+GravitySearch::clearTable()
+{
+    Entry empty = {0, 0, -1, -1, NONE};
+
+    std::fill(table.begin(), table.end(), empty);
+}
+
+///////////////////////////////////////////////////////////////////////
+// findMove(const Board &board, int time_limit)
+//
+// Parameters:  board           - The position, with every piece
+//                                resting on another or the bottom
+//              int time_limit  - Milliseconds allowed, 0 for no limit
+//
+// Returns: The cell the player to move should drop a piece in, or -1
+// if there are no moves or the board does not fit a GravityBoard. If
+// time runs out or stop() is called, the best move found so far is
+// returned.
+///////////////////////////////////////////////////////////////////////
+int
+GravitySearch::findMove(const Board &board, int time_limit)
+{
+    int         cols[MAX_COLS];
+    int         count;
+    int         best = -1;
+    int         rows = board.getRows();
+    int         width = board.getCols();
+
+    stopped       = interrupted != 0;
+    nodes         = 0;
+    score         = 0;
+    depth_reached = 0;
+    solved        = false;
+    start_time    = Search::monotonicMicros();
+    deadline      = time_limit > 0 ? start_time + int64_t(time_limit) * 1000 : 0;
+
+    if (!GravityBoard::fits(rows, width) || board.isOver()) {
+        elapsed = Search::monotonicMicros() - start_time;
+        return -1;
+    }
+
+    // A different game, so nothing in the table applies
+    if (position.getRows() != rows || position.getCols() != width
+            || position.getWinLength() != board.getWinLength()) {
+        position = GravityBoard(rows, width, board.getWinLength());
+        centreOrder(width, centre_order);
+        clearTable();
+    }
+
+    if (!position.fromBoard(board)) {
+        elapsed = Search::monotonicMicros() - start_time;
+        return -1;
+    }
+
+    Board::Cell me       = position.toMove();
+    Board::Cell them     = Board::opponent(me);
+    uint64_t    playable = position.playable();
+    uint64_t    wins     = position.winningCells(me) & playable;
+    uint64_t    threats  = position.winningCells(them);
+    uint64_t    allowed  = playable;
+
+    if (wins) {
+        best          = position.columnOf(wins & (~wins + 1));
+        score         = WIN_SCORE - 1;
+        depth_reached = 1;
+        solved        = true;
+    } else {
+        // Block if we must, and never play under a win for them; if
+        // every move loses, any will do
+        if (threats & playable)
+            allowed = threats & playable;
+        if (allowed & ~(threats >> 1))
+            allowed &= ~(threats >> 1);
+
+        Entry &root = probe(position.key());
+
+        count = sortMoves(allowed, root.key == position.key() ? root.move
+                                                              : -1, cols);
+        best  = count > 0 ? cols[0] : -1;
+
+        int empty = rows * width - position.getMoveCount();
+
+        for (int depth = 1; depth <= empty && count > 0; ++depth) {
+            int value = searchRoot(depth, -INFINITE, INFINITE, cols, count);
+
+            // The previous best move is always searched first, so
+            // whatever beat it in an unfinished iteration is better
+            if (stopped) {
+                if (root_best >= 0)
+                    best = root_best;
+                break;
+            }
+
+            best          = root_best;
+            score         = value;
+            depth_reached = depth;
+
+            // Every line of play was followed to its end
+            if (value > MATE_BOUND || value < -MATE_BOUND
+                    || depth == empty) {
+                solved = true;
+                break;
+            }
+
+            // Not worth starting an iteration that can not finish
+            if (deadline && (Search::monotonicMicros() - start_time) * 2
+                            > deadline - start_time)
+                break;
+        }
+    }
+
+    elapsed = Search::monotonicMicros() - start_time;
+    if (best < 0)
+        return -1;
+    return position.landingRow(best) * width + best;
+}
+
+///////////////////////////////////////////////////////////////////////
+// orderMoves(const Board &board, int *moves)
+//
+// Parameters:  board       - Any size of board
+//              moves       - Filled with the cell each column with
+//                            room would take a piece in, middle
+//                            columns first
+//
+// Returns: How many moves there are
+///////////////////////////////////////////////////////////////////////
+int
+GravitySearch::orderMoves(const Board &board, int *moves)
+{
+    int rows  = board.getRows();
+    int width = board.getCols();
+    int order[Board::MAX_CELLS];
+    int count = 0;
+
+    centreOrder(width, order);
+
+    for (int i = 0; i < width; ++i) {
+        int col = order[i];
+        int row = rows - 1;
+
+        while (row >= 0 && board.getCell(row, col) != Board::EMPTY)
+            --row;
+        if (row >= 0)
+            moves[count++] = row * width + col;
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// searchRoot(int depth, int alpha, int beta, int *cols, int count)
+//
+// Parameters:  int depth   - Plies to search
+//              int alpha   - Bottom of the window
+//              int beta    - Top of the window
+//              int *cols   - The moves from the root, best first. The
+//                            best move of this iteration is moved to
+//                            the front.
+//              int count   - How many moves there are
+//
+// Returns: The score of the best move
+///////////////////////////////////////////////////////////////////////
+int
+GravitySearch::searchRoot(int depth, int alpha, int beta, int *cols,
+                          int count)
+{
+    int best  = -INFINITE;
+    int index = 0;
+
+    root_best = -1;
+
+    for (int i = 0; i < count; ++i) {
+        position.play(cols[i]);
+        int value = -alphaBeta(depth - 1, -beta, -alpha, 1);
+        position.undo(cols[i]);
+
+        if (stopped)
+            break;
+
+        if (value > best) {
+            best      = value;
+            index     = i;
+            root_best = cols[i];
+        }
+        if (value > alpha)
+            alpha = value;
+        if (alpha >= beta)
+            break;
+    }
+
+    // Try the best move first next time
+    if (root_best >= 0) {
+        for (int i = index; i > 0; --i)
+            cols[i] = cols[i - 1];
+        cols[0] = root_best;
+    }
+
+    return best;
+}
+
+///////////////////////////////////////////////////////////////////////
+// alphaBeta(int depth, int alpha, int beta, int ply)
+//
+// Parameters:  int depth   - Plies left to search
+//              int alpha   - The score we already have
+//              int beta    - The score the opponent already has
+//              int ply     - Plies from the root
+//
+// Returns: The score of the position for the player to move. Nobody
+// has a line yet, as a move that makes one is never played.
+///////////////////////////////////////////////////////////////////////
+int
+GravitySearch::alphaBeta(int depth, int alpha, int beta, int ply)
+{
+    int         cols[MAX_COLS];
+    int         count;
+    int         best       = -INFINITE;
+    int         best_move  = -1;
+    int         orig_alpha = alpha;
+
+    if ((++nodes & CHECK_NODES) == 0 && outOfTime())
+        stopped = true;
+
+    if (stopped)
+        return 0;
+
+    Board::Cell me       = position.toMove();
+    Board::Cell them     = Board::opponent(me);
+    uint64_t    playable = position.playable();
+
+    // A full board, or a win on the next move
+    if (playable == 0)
+        return 0;
+    if (position.winningCells(me) & playable)
+        return WIN_SCORE - (ply + 1);
+
+    // Two wins for them can not both be blocked, one must be, and a
+    // piece under a cell that wins for them lets them have it
+    uint64_t threats = position.winningCells(them);
+    uint64_t forced  = threats & playable;
+    uint64_t allowed = forced ? forced : playable;
+
+    if (forced & (forced - 1))
+        return -(WIN_SCORE - (ply + 2));
+    allowed &= ~(threats >> 1);
+    if (allowed == 0)
+        return -(WIN_SCORE - (ply + 2));
+
+    if (depth <= 0)
+        return evaluate();
+
+    uint64_t key   = position.key();
+    Entry   &entry = probe(key);
+    int      hint  = -1;
+
+    if (entry.key == key) {
+        hint = entry.move;
+
+        if (entry.depth >= depth) {
+            int stored = entry.score;
+
+            // Wins are stored as distance from the stored position
+            if (stored > MATE_BOUND)
+                stored -= ply;
+            else if (stored < -MATE_BOUND)
+                stored += ply;
+
+            if (entry.bound == EXACT)
+                return stored;
+            if (entry.bound == LOWER && stored > alpha)
+                alpha = stored;
+            else if (entry.bound == UPPER && stored < beta)
+                beta = stored;
+            if (alpha >= beta)
+                return stored;
+        }
+    }
+
+    count = sortMoves(allowed, hint, cols);
+
+    for (int i = 0; i < count; ++i) {
+        position.play(cols[i]);
+        int value = -alphaBeta(depth - 1, -beta, -alpha, ply + 1);
+        position.undo(cols[i]);
+
+        if (stopped)
+            return 0;
+
+        if (value > best) {
+            best      = value;
+            best_move = cols[i];
+        }
+        if (value > alpha)
+            alpha = value;
+        if (alpha >= beta)
+            break;
+    }
+
+    // Always replace, the newest search knows the most
+    Entry &slot   = probe(key);
+    int    stored = best;
+
+    if (stored > MATE_BOUND)
+        stored += ply;
+    else if (stored < -MATE_BOUND)
+        stored -= ply;
+
+    slot.key   = key;
+    slot.score = short(stored);
+    slot.move  = (signed char)(best_move);
+    slot.depth = (signed char)(depth);
+    slot.bound = best <= orig_alpha ? UPPER : best >= beta ? LOWER : EXACT;
+
+    return best;
+}
+
+///////////////////////////////////////////////////////////////////////
+// sortMoves(uint64_t allowed, int hint, int *cols)
+//
+// Parameters:  allowed     - The playable cells worth trying
+//              int hint    - A column to try first, or -1
+//              int *cols   - Filled with the columns to play, best
+//                            first
+//
+// Returns: How many columns there are. The hint goes first, then the
+// moves that leave the most cells where we would complete a line,
+// middle columns first between equals.
+///////////////////////////////////////////////////////////////////////
+int
+GravitySearch::sortMoves(uint64_t allowed, int hint, int *cols)
+{
+    Board::Cell me = position.toMove();
+    int         keys[MAX_COLS];
+    int         count = 0;
+
+    for (int i = 0; i < position.getCols(); ++i) {
+        int col = centre_order[i];
+        int key;
+
+        if ((allowed & position.columnMask(col)) == 0)
+            continue;
+
+        if (col == hint) {
+            key = INFINITE;
+        } else {
+            position.play(col);
+            key = GravityBoard::count(position.winningCells(me));
+            position.undo(col);
+        }
+
+        // Insertion sort, keeping the centre order between equals
+        int j = count++;
+
+        for (; j > 0 && keys[j - 1] < key; --j) {
+            keys[j] = keys[j - 1];
+            cols[j] = cols[j - 1];
+        }
+        keys[j] = key;
+        cols[j] = col;
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// evaluate()
+//
+// Returns: A guess at how good the position is for the player to
+// move, from how many empty cells would complete a line for each side
+///////////////////////////////////////////////////////////////////////
+int
+GravitySearch::evaluate() const
+{
+    Board::Cell me   = position.toMove();
+    Board::Cell them = Board::opponent(me);
+
+    return THREAT_SCORE * (GravityBoard::count(position.winningCells(me))
+                           - GravityBoard::count(position.winningCells(them)));
+}
+
+///////////////////////////////////////////////////////////////////////
+// outOfTime()
+//
+// Returns: True if stop() was called, or there is a deadline and it
+// has passed
+///////////////////////////////////////////////////////////////////////
+bool
+GravitySearch::outOfTime()
+{
+    if (interrupted != 0)
+        return true;
+    return deadline != 0 && Search::monotonicMicros() >= deadline;
+}
+
+///////////////////////////////////////////////////////////////////////
+// probe(uint64_t key)
+//
+// Returns: The table entry a position would be kept in. The keys are
+// mostly low bits, so they are mixed before picking the entry.
+///////////////////////////////////////////////////////////////////////
+GravitySearch::Entry &
+GravitySearch::probe(uint64_t key)
+{
+    return table[(key * 0x9e3779b97f4a7c15ULL) >> (64 - table_bits)];
+}
@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_GRAVITYSEARCH_HH
+#define WF_GRAVITYSEARCH_HH
+
+///////////////////////////////////////////////////////////////////////
+// GravitySearch.hh
+//
+// This file contains the declarations for the GravitySearch class,
+// which picks moves for the computer under the gravity rules.
+///////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <stdint.h>
+
+#include <QAtomicInt>
+
+#include "Board.hh"
+#include "GravityBoard.hh"
+
+///////////////////////////////////////////////////////////////////////
+// GravitySearch
+//
+// An iterative deepening alpha-beta search over a GravityBoard, with
+// at most one move per column to look at. Once an iteration reaches
+// the end of every line of play the score is exact and the move it
+// gives is perfect play; before that, positions at the depth limit
+// are scored by how many empty cells would complete a line for each
+// player.
+//
+// Most of the tree is cut away before any move is tried. A player who
+// can win at once does; a player facing two wins at once has lost;
+// a player facing one must block it; and a move straight under a cell
+// that would win for the opponent is never made. What is left is
+// tried centre columns first, then by how many winning cells the move
+// makes, with the best move the transposition table remembers ahead
+// of them all.
+//
+// As with Search, findMove() takes a time limit and returns the best
+// move of the deepest finished iteration, the table is kept between
+// calls, and stop() may be called from another thread and lasts until
+// clearStop().
+///////////////////////////////////////////////////////////////////////
+class GravitySearch
+{
+public:
+    enum {
+        WIN_SCORE     = 10000,                  // Won on this move
+        MATE_BOUND    = WIN_SCORE - 100,        // Anything above is a win
+        INFINITE      = WIN_SCORE + 1,
+        THREAT_SCORE  = 16,                     // Per winning cell
+        MAX_COLS      = GravityBoard::BITS / 2, // Narrowest board is 1 row
+        CHECK_NODES   = 1023                    // Look at the clock this often
+    };
+
+    GravitySearch(int table_bits = 20);
+
+    int         findMove(const Board &board, int time_limit = 0);
+    int         getScore() const;               // Of the last findMove()
+    uint64_t    getNodes() const;
+    int         getDepth() const;               // Deepest finished iteration
+    int         getElapsed() const;             // Milliseconds taken
+    bool        isSolved() const;               // Last score was exact
+    void        stop();                         // Give up as soon as we can
+    bool        isStopped() const;              // stop() was called
+    void        clearStop();                    // Before the next search
+    void        clearTable();
+
+    static int  orderMoves(const Board &board, int *moves);
+
+private:
+    enum Bound {NONE, EXACT, LOWER, UPPER};
+
+    struct Entry
+    {
+        uint64_t    key;
+        short       score;
+        signed char move;                       // Column
+        signed char depth;
+        unsigned char bound;
+    };
+
+    int         searchRoot(int depth, int alpha, int beta, int *cols,
+                           int count);
+    int         alphaBeta(int depth, int alpha, int beta, int ply);
+    int         sortMoves(uint64_t allowed, int hint, int *cols);
+    int         evaluate() const;
+    bool        outOfTime();
+    Entry      &probe(uint64_t key);
+
+    GravityBoard        position;
+    std::vector<Entry>  table;
+    int                 table_bits;
+    bool                stopped;                // Unwinding, for any reason
+    QAtomicInt          interrupted;            // stop() was called
+    uint64_t            nodes;
+    int                 score;
+    int                 depth_reached;
+    bool                solved;
+    int                 root_best;              // Column, this iteration
+    int                 centre_order[MAX_COLS]; // Columns, middle first
+
+    // Time control, in microseconds from an arbitrary start
+    int64_t             start_time;
+    int64_t             deadline;               // 0 for none
+    int64_t             elapsed;
+};
+
+#endif
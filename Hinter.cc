@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QMutexLocker>
+
+#include "Hinter.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Hinter(QObject *parent)
+//
+// Constructor. Starts the thread, which sleeps until there is work.
+///////////////////////////////////////////////////////////////////////
+Hinter::Hinter(QObject *parent) :
+    QThread(parent),
+    pending(false),
+    generation(0),
+    time_limit(0),
+    quitting(false)
+{
+    start(QThread::LowPriority);
+}
+
+///////////////////////////////////////////////////////////////////////
+// ~Hinter()
+//
+// Destructor. Waits for the thread, which is never more than one
+// search from noticing.
+///////////////////////////////////////////////////////////////////////
+Hinter::~Hinter()
+{
+    mutex.lock();
+    quitting = true;
+    work.wakeOne();
+    mutex.unlock();
+
+    wait();
+}
+
+///////////////////////////////////////////////////////////////////////
+// requestHint(const Board &board, int time_limit)
+//
+// Parameters:  board       - The position, with the player to move
+//                            wanting a hint
+//              time_limit  - Milliseconds for each of the two searches
+//
+// Returns: The generation the answer will be stamped with. The board
+// is copied into one kept for the purpose, which has room for it once
+// it has seen a board of that size.
+///////////////////////////////////////////////////////////////////////
+int
+Hinter::requestHint(const Board &board, int time_limit)
+{
+    QMutexLocker locker(&mutex);
+
+    wanted           = board;
+    pending          = true;
+    this->time_limit = time_limit;
+    work.wakeOne();
+
+    return ++generation;
+}
+
+///////////////////////////////////////////////////////////////////////
+// cancel()
+//
+// Forgets the position waiting to be looked at. An answer already on
+// its way will have an old generation.
+///////////////////////////////////////////////////////////////////////
+void
+Hinter::cancel()
+{
+    QMutexLocker locker(&mutex);
+
+    pending = false;
+    generation++;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getGeneration()
+//
+// Returns: The generation answers are currently being given for
+///////////////////////////////////////////////////////////////////////
+int
+Hinter::getGeneration()
+{
+    QMutexLocker locker(&mutex);
+
+    return generation;
+}
+
+///////////////////////////////////////////////////////////////////////
+// run()
+//
+// The thread. Looks at the newest position for a win for the player
+// to move, and failing that for one the opponent is threatening, then
+// sleeps until there is another.
+///////////////////////////////////////////////////////////////////////
+void
+Hinter::run()
+{
+    QMutexLocker locker(&mutex);
+    int          moves[Board::MAX_CELLS];
+
+    while (!quitting) {
+        if (!pending) {
+            work.wait(&mutex);
+            continue;
+        }
+
+        int asked = generation;
+        int msecs = time_limit;
+
+        position = wanted;
+        pending  = false;
+        locker.unlock();
+
+        int  win        = threats.findWin(position, msecs);
+        bool threatened = win < 0
+                          && threats.findDefences(position, moves, msecs) > 0;
+
+        locker.relock();
+        if (asked == generation)
+            emit hintReady(asked, win, threatened);
+    }
+}
@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_HINTER_HH
+#define WF_HINTER_HH
+
+///////////////////////////////////////////////////////////////////////
+// Hinter.hh
+//
+// This file contains the declarations for the Hinter class, the
+// thread that looks for forced wins to hint at.
+///////////////////////////////////////////////////////////////////////
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "Board.hh"
+#include "ThreatSearch.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Hinter
+//
+// Runs a ThreatSearch on its own thread for the turn label's hint, so
+// looking for forced wins never holds up the child's next move. The
+// search and its table of failures are made once and kept, so nothing
+// is allocated per hint once the first board has been seen.
+//
+// requestHint() hands over a position and returns at once. If another
+// position comes before the thread gets to it, only the newest one is
+// looked at. The answer comes back through hintReady(), stamped with
+// the generation it was asked for in; requestHint() and cancel() each
+// start a new generation, so answers for positions that are gone can
+// be told apart.
+///////////////////////////////////////////////////////////////////////
+class Hinter : public QThread
+{
+    Q_OBJECT
+
+public:
+    Hinter(QObject *parent = 0);
+    ~Hinter();
+
+    int         requestHint(const Board &board, int time_limit);
+    void        cancel();                       // Forget the request
+    int         getGeneration();
+
+signals:
+    // win is where the player to move can force a win, or -1; if
+    // there is none, threatened says whether the opponent can
+    void        hintReady(int generation, int win, bool threatened);
+
+protected:
+    void        run();
+
+private:
+    QMutex              mutex;
+    QWaitCondition      work;                   // Something to do
+    ThreatSearch        threats;                // Only used by the thread
+    Board               wanted;                 // Position to look at
+    Board               position;               // Being looked at
+    bool                pending;                // wanted not looked at yet
+    int                 generation;
+    int                 time_limit;             // Milliseconds per search
+    bool                quitting;
+};
+
+#endif
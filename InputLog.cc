@@ -0,0 +1,614 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QtGui>
+#include <algorithm>
+#include <iostream>
+
+#include "InputLog.hh"
+#include "GameSpace.hh"
+#include "PiecesList.hh"
+#include "Search.hh"
+
+static const char *kind_names[InputEvent::KINDS] = {
+    "start", "enter", "move", "leave", "drop", "end"
+};
+
+///////////////////////////////////////////////////////////////////////
+// targetName(QWidget *widget)
+//
+// Parameters:  widget      - Where a drag event was sent
+//
+// Returns: The name to record it under, or an empty string if it is
+// not part of the board or the piece lists
+///////////////////////////////////////////////////////////////////////
+static QString
+targetName(QWidget *widget)
+{
+    if (!widget)
+        return QString();
+
+    if (widget->objectName().startsWith("space-")
+            || widget->objectName().endsWith("_pieces"))
+        return widget->objectName();
+
+    QAbstractScrollArea *area =
+        qobject_cast<QAbstractScrollArea *>(widget->parentWidget());
+
+    if (area && area->viewport() == widget
+            && area->objectName().endsWith("_pieces"))
+        return area->objectName() + "/viewport";
+    return QString();
+}
+
+///////////////////////////////////////////////////////////////////////
+// summarize(QVector<int64_t> times)
+//
+// Parameters:  times       - Microseconds, sorted in place
+//
+// Returns: The count, mean, 95th percentile, and worst, as one line
+///////////////////////////////////////////////////////////////////////
+static QString
+summarize(QVector<int64_t> &times)
+{
+    int64_t total = 0;
+
+    if (times.isEmpty())
+        return "0";
+
+    std::sort(times.begin(), times.end());
+    for (int i = 0; i < times.size(); ++i)
+        total += times[i];
+
+    return QString("%1 mean %2 us p95 %3 us max %4 us")
+           .arg(times.size()).arg(total / times.size())
+           .arg(times[(times.size() - 1) * 95 / 100]).arg(times.last());
+}
+
+///////////////////////////////////////////////////////////////////////
+// InputRecorder(QObject *parent)
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+InputRecorder::InputRecorder(QObject *parent) :
+    QObject(parent)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// open(const QString &file_name, int rows, int cols, int win_length,
+//      Rules::Set rules)
+//
+// Parameters:  file_name   - Where to save the recording
+//              rows        - Rows on the board being played
+//              cols        - Columns on the board being played
+//              win_length  - How many in a row wins
+//              rules       - The rule set being played
+//
+// Returns: False if the file could not be made. errorString() says
+// why.
+///////////////////////////////////////////////////////////////////////
+bool
+InputRecorder::open(const QString &file_name, int rows, int cols,
+                    int win_length, Rules::Set rules)
+{
+    file.setFileName(file_name);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        error = file.errorString();
+        return false;
+    }
+
+    out.setDevice(&file);
+    out << "xsnos-input 1 " << rows << " " << cols << " " << win_length
+        << " " << Rules::name(rules) << "\n";
+    out.flush();
+
+    clock.start();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// watch(QWidget *window)
+//
+// Parameters:  window      - The window whose input to record
+//
+// Starts recording. Drag events are caught on their way to any widget,
+// but only those for the board and piece lists are kept.
+///////////////////////////////////////////////////////////////////////
+void
+InputRecorder::watch(QWidget *window)
+{
+    QList<PiecesList *> trays = window->findChildren<PiecesList *>();
+
+    for (int i = 0; i < trays.size(); ++i) {
+        connect(trays[i], SIGNAL(dragStarted()), this, SLOT(dragStarted()));
+        connect(trays[i], SIGNAL(dragFinished(bool)),
+                this, SLOT(dragFinished(bool)));
+    }
+    qApp->installEventFilter(this);
+}
+
+///////////////////////////////////////////////////////////////////////
+// errorString()
+//
+// Returns: Why open() failed
+///////////////////////////////////////////////////////////////////////
+QString
+InputRecorder::errorString() const
+{
+    return error;
+}
+
+///////////////////////////////////////////////////////////////////////
+// eventFilter(QObject *watched, QEvent *event)
+//
+// Parameters:  watched     - Where the event is going
+//              event       - The event
+//
+// Returns: False, so the event always carries on as usual
+///////////////////////////////////////////////////////////////////////
+bool
+InputRecorder::eventFilter(QObject *watched, QEvent *event)
+{
+    InputEvent::Kind kind;
+
+    switch (event->type()) {
+    case QEvent::DragEnter: kind = InputEvent::ENTER;   break;
+    case QEvent::DragMove:  kind = InputEvent::MOVE;    break;
+    case QEvent::DragLeave: kind = InputEvent::LEAVE;   break;
+    case QEvent::Drop:      kind = InputEvent::DROP;    break;
+    default:                return false;
+    }
+
+    QString target = targetName(qobject_cast<QWidget *>(watched));
+
+    if (target.isEmpty())
+        return false;
+
+    if (kind == InputEvent::LEAVE) {
+        write(kind, target, 0, 0, -1);
+    } else {
+        QDropEvent *drop = static_cast<QDropEvent *>(event);
+        int         mime = -1;
+
+        if (drop->mimeData()->hasFormat(GameSpace::pieceFormat()))
+            mime = payloadId(
+                       drop->mimeData()->data(GameSpace::pieceFormat()));
+        write(kind, target, drop->pos().x(), drop->pos().y(), mime);
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////
+// dragStarted()
+//
+// A piece was picked up from one of the lists
+///////////////////////////////////////////////////////////////////////
+void
+InputRecorder::dragStarted()
+{
+    PiecesList *tray = qobject_cast<PiecesList *>(sender());
+
+    if (tray)
+        write(InputEvent::START, tray->objectName(), tray->currentRow(), 0, -1);
+}
+
+///////////////////////////////////////////////////////////////////////
+// dragFinished(bool moved)
+//
+// Parameters:  moved       - Was the piece dropped somewhere?
+///////////////////////////////////////////////////////////////////////
+void
+InputRecorder::dragFinished(bool moved)
+{
+    PiecesList *tray = qobject_cast<PiecesList *>(sender());
+
+    if (tray)
+        write(InputEvent::END, tray->objectName(), moved, 0, -1);
+    out.flush();
+}
+
+///////////////////////////////////////////////////////////////////////
+// payloadId(const QByteArray &payload)
+//
+// Parameters:  payload     - Drag data
+//
+// Returns: Its id, writing it to the file first if it is new. There are
+// only ever a few, one per kind of piece.
+///////////////////////////////////////////////////////////////////////
+int
+InputRecorder::payloadId(const QByteArray &payload)
+{
+    int id = payloads.indexOf(payload);
+
+    if (id < 0) {
+        id = payloads.size();
+        payloads.append(payload);
+        out << "mime " << id << " " << payload.toBase64() << "\n";
+    }
+    return id;
+}
+
+///////////////////////////////////////////////////////////////////////
+// write(InputEvent::Kind kind, const QString &target, int x, int y,
+//       int mime)
+//
+// Writes one event. The stream is buffered and only flushed at the end
+// of each drag, so recording costs the drag next to nothing.
+///////////////////////////////////////////////////////////////////////
+void
+InputRecorder::write(InputEvent::Kind kind, const QString &target,
+                     int x, int y, int mime)
+{
+    if (!file.isOpen())
+        return;
+
+    out << clock.elapsed() << " " << kind_names[kind] << " " << target
+        << " " << x << " " << y << " " << mime << "\n";
+}
+
+///////////////////////////////////////////////////////////////////////
+// InputReplayer(QObject *parent)
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+InputReplayer::InputReplayer(QObject *parent) :
+    QObject(parent),
+    rows(0),
+    cols(0),
+    win_length(0),
+    rules(Rules::STANDARD),
+    tray(0),
+    tray_row(-1),
+    dropped(false),
+    painting(false),
+    elapsed(0),
+    missing(0),
+    divergences(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// load(const QString &file_name)
+//
+// Parameters:  file_name   - A file made by InputRecorder
+//
+// Returns: False if it could not be read. errorString() says why.
+///////////////////////////////////////////////////////////////////////
+bool
+InputReplayer::load(const QString &file_name)
+{
+    QFile       file(file_name);
+    QTextStream in(&file);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = file.errorString();
+        return false;
+    }
+
+    QStringList header = in.readLine().split(' ');
+
+    if (header.size() != 6 || header[0] != "xsnos-input" || header[1] != "1"
+            || !Rules::fromName(header[5].toStdString(), &rules)) {
+        error = QObject::tr("%1 is not an input recording").arg(file_name);
+        return false;
+    }
+
+    rows       = header[2].toInt();
+    cols       = header[3].toInt();
+    win_length = header[4].toInt();
+    events.clear();
+    payloads.clear();
+
+    while (!in.atEnd()) {
+        QStringList fields = in.readLine().split(' ');
+
+        if (fields.size() == 3 && fields[0] == "mime") {
+            bool ok;
+            int  id = fields[1].toInt(&ok);
+
+            // The recorder numbers payloads in the order it writes them
+            if (!ok || id < 0 || id > payloads.size()) {
+                error = QObject::tr("%1 is damaged").arg(file_name);
+                return false;
+            }
+            if (id == payloads.size())
+                payloads.append(QByteArray());
+            payloads[id] = QByteArray::fromBase64(fields[2].toAscii());
+            continue;
+        }
+        if (fields.size() != 6)
+            continue;
+
+        InputEvent input;
+        int        kind = 0;
+
+        while (kind < InputEvent::KINDS && fields[1] != kind_names[kind])
+            kind++;
+        if (kind == InputEvent::KINDS)
+            continue;
+
+        input.msecs  = fields[0].toInt();
+        input.kind   = InputEvent::Kind(kind);
+        input.target = fields[2];
+        input.x      = fields[3].toInt();
+        input.y      = fields[4].toInt();
+        input.mime   = fields[5].toInt();
+        events.append(input);
+    }
+
+    if (rows < 1 || cols < 1 || win_length < 1) {
+        error = QObject::tr("%1 is damaged").arg(file_name);
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getRows(), getCols(), getWinLength(), getRules()
+//
+// Returns: The game the recording was made in
+///////////////////////////////////////////////////////////////////////
+int
+InputReplayer::getRows() const
+{
+    return rows;
+}
+
+int
+InputReplayer::getCols() const
+{
+    return cols;
+}
+
+int
+InputReplayer::getWinLength() const
+{
+    return win_length;
+}
+
+Rules::Set
+InputReplayer::getRules() const
+{
+    return rules;
+}
+
+///////////////////////////////////////////////////////////////////////
+// errorString()
+//
+// Returns: Why load() failed
+///////////////////////////////////////////////////////////////////////
+QString
+InputReplayer::errorString() const
+{
+    return error;
+}
+
+///////////////////////////////////////////////////////////////////////
+// replay(QWidget *window, bool fast)
+//
+// Parameters:  window      - A shown window with a new game in it
+//              fast        - Send each event as soon as the last is
+//                            done, rather than when it was recorded
+//
+// Plays the recording into window and gathers the timings
+///////////////////////////////////////////////////////////////////////
+void
+InputReplayer::replay(QWidget *window, bool fast)
+{
+    QTimer  dialogs;
+    int64_t start = Search::monotonicMicros();
+
+    connect(&dialogs, SIGNAL(timeout()), this, SLOT(closeDialogs()));
+    dialogs.start(1);
+    qApp->installEventFilter(this);
+    qApp->processEvents();
+
+    for (int i = 0; i < events.size(); ++i) {
+        const InputEvent &input = events[i];
+
+        // Wait for the moment it was recorded at
+        int64_t wait = start + int64_t(input.msecs) * 1000
+                     - Search::monotonicMicros();
+
+        if (!fast && wait > 0) {
+            QEventLoop loop;
+
+            QTimer::singleShot(int(wait / 1000), &loop, SLOT(quit()));
+            loop.exec();
+        }
+
+        QWidget *target = findTarget(window, input.target);
+
+        if (!target) {
+            missing++;
+            continue;
+        }
+
+        int64_t begin = Search::monotonicMicros();
+
+        send(target, input);
+        qApp->processEvents();
+        frames[input.kind].append(Search::monotonicMicros() - begin);
+    }
+
+    elapsed = Search::monotonicMicros() - start;
+    qApp->removeEventFilter(this);
+}
+
+///////////////////////////////////////////////////////////////////////
+// send(QWidget *target, const InputEvent &input)
+//
+// Parameters:  target      - The widget the event was recorded for
+//              input       - The event
+//
+// Does what Qt would have done for a real drag
+///////////////////////////////////////////////////////////////////////
+void
+InputReplayer::send(QWidget *target, const InputEvent &input)
+{
+    QPoint pos(input.x, input.y);
+
+    if (input.mime >= 0 && input.mime < payloads.size())
+        mime.setData(GameSpace::pieceFormat(), payloads[input.mime]);
+
+    switch (input.kind) {
+    case InputEvent::START:
+        tray     = qobject_cast<PiecesList *>(target);
+        tray_row = input.x;
+        dropped  = false;
+        if (tray)
+            tray->replayDrag(tray_row);
+        break;
+
+    case InputEvent::ENTER: {
+        QDragEnterEvent event(pos, Qt::MoveAction, &mime, Qt::LeftButton,
+                              Qt::NoModifier);
+        QApplication::sendEvent(target, &event);
+        break;
+    }
+
+    case InputEvent::MOVE: {
+        QDragMoveEvent event(pos, Qt::MoveAction, &mime, Qt::LeftButton,
+                             Qt::NoModifier);
+        QApplication::sendEvent(target, &event);
+        break;
+    }
+
+    case InputEvent::LEAVE: {
+        QDragLeaveEvent event;
+        QApplication::sendEvent(target, &event);
+        break;
+    }
+
+    case InputEvent::DROP: {
+        QDropEvent event(pos, Qt::MoveAction, &mime, Qt::LeftButton,
+                         Qt::NoModifier);
+        QApplication::sendEvent(target, &event);
+        dropped = event.isAccepted() && event.dropAction() == Qt::MoveAction;
+        break;
+    }
+
+    case InputEvent::END:
+        if (tray)
+            tray->finishReplayedDrag(tray_row, dropped);
+        if (dropped != (input.x != 0))
+            divergences++;
+        tray = 0;
+        break;
+
+    default:
+        break;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// findTarget(QWidget *window, const QString &target)
+//
+// Returns: The widget a recorded target names, or 0
+///////////////////////////////////////////////////////////////////////
+QWidget *
+InputReplayer::findTarget(QWidget *window, const QString &target) const
+{
+    QStringList parts  = target.split('/');
+    QWidget    *widget = window->findChild<QWidget *>(parts[0]);
+
+    if (widget && parts.size() > 1) {
+        QAbstractScrollArea *area = qobject_cast<QAbstractScrollArea *>(widget);
+        widget = area ? area->viewport() : 0;
+    }
+    return widget;
+}
+
+///////////////////////////////////////////////////////////////////////
+// eventFilter(QObject *watched, QEvent *event)
+//
+// Parameters:  watched     - Where the event is going
+//              event       - The event
+//
+// Returns: True if the event was a paint, which has been delivered and
+// timed here
+///////////////////////////////////////////////////////////////////////
+bool
+InputReplayer::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() != QEvent::Paint || painting)
+        return false;
+
+    int64_t begin = Search::monotonicMicros();
+
+    painting = true;
+    watched->event(event);
+    painting = false;
+
+    paints.append(Search::monotonicMicros() - begin);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// closeDialogs()
+//
+// Clicks OK on any message box that has popped up
+///////////////////////////////////////////////////////////////////////
+void
+InputReplayer::closeDialogs()
+{
+    QDialog *dialog = qobject_cast<QDialog *>(QApplication::activeModalWidget());
+
+    if (dialog)
+        dialog->accept();
+}
+
+///////////////////////////////////////////////////////////////////////
+// printReport()
+//
+// Prints how long the replay took and how long each kind of event and
+// each paint took, on stdout
+///////////////////////////////////////////////////////////////////////
+void
+InputReplayer::printReport() const
+{
+    QVector<int64_t> times;
+
+    std::cout << "events " << events.size() << " in " << elapsed / 1000
+              << " ms, " << missing << " missing targets, " << divergences
+              << " drags ended differently\n";
+
+    for (int kind = 0; kind < InputEvent::KINDS; ++kind) {
+        times = frames[kind];
+        std::cout << kind_names[kind] << " "
+                  << qPrintable(summarize(times)) << "\n";
+    }
+
+    times = paints;
+    std::cout << "paint " << qPrintable(summarize(times)) << "\n";
+}
+
+///////////////////////////////////////////////////////////////////////
+// getDivergences()
+//
+// Returns: How many drags were dropped in the recording but not in the
+// replay, or the other way around
+///////////////////////////////////////////////////////////////////////
+int
+InputReplayer::getDivergences() const
+{
+    return divergences;
+}
@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_INPUTLOG_HH
+#define WF_INPUTLOG_HH
+
+///////////////////////////////////////////////////////////////////////
+// InputLog.hh
+//
+// This file contains the InputEvent struct and the InputRecorder and
+// InputReplayer classes, which save the drag and drop input of a real
+// session and play it back to time the GUI.
+//
+// A recording is a text file. The first line is:
+//
+//      xsnos-input 1 {rows} {cols} {win length} {rules}
+//
+// and each line after that is either a piece's drag data, given once
+// the first time it is seen:
+//
+//      mime {id} {base64 of the image/x-piece data}
+//
+// or an event:
+//
+//      {msecs} {kind} {target} {x} {y} {mime id}
+//
+// where the target is a widget's object name, with "/viewport" added
+// for a piece list's viewport.
+///////////////////////////////////////////////////////////////////////
+
+#include <QFile>
+#include <QList>
+#include <QMimeData>
+#include <QObject>
+#include <QString>
+#include <QTextStream>
+#include <QTime>
+#include <QVector>
+#include <stdint.h>
+
+#include "Rules.hh"
+
+class PiecesList;
+class QWidget;
+
+///////////////////////////////////////////////////////////////////////
+// InputEvent
+//
+// One thing the child did. For START x is the row of the piece picked
+// up, and for END it is 1 if the piece was dropped somewhere.
+///////////////////////////////////////////////////////////////////////
+struct InputEvent
+{
+    enum Kind {START, ENTER, MOVE, LEAVE, DROP, END, KINDS};
+
+    int         msecs;                          // Since recording began
+    Kind        kind;
+    QString     target;
+    int         x;
+    int         y;
+    int         mime;                           // Drag data, -1 for none
+};
+
+///////////////////////////////////////////////////////////////////////
+// InputRecorder
+//
+// Watches every drag event that reaches a game space or piece list of
+// a window and writes it down, along with when each drag started and
+// how it ended.
+///////////////////////////////////////////////////////////////////////
+class InputRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    InputRecorder(QObject *parent = 0);
+
+    bool        open(const QString &file_name, int rows, int cols,
+                     int win_length, Rules::Set rules);
+    void        watch(QWidget *window);
+    QString     errorString() const;
+
+protected:
+    bool        eventFilter(QObject *watched, QEvent *event);
+
+private slots:
+    void        dragStarted();
+    void        dragFinished(bool moved);
+
+private:
+    int         payloadId(const QByteArray &payload);
+    void        write(InputEvent::Kind kind, const QString &target,
+                      int x, int y, int mime);
+
+    QFile               file;
+    QTextStream         out;
+    QTime               clock;
+    QList<QByteArray>   payloads;               // By id
+    QString             error;
+};
+
+///////////////////////////////////////////////////////////////////////
+// InputReplayer
+//
+// Sends a recording's events to the same widgets of a new window,
+// either at the pace they were recorded or as fast as they go. After
+// each event it lets everything that event caused run, queued signals
+// and repaints included, and times the lot as one frame. Every paint
+// is timed on its own as well. Message boxes are closed as soon as
+// they open, as nothing in the recording would close them.
+///////////////////////////////////////////////////////////////////////
+class InputReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    InputReplayer(QObject *parent = 0);
+
+    bool        load(const QString &file_name);
+    int         getRows() const;
+    int         getCols() const;
+    int         getWinLength() const;
+    Rules::Set  getRules() const;
+    QString     errorString() const;
+
+    void        replay(QWidget *window, bool fast);
+    void        printReport() const;
+    int         getDivergences() const;         // Drops that ended differently
+
+protected:
+    bool        eventFilter(QObject *watched, QEvent *event);
+
+private slots:
+    void        closeDialogs();
+
+private:
+    QWidget    *findTarget(QWidget *window, const QString &target) const;
+    void        send(QWidget *target, const InputEvent &input);
+
+    int                 rows;
+    int                 cols;
+    int                 win_length;
+    Rules::Set          rules;
+    QVector<InputEvent> events;
+    QList<QByteArray>   payloads;
+    QString             error;
+
+    // What the replay is in the middle of
+    QMimeData           mime;
+    PiecesList         *tray;                   // Piece picked up from
+    int                 tray_row;
+    bool                dropped;
+    bool                painting;
+
+    // Microseconds
+    QVector<int64_t>    frames[InputEvent::KINDS];
+    QVector<int64_t>    paints;
+    int64_t             elapsed;
+    int                 missing;                // Targets not found
+    int                 divergences;
+};
+
+#endif
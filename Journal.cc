@@ -0,0 +1,438 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QMutexLocker>
+#include <QtEndian>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Journal.hh"
+
+static const char JOURNAL_MAGIC[8] = {'X', 'S', 'N', 'O', 'S', 'J', 'N', '1'};
+
+///////////////////////////////////////////////////////////////////////
+// Journal(QObject *parent)
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+Journal::Journal(QObject *parent) :
+    QThread(parent),
+    map(0),
+    map_size(0),
+    generation(0),
+    capacity(0),
+    next(0),
+    dirty_begin(0),
+    dirty_end(0),
+    quitting(false)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// ~Journal()
+//
+// Destructor. Flushes whatever is left and closes the file.
+///////////////////////////////////////////////////////////////////////
+Journal::~Journal()
+{
+    close();
+}
+
+///////////////////////////////////////////////////////////////////////
+// open(const QString &file_name, int rows, int cols, int win_length,
+//      Rules::Set rules)
+//
+// Parameters:  file_name   - The journal, made if it does not exist
+//              rows        - Rows on the board being played
+//              cols        - Columns on the board being played
+//              win_length  - How many in a row wins
+//              rules       - The rule set being played
+//
+// Returns: False if the file could not be opened and mapped.
+// errorString() says why.
+//
+// Maps the file and replays it. A journal kept for a different game,
+// or no journal at all, is started over with no game in progress.
+///////////////////////////////////////////////////////////////////////
+bool
+Journal::open(const QString &file_name, int rows, int cols,
+              int win_length, Rules::Set rules)
+{
+    close();
+
+    file.setFileName(file_name);
+    if (!file.open(QIODevice::ReadWrite)) {
+        error = file.errorString();
+        return false;
+    }
+    if (file.size() < HEADER_SIZE + qint64(CAPACITY) * RECORD_SIZE
+            && !file.resize(HEADER_SIZE + qint64(CAPACITY) * RECORD_SIZE)) {
+        error = file.errorString();
+        close();
+        return false;
+    }
+
+    map_size = file.size();
+    map      = file.map(0, map_size);
+    capacity = int(qMin<qint64>((map_size - HEADER_SIZE) / RECORD_SIZE,
+                                CAPACITY * 16));
+
+    if (!map) {
+        error = file.errorString();
+        close();
+        return false;
+    }
+
+    bool is_journal = memcmp(map, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == 0;
+
+    generation = is_journal ? qFromLittleEndian<quint32>(map + 24) : 0;
+
+    if (is_journal
+            && qFromLittleEndian<quint32>(map + 8) == quint32(rows)
+            && qFromLittleEndian<quint32>(map + 12) == quint32(cols)
+            && qFromLittleEndian<quint32>(map + 16) == quint32(win_length)
+            && qFromLittleEndian<quint32>(map + 20) == quint32(rules)
+            && qFromLittleEndian<quint32>(map + 28) == quint32(capacity)) {
+        replay();
+    } else {
+        memcpy(map, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        qToLittleEndian<quint32>(rows, map + 8);
+        qToLittleEndian<quint32>(cols, map + 12);
+        qToLittleEndian<quint32>(win_length, map + 16);
+        qToLittleEndian<quint32>(rules, map + 20);
+        qToLittleEndian<quint32>(capacity, map + 28);
+        restart();
+    }
+
+    start();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// close()
+//
+// Waits for everything recorded to reach the disk, then unmaps and
+// closes the file.
+///////////////////////////////////////////////////////////////////////
+void
+Journal::close()
+{
+    if (isRunning()) {
+        mutex.lock();
+        quitting = true;
+        work.wakeOne();
+        mutex.unlock();
+
+        wait();
+    }
+
+    if (map)
+        file.unmap(map);
+    if (file.isOpen())
+        file.close();
+
+    map         = 0;
+    map_size    = 0;
+    capacity    = 0;
+    next        = 0;
+    dirty_begin = 0;
+    dirty_end   = 0;
+    quitting    = false;
+    game.clear();
+}
+
+///////////////////////////////////////////////////////////////////////
+// getGame()
+//
+// Returns: The moves of the game in progress when the journal was
+// opened, or since recording began
+///////////////////////////////////////////////////////////////////////
+const QVector<Move> &
+Journal::getGame() const
+{
+    return game;
+}
+
+///////////////////////////////////////////////////////////////////////
+// errorString()
+//
+// Returns: Why open() failed
+///////////////////////////////////////////////////////////////////////
+QString
+Journal::errorString() const
+{
+    return error;
+}
+
+///////////////////////////////////////////////////////////////////////
+// recordMove(const Move &move)
+//
+// Parameters:  move        - The move that was just played
+///////////////////////////////////////////////////////////////////////
+void
+Journal::recordMove(const Move &move)
+{
+    game.append(move);
+    append(MOVE, move);
+}
+
+///////////////////////////////////////////////////////////////////////
+// recordUndo()
+//
+// The last move was taken back
+///////////////////////////////////////////////////////////////////////
+void
+Journal::recordUndo()
+{
+    Move none = {GameSpace::EMPTY, 0, 0};
+
+    if (!game.isEmpty())
+        game.pop_back();
+    append(UNDO, none);
+}
+
+///////////////////////////////////////////////////////////////////////
+// recordNewGame()
+//
+// A new game was started. Once the file is half full it is started
+// over here, where there is no game in progress to lose.
+///////////////////////////////////////////////////////////////////////
+void
+Journal::recordNewGame()
+{
+    Move none = {GameSpace::EMPTY, 0, 0};
+
+    game.clear();
+
+    if (map && next > capacity / 2)
+        restart();
+    else
+        append(NEW_GAME, none);
+}
+
+///////////////////////////////////////////////////////////////////////
+// check(int index, const uchar *record)
+//
+// Parameters:  index       - Where the record is in the file
+//              record      - Its first four bytes
+//
+// Returns: An FNV-1a hash of the record, its index, and the generation.
+// A record left over from before the file was started over, or only
+// half written, will not match.
+///////////////////////////////////////////////////////////////////////
+quint32
+Journal::check(int index, const uchar *record) const
+{
+    uchar   bytes[12];
+    quint32 hash = 2166136261u;
+
+    memcpy(bytes, record, 4);
+    qToLittleEndian<quint32>(index, bytes + 4);
+    qToLittleEndian<quint32>(generation, bytes + 8);
+
+    for (int i = 0; i < 12; ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+///////////////////////////////////////////////////////////////////////
+// append(Kind kind, const Move &move)
+//
+// Parameters:  kind        - What happened
+//              move        - The move, for MOVE records
+//
+// Adds a record, or starts the file over with the game in progress if
+// it is full. Only a game with thousands of undos can fill it.
+///////////////////////////////////////////////////////////////////////
+void
+Journal::append(Kind kind, const Move &move)
+{
+    if (!map)
+        return;
+
+    if (next >= capacity)
+        restart();
+    else
+        write(kind, move);
+}
+
+///////////////////////////////////////////////////////////////////////
+// restart()
+//
+// Starts the file over under a new generation, holding only the game
+// in progress.
+///////////////////////////////////////////////////////////////////////
+void
+Journal::restart()
+{
+    Move none = {GameSpace::EMPTY, 0, 0};
+
+    generation++;
+    qToLittleEndian<quint32>(generation, map + 24);
+    markDirty(0, HEADER_SIZE);
+
+    next = 0;
+    write(NEW_GAME, none);
+    for (int i = 0; i < game.size(); ++i)
+        write(MOVE, game[i]);
+}
+
+///////////////////////////////////////////////////////////////////////
+// write(Kind kind, const Move &move)
+//
+// Parameters:  kind        - What happened
+//              move        - The move, for MOVE records
+//
+// Puts a record at next, which must have room, and hands it to the
+// thread to flush.
+///////////////////////////////////////////////////////////////////////
+void
+Journal::write(Kind kind, const Move &move)
+{
+    qint64  offset = HEADER_SIZE + qint64(next) * RECORD_SIZE;
+    uchar  *record = map + offset;
+
+    record[0] = kind;
+    record[1] = move.state;
+    record[2] = move.row;
+    record[3] = move.col;
+    qToLittleEndian<quint32>(check(next, record), record + 4);
+
+    next++;
+    markDirty(offset, offset + RECORD_SIZE);
+}
+
+///////////////////////////////////////////////////////////////////////
+// markDirty(qint64 begin, qint64 end)
+//
+// Parameters:  begin       - First byte that changed
+//              end         - One past the last
+//
+// Wakes the thread to get those bytes onto the disk
+///////////////////////////////////////////////////////////////////////
+void
+Journal::markDirty(qint64 begin, qint64 end)
+{
+    QMutexLocker locker(&mutex);
+
+    if (dirty_begin >= dirty_end) {
+        dirty_begin = begin;
+        dirty_end   = end;
+    } else {
+        dirty_begin = qMin(dirty_begin, begin);
+        dirty_end   = qMax(dirty_end, end);
+    }
+    work.wakeOne();
+}
+
+///////////////////////////////////////////////////////////////////////
+// flush(qint64 begin, qint64 end)
+//
+// Parameters:  begin       - First byte to write out
+//              end         - One past the last
+//
+// Waits for the pages holding those bytes to reach the disk. Only
+// called on the journal's thread.
+///////////////////////////////////////////////////////////////////////
+void
+Journal::flush(qint64 begin, qint64 end)
+{
+    qint64 page  = sysconf(_SC_PAGESIZE);
+    qint64 start = begin / page * page;
+
+    msync(map + start, end - start, MS_SYNC);
+}
+
+///////////////////////////////////////////////////////////////////////
+// replay()
+//
+// Reads records from the start of the file until one does not check
+// out, keeping track of the game in progress. The next record goes
+// where that one is.
+///////////////////////////////////////////////////////////////////////
+void
+Journal::replay()
+{
+    game.clear();
+
+    for (next = 0; next < capacity; ++next) {
+        const uchar *record = map + HEADER_SIZE + qint64(next) * RECORD_SIZE;
+
+        if (qFromLittleEndian<quint32>(record + 4) != check(next, record))
+            break;
+
+        if (record[0] == NEW_GAME) {
+            game.clear();
+        } else if (record[0] == MOVE
+                   && (record[1] == GameSpace::X || record[1] == GameSpace::O)) {
+            Move move;
+            move.state = GameSpace::SpaceState(record[1]);
+            move.row   = record[2];
+            move.col   = record[3];
+            game.append(move);
+        } else if (record[0] == UNDO) {
+            if (!game.isEmpty())
+                game.pop_back();
+        } else {
+            break;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// run()
+//
+// The thread. Sleeps until something is recorded, waits a moment for
+// more to come in, and then flushes all of it at once. When closing it
+// flushes what is left without waiting.
+///////////////////////////////////////////////////////////////////////
+void
+Journal::run()
+{
+    QMutexLocker locker(&mutex);
+
+    for (;;) {
+        while (!quitting && dirty_begin >= dirty_end)
+            work.wait(&mutex);
+
+        if (dirty_begin >= dirty_end)
+            break;
+
+        if (!quitting) {
+            locker.unlock();
+            msleep(COMMIT_DELAY);
+            locker.relock();
+        }
+
+        qint64 begin = dirty_begin;
+        qint64 end   = dirty_end;
+
+        dirty_begin = 0;
+        dirty_end   = 0;
+        locker.unlock();
+
+        flush(begin, end);
+
+        locker.relock();
+    }
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_JOURNAL_HH
+#define WF_JOURNAL_HH
+
+///////////////////////////////////////////////////////////////////////
+// Journal.hh
+//
+// This file contains the declarations for the Journal class, which
+// keeps the game in progress on disk so it survives a power cut.
+//
+// The file is laid out as:
+//
+//      "XSNOSJN1"                  magic
+//      quint32 rows, cols, win_length, rules, generation
+//      quint32 capacity            records the file has room for
+//      records[capacity]
+//
+// Each record is 8 bytes: its kind, the piece, row, and column, and a
+// check made from those, its position, and the generation. Records are
+// only valid for the generation in the header, so starting the file
+// over only takes bumping the generation. All numbers are little
+// endian.
+///////////////////////////////////////////////////////////////////////
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "GameLog.hh"
+#include "Rules.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Journal
+//
+// An append only log of moves, undos, and new games, written straight
+// into a memory mapped file. Recording something is a few bytes copied
+// into the map, so it costs the GUI thread next to nothing. Getting it
+// onto the disk is left to the journal's own thread, which waits a
+// moment after the first unsaved record so that everything that came
+// in meanwhile is flushed together.
+//
+// open() replays the file and getGame() hands back the moves of the
+// game that was being played, so it can be put back on the board.
+///////////////////////////////////////////////////////////////////////
+class Journal : public QThread
+{
+public:
+    enum {
+        HEADER_SIZE  = 32,
+        RECORD_SIZE  = 8,
+        CAPACITY     = 8192,                    // Records in a new file
+        COMMIT_DELAY = 20                       // Milliseconds to gather
+    };
+
+    Journal(QObject *parent = 0);
+    ~Journal();
+
+    bool                 open(const QString &file_name, int rows, int cols,
+                              int win_length, Rules::Set rules);
+    void                 close();
+    const QVector<Move> &getGame() const;       // As it was left
+    QString              errorString() const;
+
+    void                 recordMove(const Move &move);
+    void                 recordUndo();
+    void                 recordNewGame();
+
+protected:
+    void                 run();
+
+private:
+    enum Kind {INVALID, NEW_GAME, MOVE, UNDO};
+
+    quint32              check(int index, const uchar *record) const;
+    void                 append(Kind kind, const Move &move);
+    void                 restart();
+    void                 write(Kind kind, const Move &move);
+    void                 markDirty(qint64 begin, qint64 end);
+    void                 flush(qint64 begin, qint64 end);
+    void                 replay();
+
+    QFile                file;
+    uchar               *map;
+    qint64               map_size;
+    quint32              generation;
+    int                  capacity;
+    int                  next;                  // Where the next record goes
+    QVector<Move>        game;                  // Moves since the last new game
+    QString              error;
+
+    // Shared with the thread
+    QMutex               mutex;
+    QWaitCondition       work;                  // Something to flush
+    qint64               dirty_begin;           // Bytes not yet on disk,
+    qint64               dirty_end;             // empty if begin >= end
+    bool                 quitting;
+};
+
+#endif
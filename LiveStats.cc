@@ -0,0 +1,378 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QDateTime>
+#include <QFile>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+
+#include "LiveStats.hh"
+#include "GameLog.hh"
+
+///////////////////////////////////////////////////////////////////////
+// LiveStats(int rows, int cols, int win_length, QObject *parent)
+//
+// Parameters:  rows, cols  - Size of the board the games are played on
+//              win_length  - How many in a row wins
+//              parent
+///////////////////////////////////////////////////////////////////////
+LiveStats::LiveStats(int rows, int cols, int win_length, QObject *parent) :
+    QObject(parent),
+    board(rows, cols, win_length),
+    plies(0),
+    started(QDateTime::currentDateTime().toTime_t()),
+    skipped(0),
+    server(0),
+    timer(0)
+{
+    wins[Board::EMPTY] = 0;
+    wins[Board::X]     = 0;
+    wins[Board::O]     = 0;
+
+    buildSnapshot(started);
+}
+
+///////////////////////////////////////////////////////////////////////
+// addLog(const QString &file_name)
+//
+// Parameters:  file_name   - A log that printMoves() is writing to
+//
+// Follows the log from its current end. A log that does not exist yet
+// is followed from when it appears.
+//
+// Returns: False if the file is there but can not be read
+///////////////////////////////////////////////////////////////////////
+bool
+LiveStats::addLog(const QString &file_name)
+{
+    QFile  file(file_name);
+    Source source;
+
+    source.file_name = file_name;
+    source.offset    = 0;
+
+    if (file.exists()) {
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = file_name + ": " + file.errorString();
+            return false;
+        }
+        source.offset = file.size();
+    }
+
+    sources.append(source);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// listen(const QString &name)
+//
+// Parameters:  name        - The local socket to serve snapshots on
+//
+// Starts serving, and reading the logs every POLL_MSECS. A socket
+// left behind by an earlier run that did not shut down is replaced.
+//
+// Returns: False if the socket could not be made
+///////////////////////////////////////////////////////////////////////
+bool
+LiveStats::listen(const QString &name)
+{
+    server = new QLocalServer(this);
+    QLocalServer::removeServer(name);
+
+    if (!server->listen(name)) {
+        error = name + ": " + server->errorString();
+        return false;
+    }
+    connect(server, SIGNAL(newConnection()), this, SLOT(serve()));
+
+    timer = new QTimer(this);
+    connect(timer, SIGNAL(timeout()), this, SLOT(poll()));
+    timer->start(POLL_MSECS);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// errorString()
+//
+// Returns: Why something failed
+///////////////////////////////////////////////////////////////////////
+QString
+LiveStats::errorString() const
+{
+    return error;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getSnapshot()
+//
+// Returns: The figures as they were after the last change. The bytes
+// are shared, not copied.
+///////////////////////////////////////////////////////////////////////
+QByteArray
+LiveStats::getSnapshot() const
+{
+    return snapshot;
+}
+
+///////////////////////////////////////////////////////////////////////
+// query(const QString &name, QByteArray *snapshot, QString *error)
+//
+// Parameters:  name        - The socket a LiveStats is serving on
+//              snapshot    - Set to what it sent
+//              error       - Set to what went wrong, if anything
+//
+// Returns: False if nobody answered
+///////////////////////////////////////////////////////////////////////
+bool
+LiveStats::query(const QString &name, QByteArray *snapshot, QString *error)
+{
+    QLocalSocket socket;
+
+    socket.connectToServer(name, QIODevice::ReadOnly);
+    if (!socket.waitForConnected(POLL_MSECS)) {
+        *error = name + ": " + socket.errorString();
+        return false;
+    }
+
+    snapshot->clear();
+    while (socket.state() == QLocalSocket::ConnectedState
+            && socket.waitForReadyRead(POLL_MSECS))
+        snapshot->append(socket.readAll());
+    snapshot->append(socket.readAll());
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// poll()
+//
+// Reads whatever has been added to each log, lets old games drop out
+// of the window, and rebuilds the snapshot if anything changed
+///////////////////////////////////////////////////////////////////////
+void
+LiveStats::poll()
+{
+    uint now     = QDateTime::currentDateTime().toTime_t();
+    bool changed = expire(now);
+
+    for (int i = 0; i < sources.size(); ++i)
+        changed |= readSource(sources[i], now);
+
+    if (changed)
+        buildSnapshot(now);
+}
+
+///////////////////////////////////////////////////////////////////////
+// serve()
+//
+// Sends the snapshot to everyone who has connected, and hangs up once
+// it has gone
+///////////////////////////////////////////////////////////////////////
+void
+LiveStats::serve()
+{
+    while (server->hasPendingConnections()) {
+        QLocalSocket *socket = server->nextPendingConnection();
+
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+        socket->write(snapshot);
+        socket->disconnectFromServer();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// readSource(Source &source, uint now)
+//
+// Parameters:  source      - The log to read
+//              now         - When the games in it count as finished
+//
+// Reads what was added since last time. The file is opened afresh
+// each time, so a log that is moved aside and started again is picked
+// up under its name.
+//
+// Returns: True if any games were added
+///////////////////////////////////////////////////////////////////////
+bool
+LiveStats::readSource(Source &source, uint now)
+{
+    QFile file(source.file_name);
+    bool  added = false;
+
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    qint64 size = file.size();
+
+    // Shorter than before, so it was started again
+    if (size < source.offset) {
+        source.offset = 0;
+        source.partial.clear();
+    }
+    if (size == source.offset || !file.seek(source.offset))
+        return false;
+
+    while (source.offset < size) {
+        QByteArray chunk = file.read(qMin(qint64(READ_SIZE),
+                                          size - source.offset));
+
+        if (chunk.isEmpty())
+            break;
+        source.offset += chunk.size();
+        source.partial.append(chunk);
+
+        // Every finished line is a game; the rest waits for more
+        int start = 0;
+        int end;
+
+        while ((end = source.partial.indexOf('\n', start)) >= 0) {
+            added |= addGame(source.partial.mid(start, end - start), now);
+            start  = end + 1;
+        }
+        source.partial.remove(0, start);
+    }
+    return added;
+}
+
+///////////////////////////////////////////////////////////////////////
+// addGame(const QByteArray &line, uint now)
+//
+// Parameters:  line        - A line of a log
+//              now         - When the game finished
+//
+// Returns: False if the line is not a game on this board
+///////////////////////////////////////////////////////////////////////
+bool
+LiveStats::addGame(const QByteArray &line, uint now)
+{
+    QVector<Move> moves;
+
+    if (!GameLog::parseGame(QString::fromLatin1(line.trimmed()), &moves)
+            || moves.isEmpty() || !GameLog::replay(moves, &board)) {
+        skipped++;
+        return false;
+    }
+
+    // Openings get a number the first time they are seen, so a game
+    // only has to keep the number
+    QString opening = GameLog::formatGame(moves.mid(0, OPENING_PLIES));
+    int     id      = opening_ids.value(opening, -1);
+
+    if (id < 0) {
+        id = opening_names.size();
+        opening_ids.insert(opening, id);
+        opening_names.append(opening);
+        opening_counts.append(0);
+    }
+
+    Game game;
+
+    game.time    = now;
+    game.winner  = board.hasLine(Board::X) ? Board::X
+                 : board.hasLine(Board::O) ? Board::O : Board::EMPTY;
+    game.plies   = moves.size();
+    game.opening = id;
+
+    wins[game.winner]++;
+    plies += game.plies;
+    opening_counts[id]++;
+    games.enqueue(game);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// expire(uint now)
+//
+// Parameters:  now         - The time now
+//
+// Takes the games that finished more than WINDOW_SECS ago back off the
+// counts. They are the oldest, so they are all at the front.
+//
+// Returns: True if any were taken off
+///////////////////////////////////////////////////////////////////////
+bool
+LiveStats::expire(uint now)
+{
+    bool expired = false;
+
+    while (!games.isEmpty() && games.head().time + WINDOW_SECS <= now) {
+        Game game = games.dequeue();
+
+        wins[game.winner]--;
+        plies -= game.plies;
+        opening_counts[game.opening]--;
+        expired = true;
+    }
+    return expired;
+}
+
+///////////////////////////////////////////////////////////////////////
+// buildSnapshot(uint now)
+//
+// Parameters:  now         - The time the figures are for
+//
+// Writes the figures out as text, once, for serve() to send. Only the
+// distinct openings are looked through for the most common, never the
+// games themselves.
+///////////////////////////////////////////////////////////////////////
+void
+LiveStats::buildSnapshot(uint now)
+{
+    int     count = games.size();
+    uint    span  = qMin(uint(WINDOW_SECS), qMax(now - started, uint(1)));
+    int     top[TOP_OPENINGS];
+    int     found = 0;
+    QString text;
+
+    // Pick the most common openings out one at a time
+    for (; found < TOP_OPENINGS; ++found) {
+        int best = -1;
+
+        for (int i = 0; i < opening_counts.size(); ++i) {
+            bool taken = false;
+
+            for (int j = 0; j < found; ++j)
+                taken |= top[j] == i;
+            if (!taken && opening_counts[i] > 0
+                    && (best < 0 || opening_counts[i] > opening_counts[best]))
+                best = i;
+        }
+        if (best < 0)
+            break;
+        top[found] = best;
+    }
+
+    text += QString("window %1\n").arg(int(WINDOW_SECS));
+    text += QString("games %1\n").arg(count);
+    text += QString("games_per_hour %1\n")
+            .arg(count * 3600.0 / span, 0, 'f', 1);
+    text += QString("x_wins %1\n").arg(wins[Board::X]);
+    text += QString("o_wins %1\n").arg(wins[Board::O]);
+    text += QString("draws %1\n").arg(wins[Board::EMPTY]);
+    text += QString("average_plies %1\n")
+            .arg(count > 0 ? double(plies) / count : 0.0, 0, 'f', 2);
+    for (int i = 0; i < found; ++i) {
+        text += QString("opening %1 %2\n").arg(opening_names[top[i]])
+                .arg(opening_counts[top[i]]);
+    }
+    text += QString("skipped %1\n").arg(skipped);
+    text += QString("updated %1\n").arg(now);
+
+    snapshot = text.toLatin1();
+}
@@ -0,0 +1,150 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_LIVESTATS_HH
+#define WF_LIVESTATS_HH
+
+///////////////////////////////////////////////////////////////////////
+// LiveStats.hh
+//
+// This file contains the declarations for the LiveStats class, which
+// follows the game logs of every game in a room as they are written
+// and serves up what has been happening on a local socket.
+//
+// Whoever connects to the socket is sent one snapshot and the socket
+// is closed. The snapshot is text, one figure per line:
+//
+//      window {seconds}                How far back the figures go
+//      games {n}                       Games finished in the window
+//      games_per_hour {n}
+//      x_wins {n}
+//      o_wins {n}
+//      draws {n}
+//      average_plies {n}
+//      opening {moves} {n}             The most common first moves,
+//                                      most common first, in the log's
+//                                      format
+//      skipped {n}                     Lines that were not games on
+//                                      this board, all day
+//      updated {time}                  Seconds since 1970, UTC
+///////////////////////////////////////////////////////////////////////
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Board.hh"
+
+class QLocalServer;
+class QTimer;
+
+///////////////////////////////////////////////////////////////////////
+// LiveStats
+//
+// Each log is read from where it ended when it was added, and after
+// that only what has been added since the last look is read, so the
+// games already counted are never read again. A log that gets shorter
+// has been started again and is read from the top.
+//
+// Every game keeps a small record in a queue, in the order the games
+// finished. A new game adds its record to the counts, and a record
+// that falls out of the window takes itself back off, so keeping the
+// figures up to date costs the same however long the day has been.
+// The log has no times in it, so a game counts as finished when its
+// line is read, at most POLL_MSECS late.
+//
+// The snapshot is rebuilt whenever a game comes in or drops out, and
+// sent as it is to everyone who asks, so answering costs the same
+// however many games there are or however often the dashboard asks.
+// Games are scored by whoever has a line, which is right for the
+// standard and gravity rules.
+///////////////////////////////////////////////////////////////////////
+class LiveStats : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum {
+        WINDOW_SECS   = 3600,                   // Games counted this long
+        POLL_MSECS    = 1000,                   // How often the logs are read
+        OPENING_PLIES = 2,                      // Moves that make an opening
+        TOP_OPENINGS  = 5,                      // Openings in the snapshot
+        READ_SIZE     = 65536                   // Bytes read at a time
+    };
+
+    LiveStats(int rows, int cols, int win_length, QObject *parent = 0);
+
+    bool        addLog(const QString &file_name);
+    bool        listen(const QString &name);    // And start following
+    QString     errorString() const;
+    QByteArray  getSnapshot() const;
+
+    static bool query(const QString &name, QByteArray *snapshot,
+                      QString *error);
+
+private slots:
+    void        poll();
+    void        serve();
+
+private:
+    // A log being followed
+    struct Source
+    {
+        QString     file_name;
+        qint64      offset;                     // Read up to here
+        QByteArray  partial;                    // A line not finished yet
+    };
+
+    // What is kept about each game in the window
+    struct Game
+    {
+        uint        time;                       // Seconds since 1970
+        Board::Cell winner;                     // EMPTY for a draw
+        int         plies;
+        int         opening;                    // Index into openings
+    };
+
+    bool        readSource(Source &source, uint now);
+    bool        addGame(const QByteArray &line, uint now);
+    bool        expire(uint now);
+    void        buildSnapshot(uint now);
+
+    Board                   board;              // For scoring games
+    QVector<Source>         sources;
+    QQueue<Game>            games;              // Oldest first
+    int                     wins[3];            // By Board::Cell, in window
+    qint64                  plies;              // Total, in window
+    QHash<QString, int>     opening_ids;        // Every opening ever seen
+    QStringList             opening_names;
+    QVector<int>            opening_counts;     // By opening, in window
+    uint                    started;
+    quint64                 skipped;            // Lines that were not games
+
+    QByteArray              snapshot;
+    QLocalServer           *server;
+    QTimer                 *timer;
+    QString                 error;
+};
+
+#endif
@@ -22,27 +22,70 @@
 #include <stdlib.h>
 
 #include "MainWindow.hh"
+#include "AllocCount.hh"
+#include "AnimationClock.hh"
+#include "Artwork.hh"
 #include "PiecesList.hh"
 #include "GameSpace.hh"
+#include "GravityBoard.hh"
+#include "Hinter.hh"
+#include "Journal.hh"
+#include "MoveQueue.hh"
+#include "Ponderer.hh"
+#include "Tablebase.hh"
+#include "Theme.hh"
 
 ///////////////////////////////////////////////////////////////////////
-// MainWindow(QWidget *parent)
+// MainWindow(int rows, int cols, int win_length, QWidget *parent)
 //
-// Parameters:  QWidget     *parent
+// Parameters:  int         rows        Rows on the board
+//              int         cols        Columns on the board
+//              int         win_length  How many in a row wins
+//              QWidget     *parent
 //
 // Constructor
 ///////////////////////////////////////////////////////////////////////
-MainWindow::MainWindow(QWidget *parent) :
-    QMainWindow(parent)
+MainWindow::MainWindow(int rows, int cols, int win_length, QWidget *parent) :
+    QMainWindow(parent),
+    rows(rows),
+    cols(cols),
+    pieces_per_side(rows * cols / 2 + 2),
+    cell_size(Artwork::BASE_SIZE),
+    scale_times(false),
+    interactive(true),
+    game_over(false),
+    winner(Board::EMPTY),
+    applied_sequence(0),
+    board(rows, cols, win_length),
+    rules(Rules::STANDARD),
+    next_rules(Rules::STANDARD),
+    tablebase(0),
+    computer(Board::EMPTY),
+    ponderer(0),
+    thinking_time(50),
+    network(0),
+    hinter(0),
+    journal(0),
+    theme(0),
+    theme_list(0)
 {
     // Initialize the gamespaces
-    for (int i = 0; i < 3; ++i) {
-        for (int j = 0; j < 3; ++j) {
+    space.resize(rows);
+    for (int i = 0; i < rows; ++i) {
+        space[i].resize(cols);
+        for (int j = 0; j < cols; ++j) {
             space[i][j] = new GameSpace(i, j);
+            space[i][j]->setObjectName(QString("space-%1-%2").arg(i).arg(j));
         }
     }
 
-    move = new QVector<Move>;
+    // A game never has more moves than spaces, so with room for that
+    // the list never has to grow during play
+    move.reserve(rows * cols);
+
+    // Moves come from the spaces through here, see movesPlayed()
+    move_queue = new MoveQueue(rows * cols, this);
+    connect(move_queue, SIGNAL(movesReady()), this, SLOT(movesPlayed()));
 
     // Create all the widgets and start a new game
     setupWidgets();
@@ -64,288 +107,721 @@ MainWindow::MainWindow(QWidget *parent) :
 void
 MainWindow::printMoves()
 {
-    char piece;
+    std::cout << qPrintable(GameLog::formatGame(move)) << "\n";
+}
 
-    for(int i = 0; i < move->size(); i++) {
-        Move cur = move->at(i);
-        if (cur.state == GameSpace::X) 
-            piece = 'X';
-        else
-            piece = 'O';
-        
-        std::cout << piece << "->(" << cur.row << "," << cur.col << ")";
+///////////////////////////////////////////////////////////////////////
+// setTablebase(Tablebase *tablebase)
+//
+// Parameters:  Tablebase   *tablebase  An open tablebase, or 0
+//
+// Once a tablebase is set, the turn label's tooltip says what the
+// current position is worth. The tablebase is not owned by us.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::setTablebase(Tablebase *tablebase)
+{
+    this->tablebase = tablebase;
+    showHint();
+}
 
-        if (&(move->at(i)) != &(move->last()))
-            std::cout << ":";
+///////////////////////////////////////////////////////////////////////
+// setComputer(Board::Cell player)
+//
+// Parameters:  Board::Cell player      X or O for the computer to play
+//                                      that side, EMPTY for nobody
+//
+// Lets the computer play one side. It thinks on its own thread, and
+// gets a head start while a child is dragging a piece.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::setComputer(Board::Cell player)
+{
+    computer = player;
+
+    if (computer != Board::EMPTY && !ponderer) {
+        ponderer = new Ponderer(this);
+        ponderer->setMoveTime(thinking_time);
+        ponderer->setNetwork(network);
+        ponderer->setGravity(rules == Rules::GRAVITY);
+        connect(ponderer, SIGNAL(moveReady(int, int)),
+                this, SLOT(computerMoved(int, int)),
+                Qt::QueuedConnection);
+        connect(ponderer, SIGNAL(searchReport(int, int, int)),
+                this, SLOT(computerReported(int, int, int)),
+                Qt::QueuedConnection);
     }
 
-    std::cout << "\n";
+    if (ponderer)
+        ponderer->cancel();
+
+    startComputerMove();
 }
 
 ///////////////////////////////////////////////////////////////////////
-// newGame()
+// setThinkingTime(int msecs)
 //
-// Clears everything and resets all states back to how they are at
-// first execution.
+// Parameters:  int         msecs       How long the computer may think
+//                                      about each move, 0 for as long
+//                                      as a fixed depth search takes
+//
+// The computer always answers within this time, however big the board
+// and however slow the machine; it just looks less far ahead.
 ///////////////////////////////////////////////////////////////////////
 void
-MainWindow::newGame()
+MainWindow::setThinkingTime(int msecs)
 {
-    move->clear();
+    thinking_time = msecs;
 
-    x_pieces_list->clear();
-    o_pieces_list->clear();
+    if (ponderer)
+        ponderer->setMoveTime(msecs);
+}
 
-    for (int i = 0; i < 3; ++i) {
-        for (int j = 0; j < 3; ++j) {
-            space[i][j]->clear();
-        }
-    }
+///////////////////////////////////////////////////////////////////////
+// setNetwork(const Network *network)
+//
+// Parameters:  Network     *network    Weights for the computer to
+//                                      score positions with, or 0 to
+//                                      count lines. Not owned by us.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::setNetwork(const Network *network)
+{
+    this->network = network;
 
-    QString x_image_file_name = ":/images/x.png";
-    QString o_image_file_name = ":/images/o.png";
+    if (ponderer)
+        ponderer->setNetwork(network);
+}
 
-    QPixmap x_image;
-    x_image.load(x_image_file_name);
-    
-    QPixmap o_image;
-    o_image.load(o_image_file_name);
+///////////////////////////////////////////////////////////////////////
+// setJournal(Journal *journal)
+//
+// Parameters:  Journal     *journal    An open journal. Not owned by us.
+//
+// Puts back the game the journal was left in, say by a power cut, and
+// records every move, undo, and new game from then on.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::setJournal(Journal *journal)
+{
+    this->journal = journal;
+    restoreGame(journal->getGame());
+}
 
-    for (int i = 0; i < 6; ++i) {
-        x_pieces_list->createPiece(x_image, true);
-        o_pieces_list->createPiece(o_image, false);
-    }
+///////////////////////////////////////////////////////////////////////
+// setRules(Rules::Set rules)
+//
+// Parameters:  Rules::Set  rules       Which game to play
+//
+// Switches rule sets from the next new game on, since the pieces each
+// side gets depend on them; the game in progress keeps its rules until
+// newGame() takes up the new ones. The computer only knows the standard
+// and gravity rules, so it sits out any other game.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::setRules(Rules::Set rules)
+{
+    next_rules = rules;
+}
 
-    changeTurnToX();
+///////////////////////////////////////////////////////////////////////
+// setTheme(Theme *theme, const QString &name)
+//
+// Parameters:  Theme       *theme      The theme packs to choose from.
+//                                      Not owned by us.
+//              QString     name        The pack to start with, or
+//                                      empty for the built in pictures
+//
+// Adds a list of the packs beside the undo button. A pack starts
+// decoding as soon as it is highlighted, so by the time it is picked
+// it is usually ready and goes in at once.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::setTheme(Theme *theme, const QString &name)
+{
+    QStringList names = theme->getNames();
+
+    this->theme = theme;
 
+    theme_list = new QComboBox;
+    theme_list->addItems(names);
+    theme_list->setCurrentIndex(qMax(0, names.indexOf(theme->getCurrent())));
+    bottom_layout->insertWidget(0, theme_list);
+
+    connect(theme_list, SIGNAL(highlighted(int)),
+            this, SLOT(themeHighlighted(int)));
+    connect(theme_list, SIGNAL(activated(int)),
+            this, SLOT(themePicked(int)));
+    connect(theme, SIGNAL(changed()), this, SLOT(themeChanged()));
+
+    if (!name.isEmpty())
+        theme->apply(name, cell_size);
 }
 
 ///////////////////////////////////////////////////////////////////////
-// movePlayed(bool is_x, int row, int col)
+// themeHighlighted(int index)
 //
-// Parameters:  bool        is_x        Was the piece played an X?
-//              int         row         What row was the piece played
-//              int         col         what col was the piece played
+// Parameters:  int         index       The pack under the pointer
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::themeHighlighted(int index)
+{
+    theme->prefetch(theme_list->itemText(index), cell_size);
+}
+
+///////////////////////////////////////////////////////////////////////
+// themePicked(int index)
 //
-// This checks to see if the game has ended. It then acts appropriately
-// depending on determined state of the game. The bool is a bit of a 
-// kludge, and I'm sorry for it. Unfortunately, Qt would not queue
-// signals with my GameSpace::SpaceState enum as a parameter, and it
-// resulted in a race condition bug. The bool was my fix for this.
+// Parameters:  int         index       The pack picked
 ///////////////////////////////////////////////////////////////////////
 void
-MainWindow::movePlayed(bool is_x, int row, int col)
+MainWindow::themePicked(int index)
 {
-    // Get the info from the last move, and log it
-    Move lastmove;
-    lastmove.row   = row;
-    lastmove.col   = col;
+    theme->apply(theme_list->itemText(index), cell_size);
+}
 
-    if (is_x) {
-        changeTurnToO();
-        lastmove.state = GameSpace::X;
-    }
-    if (!is_x) {
-        changeTurnToX();
-        lastmove.state = GameSpace::O;
+///////////////////////////////////////////////////////////////////////
+// themeChanged()
+//
+// Shows the pictures the theme has just put into Artwork everywhere
+// they are shown, keeping whose turn it is or how the game ended. The
+// game carries on as it was.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::themeChanged()
+{
+    const QPixmap *shown   = turn->pixmap();
+    qint64         key     = shown ? shown->cacheKey() : 0;
+    QPixmap       *turn_as = 0;             // Which picture it was
+
+    if (shown && key == x_turn_image.cacheKey())
+        turn_as = &x_turn_image;
+    else if (shown && key == o_turn_image.cacheKey())
+        turn_as = &o_turn_image;
+    for (int i = 0; i < 3 && shown && !turn_as; ++i) {
+        if (key == result_images[i].cacheKey())
+            turn_as = &result_images[i];
     }
 
-    move->push_back(lastmove);
+    loadPictures();
+    if (turn_as)
+        turn->setPixmap(*turn_as);
 
-    if (lastmove.state == GameSpace::X) {
-        if (checkXWin()) {
-            // This creates a message box that alerts the user that X won
-            QMessageBox *x_box = new QMessageBox(this);
-            QString x_wins_pixmap_file_name = ":/images/x_wins.png";
+    // A pack can be reloaded while the result box is still up
+    if (game_over && result_box->isVisible())
+        result_box->setIconPixmap(result_images[winner]);
 
-            QPixmap x_wins_pixmap;
-            x_wins_pixmap.load(x_wins_pixmap_file_name);
-            x_box->setIconPixmap(x_wins_pixmap);
-            x_box->setText(tr("X Wins!"));
-            x_box->setStandardButtons(QMessageBox::Ok);
-            x_box->exec();
-            
-            delete x_box;
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j)
+            space[i][j]->setSize(cell_size);
+    }
+    x_pieces_list->setPieceSize(cell_size);
+    o_pieces_list->setPieceSize(cell_size);
 
-            printMoves();
+    int index = theme_list->findText(theme->getCurrent());
 
-            newGame();
-            return;
-        }
+    if (index >= 0)
+        theme_list->setCurrentIndex(index);
+}
 
-    } else {
-        if (checkOWin()) {
-            // This message box alerts the user that O won
-            QMessageBox *o_box = new QMessageBox(this);
-            QString o_wins_pixmap_file_name = ":/images/o_wins.png";
-
-            QPixmap o_wins_pixmap;
-            o_wins_pixmap.load(o_wins_pixmap_file_name);
-            o_box->setIconPixmap(o_wins_pixmap);
-            o_box->setText(tr("O Wins!"));
-            o_box->setStandardButtons(QMessageBox::Ok);
-            o_box->exec();
-            
-            delete o_box;
+///////////////////////////////////////////////////////////////////////
+// setCellSize(int size)
+//
+// Parameters:  int         size        Width and height of a space
+//
+// Draws the board and the pieces at a new size, for screens where the
+// pictures' own 60 pixels are too small. The pictures are scaled once
+// here, not when they are painted. How long that took is written to
+// stderr if setScaleTimes() asked for it.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::setCellSize(int size)
+{
+    QTime timer;
+    int   rasterized = Artwork::getRasterized();
 
-            printMoves();
+    size = qBound(int(MIN_CELL_SIZE), size, int(MAX_CELL_SIZE));
+    if (size == cell_size)
+        return;
 
-            newGame();
-            return;
-        }
-    }
+    timer.start();
+    cell_size = size;
 
-    // If we did find a draw do the following
-    if (checkDraw()) {
-        //This messagebox alerts the user there is a draw
-        QMessageBox *draw_box             = new QMessageBox(this);
-        QString     draw_pixmap_file_name = ":/images/draw.png";
-        QPixmap     draw_pixmap;
-
-        draw_pixmap.load(draw_pixmap_file_name);
-        draw_box->setIconPixmap(draw_pixmap);
-        draw_box->setText(tr("Draw!"));
-        draw_box->setStandardButtons(QMessageBox::Ok);
-        draw_box->exec();
-            
-        delete draw_box;
-
-        printMoves();
-        newGame();
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j)
+            space[i][j]->setSize(size);
     }
+    x_pieces_list->setPieceSize(size);
+    o_pieces_list->setPieceSize(size);
+    board_grid->setMaximumSize(cols * size + 100, rows * size + 100);
+
+    if (scale_times)
+        std::cerr << "cell size " << size << ": "
+                  << Artwork::getRasterized() - rasterized
+                  << " pictures scaled in " << timer.elapsed() << " ms\n";
+}
+
+///////////////////////////////////////////////////////////////////////
+// setScaleTimes(bool report)
+//
+// Parameters:  bool        report      Whether to say how long each
+//                                      change of cell size took
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::setScaleTimes(bool report)
+{
+    scale_times = report;
+}
 
+///////////////////////////////////////////////////////////////////////
+// zoomIn()
+//
+// Makes the spaces a quarter bigger
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::zoomIn()
+{
+    setCellSize(cell_size + cell_size / 4);
+}
+
+///////////////////////////////////////////////////////////////////////
+// zoomOut()
+//
+// Makes the spaces a fifth smaller, undoing zoomIn()
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::zoomOut()
+{
+    setCellSize(cell_size - cell_size / 5);
+}
+
+///////////////////////////////////////////////////////////////////////
+// currentBoard()
+//
+// Returns: What is on the board, for the rules engine. It changes as
+// moves are played, so keep a copy if it is wanted for long.
+///////////////////////////////////////////////////////////////////////
+const Board &
+MainWindow::currentBoard() const
+{
+    return board;
+}
+
+///////////////////////////////////////////////////////////////////////
+// setInteractive(bool interactive)
+//
+// Parameters:  bool        interactive Is somebody watching?
+//
+// With nobody watching, as when a script is playing, there are no
+// hints, no animations, no message box at the end of a game, and no
+// log line on stdout. A finished game is left as it is until newGame().
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::setInteractive(bool interactive)
+{
+    this->interactive = interactive;
+    AnimationClock::instance()->setEnabled(interactive);
 }
 
 ///////////////////////////////////////////////////////////////////////
-// checkXwin()
+// playMove(Board::Cell piece, int row, int col)
+//
+// Parameters:  Board::Cell piece       The piece to put down
+//              int         row         Where to put it
+//              int         col
+//
+// Plays a piece straight from its tray, the way the computer does,
+// without dragging it. The move is taken from the move queue at once,
+// so the board, the winner, and the log are up to date on return.
+//
+// Under the gravity rules the piece falls to the lowest empty space
+// of col, whatever row is given, as it would if it were dropped.
 //
-// Checks if X has won.
+// Returns: False if the game is over, the space is off the board or
+// taken, or there are no such pieces left
 ///////////////////////////////////////////////////////////////////////
 bool
-MainWindow::checkXWin()
-{
-    // Check to see if X wins
-    for (int i = 0; i < 3; i++) {
-        if (   (space[i][0]->getState() == GameSpace::X 
-            &&  space[i][1]->getState() == GameSpace::X  // Rows
-            &&  space[i][2]->getState() == GameSpace::X)
-            || (space[0][i]->getState() == GameSpace::X 
-            &&  space[1][i]->getState() == GameSpace::X  // Cols
-            &&  space[2][i]->getState() == GameSpace::X)
-            || (space[0][0]->getState() == GameSpace::X
-            &&  space[1][1]->getState() == GameSpace::X  // Diagonal 1
-            &&  space[2][2]->getState() == GameSpace::X)
-            || (space[0][2]->getState() == GameSpace::X
-            &&  space[1][1]->getState() == GameSpace::X  // Diagonal 2
-            &&  space[2][0]->getState() == GameSpace::X)) 
-            return true;
+MainWindow::playMove(Board::Cell piece, int row, int col)
+{
+    if (rules == Rules::GRAVITY && col >= 0 && col < cols) {
+        for (row = rows - 1; row > 0; --row) {
+            if (board.getCell(row, col) == Board::EMPTY)
+                break;
+        }
     }
-    return false;
+
+    if (game_over || piece == Board::EMPTY || row < 0 || row >= rows
+            || col < 0 || col >= cols
+            || board.getCell(row, col) != Board::EMPTY
+            || piecesFor(piece)->count() == 0)
+        return false;
+
+    if (AllocCount::isEnabled())
+        move_allocs = AllocCount::get();
+
+    piecesFor(piece)->takePiece();
+    space[row][col]->playPiece(piece == Board::X);
+    movesPlayed();
+    return true;
 }
 
 ///////////////////////////////////////////////////////////////////////
-// checkOWin()
+// isGameOver()
 //
-// Checks if O has won.
+// Returns: True if the game on the board has been won or drawn. Only
+// ever seen when not interactive, as otherwise a new game is started.
 ///////////////////////////////////////////////////////////////////////
 bool
-MainWindow::checkOWin()
-{
-    // Check to see if O wins
-    for (int i = 0; i < 3; i++) {
-        if (   (space[i][0]->getState() == GameSpace::O 
-            &&  space[i][1]->getState() == GameSpace::O  // Rows
-            &&  space[i][2]->getState() == GameSpace::O)
-            || (space[0][i]->getState() == GameSpace::O
-            &&  space[1][i]->getState() == GameSpace::O  // Cols
-            &&  space[2][i]->getState() == GameSpace::O)
-            || (space[0][0]->getState() == GameSpace::O
-            &&  space[1][1]->getState() == GameSpace::O  // Diagonal 1
-            &&  space[2][2]->getState() == GameSpace::O)
-            || (space[0][2]->getState() == GameSpace::O
-            &&  space[1][1]->getState() == GameSpace::O  // Diagonal 2
-            &&  space[2][0]->getState() == GameSpace::O)) 
-        return true;
-        
+MainWindow::isGameOver() const
+{
+    return game_over;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getWinner()
+//
+// Returns: Who won the game on the board, EMPTY if nobody has
+///////////////////////////////////////////////////////////////////////
+Board::Cell
+MainWindow::getWinner() const
+{
+    return winner;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getHash()
+//
+// Returns: The Zobrist hash of what is on the board
+///////////////////////////////////////////////////////////////////////
+uint64_t
+MainWindow::getHash() const
+{
+    return board.hash();
+}
+
+///////////////////////////////////////////////////////////////////////
+// getGameLog()
+//
+// Returns: The game so far, as printMoves() would print it
+///////////////////////////////////////////////////////////////////////
+QString
+MainWindow::getGameLog() const
+{
+    return GameLog::formatGame(move);
+}
+
+///////////////////////////////////////////////////////////////////////
+// showHint()
+//
+// Gets the turn label's tooltip ready for a new position. With a
+// tablebase there is nothing to do, as eventFilter() looks the
+// position up when the tooltip is shown. Big boards with no tablebase
+// get a quick look for forced wins instead, as long as the standard
+// rules are in play. That look is taken by a Hinter on its own thread,
+// and the tooltip is filled in by hintFound() when it is done.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::showHint()
+{
+    if (!interactive)
+        return;
+
+    // The tablebase is asked when the tooltip is about to be shown
+    if (tablebase && tablebase->getRules() == rules)
+        return;
+
+    if (rules != Rules::STANDARD
+            || board.getCellCount() <= Search::NEARBY_CELLS
+            || board.getWinLength() < 4 || board.isOver()) {
+        if (hinter)
+            hinter->cancel();
+        return;
+    }
+
+    if (!hinter) {
+        hinter = new Hinter(this);
+        connect(hinter, SIGNAL(hintReady(int, int, bool)),
+                this, SLOT(hintFound(int, int, bool)),
+                Qt::QueuedConnection);
     }
-    return false;
+
+    // The last position's hint is no use for this one
+    turn->setToolTip(QString());
+    hinter->requestHint(board, HINT_TIME);
 }
 
 ///////////////////////////////////////////////////////////////////////
-// checkDraw()
+// eventFilter(QObject *watched, QEvent *event)
+//
+// Parameters:  QObject     *watched    The turn label
+//              QEvent      *event      What is happening to it
 //
-// Checks if a draw has occured. Alerts the user and starts a new game 
-// if neccessary. Inspired and based on code written by Bart Massey.
+// Returns: False, so the label still gets every event
+//
+// Looks the position up in the tablebase just before the turn label's
+// tooltip is shown. Nobody reads most positions' tooltips, so doing it
+// here rather than every turn keeps the lookup, and the block it may
+// have to unpack, off the moves.
 ///////////////////////////////////////////////////////////////////////
 bool
-MainWindow::checkDraw()
+MainWindow::eventFilter(QObject *watched, QEvent *event)
 {
-    bool draw    = true;
-    bool found_x = false;
-    bool found_o = false;
-
-    // Check the rows to see if they contain an X and an O
-    for (int i = 0; i < 3; i++) {
-        for (int j = 0; j < 3; j++) {
-            if (space[i][j]->getState() == GameSpace::X)
-                found_x = true;
-            else if (space[i][j]->getState() == GameSpace::O)
-                found_o = true;
-        }
-        if (!found_x || !found_o) {
-            draw = false;
-        } else {
-            found_x = false;
-            found_o = false;
+    if (watched == turn && event->type() == QEvent::ToolTip
+            && tablebase && tablebase->getRules() == rules)
+        turn->setToolTip(tablebase->describe(board));
+
+    return QMainWindow::eventFilter(watched, event);
+}
+
+///////////////////////////////////////////////////////////////////////
+// hintFound(int generation, int win, bool threatened)
+//
+// Parameters:  int         generation  When the hint was asked for
+//              int         win         Where the player to move can
+//                                      force a win, or -1
+//              bool        threatened  The opponent can force one
+//
+// Puts the Hinter's answer in the turn label's tooltip, unless the
+// position it was asked about is gone.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::hintFound(int generation, int win, bool threatened)
+{
+    if (generation != hinter->getGeneration() || board.isOver())
+        return;
+
+    QString player = board.toMove() == Board::X ? "X" : "O";
+    QString other  = board.toMove() == Board::X ? "O" : "X";
+
+    if (win >= 0)
+        turn->setToolTip(tr("%1 can force a win at row %2, column %3")
+                         .arg(player).arg(win / cols + 1)
+                         .arg(win % cols + 1));
+    else if (threatened)
+        turn->setToolTip(tr("%1 is threatening a forced win").arg(other));
+}
+
+///////////////////////////////////////////////////////////////////////
+// newGame()
+//
+// Clears everything and resets all states back to how they are at
+// first execution.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::newGame()
+{
+    if (ponderer)
+        ponderer->cancel();
+
+    // Rules set since the last game start with this one
+    rules = next_rules;
+    if (ponderer)
+        ponderer->setGravity(rules == Rules::GRAVITY);
+
+    if (journal)
+        journal->recordNewGame();
+    if (AllocCount::isEnabled())
+        game_allocs = AllocCount::get();
+
+    // Moves still on their way belong to the game being thrown away
+    move_queue->discard();
+    game_over = false;
+    winner    = Board::EMPTY;
+
+    // resize() rather than clear(), which would give up the room
+    // reserved for the moves
+    move.resize(0);
+    board.clear();
+
+    // Under gravity each space passes drops down its column
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            space[i][j]->clear();
+            if (rules == Rules::GRAVITY)
+                space[i][j]->setColumn(i > 0 ? space[i - 1][j] : 0,
+                                       i + 1 < rows ? space[i + 1][j] : 0);
+            else
+                space[i][j]->setColumn(0, 0);
         }
     }
 
-    // Check the columns to see if they contain an X and an O
-    for (int i = 0; i < 3; i++) {
-        for (int j = 0; j < 3; j++) {
-            if (space[j][i]->getState() == GameSpace::X)
-                found_x = true;
-            else if (space[j][i]->getState() == GameSpace::O)
-                found_o = true;
-        }
-        if (!found_x || !found_o) {
-            draw = false;
-        } else {
-            found_x = false;
-            found_o = false;
+    fillTrays(0, 0);
+
+    changeTurnToX();
+
+    startComputerMove();
+}
+
+///////////////////////////////////////////////////////////////////////
+// movesPlayed()
+//
+// Takes the moves played since last time from the move queue, which
+// may be several when drops or scripted moves come quickly, and checks
+// to see if the game has ended. Each move is checked as it is put on
+// the board, as the game may end partway through; whatever follows the
+// end belongs to a finished game and is dropped. The turn, the hint,
+// and the result are only shown once for the whole batch.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::movesPlayed()
+{
+    const QVector<MoveQueue::Event> &batch = move_queue->take();
+    Board::Cell                      mover = Board::EMPTY;
+
+    for (int i = 0; i < batch.size() && !game_over; ++i) {
+        const MoveQueue::Event &event  = batch[i];
+        const Move             &played = event.move;
+        int                     cell   = played.row * cols + played.col;
+
+        // The queue numbers moves in order, and a space only takes one
+        // piece, so neither of these should happen; if they do the move
+        // is not counted twice.
+        if (event.sequence <= applied_sequence
+                || board.getCell(cell) != Board::EMPTY) {
+            qWarning("ignoring move %s to (%d,%d), already played",
+                     qPrintable(QString::number(event.sequence)),
+                     played.row + 1, played.col + 1);
+            continue;
         }
-    }
+        applied_sequence = event.sequence;
+
+        // Who moved depends on the rules, not always on the piece
+        mover = Rules::player(rules, Board::Cell(played.state),
+                              move.size());
 
-    // Check the first diaganol
-    for (int i = 0; i < 3; i++) {
-        if (space[i][i]->getState() == GameSpace::X)
-            found_x = true;
-        else if (space[i][i]->getState() == GameSpace::O)
-            found_o = true;
+        board.place(cell, Board::Cell(played.state));
+        move.push_back(played);
+        if (journal)
+            journal->recordMove(played);
+
+        winner    = checkWin(mover);
+        game_over = winner != Board::EMPTY || checkDraw();
     }
-    if (!found_x || !found_o) {
-        draw = false;
-    } else {
-        found_x = false;
-        found_o = false;
+
+    if (mover == Board::EMPTY)
+        return;
+
+    if (mover == Board::X)
+        changeTurnToO();
+    else
+        changeTurnToX();
+
+    countAllocations(game_over);
+
+    // Without a user to click the result away, the finished game stays
+    // on the board until whoever is driving asks for a new one
+    if (game_over) {
+        if (interactive) {
+            highlightWin();
+            showResult(winner);
+            printMoves();
+            newGame();
+        }
+        return;
     }
 
-    // Check the second diaganol
-    int j = 2;
-    for (int i = 0; i < 3; i++) {
-        if (space[i][j]->getState() == GameSpace::X)
-            found_x = true;
-        else if (space[i][j]->getState() == GameSpace::O)
-            found_o = true;
+    startComputerMove();
+}
+
+///////////////////////////////////////////////////////////////////////
+// checkWin(Board::Cell mover)
+//
+// Parameters:  Board::Cell mover       Who just moved
+//
+// Checks if anybody has won now that mover has moved. Under the
+// standard rules that is mover if they made a line, but misère and
+// Notakto hand the win to the other player.
+//
+// Returns: X or O for the winner, otherwise Board::EMPTY
+///////////////////////////////////////////////////////////////////////
+Board::Cell
+MainWindow::checkWin(Board::Cell mover)
+{
+    return Rules::winner(rules, board, mover);
+}
+
+///////////////////////////////////////////////////////////////////////
+// checkDraw()
+//
+// Checks if a draw has occured, which is as soon as every row,
+// column, and diagonal contains both an X and an O. Inspired and based
+// on code written by Bart Massey. The Board keeps count of the lines
+// that are still open as pieces are played, so this is only a lookup.
+// Notakto lines can not be blocked, so there it is a full board.
+///////////////////////////////////////////////////////////////////////
+bool
+MainWindow::checkDraw()
+{
+    return Rules::isDrawn(rules, board);
+}
 
-        j--;
+///////////////////////////////////////////////////////////////////////
+// highlightWin()
+//
+// Lights up every line that ended the game. The spaces go on glowing
+// while the result is shown, until the next game clears them.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::highlightWin()
+{
+    int length = board.getWinLength();
+
+    for (int line = 0; line < board.getLineCount(); ++line) {
+        if (board.getLinePieces(line, Board::X) != length
+                && board.getLinePieces(line, Board::O) != length)
+            continue;
+
+        const int *cells = board.getLineCells(line);
+
+        for (int i = 0; i < length; ++i)
+            space[cells[i] / cols][cells[i] % cols]->highlight();
     }
-    if (!found_x || !found_o) 
-        draw = false;
+}
 
-    // If all rows, cols, and diaganols contain an X
-    // and an O then it is a draw.
-    return draw;
+///////////////////////////////////////////////////////////////////////
+// showResult(Board::Cell winner)
+//
+// Parameters:  Board::Cell winner      X or O, or EMPTY for a draw
+//
+// Tells the user how the game ended. The same message box is used for
+// every game, with pictures that were loaded at the start.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::showResult(Board::Cell winner)
+{
+    result_box->setIconPixmap(result_images[winner]);
+    result_box->setText(result_texts[winner]);
+    result_box->exec();
+}
+
+///////////////////////////////////////////////////////////////////////
+// countAllocations(bool game_over)
+//
+// Parameters:  bool        game_over   Did this move end the game?
+//
+// With --count-allocations, says on stderr how many allocations the
+// move just played took, from picking the piece up to here, and at
+// the end of a game how many the whole game took.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::countAllocations(bool game_over)
+{
+    if (!AllocCount::isEnabled())
+        return;
+
+    AllocCount::Counts in_move = AllocCount::since(move_allocs);
+
+    std::cerr << "allocations: move " << move.size() << ", "
+              << in_move.allocations << " (" << in_move.bytes
+              << " bytes)";
+
+    if (game_over) {
+        AllocCount::Counts in_game = AllocCount::since(game_allocs);
+
+        std::cerr << ", game " << in_game.allocations << " ("
+                  << in_game.bytes << " bytes)";
+    }
+    std::cerr << "\n";
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -356,13 +832,9 @@ MainWindow::checkDraw()
 void
 MainWindow::changeTurnToX()
 {
-    turn->setText(tr("X's Turn"));
-    QString x_turn_image_file_name = ":/images/x_turn.png";
-
-    QPixmap x_turn_image;
-    x_turn_image.load(x_turn_image_file_name);
-
+    turn->setText(x_turn_text);
     turn->setPixmap(x_turn_image);
+    showHint();
     return;
 }
 
@@ -374,26 +846,12 @@ MainWindow::changeTurnToX()
 void
 MainWindow::changeTurnToO()
 {
-    bool start_game = true;
-
-    turn->setText(tr("O's Turn"));
-    QString o_turn_image_file_name = ":/images/o_turn.png";
-
-    QPixmap o_turn_image;
-    o_turn_image.load(o_turn_image_file_name);
-
+    turn->setText(o_turn_text);
     turn->setPixmap(o_turn_image);
-
-    // Check to see if it is the start of a game
-    for (int i = 0; i < 3; i++) {
-        for (int j = 0; j < 3; j++) {
-            if (!(space[i][j]->getState() == GameSpace::EMPTY))
-                start_game = false;
-        }
-    }
+    showHint();
 
     // if this is a new game change the player to X
-    if (start_game)
+    if (board.getMoveCount() == 0)
         changeTurnToX();
 
     return;
@@ -402,57 +860,170 @@ MainWindow::changeTurnToO()
 ///////////////////////////////////////////////////////////////////////
 // undo()
 //
-// Undoes the last move taken during the current active game
+// Undoes the last move taken during the current active game. When
+// playing the computer, the computer's move and the move it answered
+// are both taken back, so it is the child's turn again.
 ///////////////////////////////////////////////////////////////////////
 void
 MainWindow::undo()
 {
-    if (!move->isEmpty()) {
+    if (ponderer)
+        ponderer->cancel();
+
+    // A piece that is on the board but not yet in the move list would
+    // be left behind, so catch up first
+    if (move_queue->getPending() > 0)
+        movesPlayed();
+
+    if (move.isEmpty())
+        return;
+
+    bool undid_computer = computer != Board::EMPTY
+                       && Board::Cell(move.last().state) == computer;
+
+    undoLastMove();
+
+    if (undid_computer && !move.isEmpty())
+        undoLastMove();
+
+    startComputerMove();
+}
+
+///////////////////////////////////////////////////////////////////////
+// undoLastMove()
+//
+// Takes back the last move and gives the piece back to its list
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::undoLastMove()
+{
+    if (!move.isEmpty()) {
         GameSpace::SpaceState state;
         int                   row;
         int                   col;
         Move                  last;
 
         // What was the last move?
-        last  = move->last();
+        last  = move.last();
         row   = last.row;
         col   = last.col;
         state = last.state;
     
         // Clear the space where the last move occurred
         space[row][col]->clear();
+        board.remove(row * cols + col);
         
-        // If we are undoing an X move add an X to the x_pieces_list
-        if (state == GameSpace::X) {
-            QString x_image_file_name = ":/images/x.png";
-    
-            QPixmap x_image;
-            x_image.load(x_image_file_name);
-    
-            x_pieces_list->createPiece(x_image, true);
-        }
-    
-        // If we are undoing an O move an O to the o_pieces_list
-        if (state == GameSpace::O) {
-            QString o_image_file_name = ":/images/o.png";
+        // Put the piece back in the list it came from
+        if (state == GameSpace::X)
+            x_pieces_list->addPiece();
+        if (state == GameSpace::O)
+            o_pieces_list->addPiece();
 
-            QPixmap o_image;
-            o_image.load(o_image_file_name);
+        showNextTurn();
 
-            o_pieces_list->createPiece(o_image, false);
-        }
+        move.pop_back();
+        if (journal)
+            journal->recordUndo();
 
-        // After an undo move I set the current player depending on 
-        // who has played the most pieces. This is not a bug! If a
-        // user plays a move out of turn and then undoes that move
-        // I want to display the turn of who should be going next.
-        if ((x_pieces_list->count()) >= (o_pieces_list->count()))
+        game_over = false;
+        winner    = Board::EMPTY;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// showNextTurn()
+//
+// After an undo move I set the current player depending on who has
+// played the most pieces. This is not a bug! If a user plays a move out
+// of turn and then undoes that move I want to display the turn of who
+// should be going next. Wild and Notakto players take turns whatever
+// they put down.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::showNextTurn()
+{
+    if (rules == Rules::WILD || rules == Rules::NOTAKTO) {
+        if (Rules::toMove(rules, board) == Board::X)
             changeTurnToX();
         else
             changeTurnToO();
+    } else if ((x_pieces_list->count()) >= (o_pieces_list->count())) {
+        changeTurnToX();
+    } else {
+        changeTurnToO();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// fillTrays(int x_used, int o_used)
+//
+// Parameters:  int         x_used      Xs already on the board
+//              int         o_used      Os already on the board
+//
+// Fills the piece lists with what each side has left to play.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::fillTrays(int x_used, int o_used)
+{
+    // Wild players may use either piece and Notakto players only Xs,
+    // so those lists get enough for every space.
+    int x_pieces = pieces_per_side;
+    int o_pieces = pieces_per_side;
+
+    if (rules == Rules::WILD) {
+        x_pieces = rows * cols;
+        o_pieces = rows * cols;
+    } else if (rules == Rules::NOTAKTO) {
+        x_pieces = rows * cols;
+        o_pieces = 0;
+    }
+
+    x_pieces_list->setCount(x_pieces - x_used);
+    o_pieces_list->setCount(o_pieces - o_used);
+}
+
+///////////////////////////////////////////////////////////////////////
+// restoreGame(const QVector<Move> &moves)
+//
+// Parameters:  QVector<Move> moves     A game in progress
+//
+// Puts a game back on the board all at once, without playing it move
+// by move, so nothing is logged or recorded again. A game that does
+// not fit this board, or had already ended, is replaced by a new one.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::restoreGame(const QVector<Move> &moves)
+{
+    if (ponderer)
+        ponderer->cancel();
+
+    if (moves.isEmpty() || !GameLog::replay(moves, &board)
+            || (rules == Rules::GRAVITY && !GravityBoard::isSettled(board))) {
+        newGame();
+        return;
+    }
+
+    Board::Cell mover = Rules::player(rules, Board::Cell(moves.last().state),
+                                      moves.size() - 1);
+
+    if (checkWin(mover) != Board::EMPTY || checkDraw()) {
+        newGame();
+        return;
+    }
 
-        move->pop_back();
+    move = moves;
+    move.reserve(rows * cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            space[i][j]->setState(
+                GameSpace::SpaceState(board.getCell(i * cols + j)));
+        }
     }
+
+    fillTrays(board.getPieceCount(Board::X), board.getPieceCount(Board::O));
+    showNextTurn();
+
+    startComputerMove();
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -475,24 +1046,29 @@ MainWindow::setupWidgets()
     board_grid    = new QGroupBox;
     x_pieces_list = new PiecesList(true);
     o_pieces_list = new PiecesList(false);
+    x_pieces_list->setObjectName("x_pieces");
+    o_pieces_list->setObjectName("o_pieces");
+
+    // What is shown every turn and at the end of every game
+    x_turn_text = tr("X's Turn");
+    o_turn_text = tr("O's Turn");
+
+    result_box = new QMessageBox(this);
+    result_box->setStandardButtons(QMessageBox::Ok);
+    result_texts[Board::EMPTY] = tr("Draw!");
+    result_texts[Board::X]     = tr("X Wins!");
+    result_texts[Board::O]     = tr("O Wins!");
 
     // New Game Button
     new_game_button = new QPushButton();
     new_game_button->setMaximumSize(80, 80);
-    QPixmap new_game_image;
-    QString new_game_image_file_name = ":/images/new_game.png";
-    new_game_image.load(new_game_image_file_name);
-    new_game_button->setIcon(new_game_image);
     new_game_button->setIconSize(QSize(50, 50));
     connect(new_game_button, SIGNAL(clicked()), this, SLOT(newGame()));
 
     // Title Image
-    QString title_image_file_name = ":/images/title.png";
-    QPixmap title_image;
-    title_image.load(title_image_file_name);
     title_pic = new QLabel();
-    title_pic->setPixmap(title_image);
-    turn = new QLabel(tr("X's Turn"));
+    turn = new QLabel(x_turn_text);
+    turn->installEventFilter(this);
 
     // Notify Layout
     notify_layout->addWidget(title_pic);
@@ -503,20 +1079,12 @@ MainWindow::setupWidgets()
     // Quit Button
     quit_button   = new QPushButton();
     quit_button->setMaximumSize(60, 60);
-    QPixmap quit_image;
-    QString quit_image_file_name = ":/images/quit.png";
-    quit_image.load(quit_image_file_name);
-    quit_button->setIcon(quit_image);
     quit_button->setIconSize(QSize(50, 50));
     connect(quit_button, SIGNAL(clicked()), qApp, SLOT(quit()));
 
     // Undo Button
     undo_button   = new QPushButton();
     undo_button->setMaximumSize(60, 60);
-    QPixmap undo_image;
-    QString undo_image_file_name = ":/images/undo.png";
-    undo_image.load(undo_image_file_name);
-    undo_button->setIcon(undo_image);
     undo_button->setIconSize(QSize(50, 50));
     connect(undo_button, SIGNAL(clicked()), this, SLOT(undo()));
 
@@ -525,33 +1093,45 @@ MainWindow::setupWidgets()
     bottom_layout->addWidget(quit_button);
     bottom_box->setLayout(bottom_layout);
 
+    loadPictures();
+
     // Board Grid
     board_grid->setStyleSheet("background-image: url(images/bg.png)");
-    board_grid->setMaximumSize(280, 280);
+    board_grid->setMaximumSize(cols * cell_size + 100,
+                               rows * cell_size + 100);
 
     // Board Layout
-    board_layout->addWidget(space[0][0], 0, 0);
-    board_layout->addWidget(space[0][1], 0, 1);
-    board_layout->addWidget(space[0][2], 0, 2);
-    board_layout->addWidget(space[1][0], 1, 0);
-    board_layout->addWidget(space[1][1], 1, 1);
-    board_layout->addWidget(space[1][2], 1, 2);
-    board_layout->addWidget(space[2][0], 2, 0);
-    board_layout->addWidget(space[2][1], 2, 1);
-    board_layout->addWidget(space[2][2], 2, 2);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            board_layout->addWidget(space[i][j], i, j);
+        }
+    }
     board_grid->setLayout(board_layout);
 
     // Connect each game space with the piecePlayed signal
-    for (int i = 0; i < 3; ++i) {
-        for (int j = 0; j < 3; ++j) {
-            connect(space[i][j], 
-                    SIGNAL(piecePlayed(bool, int, int)),
-                    this, 
-                    SLOT(movePlayed(bool, int, int)), 
-                    Qt::QueuedConnection);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            connect(space[i][j],
+                    SIGNAL(piecePlayed(GameSpace::SpaceState, int, int)),
+                    move_queue,
+                    SLOT(post(GameSpace::SpaceState, int, int)));
+            connect(space[i][j],
+                    SIGNAL(pieceHovered(int, int)),
+                    this,
+                    SLOT(spaceHovered(int, int)));
         }
     }
 
+    // Bigger and smaller spaces, for big screens
+    connect(new QShortcut(QKeySequence::ZoomIn, this), SIGNAL(activated()),
+            this, SLOT(zoomIn()));
+    connect(new QShortcut(QKeySequence::ZoomOut, this), SIGNAL(activated()),
+            this, SLOT(zoomOut()));
+
+    // The computer thinks while a piece is being dragged
+    connect(x_pieces_list, SIGNAL(dragStarted()), this, SLOT(dragStarted()));
+    connect(o_pieces_list, SIGNAL(dragStarted()), this, SLOT(dragStarted()));
+
     // Horizontal Layout
     horz_layout->addWidget(x_pieces_list);
     horz_layout->addWidget(board_grid);
@@ -567,3 +1147,141 @@ MainWindow::setupWidgets()
 
     setCentralWidget(frame);
 }
+
+///////////////////////////////////////////////////////////////////////
+// loadPictures()
+//
+// Takes the pictures for the title, the buttons, the turn, and the
+// result from Artwork, once here rather than each time they are shown
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::loadPictures()
+{
+    x_turn_image = Artwork::get(Artwork::X_TURN);
+    o_turn_image = Artwork::get(Artwork::O_TURN);
+
+    result_images[Board::EMPTY] = Artwork::get(Artwork::DRAW);
+    result_images[Board::X]     = Artwork::get(Artwork::X_WINS);
+    result_images[Board::O]     = Artwork::get(Artwork::O_WINS);
+
+    title_pic->setPixmap(Artwork::get(Artwork::TITLE));
+    new_game_button->setIcon(Artwork::get(Artwork::NEW_GAME));
+    quit_button->setIcon(Artwork::get(Artwork::QUIT));
+    undo_button->setIcon(Artwork::get(Artwork::UNDO));
+}
+
+///////////////////////////////////////////////////////////////////////
+// piecesFor(Board::Cell player)
+//
+// Returns: The list that holds player's pieces
+///////////////////////////////////////////////////////////////////////
+PiecesList *
+MainWindow::piecesFor(Board::Cell player)
+{
+    return player == Board::X ? x_pieces_list : o_pieces_list;
+}
+
+///////////////////////////////////////////////////////////////////////
+// computerKnowsRules()
+//
+// Returns: True if the computer can play the rules in use, which are
+// the standard rules on any board, or gravity on a board small enough
+// for a GravityBoard
+///////////////////////////////////////////////////////////////////////
+bool
+MainWindow::computerKnowsRules() const
+{
+    return rules == Rules::STANDARD
+        || (rules == Rules::GRAVITY && GravityBoard::fits(rows, cols));
+}
+
+///////////////////////////////////////////////////////////////////////
+// startComputerMove()
+//
+// If it is the computer's turn, ask it for a move. The move arrives
+// later through computerMoved().
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::startComputerMove()
+{
+    if (ponderer && computer != Board::EMPTY && computerKnowsRules()
+            && board.toMove() == computer && !board.isOver())
+        ponderer->requestMove(board);
+}
+
+///////////////////////////////////////////////////////////////////////
+// dragStarted()
+//
+// A child picked up a piece. If it is their turn against the computer,
+// the computer starts thinking about its answers right away.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::dragStarted()
+{
+    if (AllocCount::isEnabled())
+        move_allocs = AllocCount::get();
+
+    if (ponderer && computer != Board::EMPTY && computerKnowsRules()
+            && board.toMove() != computer && !board.isOver())
+        ponderer->ponder(board);
+}
+
+///////////////////////////////////////////////////////////////////////
+// spaceHovered(int row, int col)
+//
+// Parameters:  int         row     Row of the space
+//              int         col     Column of the space
+//
+// A piece is being dragged over a space, which makes that the most
+// likely move. The computer thinks about it next.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::spaceHovered(int row, int col)
+{
+    if (ponderer)
+        ponderer->prioritize(row * cols + col);
+}
+
+///////////////////////////////////////////////////////////////////////
+// computerMoved(int generation, int cell)
+//
+// Parameters:  int         generation  When the move was asked for
+//              int         cell        Where the computer wants to go
+//
+// Plays the computer's move, unless the game has changed since it was
+// asked for.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::computerMoved(int generation, int cell)
+{
+    if (generation != ponderer->getGeneration() || cell < 0
+            || board.getCell(cell) != Board::EMPTY
+            || board.toMove() != computer)
+        return;
+
+    if (AllocCount::isEnabled())
+        move_allocs = AllocCount::get();
+
+    piecesFor(computer)->takePiece();
+    space[cell / cols][cell % cols]->playPiece(computer == Board::X);
+}
+
+///////////////////////////////////////////////////////////////////////
+// computerReported(int depth, int nodes, int msecs)
+//
+// Parameters:  int         depth       Plies the search finished
+//              int         nodes       Positions it looked at
+//              int         msecs       How long it took
+//
+// Logs how the search for the computer's move went. This goes to
+// stderr so it never gets mixed up with the game log on stdout.
+///////////////////////////////////////////////////////////////////////
+void
+MainWindow::computerReported(int depth, int nodes, int msecs)
+{
+    qint64 per_second = msecs > 0 ? qint64(nodes) * 1000 / msecs : nodes;
+
+    std::cerr << "computer: depth " << depth << ", " << nodes
+              << " nodes in " << msecs << " ms (" << per_second
+              << " nodes/s)\n";
+}
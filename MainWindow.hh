@@ -26,27 +26,27 @@
 #include <QRectF>
 #include <QPushButton>
 #include <QLabel>
+#include <QMessageBox>
 #include <QVector>
 
+#include "AllocCount.hh"
+#include "Board.hh"
+#include "GameLog.hh"
 #include "GameSpace.hh"
+#include "Rules.hh"
 
 // These classes need to be declared here so that I can put them to use later. 
 class PiecesList;
 class GameBoard;
+class Hinter;
 class QListWidgetItem;
-
-///////////////////////////////////////////////////////////////////////
-// Move
-//
-// This struct represents a move that was played in this game. It is
-// utilized for undo and logging procedures.
-///////////////////////////////////////////////////////////////////////
-struct Move 
-{
-    GameSpace::SpaceState   state; 
-    int                     row;
-    int                     col;
-};
+class Journal;
+class MoveQueue;
+class Network;
+class Ponderer;
+class Tablebase;
+class Theme;
+class QComboBox;
 
 ///////////////////////////////////////////////////////////////////////
 // MainWindow
@@ -54,30 +54,80 @@ struct Move
 // This class creates a main window for xsnos. It will probably always
 // be ran as a singleton, but if you want multiple instances go for it.
 // It works great with multiple instances with reasonable results.
+//
+// The board is 3x3 with three in a row to win unless told otherwise.
 ///////////////////////////////////////////////////////////////////////
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = 0);
+    enum {
+        HINT_TIME     = 20,                     // Milliseconds per hint
+        MIN_CELL_SIZE = 30,                     // Pixels a space can be
+        MAX_CELL_SIZE = 480
+    };
+
+    MainWindow(int rows = 3, int cols = 3, int win_length = 3,
+               QWidget *parent = 0);
     void printMoves();
+    void setTablebase(Tablebase *tablebase);
+    void setComputer(Board::Cell player);
+    void setThinkingTime(int msecs);
+    void setNetwork(const Network *network);
+    void setRules(Rules::Set rules);
+    void setJournal(Journal *journal);
+    void setInteractive(bool interactive);
+    void setCellSize(int size);
+    void setScaleTimes(bool report);
+    void setTheme(Theme *theme, const QString &name = QString());
+    const Board &currentBoard() const;
+
+    bool        playMove(Board::Cell piece, int row, int col);
+    bool        isGameOver() const;
+    Board::Cell getWinner() const;              // EMPTY for a draw too
+    uint64_t    getHash() const;
+    QString     getGameLog() const;
 
 public slots:
     void        newGame();
+    void        undo();
+
+protected:
+    bool        eventFilter(QObject *watched, QEvent *event);
 
 private slots:
                 // Check for endgame condition
-    void        movePlayed(bool state, int row, int col);
+    void        movesPlayed();
     void        changeTurnToX();
     void        changeTurnToO();
-    void        undo();
+    void        dragStarted();
+    void        spaceHovered(int row, int col);
+    void        computerMoved(int generation, int cell);
+    void        computerReported(int depth, int nodes, int msecs);
+    void        hintFound(int generation, int win, bool threatened);
+    void        zoomIn();
+    void        zoomOut();
+    void        themeHighlighted(int index);
+    void        themePicked(int index);
+    void        themeChanged();
 
 private:
     void        setupWidgets();
-    bool        checkOWin();
-    bool        checkXWin();
+    void        loadPictures();
+    Board::Cell checkWin(Board::Cell mover);
     bool        checkDraw();
+    void        highlightWin();
+    void        showResult(Board::Cell winner);
+    void        countAllocations(bool game_over);
+    void        showHint();
+    void        undoLastMove();
+    void        showNextTurn();
+    void        fillTrays(int x_used, int o_used);
+    void        restoreGame(const QVector<Move> &moves);
+    bool        computerKnowsRules() const;
+    void        startComputerMove();
+    PiecesList *piecesFor(Board::Cell player);
 
     // The layouts and boxes that make it look pretty
     QFrame      *frame;
@@ -94,10 +144,55 @@ private:
     // The game objects
     PiecesList  *o_pieces_list;
     PiecesList  *x_pieces_list;
-    GameSpace   *space[3][3];
+    QVector< QVector<GameSpace *> > space;
+    int         rows;
+    int         cols;
+    int         pieces_per_side;
+    int         cell_size;                      // Pixels across a space
+    bool        scale_times;                    // Report each rescale
+    bool        interactive;                    // Somebody is watching
+    bool        game_over;                      // Won or drawn, see
+    Board::Cell winner;                         // setInteractive()
 
     // Record keeping
-    QVector<Move> *move;
+    QVector<Move> move;                         // Room for a full board
+    MoveQueue   *move_queue;                    // Moves not yet looked at
+    quint64     applied_sequence;               // Last move taken from it
+    Board       board;                          // What is on the spaces
+    Rules::Set  rules;                          // Which game is being played
+    Rules::Set  next_rules;                     // Which from the next game on
+
+    // The computer player, if there is one
+    Board::Cell computer;
+    Ponderer    *ponderer;
+    int         thinking_time;                  // Milliseconds per move
+    const Network *network;                     // Its evaluation, or 0
+
+    // Looks for forced wins to hint at, made when first needed
+    Hinter      *hinter;
+
+    // Where the game in progress is kept safe, if anywhere
+    Journal     *journal;
+
+    // Solved positions, if we were given a tablebase
+    Tablebase   *tablebase;
+
+    // The theme packs to choose from, if we were given any
+    Theme       *theme;
+    QComboBox   *theme_list;
+
+    // Shown every turn and after every game, loaded once per theme
+    QString     x_turn_text;
+    QString     o_turn_text;
+    QPixmap     x_turn_image;
+    QPixmap     o_turn_image;
+    QMessageBox *result_box;
+    QString     result_texts[3];                // By winner, EMPTY for
+    QPixmap     result_images[3];               // a draw
+
+    // Allocation counts when they are wanted, see AllocCount.hh
+    AllocCount::Counts move_allocs;             // When the move began
+    AllocCount::Counts game_allocs;             // When the game began
 
     // Buttons and Labels
     QPushButton *quit_button;
@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include "MoveQueue.hh"
+
+///////////////////////////////////////////////////////////////////////
+// MoveQueue(int capacity, QObject *parent)
+//
+// Parameters:  int         capacity    Moves a batch can hold without
+//                                      growing, a full board is plenty
+//              QObject    *parent      Who deletes us
+///////////////////////////////////////////////////////////////////////
+MoveQueue::MoveQueue(int capacity, QObject *parent) :
+    QObject(parent), filling(0), last_sequence(0), scheduled(false)
+{
+    buffers[0].reserve(capacity);
+    buffers[1].reserve(capacity);
+}
+
+///////////////////////////////////////////////////////////////////////
+// post(GameSpace::SpaceState state, int row, int col)
+//
+// Parameters:  GameSpace::SpaceState state     The piece that was played
+//              int         row                 Where it was played
+//              int         col
+//
+// Numbers a move and adds it to the batch being gathered. The first
+// move of a batch asks the event loop to deliver it; the rest ride
+// along. Delivery always waits for the event loop, so nothing the
+// reader does can happen in the middle of a drop.
+///////////////////////////////////////////////////////////////////////
+void
+MoveQueue::post(GameSpace::SpaceState state, int row, int col)
+{
+    Event event;
+
+    event.sequence   = ++last_sequence;
+    event.move.state = state;
+    event.move.row   = row;
+    event.move.col   = col;
+    buffers[filling].push_back(event);
+
+    if (!scheduled) {
+        scheduled = true;
+        QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// take()
+//
+// Returns: Every move posted since the last take, oldest first. Moves
+// posted while the batch is being read go into the other buffer and
+// come out with the next one.
+///////////////////////////////////////////////////////////////////////
+const QVector<MoveQueue::Event> &
+MoveQueue::take()
+{
+    int full = filling;
+
+    filling ^= 1;
+    // resize() rather than clear(), which would give up the room
+    buffers[filling].resize(0);
+    return buffers[full];
+}
+
+///////////////////////////////////////////////////////////////////////
+// discard()
+//
+// Forgets the moves waiting to be delivered, for when the game they
+// were played in is over. Their sequence numbers are not given out
+// again.
+///////////////////////////////////////////////////////////////////////
+void
+MoveQueue::discard()
+{
+    buffers[filling].resize(0);
+}
+
+///////////////////////////////////////////////////////////////////////
+// getPending()
+//
+// Returns: How many moves are waiting to be delivered
+///////////////////////////////////////////////////////////////////////
+int
+MoveQueue::getPending() const
+{
+    return buffers[filling].size();
+}
+
+///////////////////////////////////////////////////////////////////////
+// getLastSequence()
+//
+// Returns: The sequence number of the last move posted, 0 for none
+///////////////////////////////////////////////////////////////////////
+quint64
+MoveQueue::getLastSequence() const
+{
+    return last_sequence;
+}
+
+///////////////////////////////////////////////////////////////////////
+// deliver()
+//
+// Tells the reader a batch is waiting, unless it was already taken or
+// discarded since it was posted.
+///////////////////////////////////////////////////////////////////////
+void
+MoveQueue::deliver()
+{
+    scheduled = false;
+
+    if (!buffers[filling].isEmpty())
+        emit movesReady();
+}
@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_MOVEQUEUE_HH
+#define WF_MOVEQUEUE_HH
+
+///////////////////////////////////////////////////////////////////////
+// MoveQueue.hh
+//
+// This file contains the declarations for the MoveQueue class, which
+// carries moves from the spaces on the board to the window that keeps
+// score.
+///////////////////////////////////////////////////////////////////////
+
+#include <QObject>
+#include <QVector>
+
+#include "GameLog.hh"
+#include "GameSpace.hh"
+
+///////////////////////////////////////////////////////////////////////
+// MoveQueue
+//
+// Moves used to reach the window through one queued signal each, which
+// had to be a bool because Qt can not queue our enum, and nothing
+// stopped one arriving twice or late. Now each space hands its move to
+// the queue straight away, where it is given the next sequence number,
+// and the queue asks the event loop to deliver once. Every move posted
+// before delivery comes out together, in order, as one batch for its
+// only reader.
+//
+// The batches are kept in two buffers that take turns, so once they
+// have grown to a game's worth of moves posting costs no allocation.
+///////////////////////////////////////////////////////////////////////
+class MoveQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Event
+    {
+        quint64     sequence;                   // 1 for the first move
+        Move        move;
+    };
+
+    MoveQueue(int capacity, QObject *parent = 0);
+
+    const QVector<Event> &take();               // Good until the next take
+    void        discard();                      // Forget what is waiting
+    int         getPending() const;
+    quint64     getLastSequence() const;
+
+public slots:
+    void        post(GameSpace::SpaceState state, int row, int col);
+
+signals:
+    void        movesReady();                   // Once per batch
+
+private slots:
+    void        deliver();
+
+private:
+    QVector<Event> buffers[2];
+    int         filling;                        // Which buffer posts go to
+    quint64     last_sequence;
+    bool        scheduled;                      // Delivery is on its way
+};
+
+#endif
@@ -0,0 +1,604 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "Network.hh"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const char MAGIC[8] = {'X', 'S', 'N', 'O', 'S', 'N', 'N', '1'};
+
+///////////////////////////////////////////////////////////////////////
+// Little endian helpers for the weights file
+///////////////////////////////////////////////////////////////////////
+static uint32_t
+readWord(const unsigned char *data, int bytes)
+{
+    uint32_t value = 0;
+
+    for (int i = bytes - 1; i >= 0; --i)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+static void
+writeWord(std::string &out, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+        out += char((value >> (8 * i)) & 0xff);
+}
+
+///////////////////////////////////////////////////////////////////////
+// randomWeight(uint64_t &state, int range)
+//
+// Returns: A number from -range to range. splitmix64, the same
+// generator Board uses for its hash keys.
+///////////////////////////////////////////////////////////////////////
+static int
+randomWeight(uint64_t &state, int range)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return int(z % uint64_t(2 * range + 1)) - range;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Scalar kernels. These are what evaluateReference() uses, and what
+// everything uses when the compiler has no SIMD turned on.
+///////////////////////////////////////////////////////////////////////
+static void
+addScalar(int16_t *values, const int16_t *column)
+{
+    for (int i = 0; i < Network::HIDDEN; ++i)
+        values[i] = int16_t(values[i] + column[i]);
+}
+
+static void
+clipScalar(uint8_t *out, const int16_t *values)
+{
+    for (int i = 0; i < Network::HIDDEN; ++i)
+        out[i] = uint8_t(std::max(0, std::min(127, int(values[i]))));
+}
+
+static int32_t
+dotScalar(const uint8_t *inputs, const int8_t *weights, int count)
+{
+    int32_t sum = 0;
+
+    for (int i = 0; i < count; ++i)
+        sum += int32_t(inputs[i]) * weights[i];
+    return sum;
+}
+
+///////////////////////////////////////////////////////////////////////
+// SIMD kernels. They give exactly the same answers as the scalar ones:
+// the first layer wraps the same way, and the clipped inputs are at
+// most 127 so the pairwise sums in maddubs can not saturate.
+///////////////////////////////////////////////////////////////////////
+#if defined(__AVX2__)
+
+static const char *KERNEL = "avx2";
+
+static void
+addColumn(int16_t *values, const int16_t *column)
+{
+    for (int i = 0; i < Network::HIDDEN; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(column + i));
+        _mm256_storeu_si256((__m256i *)(values + i), _mm256_add_epi16(v, c));
+    }
+}
+
+static void
+subtractColumn(int16_t *values, const int16_t *column)
+{
+    for (int i = 0; i < Network::HIDDEN; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(column + i));
+        _mm256_storeu_si256((__m256i *)(values + i), _mm256_sub_epi16(v, c));
+    }
+}
+
+static void
+clip(uint8_t *out, const int16_t *values)
+{
+    const __m256i top = _mm256_set1_epi8(127);
+
+    for (int i = 0; i < Network::HIDDEN; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(values + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(values + i + 16));
+        // packus works within 128 bit lanes, put the quarters back in order
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_min_epu8(p, top));
+    }
+}
+
+static int32_t
+dot(const uint8_t *inputs, const int8_t *weights, int count)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i       sum  = _mm256_setzero_si256();
+
+    for (int i = 0; i < count; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)(inputs + i));
+        __m256i w  = _mm256_loadu_si256((const __m256i *)(weights + i));
+        __m256i p  = _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones);
+        sum = _mm256_add_epi32(sum, p);
+    }
+
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                 _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4e));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xb1));
+    return _mm_cvtsi128_si32(half);
+}
+
+#elif defined(__SSE2__)
+
+#if defined(__SSSE3__)
+static const char *KERNEL = "ssse3";
+#else
+static const char *KERNEL = "sse2";
+#endif
+
+static void
+addColumn(int16_t *values, const int16_t *column)
+{
+    for (int i = 0; i < Network::HIDDEN; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+        __m128i c = _mm_loadu_si128((const __m128i *)(column + i));
+        _mm_storeu_si128((__m128i *)(values + i), _mm_add_epi16(v, c));
+    }
+}
+
+static void
+subtractColumn(int16_t *values, const int16_t *column)
+{
+    for (int i = 0; i < Network::HIDDEN; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+        __m128i c = _mm_loadu_si128((const __m128i *)(column + i));
+        _mm_storeu_si128((__m128i *)(values + i), _mm_sub_epi16(v, c));
+    }
+}
+
+static void
+clip(uint8_t *out, const int16_t *values)
+{
+    const __m128i top = _mm_set1_epi8(127);
+
+    for (int i = 0; i < Network::HIDDEN; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(values + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(values + i + 8));
+        __m128i p = _mm_packus_epi16(a, b);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_min_epu8(p, top));
+    }
+}
+
+static int32_t
+dot(const uint8_t *inputs, const int8_t *weights, int count)
+{
+    __m128i sum = _mm_setzero_si128();
+
+    for (int i = 0; i < count; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(inputs + i));
+        __m128i w  = _mm_loadu_si128((const __m128i *)(weights + i));
+#if defined(__SSSE3__)
+        __m128i p  = _mm_madd_epi16(_mm_maddubs_epi16(in, w),
+                                    _mm_set1_epi16(1));
+        sum = _mm_add_epi32(sum, p);
+#else
+        // Widen both to 16 bits, the weights keeping their sign
+        __m128i zero = _mm_setzero_si128();
+        __m128i in_lo = _mm_unpacklo_epi8(in, zero);
+        __m128i in_hi = _mm_unpackhi_epi8(in, zero);
+        __m128i w_lo  = _mm_srai_epi16(_mm_unpacklo_epi8(w, w), 8);
+        __m128i w_hi  = _mm_srai_epi16(_mm_unpackhi_epi8(w, w), 8);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(in_lo, w_lo));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(in_hi, w_hi));
+#endif
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+#else
+
+static const char *KERNEL = "scalar";
+
+static void
+addColumn(int16_t *values, const int16_t *column)
+{
+    addScalar(values, column);
+}
+
+static void
+subtractColumn(int16_t *values, const int16_t *column)
+{
+    for (int i = 0; i < Network::HIDDEN; ++i)
+        values[i] = int16_t(values[i] - column[i]);
+}
+
+static void
+clip(uint8_t *out, const int16_t *values)
+{
+    clipScalar(out, values);
+}
+
+static int32_t
+dot(const uint8_t *inputs, const int8_t *weights, int count)
+{
+    return dotScalar(inputs, weights, count);
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// hiddenOutput(int32_t sum)
+//
+// Returns: A second layer output scaled and clipped to 0..127. The
+// layers after the first are tiny, so this part is always scalar.
+///////////////////////////////////////////////////////////////////////
+static int
+hiddenOutput(int32_t sum)
+{
+    if (sum <= 0)
+        return 0;
+    return std::min(127, int(sum >> Network::HIDDEN_SHIFT));
+}
+
+///////////////////////////////////////////////////////////////////////
+// Network()
+//
+// Constructor. The network is empty until load() or randomize().
+///////////////////////////////////////////////////////////////////////
+Network::Network() :
+    cells(0),
+    output_bias(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// Getters
+///////////////////////////////////////////////////////////////////////
+bool
+Network::isLoaded() const
+{
+    return cells > 0;
+}
+
+int
+Network::getCells() const
+{
+    return cells;
+}
+
+const char *
+Network::kernelName()
+{
+    return KERNEL;
+}
+
+///////////////////////////////////////////////////////////////////////
+// load(const std::string &file_name, std::string *error)
+//
+// Parameters:  file_name   - A weights file
+//              error       - Set to what went wrong, if not 0
+//
+// Returns: True if the network was read. On failure the network is
+// left as it was.
+///////////////////////////////////////////////////////////////////////
+bool
+Network::load(const std::string &file_name, std::string *error)
+{
+    std::ifstream       file(file_name.c_str(), std::ios::binary);
+    std::string         data;
+    std::string         problem;
+
+    if (!file) {
+        problem = "Could not open " + file_name;
+    } else {
+        data.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+    }
+
+    const unsigned char *bytes = (const unsigned char *)data.data();
+    size_t               header = sizeof(MAGIC) + 3 * 4;
+    uint32_t             count  = 0;
+
+    if (problem.empty()
+            && (data.size() < header
+                || memcmp(bytes, MAGIC, sizeof(MAGIC)) != 0))
+        problem = file_name + " is not a weights file";
+
+    if (problem.empty()) {
+        count = readWord(bytes + 8, 4);
+        if (count == 0 || count > uint32_t(Board::MAX_CELLS)
+                || readWord(bytes + 12, 4) != uint32_t(HIDDEN)
+                || readWord(bytes + 16, 4) != uint32_t(SECOND))
+            problem = file_name + " has the wrong size of network";
+    }
+
+    size_t expected = header
+                      + size_t(count) * 2 * HIDDEN * 2  // feature_weights
+                      + HIDDEN * 2                      // feature_bias
+                      + SECOND * HIDDEN * 2             // hidden_weights
+                      + SECOND * 4                      // hidden_bias
+                      + SECOND                          // output_weights
+                      + 4;                              // output_bias
+
+    if (problem.empty() && data.size() != expected)
+        problem = file_name + " is the wrong length";
+
+    if (!problem.empty()) {
+        if (error)
+            *error = problem;
+        return false;
+    }
+
+    const unsigned char *at = bytes + header;
+
+    cells = int(count);
+    feature_weights.resize(size_t(cells) * 2 * HIDDEN);
+    for (size_t i = 0; i < feature_weights.size(); ++i, at += 2)
+        feature_weights[i] = int16_t(readWord(at, 2));
+
+    feature_bias.resize(HIDDEN);
+    for (int i = 0; i < HIDDEN; ++i, at += 2)
+        feature_bias[i] = int16_t(readWord(at, 2));
+
+    hidden_weights.resize(SECOND * HIDDEN * 2);
+    for (size_t i = 0; i < hidden_weights.size(); ++i, ++at)
+        hidden_weights[i] = int8_t(*at);
+
+    hidden_bias.resize(SECOND);
+    for (int i = 0; i < SECOND; ++i, at += 4)
+        hidden_bias[i] = int32_t(readWord(at, 4));
+
+    output_weights.resize(SECOND);
+    for (int i = 0; i < SECOND; ++i, ++at)
+        output_weights[i] = int8_t(*at);
+
+    output_bias = int32_t(readWord(at, 4));
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// save(const std::string &file_name)
+//
+// Parameters:  file_name   - Where to write the weights
+//
+// Returns: True if the file was written
+///////////////////////////////////////////////////////////////////////
+bool
+Network::save(const std::string &file_name) const
+{
+    std::string out(MAGIC, sizeof(MAGIC));
+
+    if (!isLoaded())
+        return false;
+
+    writeWord(out, uint32_t(cells), 4);
+    writeWord(out, HIDDEN, 4);
+    writeWord(out, SECOND, 4);
+
+    for (size_t i = 0; i < feature_weights.size(); ++i)
+        writeWord(out, uint16_t(feature_weights[i]), 2);
+    for (size_t i = 0; i < feature_bias.size(); ++i)
+        writeWord(out, uint16_t(feature_bias[i]), 2);
+    for (size_t i = 0; i < hidden_weights.size(); ++i)
+        out += char(hidden_weights[i]);
+    for (size_t i = 0; i < hidden_bias.size(); ++i)
+        writeWord(out, uint32_t(hidden_bias[i]), 4);
+    for (size_t i = 0; i < output_weights.size(); ++i)
+        out += char(output_weights[i]);
+    writeWord(out, uint32_t(output_bias), 4);
+
+    std::ofstream file(file_name.c_str(), std::ios::binary);
+
+    file.write(out.data(), out.size());
+    file.close();
+    return bool(file);
+}
+
+///////////////////////////////////////////////////////////////////////
+// randomize(int cells, uint32_t seed)
+//
+// Parameters:  int      cells  - Cells on the board it is for
+//              uint32_t seed   - Picks the weights
+//
+// Fills the network with small random weights. It plays no better than
+// chance, it is for trying out the file format and the kernels before
+// there are trained weights.
+///////////////////////////////////////////////////////////////////////
+void
+Network::randomize(int cells, uint32_t seed)
+{
+    uint64_t state = seed;
+
+    this->cells = std::max(1, std::min(cells, int(Board::MAX_CELLS)));
+
+    feature_weights.resize(size_t(this->cells) * 2 * HIDDEN);
+    for (size_t i = 0; i < feature_weights.size(); ++i)
+        feature_weights[i] = int16_t(randomWeight(state, 24));
+
+    feature_bias.resize(HIDDEN);
+    for (int i = 0; i < HIDDEN; ++i)
+        feature_bias[i] = int16_t(32 + randomWeight(state, 32));
+
+    hidden_weights.resize(SECOND * HIDDEN * 2);
+    for (size_t i = 0; i < hidden_weights.size(); ++i)
+        hidden_weights[i] = int8_t(randomWeight(state, 127));
+
+    hidden_bias.resize(SECOND);
+    for (int i = 0; i < SECOND; ++i)
+        hidden_bias[i] = randomWeight(state, 1 << 12);
+
+    output_weights.resize(SECOND);
+    for (int i = 0; i < SECOND; ++i)
+        output_weights[i] = int8_t(randomWeight(state, 127));
+
+    output_bias = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// column(int cell, Board::Cell piece, int side)
+//
+// Parameters:  int     cell    - Where the piece is
+//              piece           - X or O
+//              int     side    - 0 to see it as X, 1 to see it as O
+//
+// Returns: The first layer weights for that input
+///////////////////////////////////////////////////////////////////////
+const int16_t *
+Network::column(int cell, Board::Cell piece, int side) const
+{
+    bool mine = (piece == Board::X) == (side == 0);
+
+    return &feature_weights[(size_t(cell) * 2 + (mine ? 0 : 1)) * HIDDEN];
+}
+
+///////////////////////////////////////////////////////////////////////
+// refresh(Accumulator &accumulator, const Board &board)
+//
+// Parameters:  accumulator - Filled in for board
+//              board       - A position on a board with getCells() cells
+//
+// Works out the first layer from scratch. After this, addPiece() and
+// removePiece() keep it up to date.
+///////////////////////////////////////////////////////////////////////
+void
+Network::refresh(Accumulator &accumulator, const Board &board) const
+{
+    for (int side = 0; side < 2; ++side)
+        std::copy(feature_bias.begin(), feature_bias.end(),
+                  accumulator.values[side]);
+
+    for (int i = 0; i < board.getCellCount() && i < cells; ++i) {
+        if (board.getCell(i) != Board::EMPTY)
+            addPiece(accumulator, i, board.getCell(i));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// addPiece(Accumulator &accumulator, int cell, Board::Cell player)
+// removePiece(Accumulator &accumulator, int cell, Board::Cell player)
+//
+// Parameters:  accumulator - Kept up to date
+//              int cell    - Where the piece went or came from
+//              player      - Whose piece it is
+///////////////////////////////////////////////////////////////////////
+void
+Network::addPiece(Accumulator &accumulator, int cell,
+                  Board::Cell player) const
+{
+    for (int side = 0; side < 2; ++side)
+        addColumn(accumulator.values[side], column(cell, player, side));
+}
+
+void
+Network::removePiece(Accumulator &accumulator, int cell,
+                     Board::Cell player) const
+{
+    for (int side = 0; side < 2; ++side)
+        subtractColumn(accumulator.values[side], column(cell, player, side));
+}
+
+///////////////////////////////////////////////////////////////////////
+// evaluate(const Accumulator &accumulator, Board::Cell player)
+//
+// Parameters:  accumulator - The first layer, kept up to date
+//              player      - Who we are scoring for
+//
+// Returns: How good the position is for player
+///////////////////////////////////////////////////////////////////////
+int
+Network::evaluate(const Accumulator &accumulator, Board::Cell player) const
+{
+    uint8_t inputs[HIDDEN * 2];
+    int32_t total = output_bias;
+    int     us    = player == Board::X ? 0 : 1;
+
+    // Our side first, so the same weights work for both players
+    clip(inputs, accumulator.values[us]);
+    clip(inputs + HIDDEN, accumulator.values[1 - us]);
+
+    for (int j = 0; j < SECOND; ++j) {
+        int32_t sum = hidden_bias[j]
+                      + dot(inputs, &hidden_weights[j * HIDDEN * 2],
+                            HIDDEN * 2);
+        total += hiddenOutput(sum) * output_weights[j];
+    }
+
+    return int(total / (1 << OUTPUT_SHIFT));
+}
+
+///////////////////////////////////////////////////////////////////////
+// evaluateReference(const Board &board, Board::Cell player)
+//
+// Parameters:  board       - The position
+//              player      - Who we are scoring for
+//
+// Returns: What evaluate() should return for board, worked out from
+// scratch with no SIMD at all.
+///////////////////////////////////////////////////////////////////////
+int
+Network::evaluateReference(const Board &board, Board::Cell player) const
+{
+    Accumulator accumulator;
+    uint8_t     inputs[HIDDEN * 2];
+    int32_t     total = output_bias;
+    int         us    = player == Board::X ? 0 : 1;
+
+    for (int side = 0; side < 2; ++side) {
+        std::copy(feature_bias.begin(), feature_bias.end(),
+                  accumulator.values[side]);
+
+        for (int i = 0; i < board.getCellCount() && i < cells; ++i) {
+            if (board.getCell(i) != Board::EMPTY)
+                addScalar(accumulator.values[side],
+                          column(i, board.getCell(i), side));
+        }
+    }
+
+    clipScalar(inputs, accumulator.values[us]);
+    clipScalar(inputs + HIDDEN, accumulator.values[1 - us]);
+
+    for (int j = 0; j < SECOND; ++j) {
+        int32_t sum = hidden_bias[j]
+                      + dotScalar(inputs, &hidden_weights[j * HIDDEN * 2],
+                                  HIDDEN * 2);
+        total += hiddenOutput(sum) * output_weights[j];
+    }
+
+    return int(total / (1 << OUTPUT_SHIFT));
+}
@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#ifndef WF_NETWORK_HH
+#define WF_NETWORK_HH
+
+///////////////////////////////////////////////////////////////////////
+// Network.hh
+//
+// This file contains the declarations for the Network class, a small
+// quantized neural network the search can use to score positions on
+// big boards instead of counting lines.
+//
+// The weights file is laid out as:
+//
+//      "XSNOSNN1"                      magic
+//      uint32  cells, hidden, second
+//      int16   feature_weights[cells * 2][hidden]
+//      int16   feature_bias[hidden]
+//      int8    hidden_weights[second][hidden * 2]
+//      int32   hidden_bias[second]
+//      int8    output_weights[second]
+//      int32   output_bias
+//
+// All numbers are little endian. hidden and second must match HIDDEN
+// and SECOND below.
+///////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "Board.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Network
+//
+// The first layer has one input per cell and piece, seen from each
+// player's side: "my piece here" and "their piece here". Its output
+// for both sides is kept in an Accumulator, which only needs one
+// column of weights added or taken away when a piece is played or
+// taken back, so nothing is recomputed from scratch during a search.
+//
+// The rest of the network is clipped to 0..127, multiplied by int8
+// weights, and summed in int32. With AVX2 or SSSE3 turned on in the
+// compiler (for example -march=native) those loops use SIMD
+// instructions; otherwise they are plain C++. evaluateReference()
+// always uses plain C++ and recomputes everything, to check the fast
+// path against.
+///////////////////////////////////////////////////////////////////////
+class Network
+{
+public:
+    enum {
+        HIDDEN       = 256,                     // First layer outputs
+        SECOND       = 32,                      // Second layer outputs
+        HIDDEN_SHIFT = 6,                       // Second layer scaling
+        OUTPUT_SHIFT = 4                        // Output scaling
+    };
+
+    // The first layer's output, from X's side [0] and O's side [1]
+    struct Accumulator
+    {
+        int16_t values[2][HIDDEN];
+    };
+
+    Network();
+
+    bool        load(const std::string &file_name, std::string *error = 0);
+    bool        save(const std::string &file_name) const;
+    void        randomize(int cells, uint32_t seed);
+    bool        isLoaded() const;
+    int         getCells() const;
+
+    void        refresh(Accumulator &accumulator, const Board &board) const;
+    void        addPiece(Accumulator &accumulator, int cell,
+                         Board::Cell player) const;
+    void        removePiece(Accumulator &accumulator, int cell,
+                            Board::Cell player) const;
+    int         evaluate(const Accumulator &accumulator,
+                         Board::Cell player) const;
+    int         evaluateReference(const Board &board,
+                                  Board::Cell player) const;
+
+    static const char *kernelName();            // Which SIMD is in use
+
+private:
+    const int16_t *column(int cell, Board::Cell piece, int side) const;
+
+    int                     cells;
+    std::vector<int16_t>    feature_weights;    // [cells * 2][HIDDEN]
+    std::vector<int16_t>    feature_bias;       // [HIDDEN]
+    std::vector<int8_t>     hidden_weights;     // [SECOND][HIDDEN * 2]
+    std::vector<int32_t>    hidden_bias;        // [SECOND]
+    std::vector<int8_t>     output_weights;     // [SECOND]
+    int32_t                 output_bias;
+};
+
+#endif
@@ -51,6 +51,165 @@
 #include <QtGui>
 
 #include "PiecesList.hh"
+#include "GameSpace.hh"
+#include "Artwork.hh"
+
+///////////////////////////////////////////////////////////////////////
+// PiecesModel(QObject *parent)
+//
+// Parameters:  QObject     *parent
+//
+// Constructor, for an empty list
+///////////////////////////////////////////////////////////////////////
+PiecesModel::PiecesModel(QObject *parent) :
+    QAbstractListModel(parent),
+    count(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// rowCount(const QModelIndex &parent)
+//
+// Returns: How many pieces are left
+///////////////////////////////////////////////////////////////////////
+int
+PiecesModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// data(const QModelIndex &index, int role)
+//
+// Returns: Nothing, as the pieces differ only in where they are and
+// PieceDelegate paints them all the same.
+///////////////////////////////////////////////////////////////////////
+QVariant
+PiecesModel::data(const QModelIndex & /*index*/, int /*role*/) const
+{
+    return QVariant();
+}
+
+///////////////////////////////////////////////////////////////////////
+// flags(const QModelIndex &index)
+//
+// Returns: What may be done with a piece
+///////////////////////////////////////////////////////////////////////
+Qt::ItemFlags
+PiecesModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return 0;
+
+    return Qt::ItemIsEnabled |                      // Not grayed out
+           Qt::ItemIsSelectable |                   // Can be selected
+           Qt::ItemIsDragEnabled;                   // Can be dragged
+}
+
+///////////////////////////////////////////////////////////////////////
+// setCount(int count)
+//
+// Parameters:  int         count       Pieces the list should hold
+//
+// Refills the list in one go, without touching each piece.
+///////////////////////////////////////////////////////////////////////
+void
+PiecesModel::setCount(int count)
+{
+    beginResetModel();
+    this->count = count < 0 ? 0 : count;
+    endResetModel();
+}
+
+///////////////////////////////////////////////////////////////////////
+// addPiece()
+//
+// Puts a piece back at the end of the list.
+///////////////////////////////////////////////////////////////////////
+void
+PiecesModel::addPiece()
+{
+    beginInsertRows(QModelIndex(), count, count);
+    ++count;
+    endInsertRows();
+}
+
+///////////////////////////////////////////////////////////////////////
+// takePiece()
+//
+// Returns: False if the list was already empty
+//
+// The pieces are all the same, so it is always the last one that goes.
+///////////////////////////////////////////////////////////////////////
+bool
+PiecesModel::takePiece()
+{
+    if (count == 0)
+        return false;
+
+    beginRemoveRows(QModelIndex(), count - 1, count - 1);
+    --count;
+    endRemoveRows();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// PieceDelegate(const QPixmap &pixmap, QObject *parent)
+//
+// Parameters:  QPixmap     pixmap      The piece to paint
+//              QObject     *parent
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+PieceDelegate::PieceDelegate(const QPixmap &pixmap, QObject *parent) :
+    QAbstractItemDelegate(parent),
+    pixmap(pixmap)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// setPixmap(const QPixmap &pixmap)
+//
+// Parameters:  QPixmap     pixmap      The piece to paint from now on
+///////////////////////////////////////////////////////////////////////
+void
+PieceDelegate::setPixmap(const QPixmap &pixmap)
+{
+    this->pixmap = pixmap;
+}
+
+///////////////////////////////////////////////////////////////////////
+// paint(QPainter *painter, const QStyleOptionViewItem &option,
+//       const QModelIndex &index)
+//
+// Draws the piece in the middle of its cell, over the highlight if it
+// is the one selected.
+///////////////////////////////////////////////////////////////////////
+void
+PieceDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                     const QModelIndex & /*index*/) const
+{
+    QRect   target(QPoint(0, 0), pixmap.size());
+
+    target.moveCenter(option.rect.center());
+
+    if (option.state & QStyle::State_Selected)
+        painter->fillRect(option.rect, option.palette.highlight());
+
+    painter->drawPixmap(target, pixmap);
+}
+
+///////////////////////////////////////////////////////////////////////
+// sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index)
+//
+// Returns: The size of a piece, which is the same for all of them
+///////////////////////////////////////////////////////////////////////
+QSize
+PieceDelegate::sizeHint(const QStyleOptionViewItem & /*option*/,
+                        const QModelIndex & /*index*/) const
+{
+    return pixmap.size();
+}
 
 ///////////////////////////////////////////////////////////////////////
 // PiecesList(bool is_x, QWidget *parent)
@@ -58,40 +217,141 @@
 // Parameters:  bool        is_x
 //              QWidget     *parent
 //
-// Constructor
+// Constructor. The pixmap is fetched and the drag data written once,
+// here, rather than for each piece or each drag.
 ///////////////////////////////////////////////////////////////////////
 PiecesList::PiecesList(bool is_x, QWidget *parent) :
-    QListWidget(parent), 
-    is_x(is_x)
+    QListView(parent), 
+    is_x(is_x),
+    model(new PiecesModel(this))
 {
+    delegate = new PieceDelegate(pixmap, this);
+
+    setModel(model);
+    setItemDelegate(delegate);
+
     setDragEnabled(true);                   // Yes, I want to drag things
-    setViewMode(QListView::IconMode);       // Make it look like icons
-    setIconSize(QSize(60, 60));             // Size of icons
+    setFlow(QListView::LeftToRight);        // Lay pieces out in rows
+    setWrapping(true);                      // As many rows as it takes
+    setResizeMode(QListView::Adjust);       // Rewrap when resized
+    setUniformItemSizes(true);              // Every piece is the same size
     setSpacing(5);                          // Space between icons
     setAcceptDrops(true);                   // Yes, drop things back here
     setDropIndicatorShown(true);            // Show cursor indicator
-    setMaximumSize(175, 220);               // The perfect size
+    setPieceSize(Artwork::BASE_SIZE);
+}
+
+///////////////////////////////////////////////////////////////////////
+// setPieceSize(int size)
+//
+// Parameters:  int         size        Width and height of a piece
+//
+// Shows the pieces at a new size, to match the board's spaces. The list
+// grows with them, keeping the room it had for pieces at BASE_SIZE.
+///////////////////////////////////////////////////////////////////////
+void
+PiecesList::setPieceSize(int size)
+{
+    pixmap = Artwork::get(is_x ? Artwork::X : Artwork::O, size);
+    delegate->setPixmap(pixmap);
+
+    // The drag data carries the picture, so it is written again
+    payload.clear();
+    QDataStream data_stream(&payload, QIODevice::WriteOnly);
+
+    data_stream << pixmap << is_x;
+
+    setMaximumSize(175 * size / Artwork::BASE_SIZE,
+                   220 * size / Artwork::BASE_SIZE);   // The perfect size
+    doItemsLayout();
+}
+
+///////////////////////////////////////////////////////////////////////
+// setCount(int count)
+//
+// Parameters:  int         count       Pieces the list should hold
+///////////////////////////////////////////////////////////////////////
+void
+PiecesList::setCount(int count)
+{
+    model->setCount(count);
+}
+
+///////////////////////////////////////////////////////////////////////
+// count()
+//
+// Returns: How many pieces are left in the list
+///////////////////////////////////////////////////////////////////////
+int
+PiecesList::count() const
+{
+    return model->rowCount();
 }
 
 ///////////////////////////////////////////////////////////////////////
-// createPiece(QPixmap pixmap, bool is_x)
+// currentRow()
 //
-// Parameters:  QPixmap     pixmap
-//              bool        is_x
+// Returns: The piece selected, or -1 if there is none
+///////////////////////////////////////////////////////////////////////
+int
+PiecesList::currentRow() const
+{
+    return currentIndex().row();
+}
+
+///////////////////////////////////////////////////////////////////////
+// addPiece()
 //
-// Creates piece to be added to the list.
+// Puts a piece back in the list, for when a move is undone.
 ///////////////////////////////////////////////////////////////////////
 void
-PiecesList::createPiece(QPixmap pixmap, bool is_x)
+PiecesList::addPiece()
 {
-    QListWidgetItem *piece_item = new QListWidgetItem(this);
+    model->addPiece();
+}
 
-    piece_item->setIcon(QIcon(pixmap));
-    piece_item->setData(Qt::UserRole, QVariant(pixmap));
-    piece_item->setData(Qt::UserRole + 1, is_x);
-    piece_item->setFlags(Qt::ItemIsEnabled |                // Not grayed out
-                         Qt::ItemIsSelectable |             // Can be selected
-                         Qt::ItemIsDragEnabled);            // Can be dragged
+///////////////////////////////////////////////////////////////////////
+// takePiece()
+//
+// Returns: False if the list was already empty
+//
+// Removes a piece from the list, for when the computer plays one.
+///////////////////////////////////////////////////////////////////////
+bool
+PiecesList::takePiece()
+{
+    return model->takePiece();
+}
+
+///////////////////////////////////////////////////////////////////////
+// replayDrag(int row)
+//
+// Parameters:  int         row         The piece to pick up
+//
+// Picks up a piece the way startDrag() does, but without starting a
+// real drag, so recorded drag events can be sent in by hand.
+///////////////////////////////////////////////////////////////////////
+void
+PiecesList::replayDrag(int row)
+{
+    setCurrentIndex(model->index(row));
+    emit dragStarted();
+}
+
+///////////////////////////////////////////////////////////////////////
+// finishReplayedDrag(int row, bool moved)
+//
+// Parameters:  int         row         The piece that was picked up
+//              bool        moved       Was it dropped somewhere?
+//
+// Ends a drag begun by replayDrag(), taking the piece out of the list
+// if it was dropped, as startDrag() does after a real drag.
+///////////////////////////////////////////////////////////////////////
+void
+PiecesList::finishReplayedDrag(int row, bool moved)
+{
+    if (moved && row >= 0 && row < count())
+        model->takePiece();
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -102,7 +362,7 @@ PiecesList::createPiece(QPixmap pixmap, bool is_x)
 void
 PiecesList::dragEnterEvent(QDragEnterEvent *event)
 {
-    if (event->mimeData()->hasFormat("image/x-piece"))
+    if (event->mimeData()->hasFormat(GameSpace::pieceFormat()))
         event->accept();
     else
         event->ignore();
@@ -116,7 +376,7 @@ PiecesList::dragEnterEvent(QDragEnterEvent *event)
 void
 PiecesList::dragMoveEvent(QDragMoveEvent *event)
 {
-    if (event->mimeData()->hasFormat("image/x-piece")) {
+    if (event->mimeData()->hasFormat(GameSpace::pieceFormat())) {
         event->setDropAction(Qt::MoveAction);
         event->accept();
     } else
@@ -128,25 +388,39 @@ PiecesList::dragMoveEvent(QDragMoveEvent *event)
 //
 // Parameters:  *event
 //
-// How to handle items being dropped into the list
+// How to handle items being dropped into the list. Every piece in a
+// list is the same, so only pieces of its own kind are taken back; the
+// other kind is refused and stays in its own list.
 ///////////////////////////////////////////////////////////////////////
 void
 PiecesList::dropEvent(QDropEvent *event)
 {
     // Make sure that that the piece is tictactoe piece
-    // Currently pieces of either type can be dropped into either list. I'm
-    // not sure if this is a bug or not.
-    if (event->mimeData()->hasFormat("image/x-piece")) {
+    if (event->mimeData()->hasFormat(GameSpace::pieceFormat())) {
         // piece_data  - The mimetype of the item
-        // data_stream - The IO stream for writing the item data 
-        QByteArray  piece_data = event->mimeData()->data("image/x-piece");
-        QDataStream data_stream(&piece_data, QIODevice::ReadOnly);
-        QPixmap     pixmap;                         // Pixmap to be painted
-        bool        is_x;                           // Is the item an X?
+        // data_stream - The IO stream for reading the item data 
+        QByteArray  piece_data =
+                        event->mimeData()->data(GameSpace::pieceFormat());
+        bool        ours = piece_data == payload;
+
+        // Our own drags carry payload exactly, so the pixmap only has
+        // to be read for pieces from somewhere else
+        if (!ours) {
+            QDataStream data_stream(&piece_data, QIODevice::ReadOnly);
+            QPixmap     piece_pixmap;
+            bool        piece_is_x;
 
-        data_stream >> pixmap >> is_x;
+            data_stream >> piece_pixmap >> piece_is_x;
+            ours = data_stream.status() == QDataStream::Ok &&
+                   piece_is_x == is_x;
+        }
 
-        createPiece(pixmap, is_x);                  // Add piece to the list
+        if (!ours) {
+            event->ignore();
+            return;
+        }
+
+        model->addPiece();                          // Add piece to the list
 
         event->setDropAction(Qt::MoveAction);
         event->accept();
@@ -165,22 +439,21 @@ PiecesList::dropEvent(QDropEvent *event)
 void
 PiecesList::startDrag(Qt::DropActions /*supported_actions*/)
 {
-    QByteArray      item_data;
-    QDataStream     data_stream(&item_data, QIODevice::WriteOnly);
-    QListWidgetItem *item = currentItem();
-    QPixmap         pixmap = qVariantValue<QPixmap>(item->data(Qt::UserRole));
     QMimeData       *mime_data = new QMimeData;
     QDrag           *drag = new QDrag(this);
-    bool            is_x = qVariantValue<bool>(item->data(Qt::UserRole + 1));
 
-    data_stream << pixmap << is_x;
+    emit dragStarted();
 
-    mime_data->setData("image/x-piece", item_data);
+    mime_data->setData(GameSpace::pieceFormat(), payload);
 
     drag->setMimeData(mime_data);
     drag->setHotSpot(QPoint(pixmap.width()/2, pixmap.height()/2));
     drag->setPixmap(pixmap);
 
-    if (drag->exec(Qt::MoveAction) == Qt::MoveAction)
-        delete takeItem(row(item));
+    bool moved = drag->exec(Qt::MoveAction) == Qt::MoveAction;
+
+    if (moved)
+        model->takePiece();
+
+    emit dragFinished(moved);
 }
@@ -51,20 +51,75 @@
 #ifndef WF_PIECESLIST_HH
 #define WF_PIECESLIST_HH
 
-#include <QListWidget>
+#include <QAbstractListModel>
+#include <QAbstractItemDelegate>
+#include <QListView>
+#include <QPixmap>
+
+///////////////////////////////////////////////////////////////////////
+// PiecesModel
+//
+// The pieces left in a list. They are all the same, so all the model
+// keeps is how many there are; a new game is one reset however many
+// pieces it hands out.
+///////////////////////////////////////////////////////////////////////
+class PiecesModel : public QAbstractListModel
+{
+public:
+    PiecesModel(QObject *parent = 0);                   // Constructor
+    int             rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant        data(const QModelIndex &index, int role) const;
+    Qt::ItemFlags   flags(const QModelIndex &index) const;
+    void            setCount(int count);                // Refill at once
+    void            addPiece();
+    bool            takePiece();
+
+private:
+    int count;                                          // Pieces left
+};
+
+///////////////////////////////////////////////////////////////////////
+// PieceDelegate
+//
+// Paints every piece in a list from the one pixmap.
+///////////////////////////////////////////////////////////////////////
+class PieceDelegate : public QAbstractItemDelegate
+{
+public:
+    PieceDelegate(const QPixmap &pixmap, QObject *parent = 0);
+    void    setPixmap(const QPixmap &pixmap);
+    void    paint(QPainter *painter, const QStyleOptionViewItem &option,
+                  const QModelIndex &index) const;
+    QSize   sizeHint(const QStyleOptionViewItem &option,
+                     const QModelIndex &index) const;
+
+private:
+    QPixmap pixmap;
+};
 
 ///////////////////////////////////////////////////////////////////////
 // PiecesList
 //
 // This is the headerfile for the PiecesList class.
 ///////////////////////////////////////////////////////////////////////
-class PiecesList : public QListWidget
+class PiecesList : public QListView
 {
     Q_OBJECT                                            // Macro used by Qt4
 
 public:
     PiecesList(bool is_x, QWidget *parent = 0);         // Constructor
-    void createPiece(QPixmap pixmap, bool is_x);        // Make a new piece
+    void setCount(int count);                           // Fill the list
+    void setPieceSize(int size);                        // Match the board
+    int  count() const;                                 // Pieces left
+    int  currentRow() const;                            // Piece selected
+    void addPiece();                                    // Put one back
+    bool takePiece();                                   // Remove a piece
+    void replayDrag(int row);                           // Pick up, no mouse
+    void finishReplayedDrag(int row, bool moved);       // And let go
+
+signals:
+    void dragStarted();                                 // A piece was picked up
+    void dragFinished(bool moved);                      // And let go of
 
 protected:
     void dragEnterEvent(QDragEnterEvent *event);        // Drag&Drop methods
@@ -73,6 +128,10 @@ protected:
     void startDrag(Qt::DropActions supported_actions);
 
 private:
-    bool is_x;                                          // Is this a list of Xs
+    bool        is_x;                                   // Is this a list of Xs
+    QPixmap     pixmap;                                 // Shared by every piece
+    QByteArray  payload;                                // What a drag carries
+    PiecesModel *model;
+    PieceDelegate *delegate;
 };
 #endif
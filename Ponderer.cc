@@ -0,0 +1,358 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#include <QMutexLocker>
+
+#include "Ponderer.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Ponderer(QObject *parent)
+//
+// Constructor. Starts the thread, which sleeps until there is work.
+///////////////////////////////////////////////////////////////////////
+Ponderer::Ponderer(QObject *parent) :
+    QThread(parent),
+    thinking_about(0),
+    thinking(false),
+    move_wanted(false),
+    generation(0),
+    move_time(50),
+    network(0),
+    gravity(false),
+    quitting(false)
+{
+    start(QThread::LowPriority);
+}
+
+///////////////////////////////////////////////////////////////////////
+// ~Ponderer()
+//
+// Destructor. Stops any search and waits for the thread to finish.
+///////////////////////////////////////////////////////////////////////
+Ponderer::~Ponderer()
+{
+    mutex.lock();
+    quitting = true;
+    stopSearch();
+    work.wakeOne();
+    mutex.unlock();
+
+    wait();
+}
+
+///////////////////////////////////////////////////////////////////////
+// ponder(const Board &board)
+//
+// Parameters:  board       - The position with the child to move
+//
+// Starts working out answers to every likely move from board.
+///////////////////////////////////////////////////////////////////////
+void
+Ponderer::ponder(const Board &board)
+{
+    QMutexLocker locker(&mutex);
+    int          moves[Board::MAX_CELLS];
+    int          count;
+
+    if (move_wanted || board.isOver())
+        return;
+
+    // Already pondering this position
+    if (position.getCellCount() == board.getCellCount()
+            && position.hash() == board.hash()
+            && (thinking || !candidates.isEmpty() || !replies.isEmpty()))
+        return;
+
+    if (thinking)
+        stopSearch();
+
+    position = board;
+    replies.clear();
+    candidates.clear();
+
+    count = gravity ? GravitySearch::orderMoves(board, moves)
+                    : Search::orderMoves(board, moves);
+    for (int i = 0; i < count; ++i)
+        candidates.append(moves[i]);
+
+    work.wakeOne();
+}
+
+///////////////////////////////////////////////////////////////////////
+// prioritize(int cell)
+//
+// Parameters:  int     cell    - Where the child's piece is hovering
+//
+// Moves the cell to the front of the moves still to think about.
+///////////////////////////////////////////////////////////////////////
+void
+Ponderer::prioritize(int cell)
+{
+    QMutexLocker locker(&mutex);
+
+    if (candidates.removeOne(cell))
+        candidates.prepend(cell);
+}
+
+///////////////////////////////////////////////////////////////////////
+// requestMove(const Board &board)
+//
+// Parameters:  board       - The position with the computer to move
+//
+// Asks for the computer's move. If it was already worked out while
+// pondering it comes straight back, and if it is being worked out
+// right now that search is left to finish. Any other pondering is
+// dropped.
+///////////////////////////////////////////////////////////////////////
+void
+Ponderer::requestMove(const Board &board)
+{
+    QMutexLocker locker(&mutex);
+
+    candidates.clear();
+    move_wanted = true;
+    wanted      = board;
+
+    if (thinking && thinking_about != board.hash())
+        stopSearch();
+
+    work.wakeOne();
+}
+
+///////////////////////////////////////////////////////////////////////
+// cancel()
+//
+// Stops thinking and forgets everything. Answers that were already on
+// their way will have an old generation.
+///////////////////////////////////////////////////////////////////////
+void
+Ponderer::cancel()
+{
+    QMutexLocker locker(&mutex);
+
+    generation++;
+    move_wanted = false;
+    candidates.clear();
+    replies.clear();
+
+    if (thinking)
+        stopSearch();
+}
+
+///////////////////////////////////////////////////////////////////////
+// getGeneration()
+//
+// Returns: The generation answers are currently being given for
+///////////////////////////////////////////////////////////////////////
+int
+Ponderer::getGeneration()
+{
+    QMutexLocker locker(&mutex);
+
+    return generation;
+}
+
+///////////////////////////////////////////////////////////////////////
+// setMoveTime(int msecs)
+//
+// Parameters:  int     msecs   - How long each search may take, or 0
+//                                to search a fixed depth instead
+///////////////////////////////////////////////////////////////////////
+void
+Ponderer::setMoveTime(int msecs)
+{
+    QMutexLocker locker(&mutex);
+
+    move_time = msecs;
+}
+
+///////////////////////////////////////////////////////////////////////
+// setNetwork(const Network *network)
+//
+// Parameters:  network     - Scores positions from the next search on,
+//                            or 0 to count lines. Not owned by us.
+///////////////////////////////////////////////////////////////////////
+void
+Ponderer::setNetwork(const Network *network)
+{
+    QMutexLocker locker(&mutex);
+
+    this->network = network;
+}
+
+///////////////////////////////////////////////////////////////////////
+// setGravity(bool on)
+//
+// Parameters:  on          - Play by the gravity rules from the next
+//                            search on
+///////////////////////////////////////////////////////////////////////
+void
+Ponderer::setGravity(bool on)
+{
+    QMutexLocker locker(&mutex);
+
+    if (thinking)
+        stopSearch();
+    gravity = on;
+}
+
+///////////////////////////////////////////////////////////////////////
+// stopSearch()
+//
+// Stops whichever search is running. Must be called with the mutex
+// locked, so gravity can not change underneath it.
+///////////////////////////////////////////////////////////////////////
+void
+Ponderer::stopSearch()
+{
+    if (gravity)
+        gravity_search.stop();
+    else
+        search.stop();
+}
+
+///////////////////////////////////////////////////////////////////////
+// clearStop()
+//
+// Forgets the last stop before a new search. Must be called with the
+// mutex locked, and before it is unlocked for the search, so a
+// stopSearch() for the new search can not come first and be forgotten.
+// Both searches are cleared, since setGravity() may switch between
+// them before think() looks.
+///////////////////////////////////////////////////////////////////////
+void
+Ponderer::clearStop()
+{
+    gravity_search.clearStop();
+    search.clearStop();
+}
+
+///////////////////////////////////////////////////////////////////////
+// think(Board &board)
+//
+// Parameters:  board       - The position with the computer to move
+//
+// Returns: The computer's answer and how the search went. Must be
+// called with the mutex unlocked.
+///////////////////////////////////////////////////////////////////////
+Ponderer::Reply
+Ponderer::think(Board &board)
+{
+    Reply reply;
+    int   depth;
+    bool  drop;
+
+    mutex.lock();
+    depth = move_time > 0 ? board.getPieceCount(Board::EMPTY)
+                          : Search::fullDepth(board);
+    reply.msecs = move_time;
+    drop        = gravity;
+    search.setNetwork(network);
+    mutex.unlock();
+
+    // Without a time limit the gravity search goes on until it has
+    // solved the position
+    if (drop) {
+        reply.cell  = gravity_search.findMove(board, reply.msecs);
+        reply.depth = gravity_search.getDepth();
+        reply.nodes = int(qMin<quint64>(gravity_search.getNodes(),
+                                        0x7fffffff));
+        reply.msecs = gravity_search.getElapsed();
+        return reply;
+    }
+
+    reply.cell  = search.findMove(board, depth, reply.msecs);
+    reply.depth = search.getDepth();
+    reply.nodes = int(qMin<quint64>(search.getNodes(), 0x7fffffff));
+    reply.msecs = search.getElapsed();
+    return reply;
+}
+
+///////////////////////////////////////////////////////////////////////
+// run()
+//
+// The thread. Answers move requests first, ponders when there are no
+// requests, and sleeps when there is nothing to do.
+///////////////////////////////////////////////////////////////////////
+void
+Ponderer::run()
+{
+    QMutexLocker locker(&mutex);
+
+    while (!quitting) {
+        if (move_wanted) {
+            Board   board = wanted;
+            int     asked = generation;
+            Reply   reply;
+
+            if (replies.contains(board.hash())) {
+                reply = replies.value(board.hash());
+            } else {
+                thinking       = true;
+                thinking_about = board.hash();
+                clearStop();
+                locker.unlock();
+
+                reply = think(board);
+
+                locker.relock();
+                thinking = false;
+            }
+
+            // The request may have changed while we were searching
+            if (asked == generation && move_wanted
+                    && wanted.hash() == board.hash()) {
+                move_wanted = false;
+                replies.clear();
+                emit searchReport(reply.depth, reply.nodes, reply.msecs);
+                emit moveReady(asked, reply.cell);
+            }
+            continue;
+        }
+
+        if (!candidates.isEmpty()) {
+            Board   board = position;
+            int     asked = generation;
+            int     cell  = candidates.takeFirst();
+
+            board.place(cell, board.toMove());
+            if (board.isOver())
+                continue;
+
+            thinking       = true;
+            thinking_about = board.hash();
+            clearStop();
+            locker.unlock();
+
+            Reply reply = think(board);
+
+            locker.relock();
+            thinking = false;
+
+            bool interrupted = gravity ? gravity_search.isStopped()
+                                       : search.isStopped();
+
+            if (asked == generation && !interrupted)
+                replies.insert(board.hash(), reply);
+            continue;
+        }
+
+        work.wait(&mutex);
+    }
+}
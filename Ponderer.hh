@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#ifndef WF_PONDERER_HH
+#define WF_PONDERER_HH
+
+///////////////////////////////////////////////////////////////////////
+// Ponderer.hh
+//
+// This file contains the declarations for the Ponderer class, the
+// thread the computer player thinks in.
+///////////////////////////////////////////////////////////////////////
+
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "Board.hh"
+#include "GravitySearch.hh"
+#include "Search.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Ponderer
+//
+// Runs the computer player's Search on its own thread. While a child
+// is still dragging a piece around, ponder() has it work out the
+// answer to each move the child might make, starting with the space
+// the piece is hovering over. When the child lets go, requestMove()
+// either finds the answer already worked out or searches for it, and
+// everything else that was worked out is thrown away.
+//
+// Answers come back through moveReady(). Each one is stamped with the
+// generation it was asked for in, and cancel() starts a new generation
+// so stale answers can be ignored after an undo or a new game. Every
+// search, pondered or not, is limited to the move time, and just
+// before moveReady() searchReport() says how deep and how fast the
+// search for that answer went.
+//
+// With setGravity() the moves are the columns' landing spaces and the
+// answers come from a GravitySearch instead.
+///////////////////////////////////////////////////////////////////////
+class Ponderer : public QThread
+{
+    Q_OBJECT
+
+public:
+    Ponderer(QObject *parent = 0);
+    ~Ponderer();
+
+    void        ponder(const Board &board);     // Child to move on board
+    void        prioritize(int cell);           // Child is hovering here
+    void        requestMove(const Board &board); // Computer to move
+    void        cancel();                       // Forget everything
+    int         getGeneration();
+    void        setMoveTime(int msecs);         // Per move, 0 for no limit
+    void        setNetwork(const Network *network);
+    void        setGravity(bool on);            // Play the gravity rules
+
+signals:
+    void        moveReady(int generation, int cell);
+    void        searchReport(int depth, int nodes, int msecs);
+
+protected:
+    void        run();
+
+private:
+    // An answer worked out while pondering
+    struct Reply
+    {
+        int cell;
+        int depth;
+        int nodes;
+        int msecs;
+    };
+
+    Reply       think(Board &board);
+    void        stopSearch();
+    void        clearStop();
+
+    QMutex              mutex;
+    QWaitCondition      work;                   // Something to do
+    Search              search;
+    GravitySearch       gravity_search;
+    Board               position;               // Being pondered
+    QList<int>          candidates;             // Child moves left to try
+    QMap<quint64, Reply> replies;               // Position hash -> answer
+    quint64             thinking_about;         // Hash being searched
+    bool                thinking;
+    bool                move_wanted;
+    Board               wanted;                 // Computer to move here
+    int                 generation;
+    int                 move_time;              // Milliseconds
+    const Network      *network;                // For the next search
+    bool                gravity;                // Which search to use
+    bool                quitting;
+};
+
+#endif
@@ -0,0 +1,266 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QFile>
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QSlider>
+#include <QSpinBox>
+#include <QTextStream>
+#include <QVBoxLayout>
+#include <string.h>
+
+#include "ReplayViewer.hh"
+#include "GameSpace.hh"
+
+///////////////////////////////////////////////////////////////////////
+// ReplayViewer(int rows, int cols, QWidget *parent)
+//
+// Parameters:  int         rows        Rows on the board the log is for
+//              int         cols        Columns on it
+//              QWidget     *parent
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+ReplayViewer::ReplayViewer(int rows, int cols, QWidget *parent) :
+    QWidget(parent),
+    rows(rows),
+    cols(cols),
+    board(rows, cols, qMin(qMax(rows, cols), 5)),
+    game(0),
+    game_ok(false),
+    target(rows * cols, char(GameSpace::EMPTY)),
+    shown(rows * cols, char(GameSpace::EMPTY))
+{
+    QGridLayout *board_layout = new QGridLayout;
+    QHBoxLayout *controls     = new QHBoxLayout;
+    QVBoxLayout *layout       = new QVBoxLayout;
+
+    // The spaces are only for looking at
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            GameSpace *space = new GameSpace(i, j);
+
+            space->setAcceptDrops(false);
+            board_layout->addWidget(space, i, j);
+            spaces.append(space);
+        }
+    }
+    board_layout->setSpacing(0);
+
+    game_box = new QSpinBox;
+    game_box->setPrefix(tr("Game "));
+    game_box->setRange(0, 0);
+
+    slider = new QSlider(Qt::Horizontal);
+    slider->setRange(0, 0);
+    slider->setPageStep(SNAPSHOT_PLIES);
+
+    status = new QLabel;
+
+    controls->addWidget(game_box);
+    controls->addWidget(slider, 1);
+
+    layout->addLayout(board_layout);
+    layout->addLayout(controls);
+    layout->addWidget(status);
+    setLayout(layout);
+
+    connect(game_box, SIGNAL(valueChanged(int)), this, SLOT(showGame(int)));
+    connect(slider, SIGNAL(valueChanged(int)), this, SLOT(seek(int)));
+
+    setWindowTitle(tr("Xs-n-Os Replay"));
+}
+
+///////////////////////////////////////////////////////////////////////
+// load(const QString &file_name)
+//
+// Parameters:  const QString &file_name    A log printed by printMoves()
+//
+// Reads the games in a log and shows the first. Games are only parsed
+// when they are shown, so a big log opens quickly.
+//
+// Returns: False if the file could not be read, and errorString() says
+// why
+///////////////////////////////////////////////////////////////////////
+bool
+ReplayViewer::load(const QString &file_name)
+{
+    QFile file(file_name);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = file_name + ": " + file.errorString();
+        return false;
+    }
+
+    QTextStream in(&file);
+    int         line_number = 0;
+
+    games.clear();
+    line_numbers.clear();
+
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+
+        line_number++;
+        if (line.trimmed().isEmpty())
+            continue;
+        games.append(line);
+        line_numbers.append(line_number);
+    }
+
+    if (games.isEmpty()) {
+        error = file_name + ": " + tr("no games");
+        return false;
+    }
+
+    game_box->setRange(1, games.size());
+    game_box->setSuffix(tr(" of %1").arg(games.size()));
+    showGame(1);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// errorString()
+//
+// Returns: Why load() failed
+///////////////////////////////////////////////////////////////////////
+QString
+ReplayViewer::errorString() const
+{
+    return error;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getGames()
+//
+// Returns: How many games the log holds
+///////////////////////////////////////////////////////////////////////
+int
+ReplayViewer::getGames() const
+{
+    return games.size();
+}
+
+///////////////////////////////////////////////////////////////////////
+// showGame(int game)
+//
+// Parameters:  int         game        Which game of the log, from 1
+//
+// Shows a game at its last move. A line that is not a game for this
+// size of board shows an empty board and says so.
+///////////////////////////////////////////////////////////////////////
+void
+ReplayViewer::showGame(int game)
+{
+    if (game < 1 || game > games.size())
+        return;
+
+    this->game = game;
+    game_ok    = GameLog::parseGame(games[game - 1], &moves)
+                 && GameLog::replay(moves, &board);
+    if (!game_ok)
+        moves.clear();
+
+    takeSnapshots();
+
+    // Quietly, or the box would show the game again and the slider
+    // would seek on its own before the seek below
+    game_box->blockSignals(true);
+    game_box->setValue(game);
+    game_box->blockSignals(false);
+
+    slider->blockSignals(true);
+    slider->setRange(0, moves.size());
+    slider->setValue(moves.size());
+    slider->blockSignals(false);
+    seek(moves.size());
+}
+
+///////////////////////////////////////////////////////////////////////
+// seek(int ply)
+//
+// Parameters:  int         ply         How many moves to show, 0 for
+//                                      the empty board
+///////////////////////////////////////////////////////////////////////
+void
+ReplayViewer::seek(int ply)
+{
+    int cells = rows * cols;
+
+    if (ply < 0 || ply > moves.size())
+        return;
+
+    // The nearest snapshot, then the moves after it
+    int snapshot = ply / SNAPSHOT_PLIES;
+
+    memcpy(target.data(), snapshots.constData() + snapshot * cells, cells);
+    for (int i = snapshot * SNAPSHOT_PLIES; i < ply; ++i)
+        target[moves[i].row * cols + moves[i].col] = char(moves[i].state);
+
+    // Only the spaces that change are redrawn
+    for (int i = 0; i < cells; ++i) {
+        if (target[i] != shown[i]) {
+            spaces[i]->setState(GameSpace::SpaceState(target[i]));
+            shown[i] = target[i];
+        }
+    }
+
+    if (!game_ok) {
+        status->setText(tr("Line %1 is not a game for a %2x%3 board")
+                        .arg(line_numbers[game - 1]).arg(rows).arg(cols));
+    } else if (ply == 0) {
+        status->setText(tr("Line %1, %2 moves")
+                        .arg(line_numbers[game - 1]).arg(moves.size()));
+    } else {
+        const Move &last = moves[ply - 1];
+
+        status->setText(tr("Line %1, move %2 of %3: %4->(%5,%6)")
+                        .arg(line_numbers[game - 1]).arg(ply)
+                        .arg(moves.size())
+                        .arg(last.state == GameSpace::X ? "X" : "O")
+                        .arg(last.row).arg(last.col));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// takeSnapshots()
+//
+// Keeps the whole board after every SNAPSHOT_PLIES moves of the game
+// shown, starting with the empty board.
+///////////////////////////////////////////////////////////////////////
+void
+ReplayViewer::takeSnapshots()
+{
+    int        cells = rows * cols;
+    QByteArray board_cells(cells, char(GameSpace::EMPTY));
+
+    snapshots.resize(0);
+    for (int ply = 0; ply <= moves.size(); ++ply) {
+        if (ply % SNAPSHOT_PLIES == 0)
+            snapshots.append(board_cells);
+        if (ply < moves.size()) {
+            const Move &move = moves[ply];
+
+            board_cells[move.row * cols + move.col] = char(move.state);
+        }
+    }
+}
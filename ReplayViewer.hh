@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_REPLAYVIEWER_HH
+#define WF_REPLAYVIEWER_HH
+
+///////////////////////////////////////////////////////////////////////
+// ReplayViewer.hh
+//
+// This file contains the declarations for the ReplayViewer class, a
+// window for stepping through games from the log.
+///////////////////////////////////////////////////////////////////////
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QWidget>
+
+#include "Board.hh"
+#include "GameLog.hh"
+
+class GameSpace;
+class QLabel;
+class QSlider;
+class QSpinBox;
+
+///////////////////////////////////////////////////////////////////////
+// ReplayViewer
+//
+// Shows one game of a log at a time on the same spaces the game uses,
+// with a slider to move through its plies. Each game is parsed when it
+// is picked, and the whole board is kept every SNAPSHOT_PLIES plies.
+// Seeking copies the nearest snapshot at or before the ply, plays at
+// most SNAPSHOT_PLIES - 1 moves on top, and then only touches the
+// spaces that differ from what is shown. A seek never starts from an
+// empty board, however long the game or the log.
+///////////////////////////////////////////////////////////////////////
+class ReplayViewer : public QWidget
+{
+    Q_OBJECT
+
+public:
+    enum {
+        SNAPSHOT_PLIES = 8                      // Plies between snapshots
+    };
+
+    ReplayViewer(int rows, int cols, QWidget *parent = 0);
+
+    bool        load(const QString &file_name);
+    QString     errorString() const;
+    int         getGames() const;
+
+public slots:
+    void        showGame(int game);             // From 1
+    void        seek(int ply);
+
+private:
+    void        takeSnapshots();
+
+    int         rows;
+    int         cols;
+    Board       board;                          // For checking games
+
+    QStringList games;                          // Lines of the log
+    QVector<int> line_numbers;                  // Where each game was
+    int         game;                           // Shown now, from 1
+    bool        game_ok;                        // Fits this board
+
+    QVector<Move> moves;                        // The game shown
+    QByteArray  snapshots;                      // rows * cols per snapshot
+    QByteArray  target;                         // What a seek should show
+    QByteArray  shown;                          // What the spaces show
+
+    QVector<GameSpace *> spaces;
+    QSpinBox    *game_box;
+    QSlider     *slider;
+    QLabel      *status;
+
+    QString     error;
+};
+
+#endif
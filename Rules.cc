@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#include "Rules.hh"
+
+static const char *names[Rules::SET_COUNT] = {
+    "standard", "misere", "wild", "notakto", "gravity"
+};
+
+///////////////////////////////////////////////////////////////////////
+// toMove(Set rules, const Board &board)
+//
+// Returns: Whose turn it is
+///////////////////////////////////////////////////////////////////////
+Board::Cell
+Rules::toMove(Set rules, const Board &board)
+{
+    switch (rules) {
+    case MISERE:    return MisereRules::toMove(board);
+    case WILD:      return WildRules::toMove(board);
+    case NOTAKTO:   return NotaktoRules::toMove(board);
+    case GRAVITY:   return GravityRules::toMove(board);
+    default:        return StandardRules::toMove(board);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// player(Set rules, Board::Cell piece, int move_number)
+//
+// Parameters:  rules           - The rule set
+//              piece           - The piece that was put down
+//              int move_number - How many moves came before it
+//
+// Returns: Who put the piece down
+///////////////////////////////////////////////////////////////////////
+Board::Cell
+Rules::player(Set rules, Board::Cell piece, int move_number)
+{
+    switch (rules) {
+    case MISERE:    return MisereRules::player(piece, move_number);
+    case WILD:      return WildRules::player(piece, move_number);
+    case NOTAKTO:   return NotaktoRules::player(piece, move_number);
+    case GRAVITY:   return GravityRules::player(piece, move_number);
+    default:        return StandardRules::player(piece, move_number);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// pieces(Set rules, Board::Cell player, Board::Cell *pieces)
+//
+// Parameters:  rules       - The rule set
+//              player      - X or O
+//              pieces      - Filled with the pieces player may use,
+//                            which needs room for two
+//
+// Returns: How many kinds of piece player may use
+///////////////////////////////////////////////////////////////////////
+int
+Rules::pieces(Set rules, Board::Cell player, Board::Cell *pieces)
+{
+    switch (rules) {
+    case MISERE:    return MisereRules::pieces(player, pieces);
+    case WILD:      return WildRules::pieces(player, pieces);
+    case NOTAKTO:   return NotaktoRules::pieces(player, pieces);
+    case GRAVITY:   return GravityRules::pieces(player, pieces);
+    default:        return StandardRules::pieces(player, pieces);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// winner(Set rules, const Board &board, Board::Cell mover)
+//
+// Parameters:  rules       - The rule set
+//              board       - The position
+//              mover       - Who just moved
+//
+// Returns: X or O if that player has won, otherwise EMPTY
+///////////////////////////////////////////////////////////////////////
+Board::Cell
+Rules::winner(Set rules, const Board &board, Board::Cell mover)
+{
+    switch (rules) {
+    case MISERE:    return MisereRules::winner(board, mover);
+    case WILD:      return WildRules::winner(board, mover);
+    case NOTAKTO:   return NotaktoRules::winner(board, mover);
+    case GRAVITY:   return GravityRules::winner(board, mover);
+    default:        return StandardRules::winner(board, mover);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// isDrawn(Set rules, const Board &board)
+//
+// Returns: True if nobody can win anymore. Only meaningful once
+// winner() has said nobody has won.
+///////////////////////////////////////////////////////////////////////
+bool
+Rules::isDrawn(Set rules, const Board &board)
+{
+    switch (rules) {
+    case MISERE:    return MisereRules::isDrawn(board);
+    case WILD:      return WildRules::isDrawn(board);
+    case NOTAKTO:   return NotaktoRules::isDrawn(board);
+    case GRAVITY:   return GravityRules::isDrawn(board);
+    default:        return StandardRules::isDrawn(board);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// name(Set rules)
+//
+// Returns: The name of a rule set, as given on the command line
+///////////////////////////////////////////////////////////////////////
+const char *
+Rules::name(Set rules)
+{
+    if (rules < 0 || rules >= SET_COUNT)
+        return names[STANDARD];
+    return names[rules];
+}
+
+///////////////////////////////////////////////////////////////////////
+// fromName(const std::string &name, Set *rules)
+//
+// Parameters:  name        - A rule set's name
+//              rules       - Set to the rule set
+//
+// Returns: False if there is no rule set by that name
+///////////////////////////////////////////////////////////////////////
+bool
+Rules::fromName(const std::string &name, Set *rules)
+{
+    for (int i = 0; i < SET_COUNT; ++i) {
+        if (name == names[i]) {
+            *rules = Set(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,281 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#ifndef WF_RULES_HH
+#define WF_RULES_HH
+
+///////////////////////////////////////////////////////////////////////
+// Rules.hh
+//
+// This file contains the rule sets xsnos can be played with. Each one
+// is a policy class of inline static functions, for code that is
+// compiled once per rule set by taking the policy as a template
+// parameter. The Board functions they are made of are inline too, so
+// each rule set's win and draw checks come down to a comparison or two
+// in the code built for it. The Rules class picks between them at run
+// time, for code that only asks once in a while.
+///////////////////////////////////////////////////////////////////////
+
+#include <string>
+
+#include "Board.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Rules
+//
+// Names the rule sets and answers questions about whichever one is in
+// use. The players are called X and O whatever pieces they put down;
+// X always goes first.
+///////////////////////////////////////////////////////////////////////
+class Rules
+{
+public:
+    enum Set {
+        STANDARD,                               // A line of yours wins
+        MISERE,                                 // A line of yours loses
+        WILD,                                   // Place either piece, any
+                                                // line wins for its maker
+        NOTAKTO,                                // Everyone plays X, making
+                                                // a line loses
+        GRAVITY,                                // Pieces drop to the bottom
+                                                // of their column
+        SET_COUNT
+    };
+
+    static Board::Cell  toMove(Set rules, const Board &board);
+    static Board::Cell  player(Set rules, Board::Cell piece, int move_number);
+    static int          pieces(Set rules, Board::Cell player,
+                               Board::Cell *pieces);
+    static Board::Cell  winner(Set rules, const Board &board,
+                               Board::Cell mover);
+    static bool         isDrawn(Set rules, const Board &board);
+
+    static const char  *name(Set rules);
+    static bool         fromName(const std::string &name, Set *rules);
+};
+
+///////////////////////////////////////////////////////////////////////
+// StandardRules
+//
+// The usual game, and the one every other part of xsnos was written
+// for: whoever makes a line with their own pieces wins, and the game is
+// drawn as soon as every line holds both an X and an O.
+//
+// Every policy has the same functions:
+//
+//      toMove(board)               Whose turn it is
+//      player(piece, move_number)  Who put a piece down, for boards
+//                                  where pieces are dropped freely
+//      pieces(player, pieces)      Which pieces player may put down
+//      winner(board, mover)        Who has won now mover has moved
+//      isDrawn(board)              Nobody can win anymore
+///////////////////////////////////////////////////////////////////////
+struct StandardRules
+{
+    enum {SET = Rules::STANDARD};
+
+    static inline Board::Cell toMove(const Board &board)
+    {
+        return board.toMove();
+    }
+
+    static inline Board::Cell player(Board::Cell piece, int)
+    {
+        return piece;
+    }
+
+    static inline int pieces(Board::Cell player, Board::Cell *pieces)
+    {
+        pieces[0] = player;
+        return 1;
+    }
+
+    static inline Board::Cell winner(const Board &board, Board::Cell mover)
+    {
+        return board.hasLine(mover) ? mover : Board::EMPTY;
+    }
+
+    static inline bool isDrawn(const Board &board)
+    {
+        return board.isBlocked();
+    }
+};
+
+///////////////////////////////////////////////////////////////////////
+// MisereRules
+//
+// Whoever makes a line with their own pieces loses. Once every line
+// holds both pieces nobody can be forced into one, so that is a draw
+// just as in the standard game.
+///////////////////////////////////////////////////////////////////////
+struct MisereRules
+{
+    enum {SET = Rules::MISERE};
+
+    static inline Board::Cell toMove(const Board &board)
+    {
+        return board.toMove();
+    }
+
+    static inline Board::Cell player(Board::Cell piece, int)
+    {
+        return piece;
+    }
+
+    static inline int pieces(Board::Cell player, Board::Cell *pieces)
+    {
+        pieces[0] = player;
+        return 1;
+    }
+
+    static inline Board::Cell winner(const Board &board, Board::Cell mover)
+    {
+        return board.hasLine(mover) ? Board::opponent(mover) : Board::EMPTY;
+    }
+
+    static inline bool isDrawn(const Board &board)
+    {
+        return board.isBlocked();
+    }
+};
+
+///////////////////////////////////////////////////////////////////////
+// WildRules
+//
+// Each player puts down an X or an O, whichever they like, and whoever
+// makes a line of either wins. The players take turns, so whose move
+// it is comes from how many pieces are down, not which.
+///////////////////////////////////////////////////////////////////////
+struct WildRules
+{
+    enum {SET = Rules::WILD};
+
+    static inline Board::Cell toMove(const Board &board)
+    {
+        return board.getMoveCount() % 2 == 0 ? Board::X : Board::O;
+    }
+
+    static inline Board::Cell player(Board::Cell, int move_number)
+    {
+        return move_number % 2 == 0 ? Board::X : Board::O;
+    }
+
+    static inline int pieces(Board::Cell, Board::Cell *pieces)
+    {
+        pieces[0] = Board::X;
+        pieces[1] = Board::O;
+        return 2;
+    }
+
+    static inline Board::Cell winner(const Board &board, Board::Cell mover)
+    {
+        return board.hasLine(Board::X) || board.hasLine(Board::O)
+               ? mover : Board::EMPTY;
+    }
+
+    static inline bool isDrawn(const Board &board)
+    {
+        return board.isBlocked();
+    }
+};
+
+///////////////////////////////////////////////////////////////////////
+// NotaktoRules
+//
+// Both players put down Xs, and whoever makes a line loses. Lines can
+// never be blocked, so the only draw is a full board, which can not
+// happen on the usual 3x3.
+///////////////////////////////////////////////////////////////////////
+struct NotaktoRules
+{
+    enum {SET = Rules::NOTAKTO};
+
+    static inline Board::Cell toMove(const Board &board)
+    {
+        return board.getMoveCount() % 2 == 0 ? Board::X : Board::O;
+    }
+
+    static inline Board::Cell player(Board::Cell, int move_number)
+    {
+        return move_number % 2 == 0 ? Board::X : Board::O;
+    }
+
+    static inline int pieces(Board::Cell, Board::Cell *pieces)
+    {
+        pieces[0] = Board::X;
+        return 1;
+    }
+
+    static inline Board::Cell winner(const Board &board, Board::Cell mover)
+    {
+        return board.hasLine(Board::X) ? Board::opponent(mover)
+                                       : Board::EMPTY;
+    }
+
+    static inline bool isDrawn(const Board &board)
+    {
+        return board.getPieceCount(Board::EMPTY) == 0;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////
+// GravityRules
+//
+// Connect Four: a line of yours wins as in the standard game, but a
+// piece may only go on the bottom row or on top of another piece, so
+// whatever space it is dropped on it falls to the lowest empty space
+// of its column. Nothing here has to know that, since the winner and
+// the draw depend only on what is on the board; the spaces do the
+// falling, and the computer plays it with a GravitySearch.
+//
+// Rotating the board changes the game, so the Solver, which treats
+// rotations as the same position, does not take these rules.
+///////////////////////////////////////////////////////////////////////
+struct GravityRules
+{
+    enum {SET = Rules::GRAVITY};
+
+    static inline Board::Cell toMove(const Board &board)
+    {
+        return board.toMove();
+    }
+
+    static inline Board::Cell player(Board::Cell piece, int)
+    {
+        return piece;
+    }
+
+    static inline int pieces(Board::Cell player, Board::Cell *pieces)
+    {
+        pieces[0] = player;
+        return 1;
+    }
+
+    static inline Board::Cell winner(const Board &board, Board::Cell mover)
+    {
+        return board.hasLine(mover) ? mover : Board::EMPTY;
+    }
+
+    static inline bool isDrawn(const Board &board)
+    {
+        return board.isBlocked();
+    }
+};
+
+#endif
@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QCoreApplication>
+#include <QSocketNotifier>
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+
+#include "Script.hh"
+#include "MainWindow.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Script(MainWindow *window, QObject *parent)
+//
+// Parameters:  MainWindow  *window     The game to play, which should
+//                                      not be interactive
+//              QObject     *parent
+///////////////////////////////////////////////////////////////////////
+Script::Script(MainWindow *window, QObject *parent) :
+    QObject(parent),
+    window(window),
+    notifier(0),
+    commands(0),
+    quitting(false)
+{
+    input.reserve(2 * READ_SIZE);
+    reply.reserve(2 * READ_SIZE);
+}
+
+///////////////////////////////////////////////////////////////////////
+// start()
+//
+// Starts reading commands once the event loop is running
+///////////////////////////////////////////////////////////////////////
+void
+Script::start()
+{
+    notifier = new QSocketNotifier(STDIN_FILENO, QSocketNotifier::Read,
+                                   this);
+    connect(notifier, SIGNAL(activated(int)), this, SLOT(readInput()));
+    timer.start();
+}
+
+///////////////////////////////////////////////////////////////////////
+// readInput()
+//
+// Reads whatever is waiting on stdin, runs every complete line of it,
+// and writes the replies. A line cut off at the end of the read waits
+// for the rest to arrive.
+///////////////////////////////////////////////////////////////////////
+void
+Script::readInput()
+{
+    int     kept = input.size();
+    ssize_t got;
+
+    input.resize(kept + READ_SIZE);
+    got = ::read(STDIN_FILENO, input.data() + kept, READ_SIZE);
+    input.resize(kept + (got > 0 ? int(got) : 0));
+
+    if (got < 0 && (errno == EINTR || errno == EAGAIN))
+        return;
+
+    // At the end of the input a last line needs no newline
+    if (got <= 0 && !input.isEmpty() && !input.endsWith('\n'))
+        input.append('\n');
+
+    int begin = 0;
+    int end;
+
+    while (!quitting && (end = input.indexOf('\n', begin)) >= 0) {
+        input[end] = '\0';
+        run(input.constData() + begin);
+        begin = end + 1;
+    }
+    input.remove(0, begin);
+
+    std::cout.write(reply.constData(), reply.size());
+    std::cout.flush();
+    reply.resize(0);
+
+    if (got <= 0 || quitting)
+        finish();
+}
+
+///////////////////////////////////////////////////////////////////////
+// run(const char *line)
+//
+// Parameters:  const char  *line       One command, without its newline
+//
+// Runs a command and adds its reply to the ones waiting to be written.
+// Blank lines get no reply.
+///////////////////////////////////////////////////////////////////////
+void
+Script::run(const char *line)
+{
+    char    command[16];
+    char    piece;
+    int     row;
+    int     col;
+
+    if (sscanf(line, "%15s", command) != 1)
+        return;
+    ++commands;
+
+    if (strcmp(command, "place") == 0) {
+        if (sscanf(line, "%*s %c %d %d", &piece, &row, &col) != 3
+                || (toupper(piece) != 'X' && toupper(piece) != 'O')) {
+            reply.append("error usage: place {X|O} {row} {col}\n");
+            return;
+        }
+        if (window->isGameOver()) {
+            reply.append("error the game is over\n");
+            return;
+        }
+        if (!window->playMove(toupper(piece) == 'X' ? Board::X : Board::O,
+                              row, col)) {
+            reply.append("error can not play there\n");
+            return;
+        }
+        replyState();
+
+    } else if (strcmp(command, "undo") == 0) {
+        window->undo();
+        replyState();
+
+    } else if (strcmp(command, "new") == 0) {
+        window->newGame();
+        replyState();
+
+    } else if (strcmp(command, "log") == 0) {
+        reply.append("ok ");
+        reply.append(window->getGameLog().toLatin1());
+        reply.append('\n');
+
+    } else if (strcmp(command, "quit") == 0) {
+        reply.append("ok\n");
+        quitting = true;
+
+    } else {
+        reply.append("error unknown command\n");
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// replyState()
+//
+// Adds the board's hash and how the game stands to the replies
+///////////////////////////////////////////////////////////////////////
+void
+Script::replyState()
+{
+    const char *state = "playing";
+    char        line[64];
+
+    if (window->isGameOver()) {
+        switch (window->getWinner()) {
+        case Board::X:  state = "x-wins";   break;
+        case Board::O:  state = "o-wins";   break;
+        default:        state = "draw";     break;
+        }
+    }
+
+    snprintf(line, sizeof(line), "ok %016llx %s\n",
+             (unsigned long long)window->getHash(), state);
+    reply.append(line);
+}
+
+///////////////////////////////////////////////////////////////////////
+// finish()
+//
+// Says how fast the commands went and ends the program
+///////////////////////////////////////////////////////////////////////
+void
+Script::finish()
+{
+    int     msecs      = timer.elapsed();
+    quint64 per_second = msecs > 0 ? commands * 1000 / msecs : commands;
+
+    notifier->setEnabled(false);
+    std::cerr << "script: " << commands << " commands in " << msecs
+              << " ms (" << per_second << " per second)\n";
+    QCoreApplication::quit();
+}
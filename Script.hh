@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_SCRIPT_HH
+#define WF_SCRIPT_HH
+
+///////////////////////////////////////////////////////////////////////
+// Script.hh
+//
+// This file contains the declarations for the Script class, which
+// lets another program play the game through stdin and stdout. One
+// command per line:
+//
+//      place {X|O} {row} {col}     Put a piece down, rows and columns
+//                                  counted from 0 as in the game log
+//      undo                        Take back the last move
+//      new                         Start a new game
+//      log                         The game so far, in log format
+//      quit                        Stop reading
+//
+// Each command gets one line back: "ok {hash} {state}", where hash is
+// the board's Zobrist hash in hex and state is playing, x-wins, o-wins,
+// or draw, or "ok {log}" for log, or "error {why}".
+///////////////////////////////////////////////////////////////////////
+
+#include <QByteArray>
+#include <QObject>
+#include <QTime>
+
+class MainWindow;
+class QSocketNotifier;
+
+///////////////////////////////////////////////////////////////////////
+// Script
+//
+// Plays the moves it is sent through the window's own code, as the
+// computer does, rather than pretending to drag pieces, which is far
+// slower. Whatever has arrived on stdin when the event loop gets to it
+// is run as one batch, and the replies go out together in one write.
+// When stdin closes the number of commands and how fast they went are
+// reported on stderr and the application quits.
+///////////////////////////////////////////////////////////////////////
+class Script : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum {
+        READ_SIZE = 65536                       // Bytes read per batch
+    };
+
+    Script(MainWindow *window, QObject *parent = 0);
+    void        start();
+
+private slots:
+    void        readInput();
+
+private:
+    void        run(const char *line);
+    void        replyState();
+    void        finish();
+
+    MainWindow      *window;
+    QSocketNotifier *notifier;
+    QByteArray      input;                      // Read but not yet run
+    QByteArray      reply;                      // Run but not yet written
+    quint64         commands;
+    QTime           timer;
+    bool            quitting;
+};
+
+#endif
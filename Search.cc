@@ -0,0 +1,789 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <time.h>
+
+#include "Search.hh"
+
+///////////////////////////////////////////////////////////////////////
+// monotonicMicros()
+//
+// Returns: Microseconds on a clock that never jumps
+///////////////////////////////////////////////////////////////////////
+int64_t
+Search::monotonicMicros()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return int64_t(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Search(int table_bits)
+//
+// Parameters:  int     table_bits  - The transposition table holds
+//                                    2^table_bits entries
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+Search::Search(int table_bits) :
+    table(size_t(1) << table_bits),
+    table_mask((uint64_t(1) << table_bits) - 1),
+    stopped(false),
+    interrupted(0),
+    nodes(0),
+    score(0),
+    depth_reached(0),
+    root_best(-1),
+    root_score(0),
+    use_threats(true),
+    network(0),
+    use_network(false),
+    start_time(0),
+    deadline(0),
+    elapsed(0)
+{
+    clearTable();
+    threats.setStopFlag(&interrupted);
+}
+
+///////////////////////////////////////////////////////////////////////
+// Getters
+///////////////////////////////////////////////////////////////////////
+int
+Search::getScore() const
+{
+    return score;
+}
+
+uint64_t
+Search::getNodes() const
+{
+    return nodes;
+}
+
+int
+Search::getDepth() const
+{
+    return depth_reached;
+}
+
+int
+Search::getElapsed() const
+{
+    return int(elapsed / 1000);
+}
+
+uint64_t
+Search::getNodesPerSecond() const
+{
+    if (elapsed <= 0)
+        return 0;
+    return nodes * 1000000 / uint64_t(elapsed);
+}
+
+bool
+Search::isStopped() const
+{
+    return interrupted != 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// stop()
+//
+// Asks a running findMove() to return, or the next one not to start,
+// until clearStop(). Safe to call from any thread.
+///////////////////////////////////////////////////////////////////////
+void
+Search::stop()
+{
+    interrupted.fetchAndStoreOrdered(1);
+}
+
+///////////////////////////////////////////////////////////////////////
+// clearStop()
+//
+// Forgets an earlier stop(), so the next findMove() can run
+///////////////////////////////////////////////////////////////////////
+void
+Search::clearStop()
+{
+    interrupted.fetchAndStoreOrdered(0);
+}
+
+///////////////////////////////////////////////////////////////////////
+// clearTable()
+//
+// Forgets everything in the transposition table, and the killer moves
+// and history that were learned along with it.
+///////////////////////////////////////////////////////////////////////
+void
+Search::clearTable()
+{
+    Entry empty = {0, 0, -1, -1, NONE};
+
+    std::fill(table.begin(), table.end(), empty);
+
+    for (int p = 0; p < 3; ++p)
+        history[p].clear();
+}
+
+///////////////////////////////////////////////////////////////////////
+// setNetwork(const Network *network)
+//
+// Parameters:  network     - Scores positions from now on, or 0 to go
+//                            back to counting lines. Not owned by us.
+//
+// The network is only used on boards with as many cells as it was
+// made for. Scores from the old evaluation are no use with the new
+// one, so the transposition table is cleared.
+///////////////////////////////////////////////////////////////////////
+void
+Search::setNetwork(const Network *network)
+{
+    if (network && !network->isLoaded())
+        network = 0;
+
+    if (network != this->network) {
+        this->network = network;
+        clearTable();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// setThreatSearch(bool on)
+//
+// Parameters:  bool    on      - Whether to look for forced wins with a
+//                                ThreatSearch before searching
+///////////////////////////////////////////////////////////////////////
+void
+Search::setThreatSearch(bool on)
+{
+    use_threats = on;
+}
+
+///////////////////////////////////////////////////////////////////////
+// findMove(Board &board, int max_depth, int time_limit)
+//
+// Parameters:  board           - The position. It is handed back
+//                                unchanged.
+//              int max_depth   - How many plies to look ahead at most
+//              int time_limit  - Milliseconds allowed, 0 for no limit
+//
+// Returns: The best cell for the player to move, or -1 if there are no
+// moves. If time runs out or stop() is called, the best move found so
+// far is returned.
+///////////////////////////////////////////////////////////////////////
+int
+Search::findMove(Board &board, int max_depth, int time_limit)
+{
+    int         moves[Board::MAX_CELLS];
+    int         count;
+    int         best_move = -1;
+    int         previous  = 0;
+    int         cells     = board.getCellCount();
+
+    stopped       = interrupted != 0;
+    nodes         = 0;
+    score         = 0;
+    depth_reached = 0;
+    start_time    = monotonicMicros();
+    deadline      = time_limit > 0 ? start_time + int64_t(time_limit) * 1000 : 0;
+
+    // Old history still helps, but the newest cutoffs should count more
+    for (int p = 0; p < 3; ++p) {
+        if (int(history[p].size()) != cells)
+            history[p].assign(cells, 0);
+        for (int i = 0; i < cells; ++i)
+            history[p][i] /= 2;
+    }
+    for (int ply = 0; ply < MAX_PLY; ++ply) {
+        killers[ply][0] = -1;
+        killers[ply][1] = -1;
+    }
+
+    if (board.isOver()) {
+        elapsed = monotonicMicros() - start_time;
+        return -1;
+    }
+
+    use_network = network && network->getCells() == cells;
+    if (use_network)
+        network->refresh(accumulator, board);
+
+    Entry &root = probe(board.hash());
+
+    count = orderMoves(board, moves,
+                       root.key == board.hash() ? root.move : -1);
+    if (count == 0) {
+        elapsed = monotonicMicros() - start_time;
+        return -1;
+    }
+
+    // Big gomoku style boards: win by force, or stop the opponent doing so
+    if (use_threats && cells > NEARBY_CELLS && board.getWinLength() >= 4) {
+        int budget = time_limit > 0 ? std::max(1, time_limit / 4) : 0;
+        int win    = threats.findWin(board, budget);
+
+        if (win >= 0) {
+            score         = MATE_BOUND + 1;
+            depth_reached = 1;
+            nodes        += threats.getNodes();
+            elapsed       = monotonicMicros() - start_time;
+            return win;
+        }
+
+        int defences[Board::MAX_CELLS];
+        int defence_count = threats.findDefences(board, defences, budget);
+        int kept          = 0;
+
+        nodes += threats.getNodes();
+
+        for (int i = 0; i < count && defence_count > 0; ++i) {
+            if (std::find(defences, defences + defence_count, moves[i])
+                    != defences + defence_count)
+                moves[kept++] = moves[i];
+        }
+        if (kept > 0)
+            count = kept;
+    }
+
+    best_move = moves[0];
+    max_depth = std::max(1, std::min(max_depth,
+                                     board.getPieceCount(Board::EMPTY)));
+
+    for (int depth = 1; depth <= max_depth; ++depth) {
+        int alpha = -INFINITE;
+        int beta  = INFINITE;
+        int value;
+
+        // Expect about the same score as last time
+        if (depth >= 3 && previous > -MATE_BOUND && previous < MATE_BOUND) {
+            alpha = previous - ASPIRATION;
+            beta  = previous + ASPIRATION;
+        }
+
+        for (;;) {
+            value = searchRoot(board, depth, alpha, beta, moves, count);
+
+            if (stopped)
+                break;
+
+            // Outside the window, look again with that side opened up
+            if (value <= alpha && alpha > -INFINITE)
+                alpha = -INFINITE;
+            else if (value >= beta && beta < INFINITE)
+                beta = INFINITE;
+            else
+                break;
+        }
+
+        // The previous best move is always searched first, so whatever
+        // beat it in an unfinished iteration is an improvement, but only
+        // if its score is a true one. In a narrowed window a score at or
+        // below alpha is just an upper bound, and the move it belongs to
+        // may be worse than the last finished iteration's.
+        if (stopped) {
+            if (root_best >= 0 && root_score > alpha)
+                best_move = root_best;
+            break;
+        }
+
+        best_move     = root_best;
+        score         = value;
+        previous      = value;
+        depth_reached = depth;
+
+        // A forced result will not change with more depth
+        if (value > MATE_BOUND || value < -MATE_BOUND)
+            break;
+
+        // Not worth starting an iteration that can not finish
+        if (deadline && (monotonicMicros() - start_time) * 2
+                        > deadline - start_time)
+            break;
+    }
+
+    elapsed = monotonicMicros() - start_time;
+    return best_move;
+}
+
+///////////////////////////////////////////////////////////////////////
+// searchRoot(Board &board, int depth, int alpha, int beta,
+//            int *moves, int count)
+//
+// Parameters:  board       - The position
+//              int depth   - Plies to search
+//              int alpha   - Bottom of the window
+//              int beta    - Top of the window
+//              int *moves  - The moves from the root, best first. The
+//                            best move of this iteration is moved to
+//                            the front.
+//              int count   - How many moves there are
+//
+// Returns: The score of the best move
+///////////////////////////////////////////////////////////////////////
+int
+Search::searchRoot(Board &board, int depth, int alpha, int beta,
+                   int *moves, int count)
+{
+    Board::Cell player = board.toMove();
+    int         best   = -INFINITE;
+    int         index  = 0;
+
+    root_best  = -1;
+    root_score = -INFINITE;
+
+    for (int i = 0; i < count; ++i) {
+        play(board, moves[i], player);
+        int value = -alphaBeta(board, depth - 1, -beta, -alpha, 1);
+        takeBack(board, moves[i], player);
+
+        if (stopped)
+            break;
+
+        if (value > best) {
+            best       = value;
+            index      = i;
+            root_best  = moves[i];
+            root_score = value;
+        }
+        if (value > alpha)
+            alpha = value;
+        if (alpha >= beta)
+            break;
+    }
+
+    // Try the best move first next time
+    if (root_best >= 0) {
+        for (int i = index; i > 0; --i)
+            moves[i] = moves[i - 1];
+        moves[0] = root_best;
+    }
+
+    return best;
+}
+
+///////////////////////////////////////////////////////////////////////
+// alphaBeta(Board &board, int depth, int alpha, int beta, int ply)
+//
+// Parameters:  board       - The position
+//              int depth   - Plies left to search
+//              int alpha   - The score we already have
+//              int beta    - The score the opponent already has
+//              int ply     - Plies from the root
+//
+// Returns: The score of the position for the player to move
+///////////////////////////////////////////////////////////////////////
+int
+Search::alphaBeta(Board &board, int depth, int alpha, int beta, int ply)
+{
+    Board::Cell player = board.toMove();
+    int         moves[Board::MAX_CELLS];
+    int         count;
+    int         best       = -INFINITE;
+    int         best_move  = -1;
+    int         orig_alpha = alpha;
+
+    if ((++nodes & CHECK_NODES) == 0 && outOfTime())
+        stopped = true;
+
+    if (stopped)
+        return 0;
+
+    // The last player to move just won, or nobody can win anymore
+    if (board.hasLine(Board::opponent(player)))
+        return -(WIN_SCORE - ply);
+    if (board.isBlocked())
+        return 0;
+    if (depth <= 0 || ply >= MAX_PLY)
+        return evaluateLeaf(board, player);
+
+    Entry &entry = probe(board.hash());
+    int    hint  = -1;
+
+    if (entry.key == board.hash()) {
+        hint = entry.move;
+
+        if (entry.depth >= depth) {
+            int stored = entry.score;
+
+            // Wins are stored as distance from the stored position
+            if (stored > MATE_BOUND)
+                stored -= ply;
+            else if (stored < -MATE_BOUND)
+                stored += ply;
+
+            if (entry.bound == EXACT)
+                return stored;
+            if (entry.bound == LOWER && stored > alpha)
+                alpha = stored;
+            else if (entry.bound == UPPER && stored < beta)
+                beta = stored;
+            if (alpha >= beta)
+                return stored;
+        }
+    }
+
+    count = sortMoves(board, moves, hint, ply);
+
+    for (int i = 0; i < count; ++i) {
+        play(board, moves[i], player);
+        int value = -alphaBeta(board, depth - 1, -beta, -alpha, ply + 1);
+        takeBack(board, moves[i], player);
+
+        if (stopped)
+            return 0;
+
+        if (value > best) {
+            best      = value;
+            best_move = moves[i];
+        }
+        if (value > alpha)
+            alpha = value;
+        if (alpha >= beta) {
+            rememberCutoff(player, moves[i], depth, ply);
+            break;
+        }
+    }
+
+    // Always replace, the newest search knows the most
+    Entry &slot = probe(board.hash());
+    int    stored = best;
+
+    if (stored > MATE_BOUND)
+        stored += ply;
+    else if (stored < -MATE_BOUND)
+        stored -= ply;
+
+    slot.key   = board.hash();
+    slot.score = stored;
+    slot.move  = short(best_move);
+    slot.depth = (signed char)(depth);
+    slot.bound = best <= orig_alpha ? UPPER : best >= beta ? LOWER : EXACT;
+
+    return best;
+}
+
+///////////////////////////////////////////////////////////////////////
+// sortMoves(const Board &board, int *moves, int hint, int ply)
+//
+// Parameters:  board       - The position
+//              int *moves  - Filled with the moves to try
+//              int hint    - The transposition table's move, or -1
+//              int ply     - Plies from the root
+//
+// Returns: The number of moves
+//
+// Like orderMoves(), but moves that caused cutoffs at this ply or
+// anywhere else in the tree are tried sooner.
+///////////////////////////////////////////////////////////////////////
+int
+Search::sortMoves(const Board &board, int *moves, int hint, int ply)
+{
+    int                     keys[Board::MAX_CELLS];
+    int                     count   = generateMoves(board, moves, keys);
+    const std::vector<int> &learned = history[board.toMove()];
+
+    for (int i = 0; i < count; ++i) {
+        int move = moves[i];
+
+        if (move == hint)
+            keys[i] += 1 << 28;
+        else if (move == killers[ply][0])
+            keys[i] += 1 << 22;
+        else if (move == killers[ply][1])
+            keys[i] += 1 << 21;
+
+        if (move < int(learned.size()))
+            keys[i] += std::min(learned[move], (1 << 20) - 1);
+    }
+
+    sortByKey(moves, keys, count);
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// rememberCutoff(Board::Cell player, int move, int depth, int ply)
+//
+// Parameters:  player      - Who made the move
+//              int move    - The move that was too good for the
+//                            opponent to allow
+//              int depth   - Plies left when it happened
+//              int ply     - Plies from the root
+//
+// Records a cutoff as a killer move for this ply and in the history.
+///////////////////////////////////////////////////////////////////////
+void
+Search::rememberCutoff(Board::Cell player, int move, int depth, int ply)
+{
+    if (killers[ply][0] != move) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
+    }
+
+    if (move < int(history[player].size()))
+        history[player][move] += depth * depth;
+}
+
+///////////////////////////////////////////////////////////////////////
+// outOfTime()
+//
+// Returns: True if stop() was called, or there is a deadline and it
+// has passed
+///////////////////////////////////////////////////////////////////////
+bool
+Search::outOfTime()
+{
+    if (interrupted != 0)
+        return true;
+    return deadline != 0 && monotonicMicros() >= deadline;
+}
+
+///////////////////////////////////////////////////////////////////////
+// play(Board &board, int cell, Board::Cell player)
+// takeBack(Board &board, int cell, Board::Cell player)
+//
+// Parameters:  board       - The position
+//              int cell    - The move
+//              player      - Who makes it
+//
+// Makes or unmakes a move, keeping the network's first layer in step.
+///////////////////////////////////////////////////////////////////////
+void
+Search::play(Board &board, int cell, Board::Cell player)
+{
+    board.place(cell, player);
+    if (use_network)
+        network->addPiece(accumulator, cell, player);
+}
+
+void
+Search::takeBack(Board &board, int cell, Board::Cell player)
+{
+    board.remove(cell);
+    if (use_network)
+        network->removePiece(accumulator, cell, player);
+}
+
+///////////////////////////////////////////////////////////////////////
+// evaluateLeaf(const Board &board, Board::Cell player)
+//
+// Returns: The network's score for player if there is one, otherwise
+// evaluate()'s. Either way it is kept clear of the winning scores.
+///////////////////////////////////////////////////////////////////////
+int
+Search::evaluateLeaf(const Board &board, Board::Cell player) const
+{
+    if (!use_network)
+        return evaluate(board, player);
+
+    int value = network->evaluate(accumulator, player);
+
+    return std::max(-MATE_BOUND + 1, std::min(MATE_BOUND - 1, value));
+}
+
+///////////////////////////////////////////////////////////////////////
+// orderMoves(const Board &board, int *moves, int hint)
+//
+// Parameters:  board       - The position
+//              int *moves  - Filled with the moves to try, which needs
+//                            room for every cell
+//              int hint    - A move to try first, or -1
+//
+// Returns: The number of moves
+//
+// Moves are tried best first: the hint, then winning moves, then
+// moves that stop the opponent winning, then moves on the busiest
+// lines.
+///////////////////////////////////////////////////////////////////////
+int
+Search::orderMoves(const Board &board, int *moves, int hint)
+{
+    int keys[Board::MAX_CELLS];
+    int count = generateMoves(board, moves, keys);
+
+    for (int i = 0; i < count; ++i) {
+        if (moves[i] == hint)
+            keys[i] += 1 << 28;
+    }
+
+    sortByKey(moves, keys, count);
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// generateMoves(const Board &board, int *moves, int *keys)
+//
+// Parameters:  board       - The position
+//              int *moves  - Filled with the legal moves
+//              int *keys   - Filled with how promising each one looks
+//
+// Returns: The number of moves
+//
+// Winning moves get the biggest keys, then moves that stop the
+// opponent winning, then moves on the busiest lines. Boards bigger
+// than NEARBY_CELLS only consider cells close to a piece that is
+// already down.
+///////////////////////////////////////////////////////////////////////
+int
+Search::generateMoves(const Board &board, int *moves, int *keys)
+{
+    int         cells   = board.getCellCount();
+    int         rows    = board.getRows();
+    int         cols    = board.getCols();
+    bool        nearby  = cells > NEARBY_CELLS && board.getMoveCount() > 0;
+    Board::Cell player  = board.toMove();
+    Board::Cell other   = Board::opponent(player);
+    int         count   = 0;
+
+    for (int i = 0; i < cells; ++i) {
+        if (board.getCell(i) != Board::EMPTY)
+            continue;
+
+        if (nearby) {
+            bool close = false;
+            int  r     = i / cols;
+            int  c     = i % cols;
+
+            for (int dr = -2; dr <= 2 && !close; ++dr) {
+                for (int dc = -2; dc <= 2 && !close; ++dc) {
+                    int nr = r + dr;
+                    int nc = c + dc;
+                    if (nr >= 0 && nr < rows && nc >= 0 && nc < cols
+                            && board.getCell(nr, nc) != Board::EMPTY)
+                        close = true;
+                }
+            }
+            if (!close)
+                continue;
+        }
+
+        int key = 0;
+        const std::vector<int> &through = board.getLinesThrough(i);
+
+        for (unsigned j = 0; j < through.size(); ++j) {
+            int mine   = board.getLinePieces(through[j], player);
+            int theirs = board.getLinePieces(through[j], other);
+
+            if (theirs == 0)
+                key += 1 + mine * mine;
+            if (mine == 0)
+                key += 1 + theirs * theirs;
+        }
+
+        if (board.completesLine(i, player))
+            key += 1 << 26;
+        else if (board.completesLine(i, other))
+            key += 1 << 24;
+
+        moves[count] = i;
+        keys[count]  = key;
+        count++;
+    }
+
+    // The board is empty, start in the middle
+    if (count == 0 && board.getMoveCount() == 0 && cells > 0) {
+        moves[count] = (rows / 2) * cols + cols / 2;
+        keys[count]  = 0;
+        count++;
+    }
+
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// sortByKey(int *moves, int *keys, int count)
+//
+// Sorts moves so the biggest keys come first. An insertion sort, as
+// the lists are short and mostly in order already.
+///////////////////////////////////////////////////////////////////////
+void
+Search::sortByKey(int *moves, int *keys, int count)
+{
+    for (int i = 1; i < count; ++i) {
+        int move = moves[i];
+        int key  = keys[i];
+        int j    = i;
+
+        while (j > 0 && keys[j - 1] < key) {
+            keys[j]  = keys[j - 1];
+            moves[j] = moves[j - 1];
+            j--;
+        }
+        keys[j]  = key;
+        moves[j] = move;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// probe(uint64_t key)
+//
+// Returns: The table slot for a position
+///////////////////////////////////////////////////////////////////////
+Search::Entry &
+Search::probe(uint64_t key)
+{
+    return table[key & table_mask];
+}
+
+///////////////////////////////////////////////////////////////////////
+// evaluate(const Board &board, Board::Cell player)
+//
+// Parameters:  board       - The position
+//              player      - Who we are scoring for
+//
+// Returns: A guess at how good the position is for player. Every line
+// that only one player has pieces on counts for that player, and the
+// more pieces on it the more it counts.
+///////////////////////////////////////////////////////////////////////
+int
+Search::evaluate(const Board &board, Board::Cell player)
+{
+    Board::Cell other = Board::opponent(player);
+    int         total = 0;
+
+    for (int line = 0; line < board.getLineCount(); ++line) {
+        int mine   = board.getLinePieces(line, player);
+        int theirs = board.getLinePieces(line, other);
+
+        if (mine > 0 && theirs == 0)
+            total += 1 << (2 * std::min(mine, 9));
+        else if (theirs > 0 && mine == 0)
+            total -= 1 << (2 * std::min(theirs, 9));
+    }
+
+    return std::max(-MATE_BOUND + 1, std::min(MATE_BOUND - 1, total));
+}
+
+///////////////////////////////////////////////////////////////////////
+// fullDepth(const Board &board)
+//
+// Returns: How deep to search. Small boards are searched to the end,
+// big ones to DEFAULT_DEPTH.
+///////////////////////////////////////////////////////////////////////
+int
+Search::fullDepth(const Board &board)
+{
+    int empty = board.getPieceCount(Board::EMPTY);
+
+    return empty <= 10 ? empty : int(DEFAULT_DEPTH);
+}
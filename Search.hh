@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#ifndef WF_SEARCH_HH
+#define WF_SEARCH_HH
+
+///////////////////////////////////////////////////////////////////////
+// Search.hh
+//
+// This file contains the declarations for the Search class, which
+// picks moves for the computer player.
+///////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <stdint.h>
+
+#include <QAtomicInt>
+
+#include "Board.hh"
+#include "Network.hh"
+#include "ThreatSearch.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Search
+//
+// An iterative deepening alpha-beta search with a transposition
+// table. Each iteration looks one ply deeper than the last, starting
+// with a narrow aspiration window around the previous score, and moves
+// are tried in the order the table, killer moves, and the history of
+// earlier cutoffs suggest. Positions at the depth limit are scored by
+// counting the lines each player could still complete, or by a Network
+// if one was given for this size of board. The network's first layer
+// is updated as moves are made and taken back.
+//
+// On boards bigger than NEARBY_CELLS with four or more in a row to
+// win, a ThreatSearch runs first. A forced win it finds is played
+// straight away, and if the opponent has one the search only looks at
+// the moves that might stop it.
+//
+// findMove() can be given a time limit. The clock is checked every
+// CHECK_NODES + 1 positions, and when time runs out the best move of the
+// deepest finished iteration is returned, or a move of the unfinished
+// one that has been proved better. The limit is kept even on a slow
+// machine, it just finishes fewer iterations.
+//
+// The transposition table is kept between calls to findMove(), so a
+// search of a position that was already looked at, for instance while
+// pondering, picks up where the last one left off. stop() may be
+// called from another thread to make findMove() return early, the
+// ThreatSearch included. A stop lasts until clearStop(), not just until
+// the next findMove(), so a caller that clears it under its own lock
+// before starting a search can not have a stop() slip in unseen.
+///////////////////////////////////////////////////////////////////////
+class Search
+{
+public:
+    enum {
+        WIN_SCORE     = 1000000,                // Won on this move
+        MATE_BOUND    = WIN_SCORE - 1000,       // Anything above is a win
+        INFINITE      = WIN_SCORE + 1,
+        MAX_PLY       = 256,
+        DEFAULT_DEPTH = 4,                      // For big boards
+        NEARBY_CELLS  = 25,                     // Bigger boards only look
+                                                // near pieces already down
+        ASPIRATION    = 64,                     // Half the first window
+        CHECK_NODES   = 15                      // Look at the clock this often
+    };
+
+    Search(int table_bits = 20);
+
+    int         findMove(Board &board, int max_depth, int time_limit = 0);
+    int         getScore() const;               // Of the last findMove()
+    uint64_t    getNodes() const;               // Positions looked at
+    int         getDepth() const;               // Deepest finished iteration
+    int         getElapsed() const;             // Milliseconds taken
+    uint64_t    getNodesPerSecond() const;
+    void        stop();                         // Give up as soon as we can
+    bool        isStopped() const;              // stop() was called
+    void        clearStop();                    // Before the next search
+    void        clearTable();
+    void        setNetwork(const Network *network); // 0 to count lines
+    void        setThreatSearch(bool on);       // On by default
+
+    static int  evaluate(const Board &board, Board::Cell player);
+    static int  orderMoves(const Board &board, int *moves, int hint = -1);
+    static int  fullDepth(const Board &board);  // Depth to search to
+    static int64_t monotonicMicros();           // For timing searches
+
+private:
+    // Bound types stored with each table entry
+    enum Bound {NONE, EXACT, LOWER, UPPER};
+
+    struct Entry
+    {
+        uint64_t    key;
+        int         score;
+        short       move;
+        signed char depth;
+        unsigned char bound;
+    };
+
+    int         searchRoot(Board &board, int depth, int alpha, int beta,
+                           int *moves, int count);
+    int         alphaBeta(Board &board, int depth, int alpha, int beta,
+                          int ply);
+    int         sortMoves(const Board &board, int *moves, int hint, int ply);
+    void        rememberCutoff(Board::Cell player, int move, int depth,
+                               int ply);
+    bool        outOfTime();
+    void        play(Board &board, int cell, Board::Cell player);
+    void        takeBack(Board &board, int cell, Board::Cell player);
+    int         evaluateLeaf(const Board &board, Board::Cell player) const;
+    Entry      &probe(uint64_t key);
+
+    static int  generateMoves(const Board &board, int *moves, int *keys);
+    static void sortByKey(int *moves, int *keys, int count);
+
+    std::vector<Entry>  table;
+    uint64_t            table_mask;
+    bool                stopped;                // Unwinding, for any reason
+    QAtomicInt          interrupted;            // stop() was called
+    uint64_t            nodes;
+    int                 score;
+    int                 depth_reached;
+    int                 root_best;              // Best move this iteration
+    int                 root_score;
+
+    // Move ordering learned during the search
+    int                 killers[MAX_PLY][2];
+    std::vector<int>    history[3];             // Indexed by player, cell
+
+    // Forced wins on big boards
+    ThreatSearch        threats;
+    bool                use_threats;
+
+    // Optional learned evaluation
+    const Network      *network;
+    bool                use_network;            // Fits this board
+    Network::Accumulator accumulator;
+
+    // Time control, in microseconds from an arbitrary start
+    int64_t             start_time;
+    int64_t             deadline;               // 0 for none
+    int64_t             elapsed;
+};
+
+#endif
@@ -0,0 +1,496 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QTime>
+#include <new>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+
+#include "SelfPlay.hh"
+#include "Search.hh"
+
+static const char magic[8] = {'X', 'S', 'N', 'O', 'S', 'S', 'P', '1'};
+
+///////////////////////////////////////////////////////////////////////
+// Header
+//
+// The start of the shared memory, written by the coordinator before
+// any worker is started and only read after.
+///////////////////////////////////////////////////////////////////////
+struct SelfPlay::Header
+{
+    char        magic[8];
+    qint32      rows;
+    qint32      cols;
+    qint32      win_length;
+    qint32      msecs;
+    qint32      workers;
+    qint64      coordinator;                    // Its pid, workers stop
+                                                // if it goes away
+};
+
+///////////////////////////////////////////////////////////////////////
+// Slot
+//
+// One finished game.
+///////////////////////////////////////////////////////////////////////
+struct SelfPlay::Slot
+{
+    qint32      length;                         // Moves played
+    qint32      winner;                         // A Board::Cell
+    Move        moves[Board::MAX_CELLS];
+};
+
+///////////////////////////////////////////////////////////////////////
+// Ring
+//
+// One worker's games. head and tail sit on cache lines of their own
+// so the worker and coordinator do not slow each other down.
+///////////////////////////////////////////////////////////////////////
+struct SelfPlay::Ring
+{
+    QAtomicInt  head;                           // Games written
+    char        head_pad[CACHE_LINE - sizeof(QAtomicInt)];
+    QAtomicInt  tail;                           // Games read
+    char        tail_pad[CACHE_LINE - sizeof(QAtomicInt)];
+    qint32      quota;                          // Games to play in all
+    Slot        games[SLOTS];
+};
+
+///////////////////////////////////////////////////////////////////////
+// random(quint64 &state)
+//
+// Returns: The next number from splitmix64, the same generator Board
+// uses for its hash keys.
+///////////////////////////////////////////////////////////////////////
+static quint64
+random(quint64 &state)
+{
+    quint64 z = (state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+///////////////////////////////////////////////////////////////////////
+// SelfPlay(int rows, int cols, int win_length, int msecs)
+//
+// Parameters:  rows, cols  - Size of the board
+//              win_length  - Pieces needed in a row
+//              msecs       - Search time for each move
+///////////////////////////////////////////////////////////////////////
+SelfPlay::SelfPlay(int rows, int cols, int win_length, int msecs) :
+    rows(rows),
+    cols(cols),
+    win_length(win_length),
+    msecs(msecs),
+    games(0),
+    moves(0),
+    elapsed(0)
+{
+    wins[Board::EMPTY] = wins[Board::X] = wins[Board::O] = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// ~SelfPlay()
+//
+// Makes sure no worker outlives the coordinator.
+///////////////////////////////////////////////////////////////////////
+SelfPlay::~SelfPlay()
+{
+    for (int i = 0; i < processes.size(); ++i) {
+        if (processes[i]->state() != QProcess::NotRunning) {
+            processes[i]->kill();
+            processes[i]->waitForFinished();
+        }
+        delete processes[i];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// headerSize()
+//
+// Returns: Bytes before the first ring
+///////////////////////////////////////////////////////////////////////
+int
+SelfPlay::headerSize()
+{
+    return (int(sizeof(Header)) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+///////////////////////////////////////////////////////////////////////
+// ringSize()
+//
+// Returns: Bytes from one ring to the next
+///////////////////////////////////////////////////////////////////////
+int
+SelfPlay::ringSize()
+{
+    return (int(sizeof(Ring)) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+///////////////////////////////////////////////////////////////////////
+// ringAt(void *memory, int worker)
+//
+// Returns: worker's ring in the shared memory
+///////////////////////////////////////////////////////////////////////
+SelfPlay::Ring *
+SelfPlay::ringAt(void *memory, int worker)
+{
+    return reinterpret_cast<Ring *>(static_cast<char *>(memory)
+                                    + headerSize() + worker * ringSize());
+}
+
+///////////////////////////////////////////////////////////////////////
+// run(int games, int workers, const QString &corpus)
+//
+// Parameters:  games       - How many games to play in all
+//              workers     - How many processes to play them in
+//              corpus      - File the games are added to
+//
+// Returns: False if the workers could not be started, or some gave up
+// before playing all their games. The totals are kept either way.
+///////////////////////////////////////////////////////////////////////
+bool
+SelfPlay::run(int games, int workers, const QString &corpus_name)
+{
+    corpus.setFileName(corpus_name);
+    if (!corpus.open(QIODevice::WriteOnly | QIODevice::Append
+                     | QIODevice::Text)) {
+        error = corpus_name + ": " + corpus.errorString();
+        return false;
+    }
+
+    memory.setKey(QString("xsnos-self-play-%1")
+                  .arg(QCoreApplication::applicationPid()));
+    if (!memory.create(headerSize() + workers * ringSize())) {
+        error = memory.errorString();
+        return false;
+    }
+
+    Header *header = new (memory.data()) Header;
+
+    memcpy(header->magic, magic, sizeof(magic));
+    header->rows        = rows;
+    header->cols        = cols;
+    header->win_length  = win_length;
+    header->msecs       = msecs;
+    header->workers     = workers;
+    header->coordinator = QCoreApplication::applicationPid();
+
+    for (int i = 0; i < workers; ++i) {
+        Ring *ring = new (ringAt(memory.data(), i)) Ring;
+
+        ring->quota = games / workers + (i < games % workers);
+    }
+
+    QTime timer;
+
+    timer.start();
+    restarts.fill(0, workers);
+    for (int i = 0; i < workers; ++i) {
+        processes.append(new QProcess);
+        processes[i]->setProcessChannelMode(QProcess::ForwardedChannels);
+        if (!startWorker(i)) {
+            error = "can not start a worker: " + processes[i]->errorString();
+            return false;
+        }
+    }
+
+    QVector<bool> failed(workers, false);
+
+    for (;;) {
+        bool busy = drain();
+        bool done = true;
+
+        QCoreApplication::processEvents();
+
+        for (int i = 0; i < workers; ++i) {
+            Ring *ring = ringAt(memory.data(), i);
+
+            if (failed[i] || ring->tail == ring->quota)
+                continue;
+            done = false;
+
+            if (processes[i]->state() != QProcess::NotRunning
+                    || ring->head.fetchAndAddAcquire(0) == ring->quota)
+                continue;
+
+            // It stopped with games still to play
+            if (restarts[i] == MAX_RESTARTS) {
+                std::cerr << "worker " << i << " keeps failing, giving up"
+                             " on it\n";
+                failed[i] = true;
+                continue;
+            }
+            std::cerr << "worker " << i << " stopped, restarting it\n";
+            restarts[i]++;
+            if (!startWorker(i))
+                failed[i] = true;
+        }
+
+        if (done)
+            break;
+        if (!busy)
+            usleep(POLL_USECS);
+    }
+
+    for (int i = 0; i < workers; ++i)
+        processes[i]->waitForFinished();
+    corpus.close();
+    elapsed = timer.elapsed();
+
+    int given_up = failed.count(true);
+
+    if (given_up > 0) {
+        error = QString("%1 of %2 workers gave up").arg(given_up).arg(workers);
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// startWorker(int worker)
+//
+// Returns: False if the process could not be started
+///////////////////////////////////////////////////////////////////////
+bool
+SelfPlay::startWorker(int worker)
+{
+    QStringList args;
+
+    args << "--self-play-worker" << memory.key() << QString::number(worker);
+    processes[worker]->start(QCoreApplication::applicationFilePath(), args);
+    return processes[worker]->waitForStarted();
+}
+
+///////////////////////////////////////////////////////////////////////
+// drain()
+//
+// Returns: True if any games were waiting
+//
+// Adds the games waiting in every ring to the totals and the corpus,
+// then hands their slots back.
+///////////////////////////////////////////////////////////////////////
+bool
+SelfPlay::drain()
+{
+    QTextStream   out(&corpus);
+    QVector<Move> game;
+    bool          any = false;
+
+    for (int i = 0; i < processes.size(); ++i) {
+        Ring *ring = ringAt(memory.data(), i);
+        int   head = ring->head.fetchAndAddAcquire(0);
+        int   tail = ring->tail;
+
+        for (; tail != head; ++tail) {
+            const Slot &slot = ring->games[tail % SLOTS];
+
+            game.resize(slot.length);
+            memcpy(game.data(), slot.moves, slot.length * sizeof(Move));
+            out << GameLog::formatGame(game) << "\n";
+
+            games++;
+            wins[slot.winner]++;
+            moves += slot.length;
+            any = true;
+        }
+        ring->tail.fetchAndStoreRelease(tail);
+    }
+    return any;
+}
+
+///////////////////////////////////////////////////////////////////////
+// errorString()
+//
+// Returns: Why run() failed
+///////////////////////////////////////////////////////////////////////
+QString
+SelfPlay::errorString() const
+{
+    return error;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getGames()
+//
+// Returns: Games drained from the workers
+///////////////////////////////////////////////////////////////////////
+int
+SelfPlay::getGames() const
+{
+    return games;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getWins(Board::Cell player)
+//
+// Returns: Games player won, or the draws for EMPTY
+///////////////////////////////////////////////////////////////////////
+int
+SelfPlay::getWins(Board::Cell player) const
+{
+    return wins[player];
+}
+
+///////////////////////////////////////////////////////////////////////
+// getMoves()
+//
+// Returns: Moves in all the games drained
+///////////////////////////////////////////////////////////////////////
+qint64
+SelfPlay::getMoves() const
+{
+    return moves;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getRestarts()
+//
+// Returns: How many times a worker had to be started again
+///////////////////////////////////////////////////////////////////////
+int
+SelfPlay::getRestarts() const
+{
+    int total = 0;
+
+    for (int i = 0; i < restarts.size(); ++i)
+        total += restarts[i];
+    return total;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getElapsed()
+//
+// Returns: Milliseconds run() took
+///////////////////////////////////////////////////////////////////////
+int
+SelfPlay::getElapsed() const
+{
+    return elapsed;
+}
+
+///////////////////////////////////////////////////////////////////////
+// work(const QString &key, int worker)
+//
+// Parameters:  key         - The coordinator's shared memory
+//              worker      - Which ring is ours
+//
+// Returns: The exit code for the worker process
+//
+// Plays games into the ring until its quota is met. Starting again
+// after a crash just carries on from head, as a game is only counted
+// once it is all in its slot.
+///////////////////////////////////////////////////////////////////////
+int
+SelfPlay::work(const QString &key, int worker)
+{
+    QSharedMemory memory(key);
+
+    if (!memory.attach()) {
+        std::cerr << qPrintable(key) << ": "
+                  << qPrintable(memory.errorString()) << "\n";
+        return 1;
+    }
+
+    const Header *header = static_cast<const Header *>(memory.constData());
+
+    if (memcmp(header->magic, magic, sizeof(magic)) != 0
+            || worker < 0 || worker >= header->workers) {
+        std::cerr << qPrintable(key) << ": not a self-play farm\n";
+        return 1;
+    }
+
+    Ring   *ring = ringAt(memory.data(), worker);
+    Search  search;
+    Slot    slot;
+
+    for (int head = ring->head; head < ring->quota; ) {
+        quint64 seed = (quint64(worker) << 32) | quint64(head);
+
+        playGame(*header, search, seed, &slot);
+
+        // Wait for room, unless nobody is left to make it
+        while (head - ring->tail.fetchAndAddAcquire(0) >= SLOTS) {
+            if (getppid() != header->coordinator)
+                return 1;
+            usleep(POLL_USECS);
+        }
+
+        memcpy(&ring->games[head % SLOTS], &slot,
+               sizeof(slot) - sizeof(slot.moves)
+               + slot.length * sizeof(Move));
+        ring->head.fetchAndStoreRelease(++head);
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// playGame(const Header &header, Search &search, quint64 seed,
+//          Slot *slot)
+//
+// Parameters:  header      - The board and time per move
+//              search      - Kept between games for its tables
+//              seed        - Picks the opening moves
+//              slot        - Where the game goes
+///////////////////////////////////////////////////////////////////////
+void
+SelfPlay::playGame(const Header &header, Search &search, quint64 seed,
+                   Slot *slot)
+{
+    Board   board(header.rows, header.cols, header.win_length);
+    quint64 state = seed;
+
+    slot->length = 0;
+
+    while (!board.isOver()) {
+        Board::Cell player  = board.toMove();
+        int         empties = board.getPieceCount(Board::EMPTY);
+        int         cell    = -1;
+
+        if (slot->length < RANDOM_MOVES) {
+            int pick = int(random(state) % quint64(empties));
+
+            for (cell = 0; ; ++cell)
+                if (board.getCell(cell) == Board::EMPTY && pick-- == 0)
+                    break;
+        } else
+            cell = search.findMove(board, empties, header.msecs);
+
+        if (cell < 0)
+            break;
+
+        Move &move = slot->moves[slot->length++];
+
+        move.state = GameSpace::SpaceState(player);
+        move.row   = cell / header.cols;
+        move.col   = cell % header.cols;
+        board.place(cell, player);
+    }
+
+    slot->winner = board.hasLine(Board::X) ? Board::X
+                 : board.hasLine(Board::O) ? Board::O : Board::EMPTY;
+}
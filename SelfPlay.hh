@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_SELFPLAY_HH
+#define WF_SELFPLAY_HH
+
+///////////////////////////////////////////////////////////////////////
+// SelfPlay.hh
+//
+// This file contains the declarations for the SelfPlay class, which
+// has the computer play itself in several processes at once.
+//
+// The processes share one block of memory, laid out as:
+//
+//      Header                      board size, time per move, workers
+//      Ring[workers]               one per worker, each starting on a
+//                                  cache line of its own
+//
+// A ring holds SLOTS finished games, each kept as the Move structs
+// MainWindow logs, and two counters: head, the games the worker has
+// written, and tail, the games the coordinator has read. Only the
+// worker moves head and only the coordinator moves tail, so neither
+// ever waits on a lock.
+///////////////////////////////////////////////////////////////////////
+
+#include <QFile>
+#include <QProcess>
+#include <QSharedMemory>
+#include <QString>
+#include <QVector>
+
+#include "Board.hh"
+#include "GameLog.hh"
+
+class Search;
+
+///////////////////////////////////////////////////////////////////////
+// SelfPlay
+//
+// The coordinator starts a copy of the program per worker with
+// --self-play-worker, gives each its share of the games, and then
+// drains their rings into the totals and a corpus file in the log
+// format, one game per line. Playing a game touches nothing but the
+// worker's own ring, so adding workers adds games per second until the
+// cores run out. A worker that dies is started again and picks up from
+// the last game it published; one that keeps dying is given up on.
+//
+// Each game starts with RANDOM_MOVES random moves, from a seed made of
+// the worker and game number, so the games differ while the search
+// itself stays deterministic.
+///////////////////////////////////////////////////////////////////////
+class SelfPlay
+{
+public:
+    enum {
+        SLOTS        = 32,                      // Games a ring can hold
+        RANDOM_MOVES = 2,                       // Opening moves by chance
+        MAX_RESTARTS = 3,                       // Per worker
+        POLL_USECS   = 1000,                    // Idle coordinator naps
+        CACHE_LINE   = 64
+    };
+
+    SelfPlay(int rows, int cols, int win_length, int msecs);
+    ~SelfPlay();
+
+    bool        run(int games, int workers, const QString &corpus);
+    QString     errorString() const;
+
+    int         getGames() const;               // Drained so far
+    int         getWins(Board::Cell player) const;  // EMPTY for draws
+    qint64      getMoves() const;
+    int         getRestarts() const;
+    int         getElapsed() const;             // Milliseconds
+
+    static int  work(const QString &key, int worker);
+
+private:
+    struct Header;
+    struct Ring;
+    struct Slot;
+
+    static int      headerSize();
+    static int      ringSize();
+    static Ring    *ringAt(void *memory, int worker);
+    static void     playGame(const Header &header, Search &search,
+                             quint64 seed, Slot *slot);
+    bool            startWorker(int worker);
+    bool            drain();
+
+    int                 rows;
+    int                 cols;
+    int                 win_length;
+    int                 msecs;                  // Search time per move
+
+    QSharedMemory       memory;
+    QVector<QProcess *> processes;
+    QVector<int>        restarts;               // Per worker
+    QFile               corpus;
+    QString             error;
+
+    int                 games;
+    int                 wins[3];                // Indexed by Board::Cell
+    qint64              moves;
+    int                 elapsed;
+};
+
+#endif
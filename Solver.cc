@@ -0,0 +1,261 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#include "Solver.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Solver(int rows, int cols, int win_length, Rules::Set rules)
+//
+// Parameters:  int     rows        - Rows on the board
+//              int     cols        - Columns on the board
+//              int     win_length  - How many in a row wins
+//              rules               - Which game is being played
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+Solver::Solver(int rows, int cols, int win_length, Rules::Set rules) :
+    rows(rows),
+    cols(cols),
+    win_length(win_length),
+    rules(rules),
+    solved_count(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// Getters
+///////////////////////////////////////////////////////////////////////
+const std::vector<unsigned char> &
+Solver::getTable() const
+{
+    return table;
+}
+
+uint64_t
+Solver::getSolvedCount() const
+{
+    return solved_count;
+}
+
+int
+Solver::getRows() const
+{
+    return rows;
+}
+
+int
+Solver::getCols() const
+{
+    return cols;
+}
+
+int
+Solver::getWinLength() const
+{
+    return win_length;
+}
+
+Rules::Set
+Solver::getRules() const
+{
+    return rules;
+}
+
+///////////////////////////////////////////////////////////////////////
+// solve()
+//
+// Returns: False if the board has too many cells to solve this way,
+// or the rules are gravity, where rotating a position does not give
+// the same game.
+//
+// Fills in the table for every position reachable from the empty
+// board.
+///////////////////////////////////////////////////////////////////////
+bool
+Solver::solve()
+{
+    if (rows * cols > MAX_CELLS || rules == Rules::GRAVITY)
+        return false;
+
+    Board board(rows, cols, win_length);
+
+    table.assign(Board::rankCount(rows * cols), 0);
+    solved_count = 0;
+
+    switch (rules) {
+    case Rules::MISERE:     search<MisereRules>(board);     break;
+    case Rules::WILD:       search<WildRules>(board);       break;
+    case Rules::NOTAKTO:    search<NotaktoRules>(board);    break;
+    default:                search<StandardRules>(board);   break;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// lookup(const Board &board)
+//
+// Parameters:  board       - A position on a board of the solved size
+//
+// Returns: The packed entry for the position, or 0 (UNKNOWN) if it
+// can not be reached by taking turns.
+///////////////////////////////////////////////////////////////////////
+unsigned char
+Solver::lookup(const Board &board) const
+{
+    uint64_t rank = board.canonicalRank();
+
+    if (rank >= table.size())
+        return 0;
+    return table[rank];
+}
+
+///////////////////////////////////////////////////////////////////////
+// search<Policy>(Board &board)
+//
+// Parameters:  Policy      - The rules, one of the classes in Rules.hh
+//              board       - The position to solve. It is handed back
+//                            unchanged.
+//
+// Returns: The packed entry for the position
+//
+// A plain depth first search that remembers every answer, so each
+// canonical position is only ever expanded once.
+///////////////////////////////////////////////////////////////////////
+template <class Policy>
+unsigned char
+Solver::search(Board &board)
+{
+    uint64_t        rank   = board.canonicalRank();
+    Board::Cell     player = Policy::toMove(board);
+    Board::Cell     last   = Board::opponent(player);
+    Board::Cell     pieces[2];
+    int             kinds  = Policy::pieces(player, pieces);
+    unsigned char   best   = 0;
+
+    if (table[rank] != 0)
+        return table[rank];
+
+    // The last player to move just decided the game, or nobody can win
+    Board::Cell winner = board.getMoveCount() > 0
+                         ? Policy::winner(board, last) : Board::EMPTY;
+
+    if (winner == last) {
+        best = pack(LOSS, 0);
+    } else if (winner == player) {
+        best = pack(WIN, 0);
+    } else if (Policy::isDrawn(board)) {
+        best = pack(DRAW, 0);
+    } else {
+        for (int i = 0; i < board.getCellCount(); ++i) {
+            if (board.getCell(i) != Board::EMPTY)
+                continue;
+
+            for (int k = 0; k < kinds; ++k) {
+                board.place(i, pieces[k]);
+                unsigned char child = childToParent(search<Policy>(board));
+                board.remove(i);
+
+                if (best == 0 || isBetter(child, best))
+                    best = child;
+            }
+        }
+    }
+
+    table[rank] = best;
+    solved_count++;
+    return best;
+}
+
+///////////////////////////////////////////////////////////////////////
+// pack(Value value, int distance)
+//
+// Parameters:  Value   value       - WIN, LOSS, or DRAW
+//              int     distance    - Plies until the game ends
+//
+// Returns: The one byte table entry
+///////////////////////////////////////////////////////////////////////
+unsigned char
+Solver::pack(Value value, int distance)
+{
+    return (unsigned char)((distance << 2) | value);
+}
+
+///////////////////////////////////////////////////////////////////////
+// valueOf(unsigned char entry)
+//
+// Returns: The value part of a table entry
+///////////////////////////////////////////////////////////////////////
+Solver::Value
+Solver::valueOf(unsigned char entry)
+{
+    return Value(entry & 3);
+}
+
+///////////////////////////////////////////////////////////////////////
+// distanceOf(unsigned char entry)
+//
+// Returns: The distance part of a table entry
+///////////////////////////////////////////////////////////////////////
+int
+Solver::distanceOf(unsigned char entry)
+{
+    return entry >> 2;
+}
+
+///////////////////////////////////////////////////////////////////////
+// childToParent(unsigned char child)
+//
+// Parameters:  child       - The entry of the position after a move
+//
+// Returns: What that move is worth to the player who made it. A loss
+// for the opponent is a win for us one ply further away, and so on.
+///////////////////////////////////////////////////////////////////////
+unsigned char
+Solver::childToParent(unsigned char child)
+{
+    Value value    = valueOf(child);
+    int   distance = distanceOf(child) + 1;
+
+    if (value == WIN)
+        return pack(LOSS, distance);
+    if (value == LOSS)
+        return pack(WIN, distance);
+    return pack(DRAW, distance);
+}
+
+///////////////////////////////////////////////////////////////////////
+// isBetter(unsigned char a, unsigned char b)
+//
+// Returns: True if entry a is a better result than entry b for the
+// player to move. Quick wins beat slow wins, wins beat draws, draws
+// beat losses, and slow losses beat quick ones.
+///////////////////////////////////////////////////////////////////////
+bool
+Solver::isBetter(unsigned char a, unsigned char b)
+{
+    static const int order[4] = {0, 3, 1, 2};  // UNKNOWN, WIN, LOSS, DRAW
+    Value va = valueOf(a);
+    Value vb = valueOf(b);
+
+    if (va != vb)
+        return order[va] > order[vb];
+    if (va == WIN || va == DRAW)
+        return distanceOf(a) < distanceOf(b);
+    return distanceOf(a) > distanceOf(b);
+}
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#ifndef WF_SOLVER_HH
+#define WF_SOLVER_HH
+
+///////////////////////////////////////////////////////////////////////
+// Solver.hh
+//
+// This file contains the declarations for the Solver class, which
+// works out the game theoretic value of every position reachable on a
+// small board when the players take turns starting with X, under any
+// of the rule sets in Rules.hh.
+///////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <stdint.h>
+
+#include "Board.hh"
+#include "Rules.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Solver
+//
+// Solves a board by searching every reachable position once. Results
+// are kept in a table with one byte per rank, and only the canonical
+// rank of each position is filled in. The byte holds the value for
+// the player to move in its low two bits and the number of plies left
+// with best play in the rest.
+//
+// The search is compiled once for each rule set, so its inner loop
+// has the rules' win and draw checks inlined rather than asking which
+// rules are in use at every position.
+///////////////////////////////////////////////////////////////////////
+class Solver
+{
+public:
+    enum Value {UNKNOWN, WIN, LOSS, DRAW};      // For the player to move
+
+    enum {
+        MAX_CELLS = 18                          // 3^18 bytes is 387MB
+    };
+
+    Solver(int rows, int cols, int win_length,
+           Rules::Set rules = Rules::STANDARD);
+
+    bool            solve();                    // False if too big, or
+                                                // gravity
+    unsigned char   lookup(const Board &board) const;
+    const std::vector<unsigned char> &getTable() const;
+    uint64_t        getSolvedCount() const;     // Positions solved
+    int             getRows() const;
+    int             getCols() const;
+    int             getWinLength() const;
+    Rules::Set      getRules() const;
+
+    static unsigned char pack(Value value, int distance);
+    static Value         valueOf(unsigned char entry);
+    static int           distanceOf(unsigned char entry);
+    static unsigned char childToParent(unsigned char child);
+    static bool          isBetter(unsigned char a, unsigned char b);
+
+private:
+    template <class Policy>
+    unsigned char   search(Board &board);
+
+    int                         rows;
+    int                         cols;
+    int                         win_length;
+    Rules::Set                  rules;
+    std::vector<unsigned char>  table;          // Indexed by rank
+    uint64_t                    solved_count;
+};
+
+#endif
@@ -0,0 +1,348 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#include <QDataStream>
+#include <QList>
+#include <QObject>
+#include <QtEndian>
+#include <string.h>
+
+#include "Tablebase.hh"
+
+static const char   TABLEBASE_MAGIC[8] = {'X', 'S', 'N', 'O', 'S', 'T', 'B', '1'};
+static const qint64 HEADER_SIZE        = 40;
+
+///////////////////////////////////////////////////////////////////////
+// Tablebase()
+//
+// Constructor. The tablebase is empty until open() is called.
+///////////////////////////////////////////////////////////////////////
+Tablebase::Tablebase() :
+    map(0),
+    map_size(0),
+    offsets(0),
+    rows(0),
+    cols(0),
+    win_length(0),
+    rules(Rules::STANDARD),
+    block_size(0),
+    block_count(0),
+    entry_count(0),
+    blocks(CACHE_BLOCKS)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// ~Tablebase()
+//
+// Destructor
+///////////////////////////////////////////////////////////////////////
+Tablebase::~Tablebase()
+{
+    close();
+}
+
+///////////////////////////////////////////////////////////////////////
+// open(const QString &file_name)
+//
+// Parameters:  file_name   - A file made by write()
+//
+// Returns: False if the file could not be mapped or is not a
+// tablebase. errorString() says why.
+//
+// Maps the file and reads its header. Nothing else is touched, so
+// this takes the same time no matter how big the file is.
+///////////////////////////////////////////////////////////////////////
+bool
+Tablebase::open(const QString &file_name)
+{
+    quint32 rule_set;
+
+    close();
+
+    file.setFileName(file_name);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+
+    map_size = file.size();
+    map      = map_size >= HEADER_SIZE ? file.map(0, map_size) : 0;
+
+    if (!map || memcmp(map, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC)) != 0) {
+        error = QObject::tr("%1 is not a tablebase").arg(file_name);
+        close();
+        return false;
+    }
+
+    rows        = qFromLittleEndian<quint32>(map + 8);
+    cols        = qFromLittleEndian<quint32>(map + 12);
+    win_length  = qFromLittleEndian<quint32>(map + 16);
+    block_size  = qFromLittleEndian<quint32>(map + 20);
+    block_count = qFromLittleEndian<quint32>(map + 24);
+    rule_set    = qFromLittleEndian<quint32>(map + 28);
+    entry_count = qFromLittleEndian<quint64>(map + 32);
+    offsets     = map + HEADER_SIZE;
+
+    if (rows * cols > Solver::MAX_CELLS || block_size == 0
+            || rule_set >= quint32(Rules::SET_COUNT)
+            || HEADER_SIZE + (qint64(block_count) + 1) * 8 > map_size
+            || entry_count > quint64(block_count) * block_size) {
+        error = QObject::tr("%1 is damaged").arg(file_name);
+        close();
+        return false;
+    }
+
+    rules = Rules::Set(rule_set);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// close()
+//
+// Unmaps the file and forgets any unpacked blocks
+///////////////////////////////////////////////////////////////////////
+void
+Tablebase::close()
+{
+    blocks.clear();
+
+    if (map)
+        file.unmap(map);
+    if (file.isOpen())
+        file.close();
+
+    map         = 0;
+    map_size    = 0;
+    offsets     = 0;
+    rows        = 0;
+    cols        = 0;
+    win_length  = 0;
+    rules       = Rules::STANDARD;
+    block_size  = 0;
+    block_count = 0;
+    entry_count = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Getters
+///////////////////////////////////////////////////////////////////////
+bool
+Tablebase::isOpen() const
+{
+    return map != 0;
+}
+
+QString
+Tablebase::errorString() const
+{
+    return error;
+}
+
+int
+Tablebase::getRows() const
+{
+    return rows;
+}
+
+int
+Tablebase::getCols() const
+{
+    return cols;
+}
+
+int
+Tablebase::getWinLength() const
+{
+    return win_length;
+}
+
+Rules::Set
+Tablebase::getRules() const
+{
+    return rules;
+}
+
+///////////////////////////////////////////////////////////////////////
+// fits(const Board &board)
+//
+// Returns: True if the board is the same size as the tablebase. The
+// caller has to make sure the rules match too.
+///////////////////////////////////////////////////////////////////////
+bool
+Tablebase::fits(const Board &board) const
+{
+    return isOpen()
+        && board.getRows() == rows
+        && board.getCols() == cols
+        && board.getWinLength() == win_length;
+}
+
+///////////////////////////////////////////////////////////////////////
+// probe(const Board &board)
+//
+// Parameters:  board       - The position to look up
+//
+// Returns: The packed Solver entry for the position, or 0 (UNKNOWN)
+// if it is not in the tablebase. Positions reached by playing out of
+// turn are never in the tablebase.
+///////////////////////////////////////////////////////////////////////
+unsigned char
+Tablebase::probe(const Board &board)
+{
+    if (!fits(board))
+        return 0;
+
+    quint64 rank = board.canonicalRank();
+
+    if (rank >= entry_count)
+        return 0;
+
+    const QByteArray *data = block(quint32(rank / block_size));
+    quint32           slot = quint32(rank % block_size);
+
+    if (!data || slot >= quint32(data->size()))
+        return 0;
+    return uchar(data->at(slot));
+}
+
+///////////////////////////////////////////////////////////////////////
+// describe(const Board &board)
+//
+// Parameters:  board       - The position to look up
+//
+// Returns: What the position is worth in words, for tooltips and the
+// command line. The table counts plies, but a child counts their own
+// moves, so that is what is said: a win in one ply is one move, and a
+// loss in two plies is one move and then the opponent's.
+///////////////////////////////////////////////////////////////////////
+QString
+Tablebase::describe(const Board &board)
+{
+    unsigned char entry    = probe(board);
+    int           moves    = (Solver::distanceOf(entry) + 1) / 2;
+    QString       player   = Rules::toMove(rules, board) == Board::X
+                             ? "X" : "O";
+
+    switch (Solver::valueOf(entry)) {
+    case Solver::WIN:
+        return QObject::tr("%1 can win in %2 moves").arg(player).arg(moves);
+    case Solver::LOSS:
+        return QObject::tr("%1 will lose in %2 moves").arg(player).arg(moves);
+    case Solver::DRAW:
+        return QObject::tr("%1 can hold a draw").arg(player);
+    default:
+        return QObject::tr("Not in the tablebase");
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// block(quint32 index)
+//
+// Parameters:  quint32     index       - Which block
+//
+// Returns: The unpacked block, or 0 if the file is damaged. The
+// pointer belongs to the cache and is only good until the next call.
+///////////////////////////////////////////////////////////////////////
+const QByteArray *
+Tablebase::block(quint32 index)
+{
+    if (index >= block_count)
+        return 0;
+
+    QByteArray *data = blocks.object(index);
+    if (data)
+        return data;
+
+    quint64 start = qFromLittleEndian<quint64>(offsets + index * 8);
+    quint64 end   = qFromLittleEndian<quint64>(offsets + (index + 1) * 8);
+
+    if (start > end || end > quint64(map_size))
+        return 0;
+
+    data = new QByteArray(qUncompress(map + start, int(end - start)));
+    blocks.insert(index, data);
+    return data;
+}
+
+///////////////////////////////////////////////////////////////////////
+// write(const Solver &solver, const QString &file_name, QString *error)
+//
+// Parameters:  solver      - A Solver that has finished solve()
+//              file_name   - Where to save the tablebase
+//              *error      - Set to the reason if writing fails
+//
+// Returns: True if the tablebase was written
+///////////////////////////////////////////////////////////////////////
+bool
+Tablebase::write(const Solver &solver, const QString &file_name,
+                 QString *error)
+{
+    const std::vector<unsigned char> &table = solver.getTable();
+    quint64                           entries = table.size();
+    quint32                           count = quint32((entries + BLOCK_SIZE - 1)
+                                                      / BLOCK_SIZE);
+    QList<QByteArray>                 packed;
+    QFile                             out(file_name);
+
+    if (entries == 0) {
+        if (error)
+            *error = QObject::tr("Nothing has been solved");
+        return false;
+    }
+
+    // Compress everything first so the offsets can go in front
+    for (quint32 i = 0; i < count; ++i) {
+        quint64 start  = quint64(i) * BLOCK_SIZE;
+        quint64 length = qMin<quint64>(BLOCK_SIZE, entries - start);
+
+        packed.append(qCompress(&table[start], int(length), 9));
+    }
+
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error)
+            *error = out.errorString();
+        return false;
+    }
+
+    QDataStream stream(&out);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    stream.writeRawData(TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC));
+    stream << quint32(solver.getRows()) << quint32(solver.getCols())
+           << quint32(solver.getWinLength()) << quint32(BLOCK_SIZE)
+           << quint32(count) << quint32(solver.getRules()) << entries;
+
+    quint64 offset = HEADER_SIZE + (quint64(count) + 1) * 8;
+    for (quint32 i = 0; i < count; ++i) {
+        stream << offset;
+        offset += packed[i].size();
+    }
+    stream << offset;
+
+    for (quint32 i = 0; i < count; ++i)
+        stream.writeRawData(packed[i].constData(), packed[i].size());
+
+    if (stream.status() != QDataStream::Ok || !out.flush()) {
+        if (error)
+            *error = out.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#ifndef WF_TABLEBASE_HH
+#define WF_TABLEBASE_HH
+
+///////////////////////////////////////////////////////////////////////
+// Tablebase.hh
+//
+// This file contains the declarations for the Tablebase class, which
+// saves a solved board to disk and answers questions about it later.
+//
+// The file is laid out as:
+//
+//      "XSNOSTB1"                  magic
+//      quint32 rows, cols, win_length, block_size, block_count
+//      quint32 rules                   Rules::Set, 0 for standard
+//      quint64 entry_count
+//      quint64 offsets[block_count + 1]
+//      compressed blocks
+//
+// All numbers are little endian. Each block holds block_size entries
+// of the Solver table, compressed with qCompress(). Opening a file
+// only maps it and reads the header, and a block is not decompressed
+// until somebody asks about a position inside it.
+///////////////////////////////////////////////////////////////////////
+
+#include <QCache>
+#include <QFile>
+#include <QString>
+
+#include "Board.hh"
+#include "Solver.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Tablebase
+//
+// A memory mapped, block compressed Solver table.
+///////////////////////////////////////////////////////////////////////
+class Tablebase
+{
+public:
+    enum {
+        BLOCK_SIZE   = 65536,                   // Entries per block
+        CACHE_BLOCKS = 32                       // Blocks kept unpacked
+    };
+
+    Tablebase();
+    ~Tablebase();
+
+    bool            open(const QString &file_name);
+    void            close();
+    bool            isOpen() const;
+    QString         errorString() const;
+
+    int             getRows() const;
+    int             getCols() const;
+    int             getWinLength() const;
+    Rules::Set      getRules() const;
+    bool            fits(const Board &board) const;
+
+    unsigned char   probe(const Board &board);  // Packed Solver entry
+    QString         describe(const Board &board);
+
+    static bool     write(const Solver &solver, const QString &file_name,
+                          QString *error = 0);
+
+private:
+    Tablebase(const Tablebase &);               // Not copyable
+    Tablebase &operator=(const Tablebase &);
+
+    const QByteArray *block(quint32 index);
+
+    QFile                       file;
+    uchar                      *map;            // The whole file
+    qint64                      map_size;
+    const uchar                *offsets;        // Block offset table
+    int                         rows;
+    int                         cols;
+    int                         win_length;
+    Rules::Set                  rules;
+    quint32                     block_size;
+    quint32                     block_count;
+    quint64                     entry_count;
+    QCache<quint32, QByteArray> blocks;         // Unpacked blocks
+    QString                     error;
+};
+
+#endif
@@ -0,0 +1,446 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <iostream>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QMutexLocker>
+#include <QResource>
+#include <QRunnable>
+
+#include "Theme.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Theme::Decoder
+//
+// Decodes one pack on the Theme's thread and hands it back. A prefetch
+// that has been overtaken by a newer one by the time its turn comes is
+// handed back empty instead, so running a finger down the list of
+// packs does not decode every pack along the way.
+///////////////////////////////////////////////////////////////////////
+class Theme::Decoder : public QRunnable
+{
+public:
+    Decoder(Theme *theme, Pack *pack) : theme(theme), pack(pack) {}
+    void        run();
+
+private:
+    Theme      *theme;
+    Pack       *pack;
+};
+
+///////////////////////////////////////////////////////////////////////
+// run()
+//
+// Reads every picture, the built in one where the pack has none, and
+// scales the pieces to the size of the spaces. QImage, unlike QPixmap,
+// may be used on any thread.
+///////////////////////////////////////////////////////////////////////
+void
+Theme::Decoder::run()
+{
+    if (theme->isStale(pack)) {
+        pack->skipped = true;
+        theme->finish(pack);
+        return;
+    }
+
+    for (int i = 0; i < Artwork::PICTURES; ++i) {
+        QString file_name = Artwork::fileName(Artwork::Picture(i));
+        QImage  image(pack->prefix + file_name);
+
+        if (image.isNull())
+            image.load(":/images/" + file_name);
+        // The format the pixmaps want, so installing them is a copy
+        pack->images[i] = image.convertToFormat(
+                              QImage::Format_ARGB32_Premultiplied);
+    }
+
+    if (pack->size != Artwork::BASE_SIZE) {
+        for (int i = 0; i < Artwork::PIECES; ++i) {
+            pack->pieces[i] = pack->images[i].scaled(pack->size, pack->size,
+                                                     Qt::KeepAspectRatio,
+                                                     Qt::SmoothTransformation);
+        }
+    }
+    theme->finish(pack);
+}
+
+///////////////////////////////////////////////////////////////////////
+// resourceRoot(int serial)
+//
+// Returns: Where a pack's .rcc file is put among the resources, a
+// different place for every decode so a pack being read again never
+// meets the one before it
+///////////////////////////////////////////////////////////////////////
+static QString
+resourceRoot(int serial)
+{
+    return "/theme" + QString::number(serial);
+}
+
+///////////////////////////////////////////////////////////////////////
+// Theme(const QString &directory, QObject *parent)
+//
+// Parameters:  directory   - Where the packs are
+//              parent
+//
+// Starts with the built in pictures, which Artwork already has.
+///////////////////////////////////////////////////////////////////////
+Theme::Theme(const QString &directory, QObject *parent) :
+    QObject(parent),
+    directory(directory),
+    current("default"),
+    current_size(Artwork::BASE_SIZE),
+    wanted_size(0),
+    ready(0),
+    newest(0),
+    watcher(new QFileSystemWatcher(this))
+{
+    pool.setMaxThreadCount(1);
+    reload_timer.setSingleShot(true);
+    reload_timer.setInterval(RELOAD_DELAY);
+
+    connect(watcher, SIGNAL(fileChanged(const QString &)),
+            this, SLOT(packChanged()));
+    connect(watcher, SIGNAL(directoryChanged(const QString &)),
+            this, SLOT(packChanged()));
+    connect(&reload_timer, SIGNAL(timeout()), this, SLOT(reload()));
+}
+
+///////////////////////////////////////////////////////////////////////
+// ~Theme()
+//
+// Waits for the pack being decoded, since it is handed back to us
+///////////////////////////////////////////////////////////////////////
+Theme::~Theme()
+{
+    pool.waitForDone();
+
+    foreach (Pack *pack, finished) {
+        if (!pack->archive.isEmpty())
+            QResource::unregisterResource(pack->archive,
+                                          resourceRoot(pack->serial));
+        delete pack;
+    }
+    delete ready;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getNames()
+//
+// Returns: "default", then every pack in the directory, by name
+///////////////////////////////////////////////////////////////////////
+QStringList
+Theme::getNames() const
+{
+    QStringList names("default");
+    QDir        dir(directory);
+
+    foreach (const QFileInfo &info,
+             dir.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot,
+                               QDir::Name)) {
+        if (info.isDir())
+            names << info.fileName();
+        else if (info.suffix() == "rcc")
+            names << info.completeBaseName();
+    }
+    return names;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getCurrent()
+//
+// Returns: The name of the pack in use
+///////////////////////////////////////////////////////////////////////
+QString
+Theme::getCurrent() const
+{
+    return current;
+}
+
+///////////////////////////////////////////////////////////////////////
+// prefetch(const QString &name, int size)
+//
+// Parameters:  name        - A pack that may be asked for soon
+//              size        - Width and height of a space
+//
+// Decodes the pack, unless it is in use or on its way already, and
+// keeps it in place of whatever was prefetched before.
+///////////////////////////////////////////////////////////////////////
+void
+Theme::prefetch(const QString &name, int size)
+{
+    QString key = name + '@' + QString::number(size);
+
+    if ((name == current && size == current_size)
+        || (ready && ready->name == name && ready->size == size)
+        || decoding.contains(key))
+        return;
+
+    decode(name, size, false);
+}
+
+///////////////////////////////////////////////////////////////////////
+// apply(const QString &name, int size)
+//
+// Parameters:  name        - The pack to use
+//              size        - Width and height of a space
+//
+// Puts the pack in straight away if it was prefetched, or as soon as it
+// is decoded if not. The pack asked for last is the one that wins.
+///////////////////////////////////////////////////////////////////////
+void
+Theme::apply(const QString &name, int size)
+{
+    QString key = name + '@' + QString::number(size);
+
+    if (name == current && size == current_size) {
+        wanted.clear();
+        return;
+    }
+
+    wanted      = name;
+    wanted_size = size;
+
+    if (ready && ready->name == name && ready->size == size) {
+        Pack *pack = ready;
+
+        ready = 0;
+        install(pack);
+    } else if (!decoding.contains(key)) {
+        decode(name, size, true);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// decode(const QString &name, int size, bool wanted)
+//
+// Parameters:  name        - The pack
+//              size        - Width and height of a space
+//              wanted      - It is to be put in, not just prefetched
+//
+// Hands the pack to our thread. A pack in an .rcc file is registered
+// here, on the GUI thread, and let go of when it comes back.
+///////////////////////////////////////////////////////////////////////
+void
+Theme::decode(const QString &name, int size, bool wanted)
+{
+    Pack   *pack = new Pack;
+    QString path = pathOf(name);
+
+    pack->name    = name;
+    pack->size    = size;
+    pack->wanted  = wanted;
+    pack->skipped = false;
+
+    mutex.lock();
+    pack->serial = ++newest;
+    mutex.unlock();
+
+    if (path.isEmpty()) {
+        pack->prefix = ":/images/";
+    } else if (QFileInfo(path).isDir()) {
+        pack->prefix = path + "/";
+    } else if (QResource::registerResource(path,
+                                           resourceRoot(pack->serial))) {
+        pack->archive = path;
+        pack->prefix  = ":" + resourceRoot(pack->serial) + "/";
+    } else {
+        // Every picture falls back to the built in one
+        std::cerr << qPrintable(path) << ": not a theme pack\n";
+    }
+
+    decoding << name + '@' + QString::number(size);
+    pool.start(new Decoder(this, pack));
+}
+
+///////////////////////////////////////////////////////////////////////
+// isStale(const Pack *pack)
+//
+// Returns: True if pack is only a prefetch and another pack has been
+// asked for since. Called from our thread.
+///////////////////////////////////////////////////////////////////////
+bool
+Theme::isStale(const Pack *pack)
+{
+    QMutexLocker lock(&mutex);
+
+    return !pack->wanted && pack->serial != newest;
+}
+
+///////////////////////////////////////////////////////////////////////
+// finish(Pack *pack)
+//
+// Parameters:  pack        - Decoded, or skipped
+//
+// Hands a pack back to the GUI thread. Called from our thread; packs
+// that finish together come back through one decoded().
+///////////////////////////////////////////////////////////////////////
+void
+Theme::finish(Pack *pack)
+{
+    bool first;
+
+    mutex.lock();
+    finished << pack;
+    first = finished.size() == 1;
+    mutex.unlock();
+
+    if (first)
+        QMetaObject::invokeMethod(this, "decoded", Qt::QueuedConnection);
+}
+
+///////////////////////////////////////////////////////////////////////
+// decoded()
+//
+// Takes the packs our thread has finished. The one that is wanted is
+// put in, any other is kept as the prefetched pack, and a wanted pack
+// that was skipped is decoded again.
+///////////////////////////////////////////////////////////////////////
+void
+Theme::decoded()
+{
+    QList<Pack *> packs;
+
+    mutex.lock();
+    packs = finished;
+    finished.clear();
+    mutex.unlock();
+
+    foreach (Pack *pack, packs) {
+        QString key     = pack->name + '@' + QString::number(pack->size);
+        bool    use     = pack->name == wanted && pack->size == wanted_size;
+
+        decoding.removeOne(key);
+        if (!pack->archive.isEmpty())
+            QResource::unregisterResource(pack->archive,
+                                          resourceRoot(pack->serial));
+
+        if (pack->skipped) {
+            if (use && !decoding.contains(key))
+                decode(wanted, wanted_size, true);
+            delete pack;
+        } else if (use) {
+            install(pack);
+        } else {
+            delete ready;
+            ready = pack;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// install(Pack *pack)
+//
+// Parameters:  pack        - Decoded, and ours to delete
+//
+// Swaps the pack's pictures into Artwork, throwing out the old ones,
+// and starts watching its files.
+///////////////////////////////////////////////////////////////////////
+void
+Theme::install(Pack *pack)
+{
+    Artwork::install(pack->images, pack->pieces, pack->size);
+    watch(pack->name);
+
+    current      = pack->name;
+    current_size = pack->size;
+    wanted.clear();
+    delete pack;
+
+    emit changed();
+}
+
+///////////////////////////////////////////////////////////////////////
+// watch(const QString &name)
+//
+// Parameters:  name        - The pack now in use
+//
+// Watches the pack's directory and every file in it, or its .rcc
+// file, in place of the pack watched before. It is watched afresh
+// after every reload, as saving a file often replaces it.
+///////////////////////////////////////////////////////////////////////
+void
+Theme::watch(const QString &name)
+{
+    QStringList paths = watcher->files() + watcher->directories();
+    QString     path  = pathOf(name);
+
+    if (!paths.isEmpty())
+        watcher->removePaths(paths);
+    if (path.isEmpty())
+        return;
+
+    watcher->addPath(path);
+    if (QFileInfo(path).isDir()) {
+        QDir dir(path);
+
+        foreach (const QString &file, dir.entryList(QDir::Files))
+            watcher->addPath(dir.filePath(file));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// packChanged()
+//
+// Waits for the pack in use to stop changing, since saving a picture
+// can take several writes
+///////////////////////////////////////////////////////////////////////
+void
+Theme::packChanged()
+{
+    reload_timer.start();
+}
+
+///////////////////////////////////////////////////////////////////////
+// reload()
+//
+// Decodes the pack in use again and puts it in
+///////////////////////////////////////////////////////////////////////
+void
+Theme::reload()
+{
+    if (current == "default")
+        return;
+
+    wanted      = current;
+    wanted_size = current_size;
+    decode(current, current_size, true);
+}
+
+///////////////////////////////////////////////////////////////////////
+// pathOf(const QString &name)
+//
+// Returns: The pack's directory or .rcc file, or nothing for "default"
+///////////////////////////////////////////////////////////////////////
+QString
+Theme::pathOf(const QString &name) const
+{
+    QDir dir(directory);
+
+    if (name == "default")
+        return QString();
+    if (QFileInfo(dir.filePath(name)).isDir())
+        return dir.filePath(name);
+    return dir.filePath(name + ".rcc");
+}
@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_THEME_HH
+#define WF_THEME_HH
+
+///////////////////////////////////////////////////////////////////////
+// Theme.hh
+//
+// This file contains the declarations for the Theme class, which
+// loads theme packs and puts them into the running game.
+///////////////////////////////////////////////////////////////////////
+
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+#include "Artwork.hh"
+
+class QFileSystemWatcher;
+
+///////////////////////////////////////////////////////////////////////
+// Theme
+//
+// A theme pack is a set of pictures with the same file names as the
+// ones in images/, either in a directory of its own or compiled into a
+// binary resource file with rcc -binary. The packs live together in
+// one directory, and a pack is named by its directory or by its .rcc
+// file without the .rcc. Pictures a pack leaves out are the built in
+// ones, and "default" is the built in pictures alone.
+//
+// The pictures are decoded into QImages on a thread of our own, with
+// the pieces already scaled to the size of the spaces, and come back
+// through the event loop. Artwork::install() then swaps them all in at
+// once and changed() tells the window to show them, so the game never
+// waits on a PNG. prefetch() decodes a pack before it is asked for,
+// as when it is highlighted in a list, and apply() of a prefetched
+// pack is over before the next paint. Only the pack in use and one
+// prefetched pack are kept; anything else is thrown away as soon as
+// it is decoded.
+//
+// The pack in use is watched, and whenever its files change it is
+// decoded and put in again, so an artist can see their work in the
+// game as they save it.
+///////////////////////////////////////////////////////////////////////
+class Theme : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum {
+        RELOAD_DELAY = 250                      // Milliseconds of quiet
+    };                                          // after a pack changes
+
+    Theme(const QString &directory, QObject *parent = 0);
+    ~Theme();
+
+    QStringList getNames() const;               // "default" first
+    QString     getCurrent() const;
+    void        prefetch(const QString &name, int size);
+    void        apply(const QString &name, int size);
+
+signals:
+    void        changed();                      // New pictures installed
+
+private slots:
+    void        decoded();
+    void        packChanged();
+    void        reload();
+
+private:
+    // One pack's pictures, decoded
+    struct Pack
+    {
+        QString     name;
+        int         size;                       // The pieces were scaled to
+        int         serial;                     // Which decode() it came from
+        QString     prefix;                     // Where its files are read
+        QString     archive;                    // Its .rcc file, if any
+        bool        wanted;                     // Decode even if a newer
+                                                // prefetch is waiting
+        bool        skipped;                    // It was not, so it is empty
+        QImage      images[Artwork::PICTURES];
+        QImage      pieces[Artwork::PIECES];
+    };
+
+    class Decoder;
+    friend class Decoder;
+
+    void        decode(const QString &name, int size, bool wanted);
+    bool        isStale(const Pack *pack);      // From the decoding thread
+    void        finish(Pack *pack);             // From the decoding thread
+    void        install(Pack *pack);
+    void        watch(const QString &name);
+    QString     pathOf(const QString &name) const;
+
+    QString     directory;                      // Where the packs are
+    QString     current;                        // Pack in use
+    int         current_size;
+
+    QString     wanted;                         // Install when decoded,
+    int         wanted_size;                    // empty for nothing
+    Pack       *ready;                          // Prefetched, or 0
+    QStringList decoding;                       // "name@size" in flight
+
+    QMutex      mutex;                          // Guards the rest
+    QList<Pack *> finished;                     // Waiting for decoded()
+    int         newest;                         // Serial of the last decode
+
+    QThreadPool pool;                           // One thread, in order
+    QFileSystemWatcher *watcher;
+    QTimer      reload_timer;
+};
+
+#endif
@@ -0,0 +1,631 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include <QAtomicInt>
+
+#include "Search.hh"
+#include "ThreatSearch.hh"
+
+///////////////////////////////////////////////////////////////////////
+// addUnique(std::vector<int> &cells, int cell)
+//
+// Adds a cell to a short list unless it is already there.
+///////////////////////////////////////////////////////////////////////
+static void
+addUnique(std::vector<int> &cells, int cell)
+{
+    if (std::find(cells.begin(), cells.end(), cell) == cells.end())
+        cells.push_back(cell);
+}
+
+///////////////////////////////////////////////////////////////////////
+// ThreatSearch()
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+ThreatSearch::ThreatSearch() :
+    root_moves(0),
+    win_move(-1),
+    four_win(false),
+    nodes(0),
+    node_limit(DEFAULT_NODES),
+    stopped(false),
+    stop_flag(0),
+    start_time(0),
+    deadline(0),
+    elapsed(0)
+{
+    open_fours[Board::EMPTY] = 0;
+    open_fours[Board::X]     = 0;
+    open_fours[Board::O]     = 0;
+
+    Failure empty = {0, -1};
+    failures.assign(size_t(1) << TABLE_BITS, empty);
+
+    for (int depth = 0; depth <= THREE_DEPTH; ++depth) {
+        threat_cells[depth].reserve(Board::MAX_CELLS);
+        below_cells[depth].reserve(Board::MAX_CELLS);
+        answer_cells[depth].reserve(Board::MAX_CELLS);
+    }
+    defence_used.reserve(Board::MAX_CELLS);
+    defence_answers.reserve(Board::MAX_CELLS);
+}
+
+///////////////////////////////////////////////////////////////////////
+// Getters
+///////////////////////////////////////////////////////////////////////
+bool
+ThreatSearch::isFourWin() const
+{
+    return four_win;
+}
+
+uint64_t
+ThreatSearch::getNodes() const
+{
+    return nodes;
+}
+
+int
+ThreatSearch::getElapsed() const
+{
+    return int(elapsed / 1000);
+}
+
+///////////////////////////////////////////////////////////////////////
+// setStopFlag(const QAtomicInt *flag)
+//
+// Parameters:  flag        - Polled with the clock; the search gives up
+//                            while it is non-zero. 0 for none.
+///////////////////////////////////////////////////////////////////////
+void
+ThreatSearch::setStopFlag(const QAtomicInt *flag)
+{
+    stop_flag = flag;
+}
+
+///////////////////////////////////////////////////////////////////////
+// findWin(const Board &board, int time_limit)
+//
+// Parameters:  board           - The position
+//              int time_limit  - Milliseconds allowed, 0 to stop after
+//                                DEFAULT_NODES positions instead
+//
+// Returns: The first move of a forced win for the player to move, or
+// -1 if none was found
+///////////////////////////////////////////////////////////////////////
+int
+ThreatSearch::findWin(const Board &board, int time_limit)
+{
+    Board::Cell attacker = board.toMove();
+
+    start(board, time_limit);
+
+    if (!board.isOver()) {
+        if (fours(attacker, FOUR_DEPTH, 0))
+            four_win = true;
+        else if (!threes(attacker, THREE_DEPTH, 0))
+            win_move = -1;
+    }
+
+    elapsed = Search::monotonicMicros() - start_time;
+    return win_move;
+}
+
+///////////////////////////////////////////////////////////////////////
+// findDefences(const Board &board, int *moves, int time_limit)
+//
+// Parameters:  board           - The position
+//              int *moves      - Filled with the moves worth trying,
+//                                which needs room for every cell
+//              int time_limit  - Milliseconds allowed, 0 to stop after
+//                                DEFAULT_NODES positions instead
+//
+// Returns: How many moves there are, or 0 if the opponent has no
+// forced win to stop
+//
+// Looks for a win the opponent would have if the player to move
+// passed. If there is one, only the cells it uses and the player's own
+// fours can stop it; anywhere else loses.
+///////////////////////////////////////////////////////////////////////
+int
+ThreatSearch::findDefences(const Board &board, int *moves, int time_limit)
+{
+    Board::Cell       defender = board.toMove();
+    Board::Cell       attacker = Board::opponent(defender);
+    std::vector<int> &used     = defence_used;
+    std::vector<int> &answers  = defence_answers;
+    int               count    = 0;
+
+    // resize() rather than clear(), which would give up the room
+    used.resize(0);
+    answers.resize(0);
+    start(board, time_limit);
+
+    // Nothing to defend if we can win on the spot
+    if (board.isOver() || open_fours[defender] > 0
+            || !threes(attacker, THREE_DEPTH, &used)) {
+        elapsed = Search::monotonicMicros() - start_time;
+        return 0;
+    }
+
+    for (unsigned i = 0; i < used.size(); ++i)
+        addUnique(answers, used[i]);
+
+    count = threatMoves(defender, FOUR, moves);
+    for (int i = 0; i < count; ++i)
+        addUnique(answers, moves[i]);
+
+    count = 0;
+    for (unsigned i = 0; i < answers.size(); ++i) {
+        if (board.getCell(answers[i]) == Board::EMPTY)
+            moves[count++] = answers[i];
+    }
+
+    elapsed = Search::monotonicMicros() - start_time;
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// start(const Board &board, int time_limit)
+//
+// Takes a copy of the board and builds the pattern tables for it from
+// scratch. From here on they are only updated a line at a time.
+///////////////////////////////////////////////////////////////////////
+void
+ThreatSearch::start(const Board &board, int time_limit)
+{
+    int cells = board.getCellCount();
+
+    // What we know about other sizes of board is no use here
+    if (this->board.getRows() != board.getRows()
+            || this->board.getCols() != board.getCols()
+            || this->board.getWinLength() != board.getWinLength()) {
+        Failure empty = {0, -1};
+        failures.assign(failures.size(), empty);
+    }
+
+    this->board = board;
+    root_moves  = board.getMoveCount();
+    win_move    = -1;
+    four_win    = false;
+    nodes       = 0;
+    stopped     = false;
+    start_time  = Search::monotonicMicros();
+    deadline    = time_limit > 0 ? start_time + int64_t(time_limit) * 1000 : 0;
+    node_limit  = time_limit > 0 ? ~uint64_t(0) : uint64_t(DEFAULT_NODES);
+
+    for (int p = Board::X; p <= Board::O; ++p) {
+        open_fours[p] = 0;
+        for (int level = 0; level < LEVELS; ++level)
+            patterns[p][level].assign(cells, 0);
+    }
+
+    for (int line = 0; line < board.getLineCount(); ++line)
+        addLine(line, 1);
+}
+
+///////////////////////////////////////////////////////////////////////
+// addLine(int line, int sign)
+//
+// Parameters:  int     line    - The line
+//              int     sign    - 1 to add what the line contributes to
+//                                the pattern tables, -1 to take it out
+///////////////////////////////////////////////////////////////////////
+void
+ThreatSearch::addLine(int line, int sign)
+{
+    int        length = board.getWinLength();
+    const int *cells  = board.getLineCells(line);
+
+    for (int p = Board::X; p <= Board::O; ++p) {
+        Board::Cell player = Board::Cell(p);
+        int         mine   = board.getLinePieces(line, player);
+        int         theirs = board.getLinePieces(line, Board::opponent(player));
+        int         level  = length - 1 - mine;
+
+        // Only lines that are ours alone and nearly full matter
+        if (theirs > 0 || mine == 0 || level < 0 || level >= LEVELS)
+            continue;
+
+        if (level == FIVE)
+            open_fours[p] += sign;
+
+        for (int i = 0; i < length; ++i) {
+            if (board.getCell(cells[i]) == Board::EMPTY)
+                patterns[p][level][cells[i]] += sign;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// update(int cell, int sign)
+//
+// Adds or takes out every line through a cell, the only lines a piece
+// there can change.
+///////////////////////////////////////////////////////////////////////
+void
+ThreatSearch::update(int cell, int sign)
+{
+    const std::vector<int> &through = board.getLinesThrough(cell);
+
+    for (unsigned i = 0; i < through.size(); ++i)
+        addLine(through[i], sign);
+}
+
+///////////////////////////////////////////////////////////////////////
+// play(int cell, Board::Cell player)
+// takeBack(int cell)
+//
+// Makes or unmakes a move, keeping the pattern tables up to date.
+///////////////////////////////////////////////////////////////////////
+void
+ThreatSearch::play(int cell, Board::Cell player)
+{
+    update(cell, -1);
+    board.place(cell, player);
+    update(cell, 1);
+}
+
+void
+ThreatSearch::takeBack(int cell)
+{
+    update(cell, -1);
+    board.remove(cell);
+    update(cell, 1);
+}
+
+///////////////////////////////////////////////////////////////////////
+// pattern(Board::Cell player, Level level, int cell)
+//
+// Returns: How many lines a piece of player's on cell would make into
+// a line of that level
+///////////////////////////////////////////////////////////////////////
+int
+ThreatSearch::pattern(Board::Cell player, Level level, int cell) const
+{
+    return patterns[player][level][cell];
+}
+
+///////////////////////////////////////////////////////////////////////
+// winCells(Board::Cell player, int *cells, int limit)
+//
+// Parameters:  player      - X or O
+//              int *cells  - Filled with cells that would win for player
+//              int limit   - Stop after this many
+//
+// Returns: How many were found
+///////////////////////////////////////////////////////////////////////
+int
+ThreatSearch::winCells(Board::Cell player, int *cells, int limit) const
+{
+    int count = 0;
+
+    if (open_fours[player] == 0)
+        return 0;
+
+    for (int i = 0; i < board.getCellCount() && count < limit; ++i) {
+        if (patterns[player][FIVE][i] > 0)
+            cells[count++] = i;
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// winCellsThrough(int cell, Board::Cell player, int *cells)
+//
+// Parameters:  int cell    - Where player just played
+//              player      - X or O
+//              int *cells  - Filled with the cells that would now win
+//
+// Returns: How many different cells there are. Only lines through
+// cell are looked at, so this is quick.
+///////////////////////////////////////////////////////////////////////
+int
+ThreatSearch::winCellsThrough(int cell, Board::Cell player, int *cells) const
+{
+    const std::vector<int> &through = board.getLinesThrough(cell);
+    int                     length  = board.getWinLength();
+    Board::Cell             other   = Board::opponent(player);
+    int                     count   = 0;
+
+    for (unsigned i = 0; i < through.size(); ++i) {
+        int line = through[i];
+
+        if (board.getLinePieces(line, player) != length - 1
+                || board.getLinePieces(line, other) != 0)
+            continue;
+
+        const int *line_cells = board.getLineCells(line);
+
+        for (int j = 0; j < length; ++j) {
+            int c = line_cells[j];
+
+            if (board.getCell(c) == Board::EMPTY
+                    && std::find(cells, cells + count, c) == cells + count)
+                cells[count++] = c;
+        }
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// threatMoves(Board::Cell player, Level level, int *moves)
+//
+// Parameters:  player      - X or O
+//              level       - FOUR or THREE
+//              int *moves  - Filled with the moves making that level
+//
+// Returns: How many moves there are. They are sorted so moves that make
+// the most threats at once come first, and lower cells first among
+// equals. Moves that make a four are left out when asking for threes.
+//
+// Each move is sorted as one int, how few threats it makes above the
+// cell number, so the sort needs nothing but an array on the stack.
+///////////////////////////////////////////////////////////////////////
+int
+ThreatSearch::threatMoves(Board::Cell player, Level level, int *moves) const
+{
+    const std::vector<unsigned char> &fours  = patterns[player][FOUR];
+    const std::vector<unsigned char> &threes = patterns[player][THREE];
+    const int                         most   = 1 << 16;
+    int                               sorted[Board::MAX_CELLS];
+    int                               count  = 0;
+
+    for (int i = 0; i < board.getCellCount(); ++i) {
+        int threats = 0;
+
+        if (level == FOUR && fours[i] > 0)
+            threats = fours[i] * 16 + threes[i];
+        else if (level == THREE && fours[i] == 0 && threes[i] > 0)
+            threats = threes[i];
+        if (threats > 0)
+            sorted[count++] = (most - threats) * Board::MAX_CELLS + i;
+    }
+
+    std::sort(sorted, sorted + count);
+
+    for (int i = 0; i < count; ++i)
+        moves[i] = sorted[i] % Board::MAX_CELLS;
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// fours(Board::Cell attacker, int depth, std::vector<int> *used)
+//
+// Parameters:  attacker    - Who is trying to win, and to move
+//              int depth   - Fours the attacker may still play
+//              used        - If not 0, the cells the win needs are
+//                            added to it
+//
+// Returns: True if the attacker wins by playing nothing but fours,
+// each of which the defender has exactly one way to block
+///////////////////////////////////////////////////////////////////////
+bool
+ThreatSearch::fours(Board::Cell attacker, int depth, std::vector<int> *used)
+{
+    Board::Cell defender = Board::opponent(attacker);
+    int         moves[Board::MAX_CELLS];
+    int         wins[Board::MAX_CELLS];
+    int         count;
+
+    if ((++nodes & CHECK_NODES) == 0 && outOfTime())
+        stopped = true;
+    if (stopped)
+        return false;
+
+    // Already one move from a line
+    if (winCells(attacker, wins, 1) > 0) {
+        if (board.getMoveCount() == root_moves)
+            win_move = wins[0];
+        if (used)
+            used->push_back(wins[0]);
+        return true;
+    }
+
+    if (depth <= 0)
+        return false;
+
+    Failure &known = failure(attacker);
+
+    if (known.key == failureKey(attacker) && known.depth >= depth)
+        return false;
+
+    // A four of the defender's has to be blocked, by a four of our own
+    count = winCells(defender, wins, 2);
+    if (count > 1)
+        return false;
+    if (count == 1) {
+        if (pattern(attacker, FOUR, wins[0]) == 0)
+            return false;
+        moves[0] = wins[0];
+    } else {
+        count = threatMoves(attacker, FOUR, moves);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        int  move  = moves[i];
+        bool won   = false;
+
+        play(move, attacker);
+
+        int replies = winCellsThrough(move, attacker, wins);
+
+        if (open_fours[defender] == 0) {
+            if (replies >= 2) {
+                won = true;
+                if (used) {
+                    used->push_back(wins[0]);
+                    used->push_back(wins[1]);
+                }
+            } else if (replies == 1) {
+                int reply = wins[0];
+
+                play(reply, defender);
+                won = fours(attacker, depth - 1, used);
+                takeBack(reply);
+
+                if (won && used)
+                    used->push_back(reply);
+            }
+        }
+
+        takeBack(move);
+
+        if (won) {
+            if (board.getMoveCount() == root_moves)
+                win_move = move;
+            if (used)
+                used->push_back(move);
+            return true;
+        }
+        if (stopped)
+            return false;
+    }
+
+    // The table may have been overwritten further down
+    Failure &slot = failure(attacker);
+
+    slot.key   = failureKey(attacker);
+    slot.depth = depth;
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////
+// threes(Board::Cell attacker, int depth, std::vector<int> *used)
+//
+// Parameters:  attacker    - Who is trying to win, and to move
+//              int depth   - Threes the attacker may still play
+//              used        - If not 0, the cells the win needs are
+//                            added to it
+//
+// Returns: True if the attacker wins with fours and threes. After each
+// three the defender tries every cell the threatened win would use and
+// every four of their own.
+///////////////////////////////////////////////////////////////////////
+bool
+ThreatSearch::threes(Board::Cell attacker, int depth, std::vector<int> *used)
+{
+    Board::Cell defender = Board::opponent(attacker);
+    int         moves[Board::MAX_CELLS];
+    int         count;
+
+    if (fours(attacker, FOUR_DEPTH, used))
+        return true;
+    if (depth <= 0 || stopped)
+        return false;
+
+    // A four of the defender's has to be blocked first
+    count = winCells(defender, moves, 2);
+    if (count > 1)
+        return false;
+    if (count == 0)
+        count = std::min(threatMoves(attacker, THREE, moves),
+                         int(MAX_THREATS));
+
+    // Kept for each depth, as the answers below use their own
+    std::vector<int> &threat  = threat_cells[depth];
+    std::vector<int> &below   = below_cells[depth];
+    std::vector<int> &answers = answer_cells[depth];
+
+    for (int i = 0; i < count; ++i) {
+        int  move = moves[i];
+        bool won;
+
+        threat.resize(0);
+        below.resize(0);
+        answers.resize(0);
+        play(move, attacker);
+
+        // It is only a threat if we would win with fours after a pass
+        won = open_fours[defender] == 0
+              && fours(attacker, FOUR_DEPTH, &threat);
+
+        if (won) {
+            int counters[Board::MAX_CELLS];
+            int counter_count;
+
+            for (unsigned j = 0; j < threat.size(); ++j)
+                addUnique(answers, threat[j]);
+
+            counter_count = threatMoves(defender, FOUR, counters);
+            for (int j = 0; j < counter_count; ++j)
+                addUnique(answers, counters[j]);
+
+            for (unsigned j = 0; j < answers.size() && won; ++j) {
+                play(answers[j], defender);
+                won = threes(attacker, depth - 1, &below);
+                takeBack(answers[j]);
+            }
+
+            if (won && used) {
+                used->push_back(move);
+                used->insert(used->end(), answers.begin(), answers.end());
+                used->insert(used->end(), below.begin(), below.end());
+            }
+        }
+
+        takeBack(move);
+
+        if (won) {
+            if (board.getMoveCount() == root_moves)
+                win_move = move;
+            return true;
+        }
+        if (stopped)
+            return false;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////
+// failureKey(Board::Cell attacker)
+// failure(Board::Cell attacker)
+//
+// Returns: The key for the current position with attacker trying to
+// win, and the table slot it goes in
+///////////////////////////////////////////////////////////////////////
+uint64_t
+ThreatSearch::failureKey(Board::Cell attacker) const
+{
+    return board.hash() ^ (attacker == Board::X ? 0 : 0x9e3779b97f4a7c15ULL);
+}
+
+ThreatSearch::Failure &
+ThreatSearch::failure(Board::Cell attacker)
+{
+    return failures[failureKey(attacker) & ((uint64_t(1) << TABLE_BITS) - 1)];
+}
+
+///////////////////////////////////////////////////////////////////////
+// outOfTime()
+//
+// Returns: True if the time or the node budget has run out, or the
+// stop flag is up
+///////////////////////////////////////////////////////////////////////
+bool
+ThreatSearch::outOfTime()
+{
+    if (nodes >= node_limit || (stop_flag && *stop_flag != 0))
+        return true;
+    return deadline != 0 && Search::monotonicMicros() >= deadline;
+}
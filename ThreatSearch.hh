@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+#ifndef WF_THREATSEARCH_HH
+#define WF_THREATSEARCH_HH
+
+///////////////////////////////////////////////////////////////////////
+// ThreatSearch.hh
+//
+// This file contains the declarations for the ThreatSearch class,
+// which looks for forced wins on big boards.
+///////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <stdint.h>
+
+#include "Board.hh"
+
+class QAtomicInt;
+
+///////////////////////////////////////////////////////////////////////
+// ThreatSearch
+//
+// A threat-space search for five in a row and the like. Instead of
+// every move, the attacker only tries threats: fours, which leave one
+// cell to complete a line, and threes, which would make a winning four
+// if the defender let them. The defender only tries the moves that
+// could spoil the threat. That tree is small enough to find wins many
+// moves deep in a few milliseconds.
+//
+// Fours are tried on their own first, since the defender's answer to
+// each is forced. Threes are then mixed in; a three counts as a threat
+// only if the attacker could win with fours alone after it, and the
+// defender's answers are the cells that win used plus any four of the
+// defender's own. That makes the wins it finds very reliable but not
+// proofs, as some odd defences are not looked at.
+//
+// For each player and empty cell the search keeps how many lines would
+// become a five, a four, or a three with a piece there. Placing a
+// piece only changes lines through it, so only those are updated.
+// Positions where fours alone do not win are remembered, as the same
+// ones come up again and again in different orders. Nothing is
+// allocated at the nodes: moves are sorted in arrays on the stack, and
+// the lists of cells a win needs are kept from one search to the next.
+//
+// Run inside a Search, it gives up when the Search is stopped, through
+// the flag given to setStopFlag().
+///////////////////////////////////////////////////////////////////////
+class ThreatSearch
+{
+public:
+    // What a piece on an empty cell would make
+    enum Level {FIVE, FOUR, THREE, LEVELS};
+
+    enum {
+        FOUR_DEPTH    = 12,                     // Attacker fours in a row
+        THREE_DEPTH   = 3,                      // Threes along the way
+        MAX_THREATS   = 16,                     // Threes tried per node
+        DEFAULT_NODES = 200000,                 // Budget with no time limit
+        CHECK_NODES   = 63,                     // Look at the clock this often
+        TABLE_BITS    = 16                      // Remembered failures
+    };
+
+    ThreatSearch();
+
+    int         findWin(const Board &board, int time_limit = 0);
+    int         findDefences(const Board &board, int *moves,
+                             int time_limit = 0);
+    bool        isFourWin() const;              // Last win needed no threes
+    uint64_t    getNodes() const;
+    int         getElapsed() const;             // Milliseconds
+    void        setStopFlag(const QAtomicInt *flag); // Non-zero to give up
+
+private:
+    // A position where the attacker can not win with fours
+    struct Failure
+    {
+        uint64_t    key;
+        int         depth;
+    };
+
+    void        start(const Board &board, int time_limit);
+    void        play(int cell, Board::Cell player);
+    void        takeBack(int cell);
+    void        addLine(int line, int sign);
+    void        update(int cell, int sign);
+    int         pattern(Board::Cell player, Level level, int cell) const;
+    int         winCells(Board::Cell player, int *cells, int limit) const;
+    int         winCellsThrough(int cell, Board::Cell player,
+                                int *cells) const;
+    int         threatMoves(Board::Cell player, Level level,
+                            int *moves) const;
+    bool        fours(Board::Cell attacker, int depth,
+                      std::vector<int> *used);
+    bool        threes(Board::Cell attacker, int depth,
+                       std::vector<int> *used);
+    bool        outOfTime();
+    uint64_t    failureKey(Board::Cell attacker) const;
+    Failure    &failure(Board::Cell attacker);
+
+    Board               board;                  // Our own copy to play on
+    int                 root_moves;             // Moves on the board at start
+    int                 win_move;               // First move of the win
+    bool                four_win;
+
+    // patterns[player][level][cell], lines a piece there would make
+    std::vector<unsigned char> patterns[3][LEVELS];
+    int                 open_fours[3];          // Lines one short, unblocked
+    std::vector<Failure> failures;              // Kept between searches
+
+    // Lists threes() fills at each depth, and findDefences() at the
+    // top, kept so that once they have grown nothing is allocated
+    std::vector<int>    threat_cells[THREE_DEPTH + 1];
+    std::vector<int>    below_cells[THREE_DEPTH + 1];
+    std::vector<int>    answer_cells[THREE_DEPTH + 1];
+    std::vector<int>    defence_used;
+    std::vector<int>    defence_answers;
+
+    uint64_t            nodes;
+    uint64_t            node_limit;
+    bool                stopped;
+    const QAtomicInt   *stop_flag;              // Not ours, or 0
+    int64_t             start_time;
+    int64_t             deadline;               // 0 for none
+    int64_t             elapsed;
+};
+
+#endif
@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QPainter>
+
+#include "Thumbnail.hh"
+
+QImage     Thumbnail::pieces[3];
+QAtomicInt Thumbnail::failures;
+
+///////////////////////////////////////////////////////////////////////
+// Thumbnail(const std::string &cells, int rows, int cols,
+//           const QString &file_name)
+//
+// Parameters:  cells       - The board, as from Board::toString()
+//              rows        - Rows on the board
+//              cols        - Columns on the board
+//              file_name   - Where to save the PNG
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+Thumbnail::Thumbnail(const std::string &cells, int rows, int cols,
+                     const QString &file_name) :
+    cells(cells),
+    rows(rows),
+    cols(cols),
+    file_name(file_name)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// run()
+//
+// Draws the board and saves it. Called on a pool thread.
+///////////////////////////////////////////////////////////////////////
+void
+Thumbnail::run()
+{
+    if (!render(cells, rows, cols).save(file_name, "PNG"))
+        failures.ref();
+}
+
+///////////////////////////////////////////////////////////////////////
+// loadArtwork()
+//
+// Loads the piece images from the resources. Must be called before any
+// thumbnail is drawn, and not while any are being drawn.
+//
+// Returns: False if an image is missing
+///////////////////////////////////////////////////////////////////////
+bool
+Thumbnail::loadArtwork()
+{
+    return pieces[0].load(":/images/empty.png")
+        && pieces[1].load(":/images/x.png")
+        && pieces[2].load(":/images/o.png");
+}
+
+///////////////////////////////////////////////////////////////////////
+// render(const std::string &cells, int rows, int cols)
+//
+// Parameters:  cells       - The board, as from Board::toString()
+//              rows        - Rows on the board
+//              cols        - Columns on the board
+//
+// Returns: A picture of the board. Each space is painted white with
+// its piece on top, just as GameSpace::paintEvent() does.
+///////////////////////////////////////////////////////////////////////
+QImage
+Thumbnail::render(const std::string &cells, int rows, int cols)
+{
+    QImage   image(cols * SPACE_SIZE, rows * SPACE_SIZE,
+                   QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+
+    image.fill(0xffffffff);
+
+    for (int i = 0; i < rows * cols && i < int(cells.size()); ++i) {
+        int piece = cells[i] == 'X' ? 1 : cells[i] == 'O' ? 2 : 0;
+
+        painter.drawImage(QRect((i % cols) * SPACE_SIZE,
+                                (i / cols) * SPACE_SIZE,
+                                SPACE_SIZE, SPACE_SIZE), pieces[piece]);
+    }
+    painter.end();
+    return image;
+}
+
+///////////////////////////////////////////////////////////////////////
+// getFailures()
+//
+// Returns: How many thumbnails could not be saved so far
+///////////////////////////////////////////////////////////////////////
+int
+Thumbnail::getFailures()
+{
+    return int(failures);
+}
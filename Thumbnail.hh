@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_THUMBNAIL_HH
+#define WF_THUMBNAIL_HH
+
+///////////////////////////////////////////////////////////////////////
+// Thumbnail.hh
+//
+// This file contains the declarations for the Thumbnail class, which
+// draws a board to a PNG file without a screen.
+///////////////////////////////////////////////////////////////////////
+
+#include <QAtomicInt>
+#include <QImage>
+#include <QRunnable>
+#include <QString>
+#include <string>
+
+///////////////////////////////////////////////////////////////////////
+// Thumbnail
+//
+// Draws one board with the same artwork and layout as the GameSpaces,
+// and saves it. It only uses QImage and QPainter, which may be used
+// on any thread, so thumbnails can be handed to a QThreadPool. The
+// artwork has to be loaded on the main thread first.
+///////////////////////////////////////////////////////////////////////
+class Thumbnail : public QRunnable
+{
+public:
+    enum {SPACE_SIZE = 60};                     // Same as a GameSpace
+
+    Thumbnail(const std::string &cells, int rows, int cols,
+              const QString &file_name);
+    void            run();
+
+    static bool     loadArtwork();
+    static QImage   render(const std::string &cells, int rows, int cols);
+    static int      getFailures();              // Files not saved
+
+private:
+    std::string     cells;                      // Board::toString()
+    int             rows;
+    int             cols;
+    QString         file_name;
+
+    static QImage     pieces[3];                // EMPTY, X, O
+    static QAtomicInt failures;
+};
+
+#endif
@@ -0,0 +1,666 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QRunnable>
+#include <QThreadPool>
+#include <QTime>
+#include <math.h>
+#include <iostream>
+
+#include "Tournament.hh"
+#include "Search.hh"
+
+// Chance of a wrong verdict either way, and the bounds they give the
+// log likelihood ratio
+static const double ERROR_RATE  = 0.05;
+static const double LOWER_BOUND = log(ERROR_RATE / (1 - ERROR_RATE));
+static const double UPPER_BOUND = log((1 - ERROR_RATE) / ERROR_RATE);
+
+///////////////////////////////////////////////////////////////////////
+// random(quint64 &state)
+//
+// Returns: The next number from splitmix64
+///////////////////////////////////////////////////////////////////////
+static quint64
+random(quint64 &state)
+{
+    quint64 z = (state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+///////////////////////////////////////////////////////////////////////
+// Tournament::Worker
+//
+// Plays games on one thread of the pool until there are none left.
+// Everything a game needs is the worker's own, so games on different
+// threads never touch the same memory.
+///////////////////////////////////////////////////////////////////////
+class Tournament::Worker : public QRunnable
+{
+public:
+    Worker(Tournament *tournament, quint64 seed);
+    ~Worker();
+
+    void        run();
+
+private:
+    Board::Cell play(int x, int o, const QVector<Move> &opening);
+    int         randomMove(const Board &board);
+    int         greedyMove(Board &board);
+
+    Tournament         *tournament;
+    QVector<Search *>   searches;               // By player, 0 if it
+                                                // does not search
+    quint64             state;                  // For random choices
+};
+
+///////////////////////////////////////////////////////////////////////
+// Worker(Tournament *tournament, quint64 seed)
+//
+// Parameters:  tournament  - Where the work comes from
+//              seed        - For the random player and greedy ties
+///////////////////////////////////////////////////////////////////////
+Tournament::Worker::Worker(Tournament *tournament, quint64 seed) :
+    tournament(tournament),
+    state(seed)
+{
+    for (int i = 0; i < tournament->players.size(); ++i) {
+        searches.append(tournament->players[i].kind == SEARCH
+                        ? new Search(TABLE_BITS) : 0);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// ~Worker()
+//
+// Destructor
+///////////////////////////////////////////////////////////////////////
+Tournament::Worker::~Worker()
+{
+    qDeleteAll(searches);
+}
+
+///////////////////////////////////////////////////////////////////////
+// run()
+//
+// Plays each opening it is given both ways round
+///////////////////////////////////////////////////////////////////////
+void
+Tournament::Worker::run()
+{
+    int pairing;
+    int opening;
+
+    while (tournament->next(&pairing, &opening)) {
+        int                  a     = tournament->pairings[pairing].a;
+        int                  b     = tournament->pairings[pairing].b;
+        const QVector<Move> &moves = tournament->openings[opening];
+        Board::Cell          first = play(a, b, moves);
+
+        tournament->finish(pairing, first, play(b, a, moves));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// play(int x, int o, const QVector<Move> &opening)
+//
+// Parameters:  x, o        - The players, by number
+//              opening     - The moves the game starts with
+//
+// Returns: Who won, or EMPTY for a draw
+///////////////////////////////////////////////////////////////////////
+Board::Cell
+Tournament::Worker::play(int x, int o, const QVector<Move> &opening)
+{
+    Board board(tournament->rows, tournament->cols, tournament->win_length);
+
+    for (int i = 0; i < opening.size(); ++i) {
+        board.place(opening[i].row * tournament->cols + opening[i].col,
+                    Board::Cell(opening[i].state));
+    }
+
+    while (!board.isOver()) {
+        int             number = board.toMove() == Board::X ? x : o;
+        const Player   &player = tournament->players[number];
+        int             cell;
+
+        switch (player.kind) {
+        case RANDOM:    cell = randomMove(board);                   break;
+        case GREEDY:    cell = greedyMove(board);                   break;
+        default:
+            cell = searches[number]->findMove(board, player.depth);
+            break;
+        }
+
+        if (cell < 0)
+            break;
+        board.place(cell, board.toMove());
+    }
+
+    return board.hasLine(Board::X) ? Board::X
+         : board.hasLine(Board::O) ? Board::O : Board::EMPTY;
+}
+
+///////////////////////////////////////////////////////////////////////
+// randomMove(const Board &board)
+//
+// Returns: Any empty space
+///////////////////////////////////////////////////////////////////////
+int
+Tournament::Worker::randomMove(const Board &board)
+{
+    int pick = int(random(state)
+                   % quint64(board.getPieceCount(Board::EMPTY)));
+
+    for (int cell = 0; cell < board.getCellCount(); ++cell) {
+        if (board.getCell(cell) == Board::EMPTY && pick-- == 0)
+            return cell;
+    }
+    return -1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// greedyMove(Board &board)
+//
+// Returns: A winning move if there is one, otherwise one that stops
+// the opponent winning next move, otherwise whichever scores best
+// straight away, picking at random between equals
+///////////////////////////////////////////////////////////////////////
+int
+Tournament::Worker::greedyMove(Board &board)
+{
+    Board::Cell me    = board.toMove();
+    Board::Cell them  = Board::opponent(me);
+    int         block = -1;
+    int         best  = -1;
+    int         best_score = 0;
+    int         ties  = 0;
+
+    for (int cell = 0; cell < board.getCellCount(); ++cell) {
+        if (board.getCell(cell) != Board::EMPTY)
+            continue;
+        if (board.completesLine(cell, me))
+            return cell;
+        if (block < 0 && board.completesLine(cell, them))
+            block = cell;
+    }
+    if (block >= 0)
+        return block;
+
+    for (int cell = 0; cell < board.getCellCount(); ++cell) {
+        if (board.getCell(cell) != Board::EMPTY)
+            continue;
+
+        board.place(cell, me);
+        int score = Search::evaluate(board, me);
+        board.remove(cell);
+
+        if (best < 0 || score > best_score) {
+            best       = cell;
+            best_score = score;
+            ties       = 1;
+        } else if (score == best_score && random(state) % ++ties == 0) {
+            best = cell;
+        }
+    }
+    return best;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Tournament(int rows, int cols, int win_length)
+//
+// Parameters:  rows, cols  - Size of the board
+//              win_length  - How many in a row wins
+///////////////////////////////////////////////////////////////////////
+Tournament::Tournament(int rows, int cols, int win_length) :
+    rows(rows),
+    cols(cols),
+    win_length(win_length),
+    next_pairing(0),
+    games(0),
+    elapsed(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// addPlayer(const QString &name)
+//
+// Parameters:  name        - random, greedy, or depth{n}
+//
+// Returns: False if there is no such player
+///////////////////////////////////////////////////////////////////////
+bool
+Tournament::addPlayer(const QString &name)
+{
+    Player player;
+
+    player.name  = name;
+    player.depth = 0;
+
+    if (name == "random") {
+        player.kind = RANDOM;
+    } else if (name == "greedy") {
+        player.kind = GREEDY;
+    } else if (name.startsWith("depth")) {
+        player.kind  = SEARCH;
+        player.depth = name.mid(5).toInt();
+        if (player.depth < 1 || player.depth > Search::MAX_PLY) {
+            error = name + ": bad depth";
+            return false;
+        }
+    } else {
+        error = name + ": no such player";
+        return false;
+    }
+
+    players.append(player);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// loadOpenings(const QString &file_name)
+//
+// Parameters:  file_name   - A log of games, one per line
+//
+// Takes the first OPENING_PLIES moves of each game in the log, leaving
+// out repeats, games too short to have that many, and games that are
+// not for this board.
+//
+// Returns: False if the file could not be read or held no openings
+///////////////////////////////////////////////////////////////////////
+bool
+Tournament::loadOpenings(const QString &file_name)
+{
+    QFile log(file_name);
+
+    if (!log.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = file_name + ": " + log.errorString();
+        return false;
+    }
+
+    QTextStream     in(&log);
+    QStringList     seen;
+    QVector<Move>   moves;
+    Board           board(rows, cols, win_length);
+
+    while (!in.atEnd()) {
+        if (!GameLog::parseGame(in.readLine(), &moves)
+                || moves.size() <= OPENING_PLIES)
+            continue;
+
+        moves.resize(OPENING_PLIES);
+
+        QString line = GameLog::formatGame(moves);
+
+        if (!GameLog::replay(moves, &board) || board.isOver()
+                || seen.contains(line))
+            continue;
+        seen.append(line);
+        openings.append(moves);
+    }
+
+    if (openings.isEmpty()) {
+        error = file_name + ": no openings for this board";
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// makeOpenings()
+//
+// Uses every possible pair of first moves as the openings
+///////////////////////////////////////////////////////////////////////
+void
+Tournament::makeOpenings()
+{
+    int             cells = rows * cols;
+    QVector<Move>   moves(2);
+
+    moves[0].state = GameSpace::X;
+    moves[1].state = GameSpace::O;
+
+    for (int first = 0; first < cells; ++first) {
+        for (int second = 0; second < cells; ++second) {
+            if (second == first)
+                continue;
+            moves[0].row = first / cols;
+            moves[0].col = first % cols;
+            moves[1].row = second / cols;
+            moves[1].col = second % cols;
+            openings.append(moves);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// run(const QString &file_name, int threads)
+//
+// Parameters:  file_name   - Where the results go
+//              threads     - How many games to play at once, 0 for one
+//                            per core
+//
+// Plays every pairing until it is decided.
+//
+// Returns: False if the results could not be written
+///////////////////////////////////////////////////////////////////////
+bool
+Tournament::run(const QString &file_name, int threads)
+{
+    if (players.size() < 2) {
+        error = "a tournament needs two players";
+        return false;
+    }
+
+    file.setFileName(file_name);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate
+                   | QIODevice::Text)) {
+        error = file_name + ": " + file.errorString();
+        return false;
+    }
+    out.setDevice(&file);
+
+    if (openings.isEmpty())
+        makeOpenings();
+
+    // Players who never choose at random play the same game from the
+    // same opening every time
+    for (int a = 0; a < players.size(); ++a) {
+        for (int b = a + 1; b < players.size(); ++b) {
+            Pairing pairing;
+            bool    fixed = players[a].kind != RANDOM
+                            && players[b].kind != RANDOM;
+
+            pairing.a         = a;
+            pairing.b         = b;
+            pairing.wins      = 0;
+            pairing.draws     = 0;
+            pairing.losses    = 0;
+            pairing.scheduled = 0;
+            pairing.limit     = fixed ? qMin(int(MAX_GAMES),
+                                             2 * openings.size())
+                                      : int(MAX_GAMES);
+            pairing.llr       = 0;
+            pairing.verdict   = 0;
+            pairings.append(pairing);
+        }
+    }
+
+    out << "# " << rows << "x" << cols << " win " << win_length << ", "
+        << openings.size() << " openings, players";
+    for (int i = 0; i < players.size(); ++i)
+        out << " " << players[i].name;
+    out << "\n";
+
+    QThreadPool pool;
+    QTime       timer;
+
+    if (threads > 0)
+        pool.setMaxThreadCount(threads);
+    timer.start();
+
+    for (int i = 0; i < pool.maxThreadCount(); ++i)
+        pool.start(new Worker(this, quint64(i + 1) << 32));
+    pool.waitForDone();
+
+    elapsed = timer.elapsed();
+    writeRatings();
+    out.flush();
+
+    if (file.error() != QFile::NoError) {
+        error = file_name + ": " + file.errorString();
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// errorString()
+//
+// Returns: Why something failed
+///////////////////////////////////////////////////////////////////////
+QString
+Tournament::errorString() const
+{
+    return error;
+}
+
+///////////////////////////////////////////////////////////////////////
+// next(int *pairing, int *opening)
+//
+// Parameters:  pairing     - Set to the pairing to play
+//              opening     - Set to the opening to play it from
+//
+// Hands out the next pair of games, taking the undecided pairings in
+// turn so they all move along together.
+//
+// Returns: False when there is nothing left to play
+///////////////////////////////////////////////////////////////////////
+bool
+Tournament::next(int *pairing, int *opening)
+{
+    QMutexLocker locker(&mutex);
+
+    for (int i = 0; i < pairings.size(); ++i) {
+        int      index = (next_pairing + i) % pairings.size();
+        Pairing &candidate = pairings[index];
+
+        if (candidate.verdict || candidate.scheduled >= candidate.limit)
+            continue;
+
+        *pairing  = index;
+        *opening  = candidate.scheduled / 2 % openings.size();
+        candidate.scheduled += 2;
+        next_pairing = (index + 1) % pairings.size();
+        return true;
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////
+// finish(int pairing, Board::Cell a_as_x, Board::Cell b_as_x)
+//
+// Parameters:  pairing     - The pairing the games were for
+//              a_as_x      - Who won the game where a played X
+//              b_as_x      - Who won the game where b played X
+//
+// Counts and writes out a pair of games, and sees if the pairing is
+// decided.
+///////////////////////////////////////////////////////////////////////
+void
+Tournament::finish(int pairing, Board::Cell a_as_x, Board::Cell b_as_x)
+{
+    static const char   results[3] = {'d', 'x', 'o'};
+    QMutexLocker        locker(&mutex);
+    Pairing            &p = pairings[pairing];
+
+    out << "g " << p.a << " " << p.b << " " << results[a_as_x] << "\n"
+        << "g " << p.b << " " << p.a << " " << results[b_as_x] << "\n";
+
+    // a won as X, or as O
+    p.wins   += (a_as_x == Board::X) + (b_as_x == Board::O);
+    p.losses += (a_as_x == Board::O) + (b_as_x == Board::X);
+    p.draws  += (a_as_x == Board::EMPTY) + (b_as_x == Board::EMPTY);
+    games    += 2;
+
+    if (!p.verdict)
+        decide(p);
+}
+
+///////////////////////////////////////////////////////////////////////
+// decide(Pairing &pairing)
+//
+// Runs the sequential probability ratio test on a pairing, and writes
+// it out if it is decided. The hypotheses are that the player ahead is
+// ELO1 stronger, or that the two are level; the log likelihood ratio
+// uses the normal approximation, which handles draws, from the mean
+// and variance of the scores so far.
+///////////////////////////////////////////////////////////////////////
+void
+Tournament::decide(Pairing &p)
+{
+    int     played = p.wins + p.draws + p.losses;
+    double  score;
+    double  variance;
+
+    estimate(p.wins, p.draws, p.losses, &score, &variance);
+
+    // Scored for whoever is ahead; a game of nothing but draws has no
+    // variance, and is about as level as can be
+    double  ahead = qMax(score, 1 - score);
+    double  s0    = 0.5;
+    double  s1    = 1 / (1 + pow(10.0, -ELO1 / 400.0));
+
+    p.llr = played * (s1 - s0) * (2 * ahead - s0 - s1)
+            / (2 * qMax(variance, 1e-6));
+
+    if (played < MIN_GAMES && played < p.limit)
+        return;
+
+    if (p.llr >= UPPER_BOUND)
+        p.verdict = "stronger";
+    else if (p.llr <= LOWER_BOUND)
+        p.verdict = "level";
+    else if (played >= p.limit)
+        p.verdict = "limit";
+    else
+        return;
+
+    double  margin = 1.96 * sqrt(variance / played);
+
+    out << "p " << p.a << " " << p.b << " " << p.wins << " " << p.draws
+        << " " << p.losses << " " << qRound(elo(score)) << " "
+        << qRound(elo(score - margin)) << " "
+        << qRound(elo(score + margin)) << " "
+        << QString::number(p.llr, 'f', 2) << " " << p.verdict << "\n";
+    out.flush();
+}
+
+///////////////////////////////////////////////////////////////////////
+// writeRatings()
+//
+// Writes each player's rating against everybody they played
+///////////////////////////////////////////////////////////////////////
+void
+Tournament::writeRatings()
+{
+    for (int i = 0; i < players.size(); ++i) {
+        int     wins   = 0;
+        int     draws  = 0;
+        int     losses = 0;
+        double  score;
+        double  variance;
+
+        for (int j = 0; j < pairings.size(); ++j) {
+            const Pairing &p = pairings[j];
+
+            if (p.a == i) {
+                wins   += p.wins;
+                losses += p.losses;
+            } else if (p.b == i) {
+                wins   += p.losses;
+                losses += p.wins;
+            } else {
+                continue;
+            }
+            draws += p.draws;
+        }
+
+        int     played = wins + draws + losses;
+
+        estimate(wins, draws, losses, &score, &variance);
+
+        double  margin = played > 0 ? 1.96 * sqrt(variance / played) : 0;
+
+        out << "r " << i << " " << played << " " << qRound(elo(score))
+            << " " << qRound(elo(score - margin)) << " "
+            << qRound(elo(score + margin)) << "\n";
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// printReport()
+//
+// Prints each pairing and how it was decided, and how fast it went
+///////////////////////////////////////////////////////////////////////
+void
+Tournament::printReport() const
+{
+    for (int i = 0; i < pairings.size(); ++i) {
+        const Pairing &p = pairings[i];
+        double         score;
+        double         variance;
+
+        estimate(p.wins, p.draws, p.losses, &score, &variance);
+
+        std::cout << qPrintable(players[p.a].name) << " vs "
+                  << qPrintable(players[p.b].name) << ": +" << p.wins
+                  << " =" << p.draws << " -" << p.losses << ", elo "
+                  << qRound(elo(score)) << ", "
+                  << (p.verdict ? p.verdict : "undecided") << "\n";
+    }
+
+    std::cout << "games " << games << " in " << elapsed << " ms, "
+              << games * 1000.0 / qMax(elapsed, 1) << " games/s\n";
+}
+
+///////////////////////////////////////////////////////////////////////
+// elo(double score)
+//
+// Parameters:  score       - Points per game, 0 to 1
+//
+// Returns: The rating difference that score would be expected from,
+// kept within about 1200 either way
+///////////////////////////////////////////////////////////////////////
+double
+Tournament::elo(double score)
+{
+    score = qBound(0.001, score, 0.999);
+    return -400 * log10(1 / score - 1);
+}
+
+///////////////////////////////////////////////////////////////////////
+// estimate(int wins, int draws, int losses, double *score,
+//          double *variance)
+//
+// Parameters:  score       - Set to the mean points per game
+//              variance    - Set to the variance of one game's points
+///////////////////////////////////////////////////////////////////////
+void
+Tournament::estimate(int wins, int draws, int losses, double *score,
+                     double *variance)
+{
+    int played = wins + draws + losses;
+
+    if (played == 0) {
+        *score    = 0.5;
+        *variance = 0;
+        return;
+    }
+
+    double s = (wins + 0.5 * draws) / played;
+
+    *score    = s;
+    *variance = (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s)
+                 + losses * s * s) / played;
+}
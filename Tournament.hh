@@ -0,0 +1,151 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_TOURNAMENT_HH
+#define WF_TOURNAMENT_HH
+
+///////////////////////////////////////////////////////////////////////
+// Tournament.hh
+//
+// This file contains the declarations for the Tournament class, which
+// plays computer players against each other to measure their strength.
+//
+// Results are streamed to a text file as they come in:
+//
+//      # {rows}x{cols} win {length}, {n} openings, players {names}...
+//      g {x} {o} {x|o|d}               a game: who played X and O, by
+//                                      number, and who won
+//      p {a} {b} {wins} {draws} {losses} {elo} {low} {high} {llr} {verdict}
+//                                      a pairing was decided, counted
+//                                      for a against b
+//      r {player} {games} {elo} {low} {high}
+//                                      at the end, each player's
+//                                      rating against the field
+//
+// Elo figures come with 95% confidence bounds.
+///////////////////////////////////////////////////////////////////////
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include "Board.hh"
+#include "GameLog.hh"
+
+///////////////////////////////////////////////////////////////////////
+// Tournament
+//
+// A round robin between players named as:
+//
+//      random          any empty space
+//      greedy          wins if it can, blocks if it must, and otherwise
+//                      takes the space that scores best right away
+//      depth{n}        the computer's search, n plies deep
+//
+// Every game starts from an opening, the first OPENING_PLIES moves of
+// a game from a log or, without a log, every possible pair of first
+// moves. Each opening is played twice per pairing, once with each
+// player as X.
+//
+// Each pairing keeps going until a sequential probability ratio test
+// decides it: either the player ahead is stronger, by about ELO1, or
+// the two are too close to tell apart. Pairings where nobody plays at
+// random can only play so many different games, so they stop once
+// every opening has been played both ways.
+//
+// The games are shared out between threads a pair at a time; each
+// thread has its own searches, and only takes the lock to hand in its
+// results and get more work.
+///////////////////////////////////////////////////////////////////////
+class Tournament
+{
+public:
+    enum {
+        OPENING_PLIES = 2,                      // Moves taken from the log
+        MIN_GAMES     = 20,                     // Before the test may stop
+        MAX_GAMES     = 4000,                   // Per pairing, at most
+        ELO1          = 50,                     // Difference worth finding
+        TABLE_BITS    = 16                      // Per search per thread
+    };
+
+    Tournament(int rows, int cols, int win_length);
+
+    bool        addPlayer(const QString &name);
+    bool        loadOpenings(const QString &file_name);
+    bool        run(const QString &file_name, int threads);
+    QString     errorString() const;
+    void        printReport() const;            // To stdout
+
+private:
+    class Worker;
+
+    enum Kind {RANDOM, GREEDY, SEARCH};
+
+    struct Player
+    {
+        QString     name;
+        Kind        kind;
+        int         depth;
+    };
+
+    // Counted for player a against player b
+    struct Pairing
+    {
+        int         a;
+        int         b;
+        int         wins;
+        int         draws;
+        int         losses;
+        int         scheduled;                  // Games handed out
+        int         limit;                      // Games it may play
+        double      llr;
+        const char *verdict;                    // 0 while undecided
+    };
+
+    void        makeOpenings();
+    bool        next(int *pairing, int *opening);
+    void        finish(int pairing, Board::Cell a_as_x, Board::Cell b_as_x);
+    void        decide(Pairing &pairing);
+    void        writeRatings();
+
+    static double   elo(double score);
+    static void     estimate(int wins, int draws, int losses, double *score,
+                             double *variance);
+
+    int                     rows;
+    int                     cols;
+    int                     win_length;
+    QVector<Player>         players;
+    QVector< QVector<Move> > openings;
+    QVector<Pairing>        pairings;
+    int                     next_pairing;       // Where to look for work
+    int                     games;
+    int                     elapsed;            // Milliseconds
+
+    QMutex                  mutex;              // For the above and out
+    QFile                   file;
+    QTextStream             out;
+    QString                 error;
+};
+
+#endif
@@ -0,0 +1,278 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QDataStream>
+#include <QFile>
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+#include <QtEndian>
+#include <string.h>
+
+#include "TrainingData.hh"
+
+static const char TRAINING_MAGIC[8] = {'X', 'S', 'N', 'O', 'S', 'C', 'L', '1'};
+
+static const char *column_names[TrainingData::COLUMN_COUNT] = {
+    "rank", "cells", "to_move", "value", "moves"
+};
+
+enum {
+    HEADER_SIZE = 8 + 4 * 4 + 8 + 4,            // Up to the columns
+    ENTRY_SIZE  = 16 + 4 + 4 + 8                // Each column's entry
+};
+
+///////////////////////////////////////////////////////////////////////
+// width(Column column, int cells)
+//
+// Parameters:  column      - Which column
+//              cells       - Cells on the board
+//
+// Returns: Bytes each position takes in the column
+///////////////////////////////////////////////////////////////////////
+int
+TrainingData::width(Column column, int cells)
+{
+    switch (column) {
+    case RANK:      return 8;
+    case CELLS:     return cells;
+    case MOVES:     return 2 * cells;
+    default:        return 1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// write(const Solver &solver, const QString &file_name, int threads,
+//       QString *error)
+//
+// Parameters:  solver      - A Solver that has finished solve()
+//              file_name   - Where to save the positions
+//              threads     - How many to use, 0 for one per core
+//              *error      - Set to the reason if writing fails
+//
+// Returns: True if every position was written
+///////////////////////////////////////////////////////////////////////
+bool
+TrainingData::write(const Solver &solver, const QString &file_name,
+                    int threads, QString *error)
+{
+    const std::vector<unsigned char> &table = solver.getTable();
+    uint64_t                          ranks = table.size();
+    int                               cells = solver.getRows()
+                                              * solver.getCols();
+    QVector<quint64>                  chunk_rows;
+    quint64                           positions = 0;
+    QFile                             out(file_name);
+
+    if (ranks == 0) {
+        if (error)
+            *error = QObject::tr("Nothing has been solved");
+        return false;
+    }
+
+    // Count each chunk's positions, so every chunk knows its first row
+    for (uint64_t first = 0; first < ranks; first += CHUNK_RANKS) {
+        uint64_t end   = qMin<uint64_t>(first + CHUNK_RANKS, ranks);
+        quint64  count = 0;
+
+        for (uint64_t rank = first; rank < end; ++rank)
+            count += table[rank] != 0;
+        chunk_rows.append(count);
+        positions += count;
+    }
+
+    quint64 offsets[COLUMN_COUNT];
+    quint64 offset = HEADER_SIZE + COLUMN_COUNT * ENTRY_SIZE;
+
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        offset     = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        offsets[c] = offset;
+        offset    += positions * width(Column(c), cells);
+    }
+
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || !out.resize(offset)) {
+        if (error)
+            *error = out.errorString();
+        return false;
+    }
+
+    QDataStream stream(&out);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    stream.writeRawData(TRAINING_MAGIC, sizeof(TRAINING_MAGIC));
+    stream << quint32(solver.getRows()) << quint32(solver.getCols())
+           << quint32(solver.getWinLength()) << quint32(solver.getRules())
+           << quint64(positions) << quint32(COLUMN_COUNT);
+
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        char name[16];
+
+        memset(name, 0, sizeof(name));
+        strncpy(name, column_names[c], sizeof(name) - 1);
+        stream.writeRawData(name, sizeof(name));
+        stream << quint32(width(Column(c), cells)) << quint32(0)
+               << offsets[c];
+    }
+
+    if (stream.status() != QDataStream::Ok || !out.flush()) {
+        if (error)
+            *error = out.errorString();
+        return false;
+    }
+    out.close();
+
+    // Fill in the columns
+    QThreadPool pool;
+    QAtomicInt  failures;
+    quint64     row = 0;
+
+    if (threads > 0)
+        pool.setMaxThreadCount(threads);
+
+    for (int i = 0; i < chunk_rows.size(); ++i) {
+        uint64_t first = uint64_t(i) * CHUNK_RANKS;
+        uint64_t end   = qMin<uint64_t>(first + CHUNK_RANKS, ranks);
+
+        if (chunk_rows[i] > 0)
+            pool.start(new TrainingData(solver, file_name, offsets, first,
+                                        end, row, chunk_rows[i],
+                                        &failures));
+        row += chunk_rows[i];
+    }
+    pool.waitForDone();
+
+    if (failures != 0) {
+        if (error)
+            *error = QObject::tr("%1 chunks could not be written")
+                     .arg(int(failures));
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// TrainingData(const Solver &solver, const QString &file_name,
+//              const quint64 *offsets, uint64_t first_rank,
+//              uint64_t end_rank, quint64 first_row, quint64 row_count,
+//              QAtomicInt *failures)
+//
+// Parameters:  solver      - The solved board
+//              file_name   - The file write() laid out
+//              offsets     - Where each column starts
+//              first_rank  - The chunk's ranks,
+//              end_rank      first_rank up to but not including end_rank
+//              first_row   - Where its positions go in the columns
+//              row_count   - How many positions it has
+//              failures    - Counted up if it can not be written
+//
+// Constructor
+///////////////////////////////////////////////////////////////////////
+TrainingData::TrainingData(const Solver &solver, const QString &file_name,
+                           const quint64 *offsets, uint64_t first_rank,
+                           uint64_t end_rank, quint64 first_row,
+                           quint64 row_count, QAtomicInt *failures) :
+    solver(solver),
+    file_name(file_name),
+    offsets(offsets),
+    first_rank(first_rank),
+    end_rank(end_rank),
+    first_row(first_row),
+    row_count(row_count),
+    failures(failures)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// run()
+//
+// Builds the chunk's part of every column and writes each into place.
+///////////////////////////////////////////////////////////////////////
+void
+TrainingData::run()
+{
+    const std::vector<unsigned char> &table = solver.getTable();
+    Board       board(solver.getRows(), solver.getCols(),
+                      solver.getWinLength());
+    int         cells = board.getCellCount();
+    QByteArray  columns[COLUMN_COUNT];
+    uchar      *data[COLUMN_COUNT];
+
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        columns[c].fill(0, int(row_count * width(Column(c), cells)));
+        data[c] = reinterpret_cast<uchar *>(columns[c].data());
+    }
+
+    for (uint64_t rank = first_rank; rank < end_rank; ++rank) {
+        unsigned char entry = table[rank];
+
+        if (entry == 0)
+            continue;
+
+        // Put the position on the board, digit i being cell i
+        uint64_t digits = rank;
+
+        board.clear();
+        for (int i = 0; i < cells; ++i, digits /= 3) {
+            data[CELLS][i] = uchar(digits % 3);
+            if (digits % 3 != 0)
+                board.place(i, Board::Cell(digits % 3));
+        }
+
+        Board::Cell player = Rules::toMove(solver.getRules(), board);
+
+        qToLittleEndian<quint64>(rank, data[RANK]);
+        *data[TO_MOVE] = uchar(player);
+        *data[VALUE]   = entry;
+
+        // Positions that are over have no moves
+        if (Solver::distanceOf(entry) > 0) {
+            Board::Cell pieces[2];
+            int         kinds = Rules::pieces(solver.getRules(), player,
+                                              pieces);
+
+            for (int i = 0; i < cells; ++i) {
+                if (board.getCell(i) != Board::EMPTY)
+                    continue;
+
+                for (int k = 0; k < kinds; ++k) {
+                    board.place(i, pieces[k]);
+                    data[MOVES][2 * i + pieces[k] - Board::X] =
+                        Solver::childToParent(solver.lookup(board));
+                    board.remove(i);
+                }
+            }
+        }
+
+        for (int c = 0; c < COLUMN_COUNT; ++c)
+            data[c] += width(Column(c), cells);
+    }
+
+    QFile out(file_name);
+    bool  ok = out.open(QIODevice::ReadWrite);
+
+    for (int c = 0; ok && c < COLUMN_COUNT; ++c) {
+        ok = out.seek(offsets[c] + first_row * width(Column(c), cells))
+             && out.write(columns[c]) == columns[c].size();
+    }
+
+    if (!ok)
+        failures->ref();
+}
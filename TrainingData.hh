@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_TRAININGDATA_HH
+#define WF_TRAININGDATA_HH
+
+///////////////////////////////////////////////////////////////////////
+// TrainingData.hh
+//
+// This file contains the declarations for the TrainingData class,
+// which writes every position of a solved board to a file laid out a
+// column at a time, for loading straight into training tools.
+//
+// The file is laid out as:
+//
+//      "XSNOSCL1"                  magic
+//      quint32 rows, cols, win_length, rules
+//      quint64 positions
+//      quint32 column_count
+//      columns[column_count]       char name[16], quint32 width,
+//                                  quint32 0, quint64 offset
+//      column data                 each column is positions * width
+//                                  bytes starting at its offset, which
+//                                  is a multiple of 64
+//
+// The columns, all one row per position, are:
+//
+//      rank        8 bytes         Board::canonicalRank(), cell i is
+//                                  digit i in base 3
+//      cells       rows * cols     0 empty, 1 X, 2 O, row by row
+//      to_move     1               1 for X, 2 for O
+//      value       1               The Solver entry for the position
+//      moves       2 * rows * cols The Solver entry, for the player to
+//                                  move, of putting an X (2i) or an O
+//                                  (2i + 1) on cell i, or 0 where the
+//                                  rules do not allow it
+//
+// Only canonical positions are written, one for each set of rotations
+// and reflections. All numbers are little endian.
+///////////////////////////////////////////////////////////////////////
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QString>
+#include <stdint.h>
+
+#include "Solver.hh"
+
+///////////////////////////////////////////////////////////////////////
+// TrainingData
+//
+// Writes the file. The positions are cut into chunks of CHUNK_RANKS
+// ranks, and a count of each chunk's positions says where its rows go
+// in every column, so the chunks can be filled in on a QThreadPool and
+// written straight into place in any order. Memory beyond the Solver's
+// table is a chunk per thread.
+///////////////////////////////////////////////////////////////////////
+class TrainingData : public QRunnable
+{
+public:
+    enum {
+        CHUNK_RANKS = 1 << 18,                  // Ranks per chunk
+        ALIGNMENT   = 64                        // Of each column
+    };
+
+    enum Column {RANK, CELLS, TO_MOVE, VALUE, MOVES, COLUMN_COUNT};
+
+    static bool     write(const Solver &solver, const QString &file_name,
+                          int threads = 0, QString *error = 0);
+    static int      width(Column column, int cells);
+
+    void            run();
+
+private:
+    TrainingData(const Solver &solver, const QString &file_name,
+                 const quint64 *offsets, uint64_t first_rank,
+                 uint64_t end_rank, quint64 first_row, quint64 row_count,
+                 QAtomicInt *failures);
+
+    const Solver   &solver;
+    QString         file_name;
+    const quint64  *offsets;                    // Of each column
+    uint64_t        first_rank;
+    uint64_t        end_rank;
+    quint64         first_row;                  // Of the chunk's positions
+    quint64         row_count;
+    QAtomicInt     *failures;                   // Chunks not written
+};
+
+#endif
@@ -0,0 +1,362 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#include <QAbstractEventDispatcher>
+#include <QFile>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Watchdog.hh"
+
+// Filled in by the signal handler, so nothing here may need a lock
+static void                 *sample_frames[Watchdog::MAX_FRAMES];
+static volatile sig_atomic_t sample_depth = 0;
+static volatile sig_atomic_t sample_state = 0;  // 0 idle, 1 wanted, 2 taken
+
+///////////////////////////////////////////////////////////////////////
+// demangle(const char *symbol)
+//
+// Parameters:  symbol      - A line from backtrace_symbols()
+//
+// Returns: The line with the function name made readable, if it could
+// be
+///////////////////////////////////////////////////////////////////////
+static QString
+demangle(const char *symbol)
+{
+    const char *open = strchr(symbol, '(');
+    const char *plus = open ? strchr(open, '+') : 0;
+
+    if (!open || !plus || plus == open + 1)
+        return symbol;
+
+    std::string name(open + 1, plus);
+    int         status;
+    char       *readable = abi::__cxa_demangle(name.c_str(), 0, 0, &status);
+    QString     line;
+
+    if (status != 0)
+        return symbol;
+
+    line = QString::fromLatin1(symbol, open + 1 - symbol) + readable + plus;
+    free(readable);
+    return line;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Watchdog(const QString &file_name, int threshold, QObject *parent)
+//
+// Parameters:  file_name   - Where to write the report
+//              threshold   - Milliseconds busy that count as a stall
+//              parent      - Parent object
+//
+// Constructor. Nothing is watched until watch() is called.
+///////////////////////////////////////////////////////////////////////
+Watchdog::Watchdog(const QString &file_name, int threshold,
+                   QObject *parent) :
+    QThread(parent),
+    file_name(file_name),
+    threshold(quint32(qMax(threshold, 1)) * 1000),
+    gui_thread(pthread_self()),
+    busy_since(0),
+    last_stall(0),
+    sampled_since(0),
+    started(QDateTime::currentDateTime()),
+    quitting(false)
+{
+    for (int i = 0; i < BUCKETS; ++i)
+        histogram[i] = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// ~Watchdog()
+//
+// Destructor. Stops the watchdog's thread.
+///////////////////////////////////////////////////////////////////////
+Watchdog::~Watchdog()
+{
+    mutex.lock();
+    quitting = true;
+    quit.wakeOne();
+    mutex.unlock();
+
+    wait();
+}
+
+///////////////////////////////////////////////////////////////////////
+// watch()
+//
+// Starts watching the event loop of the thread this is called on,
+// which should be the GUI thread, once its QApplication exists.
+///////////////////////////////////////////////////////////////////////
+void
+Watchdog::watch()
+{
+    QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance();
+    struct sigaction          action;
+    void                     *frames[1];
+
+    // The first backtrace() loads libgcc, which must not happen in the
+    // signal handler
+    backtrace(frames, 1);
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sample;
+    action.sa_flags   = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, 0);
+
+    gui_thread = pthread_self();
+    connect(dispatcher, SIGNAL(awake()), this, SLOT(awake()),
+            Qt::DirectConnection);
+    connect(dispatcher, SIGNAL(aboutToBlock()), this, SLOT(aboutToBlock()),
+            Qt::DirectConnection);
+
+    start();
+}
+
+///////////////////////////////////////////////////////////////////////
+// awake()
+//
+// The GUI thread has events to handle. Called on the GUI thread.
+///////////////////////////////////////////////////////////////////////
+void
+Watchdog::awake()
+{
+    busy_since = int(now() | 1);
+}
+
+///////////////////////////////////////////////////////////////////////
+// aboutToBlock()
+//
+// The GUI thread is done and about to wait for more. Called on the GUI
+// thread.
+///////////////////////////////////////////////////////////////////////
+void
+Watchdog::aboutToBlock()
+{
+    quint32 since = quint32(int(busy_since));
+    quint32 took  = now() - since;
+
+    busy_since = 0;
+    if (since != 0 && took >= threshold)
+        last_stall = int(took);
+}
+
+///////////////////////////////////////////////////////////////////////
+// sample(int signal_number)
+//
+// The SIGPROF handler. Runs on the GUI thread in the middle of whatever
+// it was doing, and only copies the stack if the watchdog asked for it.
+///////////////////////////////////////////////////////////////////////
+void
+Watchdog::sample(int /*signal_number*/)
+{
+    if (sample_state == 1) {
+        sample_depth = backtrace(sample_frames, MAX_FRAMES);
+        sample_state = 2;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// now()
+//
+// Returns: Microseconds on the monotonic clock, wrapping every hour or
+// so, which is fine for differences
+///////////////////////////////////////////////////////////////////////
+quint32
+Watchdog::now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return quint32(quint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+}
+
+///////////////////////////////////////////////////////////////////////
+// run()
+//
+// The watchdog's thread. Looks four times per threshold for a stall
+// that ended, or one that has gone on too long.
+///////////////////////////////////////////////////////////////////////
+void
+Watchdog::run()
+{
+    QMutexLocker locker(&mutex);
+
+    while (!quitting) {
+        quit.wait(&mutex, qMax(1u, threshold / 4000));
+        if (quitting)
+            break;
+        locker.unlock();
+
+        int took = last_stall.fetchAndStoreOrdered(0);
+
+        if (took != 0) {
+            record(took / 1000, sampled_stack);
+            sampled_since = 0;
+            sampled_stack.clear();
+            writeReport(0);
+        }
+
+        quint32 since = quint32(int(busy_since));
+
+        if (since != 0 && int(since) != sampled_since
+                && now() - since >= threshold) {
+            Stall ongoing;
+
+            sampled_since  = int(since);
+            sampled_stack  = takeSample();
+            ongoing.msecs  = (now() - since) / 1000;
+            ongoing.when   = QDateTime::currentDateTime();
+            ongoing.stack  = sampled_stack;
+            writeReport(&ongoing);
+        }
+
+        locker.relock();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// takeSample()
+//
+// Returns: The GUI thread's stack, innermost first, or nothing if it
+// did not answer the signal in time
+///////////////////////////////////////////////////////////////////////
+QStringList
+Watchdog::takeSample()
+{
+    QStringList stack;
+
+    sample_state = 1;
+    pthread_kill(gui_thread, SIGPROF);
+
+    for (int i = 0; i < 50 && sample_state != 2; ++i)
+        msleep(1);
+
+    if (sample_state == 2) {
+        char **symbols = backtrace_symbols(sample_frames, sample_depth);
+
+        // The first two frames are the handler and the signal trampoline
+        for (int i = 2; symbols && i < sample_depth; ++i)
+            stack << demangle(symbols[i]);
+        free(symbols);
+    }
+
+    sample_state = 0;
+    return stack;
+}
+
+///////////////////////////////////////////////////////////////////////
+// record(int msecs, const QStringList &stack)
+//
+// Parameters:  msecs       - How long a stall lasted
+//              stack       - Where the GUI thread was, if it was caught
+//
+// Adds a stall to the histogram, whose buckets each cover twice the
+// time of the one before, and to the worst stalls if it is one
+///////////////////////////////////////////////////////////////////////
+void
+Watchdog::record(int msecs, const QStringList &stack)
+{
+    int   bucket = 0;
+    int   limit  = threshold / 1000 * 2;
+    Stall stall;
+
+    while (msecs >= limit && bucket < BUCKETS - 1) {
+        bucket++;
+        limit *= 2;
+    }
+    histogram[bucket]++;
+
+    stall.msecs = msecs;
+    stall.when  = QDateTime::currentDateTime();
+    stall.stack = stack;
+
+    int i = 0;
+
+    while (i < worst.size() && worst[i].msecs >= msecs)
+        i++;
+    if (i < WORST)
+        worst.insert(i, stall);
+    while (worst.size() > WORST)
+        worst.removeLast();
+}
+
+///////////////////////////////////////////////////////////////////////
+// writeReport(const Stall *ongoing)
+//
+// Parameters:  ongoing     - A stall still going on, or 0
+//
+// Writes the histogram and the worst stalls over the report file. A
+// stall that is still going on is written too, in case it never ends.
+///////////////////////////////////////////////////////////////////////
+void
+Watchdog::writeReport(const Stall *ongoing)
+{
+    QFile file(file_name);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate
+                   | QIODevice::Text))
+        return;
+
+    QTextStream out(&file);
+    int         lowest = threshold / 1000;
+    int         total  = 0;
+
+    for (int i = 0; i < BUCKETS; ++i)
+        total += histogram[i];
+
+    out << "Stalls of " << lowest << " ms or more since "
+        << started.toString(Qt::ISODate) << ": " << total << "\n\n";
+
+    for (int i = 0; i < BUCKETS; ++i) {
+        int from = lowest << i;
+
+        if (i < BUCKETS - 1)
+            out << QString("%1 - %2 ms").arg(from, 7).arg(from * 2 - 1, 7);
+        else
+            out << QString("%1 ms and up  ").arg(from, 7);
+        out << QString("%1").arg(histogram[i], 8) << "\n";
+    }
+
+    if (ongoing) {
+        out << "\nStalled for " << ongoing->msecs << " ms so far at "
+            << ongoing->when.toString(Qt::ISODate) << "\n";
+        for (int i = 0; i < ongoing->stack.size(); ++i)
+            out << "    " << ongoing->stack[i] << "\n";
+    }
+
+    out << "\nWorst stalls:\n";
+    for (int i = 0; i < worst.size(); ++i) {
+        out << "\n" << worst[i].msecs << " ms at "
+            << worst[i].when.toString(Qt::ISODate) << "\n";
+        if (worst[i].stack.isEmpty())
+            out << "    (stack not caught)\n";
+        for (int j = 0; j < worst[i].stack.size(); ++j)
+            out << "    " << worst[i].stack[j] << "\n";
+    }
+}
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////
+// Copyright © 2010 Thomas Schreiber <ubiquill@gmail.com>
+//
+// This file is part of xsnos.
+//
+// Xsnos is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// Xsnos is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with xsnos.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////
+
+
+#ifndef WF_WATCHDOG_HH
+#define WF_WATCHDOG_HH
+
+///////////////////////////////////////////////////////////////////////
+// Watchdog.hh
+//
+// This file contains the declarations for the Watchdog class, which
+// catches the GUI thread when it stops answering.
+///////////////////////////////////////////////////////////////////////
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+#include <pthread.h>
+
+///////////////////////////////////////////////////////////////////////
+// Watchdog
+//
+// Watches the GUI thread's event loop for stalls: times when it was
+// busy for longer than the threshold without going back to waiting
+// for events. The event dispatcher says when the loop wakes up and
+// when it is about to wait again, and all the GUI thread does is note
+// the time at each, so nothing is slowed down while all is well.
+//
+// The watchdog's own thread looks at those times a few times per
+// threshold. Once a stall has gone on too long it sends the GUI thread
+// SIGPROF, whose handler only copies the stack into a buffer set aside
+// for it. When the stall ends it is added to a histogram, and the worst
+// ones are kept with their stacks. Both are written to the report file
+// after every stall, from the watchdog's thread.
+///////////////////////////////////////////////////////////////////////
+class Watchdog : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum {
+        MAX_FRAMES  = 48,                       // Stack depth kept
+        WORST       = 10,                       // Stalls kept in full
+        BUCKETS     = 9                         // Histogram, doubling
+    };
+
+    Watchdog(const QString &file_name, int threshold = 100,
+             QObject *parent = 0);
+    ~Watchdog();
+
+    void        watch();                        // Call on the GUI thread
+
+protected:
+    void        run();
+
+private slots:
+    void        awake();
+    void        aboutToBlock();
+
+private:
+    // One stall, with where the GUI thread was when it was caught
+    struct Stall
+    {
+        int         msecs;
+        QDateTime   when;
+        QStringList stack;
+    };
+
+    static void         sample(int signal_number);
+    static quint32      now();
+    QStringList         takeSample();
+    void                record(int msecs, const QStringList &stack);
+    void                writeReport(const Stall *ongoing);
+
+    QString             file_name;
+    quint32             threshold;              // Microseconds
+    pthread_t           gui_thread;
+
+    // Written by the GUI thread. Times are microseconds, odd so that
+    // zero can mean the loop is waiting.
+    QAtomicInt          busy_since;
+    QAtomicInt          last_stall;             // Length, 0 when read
+
+    // Only touched on the watchdog's thread
+    int                 histogram[BUCKETS];
+    QList<Stall>        worst;
+    int                 sampled_since;          // Stall the stack is for
+    QStringList         sampled_stack;
+    QDateTime           started;
+
+    QMutex              mutex;
+    QWaitCondition      quit;
+    bool                quitting;
+};
+
+#endif
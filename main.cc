@@ -20,21 +20,222 @@
 ///////////////////////////////////////////////////////////////////////
 // main.cc
 //
-// This is the driver for xsnos. Not much to see here.
+// This is the driver for xsnos. Not much to see here. If the first
+// argument names one of the tools in Commands.cc that is run instead
+// of the game.
+//
+// Game options:
+//      --size {rows}x{cols}    Play on a bigger board
+//      --win {length}          How many in a row wins
+//      --cell-size {pixels}    Draw bigger spaces, for big screens
+//      --scale-times           Report how long each change of size takes
+//      --computer {x|o}        Let the computer play one side
+//      --think {msecs}         Time the computer gets per move
+//      --network {file}        Weights for the computer's evaluation
+//      --tablebase {file}      Show what each position is worth
+//      --rules {name}          standard, misere, wild, notakto, or gravity
+//      --journal {file}        Keep the game safe from power cuts
+//      --themes {directory}    Choose among the theme packs there
+//      --theme {name}          The pack to start with
+//      --record-input {file}   Save the drag and drop input for replay
+//      --watchdog {file}       Report event loop stalls to a file
+//      --stall {msecs}         How long counts as a stall, default 100
+//      --count-allocations     Report heap allocations per move and game
+//      --frame-times           Report animation frame times on exit
+//      --script                Play the commands on stdin, see Script.hh
 ///////////////////////////////////////////////////////////////////////
 
 #include <QApplication>
+#include <QStringList>
+#include <QTime>
+#include <iostream>
 
+#include "AllocCount.hh"
+#include "AnimationClock.hh"
+#include "Commands.hh"
+#include "InputLog.hh"
+#include "Journal.hh"
 #include "MainWindow.hh"
+#include "Network.hh"
+#include "Script.hh"
+#include "Tablebase.hh"
+#include "Theme.hh"
+#include "Watchdog.hh"
+
+///////////////////////////////////////////////////////////////////////
+// optionValue(const QStringList &args, const QString &name)
+//
+// Parameters:  args        - The command line
+//              name        - An option that takes a value
+//
+// Returns: The value given after the option, or an empty string
+///////////////////////////////////////////////////////////////////////
+static QString
+optionValue(const QStringList &args, const QString &name)
+{
+    int index = args.indexOf(name);
+
+    if (index < 0 || index + 1 >= args.size())
+        return QString();
+    return args[index + 1];
+}
 
 int
 main(int argc, char **argv)
 {
+    QStringList args;
+
+    for (int i = 1; i < argc; ++i)
+        args << QString::fromLocal8Bit(argv[i]);
+
+    if (isCommand(args)) {
+        if (needsWidgets(args)) {
+            QApplication app(argc, argv);
+            return runCommand(args);
+        }
+        QCoreApplication app(argc, argv);
+        return runCommand(args);
+    }
+
+    // Turned on before anything else, so the hooks never see a thread
+    // change its mind halfway through an allocation
+    if (args.contains("--count-allocations"))
+        AllocCount::enable();
+
     QApplication app(argc,argv);
+    Tablebase    tablebase;
+    Network      network;
+    Journal      journal;
+    InputRecorder recorder;
+    Rules::Set   rules      = Rules::STANDARD;
+    QStringList  size       = optionValue(args, "--size").split('x');
+    int          rows       = 3;
+    int          cols       = 3;
+    int          win_length = 3;
+
+    if (!optionValue(args, "--rules").isEmpty()
+            && !Rules::fromName(optionValue(args, "--rules").toStdString(),
+                                &rules)) {
+        std::cerr << "unknown rules: "
+                  << qPrintable(optionValue(args, "--rules")) << "\n";
+        rules = Rules::STANDARD;
+    }
+
+    // Gravity is Connect Four unless told otherwise
+    if (rules == Rules::GRAVITY) {
+        rows       = 6;
+        cols       = 7;
+        win_length = 4;
+    }
+
+    // A bigger board wants longer lines, but gravity stays four in a row
+    if (size.size() == 2 && size[0].toInt() > 0 && size[1].toInt() > 0) {
+        rows = qMin(size[0].toInt(), 16);
+        cols = qMin(size[1].toInt(), 16);
+        if (rules != Rules::GRAVITY)
+            win_length = qMin(qMax(rows, cols), 5);
+    }
+    if (optionValue(args, "--win").toInt() > 0)
+        win_length = optionValue(args, "--win").toInt();
+    win_length = qMin(win_length, qMax(rows, cols));
+
+    MainWindow window(rows, cols, win_length);
+
+    window.setScaleTimes(args.contains("--scale-times"));
+    if (optionValue(args, "--cell-size").toInt() > 0)
+        window.setCellSize(optionValue(args, "--cell-size").toInt());
+
+    window.setRules(rules);
+
+    if (!optionValue(args, "--tablebase").isEmpty()) {
+        if (tablebase.open(optionValue(args, "--tablebase")))
+            window.setTablebase(&tablebase);
+        else
+            std::cerr << qPrintable(tablebase.errorString()) << "\n";
+    }
+
+    if (!optionValue(args, "--think").isEmpty())
+        window.setThinkingTime(optionValue(args, "--think").toInt());
+
+    if (!optionValue(args, "--network").isEmpty()) {
+        QString     file = optionValue(args, "--network");
+        std::string error;
+
+        if (network.load(file.toLocal8Bit().constData(), &error))
+            window.setNetwork(&network);
+        else
+            std::cerr << error << "\n";
+    }
+
+    QString computer = optionValue(args, "--computer").toLower();
+    if (!computer.isEmpty() && rules != Rules::STANDARD
+            && rules != Rules::GRAVITY)
+        std::cerr << "the computer only plays the standard and gravity"
+                     " rules\n";
+    if (computer == "x")
+        window.setComputer(Board::X);
+    else if (computer == "o")
+        window.setComputer(Board::O);
 
-    MainWindow window;
     window.newGame();
-    window.show();
 
-    return app.exec();
+    // Theme packs are decoded on their own thread, so the window can be
+    // shown while the first one is still on its way
+    Theme *theme = 0;
+
+    if (!optionValue(args, "--themes").isEmpty()) {
+        theme = new Theme(optionValue(args, "--themes"), &app);
+        window.setTheme(theme, optionValue(args, "--theme"));
+    }
+
+    if (!optionValue(args, "--journal").isEmpty()) {
+        QTime timer;
+
+        timer.start();
+        if (journal.open(optionValue(args, "--journal"), rows, cols,
+                         win_length, rules)) {
+            window.setJournal(&journal);
+            std::cerr << "journal: restored " << journal.getGame().size()
+                      << " moves in " << timer.elapsed() << " ms\n";
+        } else {
+            std::cerr << qPrintable(journal.errorString()) << "\n";
+        }
+    }
+
+    if (!optionValue(args, "--record-input").isEmpty()) {
+        if (recorder.open(optionValue(args, "--record-input"), rows, cols,
+                          win_length, rules))
+            recorder.watch(&window);
+        else
+            std::cerr << qPrintable(recorder.errorString()) << "\n";
+    }
+
+    // Catch the GUI freezing, from before the window is even shown
+    Watchdog *watchdog = 0;
+
+    if (!optionValue(args, "--watchdog").isEmpty()) {
+        int threshold = optionValue(args, "--stall").toInt();
+
+        watchdog = new Watchdog(optionValue(args, "--watchdog"),
+                                threshold > 0 ? threshold : 100);
+        watchdog->watch();
+    }
+
+    // A script plays without showing the window, so nothing is painted
+    Script script(&window);
+
+    if (args.contains("--script")) {
+        window.setInteractive(false);
+        script.start();
+    } else {
+        window.show();
+    }
+
+    int result = app.exec();
+
+    if (args.contains("--frame-times"))
+        AnimationClock::instance()->printReport();
+
+    delete watchdog;
+    return result;
 }
@@ -21,6 +21,29 @@ DEPENDPATH += .
 INCLUDEPATH += .
 
 # Input
-HEADERS += GameSpace.hh MainWindow.hh PiecesList.hh
-SOURCES += GameSpace.cc main.cc MainWindow.cc PiecesList.cc
+HEADERS += AllocCount.hh AnimationClock.hh Artwork.hh Board.hh \
+           Commands.hh GameIndex.hh GameLog.hh GameSpace.hh \
+           GravityBoard.hh GravitySearch.hh Hinter.hh InputLog.hh \
+           LiveStats.hh Journal.hh MainWindow.hh MoveQueue.hh Network.hh \
+           PiecesList.hh Ponderer.hh ReplayViewer.hh Rules.hh Script.hh \
+           Search.hh SelfPlay.hh Solver.hh Tablebase.hh Theme.hh \
+           ThreatSearch.hh Thumbnail.hh Tournament.hh TrainingData.hh \
+           Watchdog.hh
+SOURCES += AllocCount.cc AnimationClock.cc Artwork.cc Board.cc \
+           Commands.cc GameIndex.cc GameLog.cc GameSpace.cc \
+           GravityBoard.cc GravitySearch.cc Hinter.cc InputLog.cc \
+           LiveStats.cc Journal.cc main.cc MainWindow.cc MoveQueue.cc \
+           Network.cc PiecesList.cc Ponderer.cc ReplayViewer.cc Rules.cc \
+           Script.cc Search.cc SelfPlay.cc Solver.cc Tablebase.cc \
+           Theme.cc ThreatSearch.cc Thumbnail.cc Tournament.cc \
+           TrainingData.cc Watchdog.cc
 RESOURCES += xsnos.qrc
+
+# The live stats are served on a local socket
+QT += network
+
+# The search's clock uses clock_gettime()
+unix:LIBS += -lrt
+
+# So the watchdog's stack samples name our own functions
+unix:QMAKE_LFLAGS += -rdynamic